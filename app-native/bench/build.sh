@@ -0,0 +1,69 @@
+#!/bin/bash
+# Build the keystroke latency benchmark against the Rust core staticlib, the
+# headless pipeline simulation against the core shared library and the
+# vikey-convert batch converter (Linux)
+# Usage: ./build.sh [--run [bench args...] | --sim [pipeline_sim args...]]
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/../.." && pwd)"
+CORE_DIR="$PROJECT_ROOT/core"
+BUILD_DIR="$SCRIPT_DIR/build"
+CXX="${CXX:-g++}"
+
+echo "Building ViKey core (release staticlib + shared library)..."
+(cd "$CORE_DIR" && cargo build --release --lib)
+
+CORE_LIB="${CORE_LIB:-$CORE_DIR/target/release/libvikey_core.a}"
+if [ ! -f "$CORE_LIB" ]; then
+    echo "Error: $CORE_LIB not found"
+    exit 1
+fi
+
+mkdir -p "$BUILD_DIR"
+echo "Building key_latency_bench..."
+"$CXX" -std=c++17 -O2 -Wall \
+    -DVIKEY_BENCH_CORPUS_DIR="\"$SCRIPT_DIR/corpora\"" \
+    "$SCRIPT_DIR/key_latency_bench.cpp" "$CORE_LIB" \
+    -lpthread -ldl -o "$BUILD_DIR/key_latency_bench"
+echo "Output: $BUILD_DIR/key_latency_bench"
+
+# Pipeline simulation: app sources on SimPlatform, core loaded like core.dll
+# (libvikey_core.so next to the executable)
+SRC_DIR="$PROJECT_ROOT/app-native/src"
+SIM_SOURCES=(
+    platform.cpp platform_sim.cpp keyboard_hook.cpp keycodes.cpp text_sender.cpp
+    output_worker.cpp latency_histogram.cpp hook_watchdog.cpp encoding_converter.cpp rust_bridge.cpp ime_processor.cpp app_detector.cpp
+    foreground_tracker.cpp app_rules.cpp settings.cpp shortcut_manager.cpp injection_pacer.cpp clipboard_paste.cpp pending_edit.cpp encoding_stream.cpp
+    selection_convert.cpp text_transform.cpp utf8_codec.cpp
+)
+# ICU, if installed, is the reference the normalization tables are checked
+# and timed against
+SIM_ICU=()
+if pkg-config --exists icu-uc 2>/dev/null; then
+    SIM_ICU=(-DVIKEY_BENCH_ICU $(pkg-config --cflags --libs icu-uc))
+fi
+echo "Building pipeline_sim..."
+cp "$(dirname "$CORE_LIB")/libvikey_core.so" "$BUILD_DIR/"
+"$CXX" -std=c++17 -O2 -Wall -I"$SRC_DIR" \
+    -DVIKEY_BENCH_CORPUS_DIR="\"$SCRIPT_DIR/corpora\"" \
+    "$SCRIPT_DIR/pipeline_sim.cpp" "${SIM_SOURCES[@]/#/$SRC_DIR/}" \
+    "${SIM_ICU[@]}" -lpthread -ldl -o "$BUILD_DIR/pipeline_sim"
+echo "Output: $BUILD_DIR/pipeline_sim"
+
+# Batch file converter: portable converter sources only, no core
+CONVERT_SOURCES=(encoding_converter.cpp encoding_stream.cpp text_transform.cpp utf8_codec.cpp)
+echo "Building vikey-convert..."
+"$CXX" -std=c++17 -O2 -Wall -I"$SRC_DIR" \
+    "$PROJECT_ROOT/app-native/tools/vikey_convert.cpp" "${CONVERT_SOURCES[@]/#/$SRC_DIR/}" \
+    -lpthread -o "$BUILD_DIR/vikey-convert"
+echo "Output: $BUILD_DIR/vikey-convert"
+
+if [ "$1" = "--run" ]; then
+    shift
+    "$BUILD_DIR/key_latency_bench" "$@"
+elif [ "$1" = "--sim" ]; then
+    shift
+    "$BUILD_DIR/pipeline_sim" "$@"
+fi
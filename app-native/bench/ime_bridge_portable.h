@@ -0,0 +1,167 @@
+// ViKey - Portable Rust FFI declarations
+// ime_bridge_portable.h
+// Copy of the rust_bridge.h contract without <windows.h>, for tools that link
+// the core staticlib directly (benchmarks, simulation). Keep in sync with
+// src/rust_bridge.h and core/src/engine/types.rs.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// IME action type
+enum class ImeAction : uint8_t {
+    None = 0,    // No action needed, pass key through
+    Send = 1,    // Send text replacement
+    Restore = 2  // Restore original text (unused)
+};
+
+constexpr uint8_t IME_FLAG_KEY_CONSUMED = 0x01;
+constexpr uint8_t IME_FLAG_MORE_PENDING = 0x02;  // Batch results only: an edit was carried over
+
+// Native result structure from Rust (1028 bytes)
+struct NativeResult {
+    uint32_t chars[256];
+    uint8_t action;
+    uint8_t backspace;
+    uint8_t count;
+    uint8_t flags;
+};
+
+// Compact native result from Rust (48 bytes on 64-bit)
+constexpr size_t COMPACT_INLINE = 16;
+
+struct NativeCompactResult {
+    uint8_t action;
+    uint8_t backspace;
+    uint8_t flags;
+    uint8_t reserved;
+    uint32_t len;
+    uint16_t text[COMPACT_INLINE];
+    const uint16_t* overflow;
+};
+
+// One key for batched processing
+struct NativeKeyEvent {
+    uint16_t key;
+    bool caps;
+    bool ctrl;
+    bool shift;
+    uint8_t reserved;
+};
+
+// Opaque engine handle
+struct NativeEngine;
+
+extern "C" {
+// Global engine
+void ime_init();
+void ime_clear();
+void ime_clear_all();
+void ime_method(uint8_t method);
+bool ime_key_into(NativeResult* out, uint16_t key, bool caps, bool ctrl, bool shift);
+bool ime_key_compact(NativeCompactResult* out, uint16_t key, bool caps, bool ctrl, bool shift);
+
+// Engine handles
+NativeEngine* ime_engine_new();
+NativeEngine* ime_engine_new_like(NativeEngine* src);
+void ime_engine_free(NativeEngine* e);
+bool ime_engine_key_ext(NativeEngine* e, NativeResult* out, uint16_t key, bool caps, bool ctrl, bool shift);
+bool ime_engine_key_compact(NativeEngine* e, NativeCompactResult* out, uint16_t key, bool caps, bool ctrl, bool shift);
+size_t ime_engine_keys_batch(NativeEngine* e, const NativeKeyEvent* keys, size_t n, NativeResult* out);
+void ime_engine_clear(NativeEngine* e);
+void ime_engine_clear_all(NativeEngine* e);
+void ime_engine_method(NativeEngine* e, uint8_t method);
+void ime_engine_enabled(NativeEngine* e, bool enabled);
+void ime_engine_modern(NativeEngine* e, bool modern);
+void ime_engine_english_auto_restore(NativeEngine* e, bool enabled);
+void ime_engine_auto_capitalize(NativeEngine* e, bool enabled);
+void ime_engine_shortcuts_enabled(NativeEngine* e, bool enabled);
+void ime_engine_minimal_diff(NativeEngine* e, bool enabled);
+void ime_engine_add_shortcut(NativeEngine* e, const char* trigger, const char* replacement);
+void ime_engine_clear_shortcuts(NativeEngine* e);
+}
+
+// Host side of ime_engine_keys_batch: folds keys into as few net edits as
+// fit and calls inject(result) for each (a carried edit, FLAG_MORE_PENDING,
+// is collected before anything else). Returns the keys consumed: it stops
+// before a key the batch does not take (Enter, Tab, Esc, arrows, Ctrl),
+// which the host processes on its own.
+template <typename Inject>
+size_t ImeEngineKeysBatch(NativeEngine* engine, const NativeKeyEvent* keys, size_t n, Inject inject) {
+    NativeResult out;
+    size_t done = 0;
+    for (;;) {
+        done += ime_engine_keys_batch(engine, keys + done, n - done, &out);
+        if (out.action == static_cast<uint8_t>(ImeAction::Send)) inject(out);
+        if (!(out.flags & IME_FLAG_MORE_PENDING)) return done;
+    }
+}
+
+// macOS virtual keycodes used by the engine (core/src/data/keys.rs)
+namespace MacKey {
+constexpr uint16_t A = 0, S = 1, D = 2, F = 3, H = 4, G = 5, Z = 6, X = 7, C = 8, V = 9;
+constexpr uint16_t B = 11, Q = 12, W = 13, E = 14, R = 15, Y = 16, T = 17;
+constexpr uint16_t O = 31, U = 32, I = 34, P = 35, L = 37, J = 38, K = 40, N = 45, M = 46;
+constexpr uint16_t N1 = 18, N2 = 19, N3 = 20, N4 = 21, N5 = 23, N6 = 22, N7 = 26, N8 = 28, N9 = 25, N0 = 29;
+constexpr uint16_t SPACE = 49, DELETE = 51, TAB = 48, RETURN = 36, ESC = 53;
+constexpr uint16_t DOT = 47, COMMA = 43, SLASH = 44, SEMICOLON = 41, QUOTE = 39;
+constexpr uint16_t LBRACKET = 33, RBRACKET = 30, BACKSLASH = 42, MINUS = 27, EQUAL = 24, BACKQUOTE = 50;
+constexpr uint16_t NONE = 0xFFFF;
+}  // namespace MacKey
+
+// Key and modifier state that types an ASCII character on a US layout
+struct MacKeyStroke {
+    uint16_t key;
+    bool shift;
+    bool caps;  // Uppercase letter (caps = shift XOR CapsLock, as KeyboardHook computes)
+};
+
+inline MacKeyStroke MacKeyFromAscii(char c) {
+    using namespace MacKey;
+    static const uint16_t letters[26] = {A, B, C, D, E, F, G, H, I, J, K, L, M,
+                                         N, O, P, Q, R, S, T, U, V, W, X, Y, Z};
+    static const uint16_t digits[10] = {N0, N1, N2, N3, N4, N5, N6, N7, N8, N9};
+    if (c >= 'a' && c <= 'z') return {letters[c - 'a'], false, false};
+    if (c >= 'A' && c <= 'Z') return {letters[c - 'A'], true, true};
+    if (c >= '0' && c <= '9') return {digits[c - '0'], false, false};
+    switch (c) {
+        case ' ': return {SPACE, false, false};
+        case '\t': return {TAB, false, false};
+        case '\n': return {RETURN, false, false};
+        case '\b': return {DELETE, false, false};
+        case '.': return {DOT, false, false};
+        case ',': return {COMMA, false, false};
+        case '/': return {SLASH, false, false};
+        case ';': return {SEMICOLON, false, false};
+        case '\'': return {QUOTE, false, false};
+        case '[': return {LBRACKET, false, false};
+        case ']': return {RBRACKET, false, false};
+        case '\\': return {BACKSLASH, false, false};
+        case '-': return {MINUS, false, false};
+        case '=': return {EQUAL, false, false};
+        case '`': return {BACKQUOTE, false, false};
+        case '!': return {N1, true, false};
+        case '@': return {N2, true, false};
+        case '#': return {N3, true, false};
+        case '$': return {N4, true, false};
+        case '%': return {N5, true, false};
+        case '^': return {N6, true, false};
+        case '&': return {N7, true, false};
+        case '*': return {N8, true, false};
+        case '(': return {N9, true, false};
+        case ')': return {N0, true, false};
+        case '_': return {MINUS, true, false};
+        case '+': return {EQUAL, true, false};
+        case ':': return {SEMICOLON, true, false};
+        case '"': return {QUOTE, true, false};
+        case '<': return {COMMA, true, false};
+        case '>': return {DOT, true, false};
+        case '?': return {SLASH, true, false};
+        case '|': return {BACKSLASH, true, false};
+        case '{': return {LBRACKET, true, false};
+        case '}': return {RBRACKET, true, false};
+        case '~': return {BACKQUOTE, true, false};
+        default: return {NONE, false, false};
+    }
+}
@@ -0,0 +1,481 @@
+// ViKey - Keystroke replay latency benchmark
+// key_latency_bench.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+//
+// Replays keystroke corpora through the core staticlib the same way the
+// Windows hook drives it (RustBridge contract: one engine handle, compact
+// results, buffer clear after Space/Enter/Tab) and reports per-key latency
+// percentiles, keys/sec and heap allocations per key by ImeAction, plus the
+// events one pass injects with and without minimal-diff output, and with
+// the keys queued behind a slow injection in bursts of --burst keys:
+// replayed one by one, or folded into net edits by ime_engine_keys_batch.
+//
+// Usage: key_latency_bench [--repeat N] [--burst N] [--json FILE|-] [corpus.txt ...]
+//
+// Corpus format: text typed as-is (US layout, '\n' = Enter). Lines starting
+// with "#!" are directives:
+//   #! method telex|vni
+//   #! auto_restore on|off   (English auto-restore)
+//   #! shortcut <trigger> <replacement>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ime_bridge_portable.h"
+
+#ifndef VIKEY_BENCH_CORPUS_DIR
+#define VIKEY_BENCH_CORPUS_DIR "corpora"
+#endif
+
+// ============================================================
+// Allocation counting (glibc: interpose malloc family)
+// ============================================================
+
+static std::atomic<uint64_t> g_allocCount{0};
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    void* p = __libc_memalign(alignment, size);
+    if (!p) return 12;  // ENOMEM
+    *out = p;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+}
+constexpr bool kCountsAllocations = true;
+#else
+constexpr bool kCountsAllocations = false;
+#endif
+
+// ============================================================
+// Corpus
+// ============================================================
+
+struct Corpus {
+    std::string name;
+    uint8_t method = 0;  // 0 = Telex, 1 = VNI
+    bool autoRestore = false;
+    std::vector<std::pair<std::string, std::string>> shortcuts;
+    std::vector<MacKeyStroke> keys;
+    size_t skipped = 0;  // Characters with no US-layout key
+};
+
+static bool LoadCorpus(const std::string& path, Corpus& corpus) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    size_t begin = slash == std::string::npos ? 0 : slash + 1;
+    corpus.name = path.substr(begin, dot == std::string::npos || dot < begin ? std::string::npos : dot - begin);
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.rfind("#!", 0) == 0) {
+            std::istringstream directive(line.substr(2));
+            std::string command, arg;
+            directive >> command >> arg;
+            if (command == "method") {
+                corpus.method = (arg == "vni") ? 1 : 0;
+            } else if (command == "auto_restore") {
+                corpus.autoRestore = (arg == "on");
+            } else if (command == "shortcut") {
+                std::string replacement;
+                std::getline(directive >> std::ws, replacement);
+                corpus.shortcuts.emplace_back(arg, replacement);
+            }
+            continue;
+        }
+        line.push_back('\n');
+        for (char c : line) {
+            MacKeyStroke stroke = MacKeyFromAscii(c);
+            if (stroke.key == MacKey::NONE) {
+                corpus.skipped++;
+            } else {
+                corpus.keys.push_back(stroke);
+            }
+        }
+    }
+    return true;
+}
+
+// ============================================================
+// Measurement
+// ============================================================
+
+enum Bucket { BucketNone, BucketSend, BucketRestore, BucketAll, BucketCount };
+static const char* const kBucketNames[BucketCount] = {"none", "send", "restore", "all"};
+
+struct Samples {
+    std::vector<uint32_t> ns;
+    uint64_t allocs = 0;
+};
+
+struct Summary {
+    size_t count = 0;
+    double p50 = 0, p99 = 0, p999 = 0, mean = 0, max = 0;
+    double allocsPerKey = 0;
+};
+
+static Summary Summarize(Samples& s) {
+    Summary r;
+    r.count = s.ns.size();
+    if (r.count == 0) return r;
+    std::sort(s.ns.begin(), s.ns.end());
+    auto pct = [&](double p) {
+        size_t idx = static_cast<size_t>(p * static_cast<double>(r.count - 1) + 0.5);
+        return static_cast<double>(s.ns[idx]);
+    };
+    r.p50 = pct(0.50);
+    r.p99 = pct(0.99);
+    r.p999 = pct(0.999);
+    r.max = static_cast<double>(s.ns.back());
+    uint64_t total = 0;
+    for (uint32_t v : s.ns) total += v;
+    r.mean = static_cast<double>(total) / static_cast<double>(r.count);
+    r.allocsPerKey = static_cast<double>(s.allocs) / static_cast<double>(r.count);
+    return r;
+}
+
+// Injections (SendInput calls) and events for the queued keys of one pass
+struct QueuedCost {
+    uint64_t injections = 0;
+    uint64_t events = 0;
+};
+
+struct CorpusResult {
+    std::string name;
+    size_t keysPerPass = 0;
+    size_t skipped = 0;
+    double keysPerSec = 0;
+    Summary buckets[BucketCount];
+    uint64_t eventsFull = 0;     // Injected events per pass, full rebuild edits
+    uint64_t eventsMinimal = 0;  // Same with minimal-diff output
+    size_t burst = 0;
+    QueuedCost queuedPerKey;     // Keys queued in bursts, each injected on its own
+    QueuedCost queuedBatch;      // Same bursts folded into net edits
+};
+
+static NativeEngine* NewCorpusEngine(const Corpus& corpus) {
+    NativeEngine* engine = ime_engine_new();
+    ime_engine_method(engine, corpus.method);
+    ime_engine_english_auto_restore(engine, corpus.autoRestore);
+    for (const auto& s : corpus.shortcuts) {
+        ime_engine_add_shortcut(engine, s.first.c_str(), s.second.c_str());
+    }
+    return engine;
+}
+
+// SendInput events for one pass in Unicode mode: key down + key up per
+// backspace and per UTF-16 unit
+static uint64_t CountInjectedEvents(const Corpus& corpus, bool minimalDiff) {
+    NativeEngine* engine = NewCorpusEngine(corpus);
+    ime_engine_minimal_diff(engine, minimalDiff);
+
+    NativeCompactResult out;
+    uint64_t events = 0;
+    for (const MacKeyStroke& k : corpus.keys) {
+        if (k.key == MacKey::RETURN || k.key == MacKey::TAB) {
+            ime_engine_clear(engine);
+            continue;
+        }
+        ime_engine_key_compact(engine, &out, k.key, k.caps, false, k.shift);
+        if (k.key == MacKey::SPACE) ime_engine_clear(engine);
+        if (out.action == static_cast<uint8_t>(ImeAction::Send)) {
+            events += 2 * (static_cast<uint64_t>(out.backspace) + out.len);
+        }
+    }
+
+    ime_engine_free(engine);
+    return events;
+}
+
+// SendInput events of one edit: key down + key up per backspace and per UTF-16 unit
+static uint64_t EditEvents(const NativeResult& edit) {
+    uint64_t units = 0;
+    for (uint8_t i = 0; i < edit.count; i++) units += edit.chars[i] > 0xFFFF ? 2 : 1;
+    return 2 * (static_cast<uint64_t>(edit.backspace) + units);
+}
+
+// Keys queued behind a slow injection, up to burst at a time (a burst ends
+// at Space, Enter or Tab, where the hook clears the buffer). Per key, each
+// Send edit is injected and each key passed through is replayed (one key
+// down + up); batched, ime_engine_keys_batch folds the burst into net edits.
+static QueuedCost CountQueuedEvents(const Corpus& corpus, size_t burst, bool batched) {
+    NativeEngine* engine = NewCorpusEngine(corpus);
+    QueuedCost cost;
+    auto inject = [&cost](const NativeResult& edit) {
+        cost.injections++;
+        cost.events += EditEvents(edit);
+    };
+    auto injectKey = [&](const NativeKeyEvent& k) {
+        NativeResult out;
+        ime_engine_key_ext(engine, &out, k.key, k.caps, k.ctrl, k.shift);
+        if (out.action == static_cast<uint8_t>(ImeAction::Send)) {
+            inject(out);
+        } else if (!(out.flags & IME_FLAG_KEY_CONSUMED)) {
+            cost.injections++;
+            cost.events += 2;
+        }
+    };
+
+    std::vector<NativeKeyEvent> queued;
+    queued.reserve(burst);
+    auto flush = [&]() {
+        size_t done = 0;
+        while (done < queued.size()) {
+            if (batched) done += ImeEngineKeysBatch(engine, queued.data() + done, queued.size() - done, inject);
+            if (done < queued.size()) injectKey(queued[done++]);  // Not batchable (or per key)
+        }
+        queued.clear();
+    };
+
+    for (const MacKeyStroke& k : corpus.keys) {
+        if (k.key == MacKey::RETURN || k.key == MacKey::TAB) {
+            flush();
+            ime_engine_clear(engine);
+            continue;
+        }
+        queued.push_back({k.key, k.caps, false, k.shift, 0});
+        if (k.key == MacKey::SPACE) {
+            flush();
+            ime_engine_clear(engine);
+        } else if (queued.size() == burst) {
+            flush();
+        }
+    }
+    flush();
+
+    ime_engine_free(engine);
+    return cost;
+}
+
+static CorpusResult RunCorpus(const Corpus& corpus, int repeat, size_t burst) {
+    using Clock = std::chrono::steady_clock;
+
+    NativeEngine* engine = NewCorpusEngine(corpus);
+
+    Samples samples[BucketCount];
+    size_t total = corpus.keys.size() * static_cast<size_t>(repeat);
+    for (Samples& s : samples) s.ns.reserve(total);
+
+    NativeCompactResult out;
+    Clock::duration busy{};
+
+    // Warm-up pass (not recorded)
+    for (int pass = -1; pass < repeat; pass++) {
+        ime_engine_clear_all(engine);
+        for (const MacKeyStroke& k : corpus.keys) {
+            // KeyboardHook passes Enter/Tab through and only clears the buffer
+            if (k.key == MacKey::RETURN || k.key == MacKey::TAB) {
+                ime_engine_clear(engine);
+                continue;
+            }
+
+            uint64_t allocsBefore = g_allocCount.load(std::memory_order_relaxed);
+            Clock::time_point t0 = Clock::now();
+            ime_engine_key_compact(engine, &out, k.key, k.caps, false, k.shift);
+            if (k.key == MacKey::SPACE) ime_engine_clear(engine);  // Hook clears after Space
+            Clock::time_point t1 = Clock::now();
+            uint64_t allocs = g_allocCount.load(std::memory_order_relaxed) - allocsBefore;
+
+            if (pass < 0) continue;
+            busy += t1 - t0;
+            uint32_t ns = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+            Bucket bucket = out.action == static_cast<uint8_t>(ImeAction::Send)      ? BucketSend
+                            : out.action == static_cast<uint8_t>(ImeAction::Restore) ? BucketRestore
+                                                                                     : BucketNone;
+            samples[bucket].ns.push_back(ns);
+            samples[bucket].allocs += allocs;
+            samples[BucketAll].ns.push_back(ns);
+            samples[BucketAll].allocs += allocs;
+        }
+    }
+
+    ime_engine_free(engine);
+
+    CorpusResult result;
+    result.name = corpus.name;
+    result.keysPerPass = samples[BucketAll].ns.size() / static_cast<size_t>(repeat);
+    result.skipped = corpus.skipped;
+    double seconds = std::chrono::duration<double>(busy).count();
+    result.keysPerSec = seconds > 0 ? static_cast<double>(samples[BucketAll].ns.size()) / seconds : 0;
+    for (int b = 0; b < BucketCount; b++) result.buckets[b] = Summarize(samples[b]);
+    result.eventsFull = CountInjectedEvents(corpus, false);
+    result.eventsMinimal = CountInjectedEvents(corpus, true);
+    result.burst = burst;
+    result.queuedPerKey = CountQueuedEvents(corpus, burst, false);
+    result.queuedBatch = CountQueuedEvents(corpus, burst, true);
+    return result;
+}
+
+// ============================================================
+// Reporting
+// ============================================================
+
+static void PrintTable(FILE* f, const std::vector<CorpusResult>& results) {
+    std::fprintf(f, "%-18s %-8s %9s %9s %9s %9s %12s %11s\n",
+                 "corpus", "action", "keys", "p50 ns", "p99 ns", "p999 ns", "keys/sec", "allocs/key");
+    for (const CorpusResult& r : results) {
+        for (int b = BucketCount - 1; b >= 0; b--) {
+            const Summary& s = r.buckets[b];
+            if (s.count == 0 && b != BucketAll) continue;
+            char allocs[32];
+            if (kCountsAllocations) {
+                std::snprintf(allocs, sizeof(allocs), "%.2f", s.allocsPerKey);
+            } else {
+                std::snprintf(allocs, sizeof(allocs), "n/a");
+            }
+            std::fprintf(f, "%-18s %-8s %9zu %9.0f %9.0f %9.0f %12s %11s\n",
+                         b == BucketAll ? r.name.c_str() : "", kBucketNames[b], s.count,
+                         s.p50, s.p99, s.p999,
+                         b == BucketAll ? std::to_string(static_cast<long long>(r.keysPerSec)).c_str() : "",
+                         allocs);
+        }
+    }
+
+    std::fprintf(f, "\n%-18s %14s %14s %8s\n", "corpus", "events full", "events diff", "saved");
+    for (const CorpusResult& r : results) {
+        double saved = r.eventsFull > 0 ? 100.0 * static_cast<double>(r.eventsFull - r.eventsMinimal) /
+                                              static_cast<double>(r.eventsFull)
+                                        : 0;
+        std::fprintf(f, "%-18s %14llu %14llu %7.1f%%\n", r.name.c_str(),
+                     static_cast<unsigned long long>(r.eventsFull),
+                     static_cast<unsigned long long>(r.eventsMinimal), saved);
+    }
+
+    std::fprintf(f, "\n%-18s %6s %14s %14s %14s %14s %8s\n", "corpus", "burst", "inject key",
+                 "inject batch", "events key", "events batch", "saved");
+    for (const CorpusResult& r : results) {
+        const QueuedCost& key = r.queuedPerKey;
+        const QueuedCost& batch = r.queuedBatch;
+        double saved = key.events > 0 ? 100.0 * (static_cast<double>(key.events) - static_cast<double>(batch.events)) /
+                                            static_cast<double>(key.events)
+                                      : 0;
+        std::fprintf(f, "%-18s %6zu %14llu %14llu %14llu %14llu %7.1f%%\n", r.name.c_str(), r.burst,
+                     static_cast<unsigned long long>(key.injections), static_cast<unsigned long long>(batch.injections),
+                     static_cast<unsigned long long>(key.events), static_cast<unsigned long long>(batch.events), saved);
+    }
+}
+
+static void WriteJson(FILE* f, const std::vector<CorpusResult>& results, int repeat) {
+    std::fprintf(f, "{\n  \"benchmark\": \"key_latency\",\n  \"repeat\": %d,\n", repeat);
+    std::fprintf(f, "  \"allocations_counted\": %s,\n  \"corpora\": [\n", kCountsAllocations ? "true" : "false");
+    for (size_t i = 0; i < results.size(); i++) {
+        const CorpusResult& r = results[i];
+        std::fprintf(f, "    {\n      \"name\": \"%s\",\n      \"keys_per_pass\": %zu,\n", r.name.c_str(), r.keysPerPass);
+        std::fprintf(f, "      \"skipped_chars\": %zu,\n      \"keys_per_sec\": %.0f,\n", r.skipped, r.keysPerSec);
+        std::fprintf(f, "      \"injected_events\": {\"full\": %llu, \"minimal_diff\": %llu},\n",
+                     static_cast<unsigned long long>(r.eventsFull), static_cast<unsigned long long>(r.eventsMinimal));
+        std::fprintf(f,
+                     "      \"queued\": {\"burst\": %zu, \"per_key\": {\"injections\": %llu, \"events\": %llu}, "
+                     "\"batched\": {\"injections\": %llu, \"events\": %llu}},\n",
+                     r.burst, static_cast<unsigned long long>(r.queuedPerKey.injections),
+                     static_cast<unsigned long long>(r.queuedPerKey.events),
+                     static_cast<unsigned long long>(r.queuedBatch.injections),
+                     static_cast<unsigned long long>(r.queuedBatch.events));
+        std::fprintf(f, "      \"actions\": {\n");
+        for (int b = 0; b < BucketCount; b++) {
+            const Summary& s = r.buckets[b];
+            std::fprintf(f,
+                         "        \"%s\": {\"count\": %zu, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f, "
+                         "\"mean_ns\": %.1f, \"max_ns\": %.0f, \"allocs_per_key\": %.3f}%s\n",
+                         kBucketNames[b], s.count, s.p50, s.p99, s.p999, s.mean, s.max, s.allocsPerKey,
+                         b + 1 < BucketCount ? "," : "");
+        }
+        std::fprintf(f, "      }\n    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    int repeat = 50;
+    size_t burst = 8;
+    const char* jsonPath = nullptr;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+            burst = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            std::printf("Usage: %s [--repeat N] [--burst N] [--json FILE|-] [corpus.txt ...]\n", argv[0]);
+            return 0;
+        } else {
+            paths.emplace_back(argv[i]);
+        }
+    }
+
+    if (paths.empty()) {
+        for (const char* name : {"telex_prose", "vni_prose", "english", "source_code", "mixed_shortcuts",
+                                 "telex_english_mix"}) {
+            paths.push_back(std::string(VIKEY_BENCH_CORPUS_DIR) + "/" + name + ".txt");
+        }
+    }
+
+    std::vector<CorpusResult> results;
+    for (const std::string& path : paths) {
+        Corpus corpus;
+        if (!LoadCorpus(path, corpus)) {
+            std::fprintf(stderr, "Cannot read corpus: %s\n", path.c_str());
+            return 1;
+        }
+        results.push_back(RunCorpus(corpus, repeat, burst));
+    }
+
+    bool jsonToStdout = jsonPath && std::strcmp(jsonPath, "-") == 0;
+    PrintTable(jsonToStdout ? stderr : stdout, results);
+
+    if (jsonPath) {
+        FILE* f = jsonToStdout ? stdout : std::fopen(jsonPath, "w");
+        if (!f) {
+            std::fprintf(stderr, "Cannot write JSON: %s\n", jsonPath);
+            return 1;
+        }
+        WriteJson(f, results, repeat);
+        if (!jsonToStdout) std::fclose(f);
+    }
+    return 0;
+}
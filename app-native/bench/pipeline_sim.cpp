@@ -0,0 +1,2270 @@
+// ViKey - Headless pipeline simulation
+// pipeline_sim.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+//
+// Runs the real app pipeline (KeyboardHook → ImeProcessor → RustBridge →
+// TextSender → OutputWorker) on SimPlatform: scripted keystrokes go through
+// the hook, the core is loaded from libvikey_core.so and injected edits land
+// in virtual text fields. Checks cover the output queue ordering (with a mock
+// injector), the foreground snapshot exchange, the per-app rule matcher, the
+// injection event encoder, the learned injection pacing and the resulting
+// text; the benchmark then times the hook's cost per key (CheckAppChange,
+// engine, queueing) and the injection separately, plus foreground tracking,
+// the encoder's events/µs and how long paced retypes block after learning.
+//
+// Built with VIKEY_BENCH_ICU (build.sh does when pkg-config finds icu-uc),
+// the converter's NFC/NFD tables are also checked and timed against ICU.
+//
+// Usage: pipeline_sim [--repeat N] [--core PATH] [--checks-only] [corpus.txt]
+// Exit status is 1 if any scenario leaves the wrong text.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "platform_sim.h"
+#include "ime_processor.h"
+#include "encoding_converter.h"
+#include "encoding_tables.h"
+#include "encoding_stream.h"
+#include "output_worker.h"
+#include "spsc_queue.h"
+#include "hook_watchdog.h"
+#include "lru_cache.h"
+#include "snapshot_exchange.h"
+#include "foreground_tracker.h"
+#include "app_rules.h"
+#include "injection_encoder.h"
+#include "injection_pacer.h"
+#include "keycodes.h"
+#include "clipboard_paste.h"
+#include "pending_edit.h"
+#include "selection_convert.h"
+#include "text_transform.h"
+#include "utf8_codec.h"
+#include <map>
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+#ifdef VIKEY_BENCH_ICU
+#include <unicode/unorm2.h>
+#endif
+
+#ifndef VIKEY_BENCH_CORPUS_DIR
+#define VIKEY_BENCH_CORPUS_DIR "corpora"
+#endif
+
+static std::string ToUtf8(const std::wstring& text) {
+    std::string out;
+    for (wchar_t wc : text) {
+        uint32_t cp = static_cast<uint32_t>(wc);
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+    return out;
+}
+
+// ============================================================
+// Scenarios
+// ============================================================
+
+static int g_failures = 0;
+
+static void Expect(const char* name, const std::wstring& got, const std::wstring& want) {
+    if (got == want) {
+        std::printf("  ok    %s\n", name);
+        return;
+    }
+    g_failures++;
+    std::printf("  FAIL  %s\n        got:  \"%s\"\n        want: \"%s\"\n",
+                name, ToUtf8(got).c_str(), ToUtf8(want).c_str());
+}
+
+static void ExpectTrue(const char* name, bool ok) {
+    if (ok) {
+        std::printf("  ok    %s\n", name);
+        return;
+    }
+    g_failures++;
+    std::printf("  FAIL  %s\n", name);
+}
+
+// ============================================================
+// Output queue (portable, no core needed)
+// ============================================================
+
+static void RunQueueChecks() {
+    std::printf("Output queue\n");
+
+    // SPSC ring: every item arrives, in order, across two threads
+    {
+        static SpscQueue<uint32_t, 256> queue;
+        const uint32_t count = 2000000;
+        std::atomic<bool> ordered(true);
+        std::thread consumer([&] {
+            for (uint32_t expected = 0; expected < count;) {
+                uint32_t* item = queue.Front();
+                if (!item) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (*item != expected) ordered = false;
+                queue.Pop();
+                expected++;
+            }
+        });
+        for (uint32_t i = 0; i < count;) {
+            if (queue.TryPush(i)) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        consumer.join();
+        ExpectTrue("spsc order across threads", ordered && queue.Empty());
+    }
+
+    // OutputWorker with a mock injector that is slower than the producer:
+    // commands run in submission order, the producer never waits (a full
+    // queue spills into the overflow list), and IsBusy() covers the command
+    // being executed
+    {
+        std::vector<int> executed;
+        std::atomic<bool> inSink(false);
+        std::atomic<int> done(0);
+        OutputWorker worker([&](const OutputCommand& cmd) {
+            inSink = true;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            executed.push_back(cmd.vkCode);
+            inSink = false;
+            done++;
+        });
+        worker.Start();
+        const int count = static_cast<int>(OutputWorker::QUEUE_CAPACITY) * 4;
+        bool busyWhileInFlight = true;
+        for (int round = 0; round < 2; round++) {
+            for (int i = round * count / 2; i < (round + 1) * count / 2; i++) {
+                OutputCommand& cmd = worker.Begin();
+                cmd.kind = OutputCommand::Kind::Key;
+                cmd.vkCode = i;
+                worker.Submit();
+                if (inSink && !worker.IsBusy()) busyWhileInFlight = false;
+            }
+            // Second round: queue, then overflow, after the first drained
+            if (round == 0) ExpectTrue("producer never waits on a full queue", done < count / 2);
+            if (round == 0) worker.Flush();
+        }
+        worker.Flush();
+        bool ordered = executed.size() == static_cast<size_t>(count);
+        for (int i = 0; ordered && i < count; i++) ordered = executed[i] == i;
+        ExpectTrue("worker runs commands in order (through the overflow)", ordered && worker.Overflows() > 0);
+        ExpectTrue("worker busy while injecting", busyWhileInFlight);
+        ExpectTrue("worker idle after flush", !worker.IsBusy());
+        worker.Stop();
+    }
+
+    // Without a thread, commands wait for Flush() (or run when the queue fills)
+    {
+        std::vector<int> executed;
+        OutputWorker worker([&](const OutputCommand& cmd) { executed.push_back(cmd.vkCode); });
+        for (int i = 0; i < 3; i++) {
+            OutputCommand& cmd = worker.Begin();
+            cmd.kind = OutputCommand::Kind::Key;
+            cmd.vkCode = i;
+            worker.Submit();
+        }
+        bool deferred = executed.empty() && worker.IsBusy();
+        worker.Flush();
+        ExpectTrue("manual worker defers until flush", deferred && executed == std::vector<int>({0, 1, 2}));
+    }
+
+    // A command can absorb the ones queued behind it (merged pastes)
+    {
+        std::vector<int> executed;
+        OutputWorker* self = nullptr;
+        OutputWorker worker([&](const OutputCommand& cmd) {
+            size_t merged = 0;
+            while (const OutputCommand* next = self->PeekQueued(merged)) {
+                if (next->vkCode >= 10) break;
+                merged++;
+            }
+            self->MergeQueued(merged);
+            executed.push_back(cmd.vkCode + static_cast<int>(merged) * 100);
+        });
+        self = &worker;
+        for (int vk : {1, 2, 3, 10, 4}) {
+            OutputCommand& cmd = worker.Begin();
+            cmd.kind = OutputCommand::Kind::Key;
+            cmd.vkCode = vk;
+            worker.Submit();
+        }
+        worker.Flush();
+        ExpectTrue("worker merges queued commands", executed == std::vector<int>({201, 110}) && !worker.IsBusy());
+    }
+}
+
+// ============================================================
+// Hook watchdog (portable, synthetic timings)
+// ============================================================
+
+static HookTiming Timing(uint64_t at, uint64_t appNs, uint64_t engineNs, uint64_t outputNs) {
+    HookTiming t;
+    t.entry = at;
+    t.appChecked = t.entry + appNs;
+    t.engineDone = t.appChecked + engineNs;
+    t.outputDone = t.engineDone + outputNs;
+    return t;
+}
+
+static void RunWatchdogChecks() {
+    std::printf("Hook watchdog\n");
+    const uint64_t us = 1000, ms = 1000000, s = 1000000000;
+
+    // Buckets bracket the value with at most 25% spread
+    bool bucketsOk = true;
+    for (uint64_t v = 1; v < (uint64_t(1) << 38); v = v * 3 / 2 + 1) {
+        size_t bucket = LatencyRing::BucketOf(v);
+        uint64_t upper = LatencyRing::BucketUpperBound(bucket);
+        uint64_t lower = bucket == 0 ? 0 : LatencyRing::BucketUpperBound(bucket - 1) + 1;
+        if (v < lower || v > upper || (lower >= 4 && upper - lower + 1 > lower / 4)) bucketsOk = false;
+    }
+    ExpectTrue("histogram buckets within 25%", bucketsOk);
+
+    {
+        LatencyRing ring;
+        uint64_t t = 100 * s;
+        for (int i = 0; i < 970; i++) ring.Record(t, 10 * us);
+        for (int i = 0; i < 30; i++) ring.Record(t, 2 * ms);
+        LatencySnapshot snap = ring.Snapshot(t);
+        ExpectTrue("ring p50", snap.count == 1000 && snap.p50 >= 10 * us && snap.p50 <= 10 * us * 5 / 4);
+        ExpectTrue("ring p99", snap.p99 >= 2 * ms * 4 / 5 && snap.p99 <= 2 * ms && snap.max == 2 * ms);
+        ExpectTrue("ring forgets old windows", ring.Snapshot(t + 5 * s).count == 0 && ring.Total() == 1000);
+        ring.Record(t + 5 * s, 1 * us);
+        ExpectTrue("ring reuses a window slot", ring.Snapshot(t + 5 * s).count == 1);
+    }
+
+    {
+        HookWatchdog dog;
+        dog.SetTimeoutMs(100);
+        uint64_t t = 1000 * s;
+        bool changed = false;
+        for (int i = 0; i < 200; i++) changed |= dog.Record(Timing(t + i * 10 * ms, 5 * us, 2 * us, 1 * us));
+        ExpectTrue("watchdog idle on fast callbacks", !changed && !dog.IsDegraded());
+
+        // p99 drifts to 60% of the timeout: degrade at the next window check
+        t += 3 * s;
+        int transitions = 0;
+        for (int i = 0; i < 200; i++) transitions += dog.Record(Timing(t + i * 10 * ms, 60 * ms, 2 * us, 1 * us));
+        ExpectTrue("watchdog degrades near timeout", dog.IsDegraded() && transitions == 1 && dog.DegradeCount() == 1);
+
+        // Fast again, but degraded mode holds for MIN_DEGRADED_NS
+        t += 5 * s;
+        transitions = 0;
+        for (int i = 0; i < 100; i++) transitions += dog.Record(Timing(t + i * 10 * ms, 1 * us, 2 * us, 1 * us));
+        ExpectTrue("watchdog holds degraded mode", dog.IsDegraded() && transitions == 0);
+
+        t += HookWatchdog::MIN_DEGRADED_NS;
+        for (int i = 0; i < 100; i++) transitions += dog.Record(Timing(t + i * 10 * ms, 1 * us, 2 * us, 1 * us));
+        ExpectTrue("watchdog recovers", !dog.IsDegraded() && transitions == 1);
+
+        // One callback past the timeout: Windows may have unhooked us already
+        t += 10 * s;
+        bool tripped = dog.Record(Timing(t, 150 * ms, 1 * us, 1 * us));
+        ExpectTrue("watchdog trips on a single timeout", tripped && dog.IsDegraded() && dog.DegradeCount() == 2);
+
+        std::wstring report = dog.Report(t);
+        ExpectTrue("watchdog report", report.find(L"degraded 2 time(s)") != std::wstring::npos &&
+                                      report.find(L"app check") != std::wstring::npos);
+    }
+}
+
+// ============================================================
+// Foreground snapshot (portable, no core needed)
+// ============================================================
+
+static void RunForegroundChecks() {
+    std::printf("Foreground snapshot\n");
+
+    {
+        LruCache<int, int> cache(3);
+        cache.Put(1, 10);
+        cache.Put(2, 20);
+        cache.Put(3, 30);
+        cache.Get(1);  // 2 is now the least recently used
+        cache.Put(4, 40);
+        ExpectTrue("lru evicts least recently used",
+                   !cache.Get(2) && cache.Get(1) && *cache.Get(4) == 40 && cache.Size() == 3);
+        cache.Put(3, 31);
+        ExpectTrue("lru replaces in place", *cache.Get(3) == 31 && cache.Size() == 3);
+    }
+
+    {
+        SnapshotExchange<int> exchange;
+        exchange.Back() = 1;
+        exchange.Publish();
+        exchange.Back() = 2;
+        exchange.Publish();
+        bool latest = exchange.Read() == 2;
+        bool stable = exchange.Read() == 2;
+        exchange.Back() = 3;
+        exchange.Publish();
+        ExpectTrue("exchange reads the latest publish", latest && stable && exchange.Read() == 3);
+    }
+
+    // Writer republishes heap-owning snapshots while the reader checks that
+    // each one it sees is whole and never older than the previous
+    {
+        struct Payload {
+            uint64_t sequence = 0;
+            std::wstring name;
+            uint64_t check = 0;
+        };
+        static SnapshotExchange<Payload> exchange;
+        const uint64_t count = 200000;
+        std::thread writer([&] {
+            for (uint64_t i = 1; i <= count; i++) {
+                Payload& payload = exchange.Back();
+                payload.sequence = i;
+                payload.name.assign(i % 2 ? L"notepad.exe" : L"a-much-longer-application-name.exe");
+                payload.check = i * 2654435761ULL + payload.name.size();
+                exchange.Publish();
+                if (i % 64 == 0) std::this_thread::yield();
+            }
+        });
+        bool consistent = true;
+        uint64_t last = 0;
+        while (last < count) {
+            const Payload& payload = exchange.Read();
+            if (payload.sequence < last) consistent = false;
+            if (payload.sequence != 0 && payload.check != payload.sequence * 2654435761ULL + payload.name.size()) {
+                consistent = false;
+            }
+            last = payload.sequence;
+            std::this_thread::yield();
+        }
+        writer.join();
+        ExpectTrue("exchange consistent across threads", consistent);
+    }
+}
+
+// ============================================================
+// Per-app rules (portable, no core needed)
+// ============================================================
+
+static AppIdentity Identity(const wchar_t* path, const wchar_t* windowClass) {
+    AppIdentity app;
+    app.path = path;
+    app.exeName = AppExeName(app.path);
+    app.windowClass = windowClass;
+    return app;
+}
+
+static void RunAppRuleChecks() {
+    std::printf("App rules\n");
+    const int8_t unicode = static_cast<int8_t>(OutputEncoding::Unicode);
+    const int8_t tcvn3 = static_cast<int8_t>(OutputEncoding::TCVN3);
+    const int8_t vniEncoding = static_cast<int8_t>(OutputEncoding::VNI);
+    const int8_t vniMethod = static_cast<int8_t>(InputMethod::VNI);
+
+    ExpectTrue("glob match", GlobMatch(L"*term*.exe", L"windowsterminal.exe") && GlobMatch(L"a?c", L"abc") &&
+                             !GlobMatch(L"a?c", L"ac") && GlobMatch(L"*", L"") && GlobMatch(L"**x*", L"abxc") &&
+                             !GlobMatch(L"*.exe", L"app.com"));
+
+    std::vector<AppRule> rules;
+    std::vector<size_t> badLines;
+    bool parsed = ParseAppRules(L"# comment\n"
+                                L"exe:Notepad.exe|encoding=tcvn3\n"
+                                L"glob:*term*.exe | injection=slow | method=vni\n"
+                                L"path:C:/Tools/|enabled=off\n"
+                                L"path:c:\\tools\\legacy\\|encoding=vni\r\n"
+                                L"class:ConsoleWindowClass|injection=clipboard\n"
+                                L"\n"
+                                L"bogus line\n"
+                                L"exe:x.exe|colour=red\n"
+                                L"exe:y.exe\n", rules, &badLines);
+    ExpectTrue("parse rules", !parsed && rules.size() == 5 && badLines == std::vector<size_t>({8, 9, 10}));
+
+    AppRuleSet set;
+    set.Compile(rules);
+    AppRulePolicy policy = set.Match(Identity(L"c:\\windows\\notepad.exe", L"Notepad"));
+    ExpectTrue("exact exe rule", policy.encoding == tcvn3 && policy.enabled < 0 && policy.injection < 0);
+    policy = set.Match(Identity(L"c:\\tools\\legacy\\old.exe", L"Old"));
+    ExpectTrue("longest path prefix first", policy.encoding == vniEncoding && policy.enabled == 0);
+    policy = set.Match(Identity(L"c:\\apps\\windowsterminal.exe", L"ConsoleWindowClass"));
+    ExpectTrue("window class before glob", policy.injection == static_cast<int8_t>(InjectionMode::Clipboard) &&
+                                           policy.method == vniMethod);
+    ExpectTrue("no rule matches", set.Match(Identity(L"c:\\apps\\other.exe", L"")).IsEmpty());
+
+    // A glob without wildcards matches its text exactly
+    std::vector<AppRule> exactRules;
+    ParseAppRules(L"glob:plain.exe|encoding=tcvn3\nglob:c:\\tools\\exact.exe|encoding=vni\n", exactRules);
+    AppRuleSet exact;
+    exact.Compile(exactRules);
+    ExpectTrue("wildcard-free glob", exact.Match(Identity(L"c:\\apps\\plain.exe", L"")).encoding == tcvn3 &&
+                                     exact.Match(Identity(L"c:\\tools\\exact.exe", L"")).encoding == vniEncoding &&
+                                     exact.Match(Identity(L"c:\\apps\\plain.exe.bak", L"")).IsEmpty());
+
+    // Ids stay stable when the rules change; the policy follows the new rules
+    AppRuleCache cache;
+    cache.SetRules(std::make_shared<AppRuleSet>(set), 1);
+    AppRulePolicy a, b, again;
+    uint32_t idA = cache.Lookup(Identity(L"c:\\windows\\notepad.exe", L"Notepad"), a);
+    uint32_t idB = cache.Lookup(Identity(L"c:\\windows\\notepad.exe", L"Dialog"), b);
+    uint32_t idAgain = cache.Lookup(Identity(L"c:\\windows\\notepad.exe", L"Notepad"), again);
+    ExpectTrue("apps interned by path and class", idA != 0 && idA != idB && idA == idAgain && again.encoding == tcvn3);
+    cache.SetRules(std::make_shared<AppRuleSet>(), 2);
+    uint32_t idAfter = cache.Lookup(Identity(L"c:\\windows\\notepad.exe", L"Notepad"), again);
+    ExpectTrue("ids stable across recompiles", idAfter == idA && again.IsEmpty() && cache.AppCount() == 2);
+
+    // Managed deployments: thousands of rules of every kind
+    std::vector<AppRule> many;
+    for (int i = 0; i < 2000; i++) {
+        AppRule exe;
+        exe.pattern = L"app" + std::to_wstring(i) + L".exe";
+        exe.policy.encoding = i % 2 ? tcvn3 : unicode;
+        many.push_back(exe);
+        AppRule path;
+        path.kind = AppRuleKind::PathPrefix;
+        path.pattern = L"c:\\corp\\dept" + std::to_wstring(i) + L"\\";
+        path.policy.enabled = 0;
+        many.push_back(path);
+        AppRule glob;
+        glob.kind = AppRuleKind::Glob;
+        glob.pattern = L"tool" + std::to_wstring(i) + L"-*.exe";
+        glob.policy.method = vniMethod;
+        many.push_back(glob);
+    }
+    set.Compile(many);
+    AppRulePolicy deep = set.Match(Identity(L"c:\\corp\\dept1999\\bin\\app1999.exe", L""));
+    AppRulePolicy globbed = set.Match(Identity(L"c:\\x\\tool1234-beta.exe", L""));
+    ExpectTrue("thousands of rules", set.RuleCount() == 6000 && deep.encoding == tcvn3 && deep.enabled == 0 &&
+                                     globbed.method == vniMethod && globbed.encoding < 0);
+}
+
+// ============================================================
+// Injection encoder (portable, no core needed)
+// ============================================================
+
+using TestEncoder = InjectionEncoder<KeyEventRecordTraits, 16>;
+
+// Events as text: "B" backspace down/up, "U+XXXX" a unicode down/up pair
+static std::wstring DescribeEvents(const KeyEventRecord* events, size_t count) {
+    std::wstring out;
+    for (size_t i = 0; i + 1 < count; i += 2) {
+        const KeyEventRecord& down = events[i];
+        const KeyEventRecord& up = events[i + 1];
+        bool pair = !(down.flags & InjectionKeys::FLAG_KEYUP) && (up.flags & InjectionKeys::FLAG_KEYUP) &&
+                    down.vk == up.vk && down.scan == up.scan && down.extraInfo == 7 && up.extraInfo == 7;
+        if (!pair) return L"?";
+        if (!out.empty()) out += L' ';
+        if (down.flags & InjectionKeys::FLAG_UNICODE) {
+            wchar_t hex[16];
+            std::swprintf(hex, 16, L"U+%04X", static_cast<unsigned>(down.scan));
+            out += hex;
+        } else {
+            out += down.vk == InjectionKeys::VK_BACKSPACE && down.scan == InjectionKeys::SCAN_BACKSPACE ? L"B" : L"?";
+        }
+    }
+    return count % 2 == 0 ? out : L"?";
+}
+
+static void RunEncoderChecks() {
+    std::printf("Injection encoder\n");
+    TestEncoder encoder(7);
+    size_t count = 0;
+
+    const KeyEventRecord* events = encoder.Encode(L"ệ", 1, 2, count);
+    Expect("backspaces then text", DescribeEvents(events, count), L"B B U+1EC7");
+
+    const wchar_t pair[] = {0xD83D, 0xDE00, L'a'};  // Explicit UTF-16 "😀a"
+    events = encoder.Encode(pair, 3, 0, count);
+    Expect("surrogate pair kept", DescribeEvents(events, count), L"U+D83D U+DE00 U+0061");
+
+    const wchar_t codePoint[] = {static_cast<wchar_t>(0x1F600)};
+    if (sizeof(wchar_t) > 2) {
+        events = encoder.Encode(codePoint, 1, 0, count);
+        Expect("code point split into pair", DescribeEvents(events, count), L"U+D83D U+DE00");
+    }
+
+    const wchar_t lone[] = {0xD83D, L'a', 0xDE00};
+    events = encoder.Encode(lone, 3, 0, count);
+    Expect("lone surrogates replaced", DescribeEvents(events, count), L"U+FFFD U+0061 U+FFFD");
+
+    ExpectTrue("char length", WideCharLength(pair, 3) == 2 && WideCharLength(pair + 2, 1) == 1 &&
+                              WideCharLength(lone, 3) == 1 && WideCharLength(pair, 1) == 1 &&
+                              WideCharLength(pair, 0) == 0);
+
+    // Short edits stay in the inline buffer; a long expansion grows the arena once
+    events = encoder.Encode(L"abc", 3, 1, count);
+    ExpectTrue("inline for short edits", encoder.IsInline() && count == 8);
+    std::wstring longText(40, L'x');
+    events = encoder.Encode(longText.c_str(), longText.length(), 0, count);
+    size_t grown = encoder.Capacity();
+    ExpectTrue("arena grows for long text", !encoder.IsInline() && count == 80 && grown >= count);
+    const KeyEventRecord* arena = events;
+    events = encoder.Encode(L"a", 1, 0, count);
+    ExpectTrue("arena reused, never shrinks", events == arena && encoder.Capacity() == grown);
+
+    // Replaying the events edits a field like the injected keys would
+    SimTextField field;
+    field.text = L"vieet";
+    events = encoder.Encode(pair, 2, 2, count);
+    field.ApplyEvents(events, count);
+    std::wstring emoji = sizeof(wchar_t) > 2 ? std::wstring(codePoint, 1) : std::wstring(pair, 2);
+    Expect("field replays events", field.text, L"vie" + emoji);
+}
+
+// ============================================================
+// Injection pacing (portable, no core needed)
+// ============================================================
+
+static InjectionFeedback Clean() {
+    InjectionFeedback feedback;
+    feedback.events = 10;
+    return feedback;
+}
+
+// The app itself showed it handled the input (a clipboard read)
+static InjectionFeedback Confirmed() {
+    InjectionFeedback feedback = Clean();
+    feedback.confirmed = true;
+    return feedback;
+}
+
+static InjectionFeedback Dropped() {
+    InjectionFeedback feedback = Clean();
+    feedback.dropped = true;
+    return feedback;
+}
+
+static void RunPacingChecks() {
+    std::printf("Injection pacing\n");
+    using P = PacingProfile;
+
+    P profile;
+    InjectionPacing pacing = profile.Pacing();
+    ExpectTrue("unlearned app keeps the old delays", pacing.eventDelayUs == 15000 && pacing.settleDelayUs == 30000);
+
+    for (int i = 0; i < 200; i++) profile.Update(Clean());
+    ExpectTrue("unconfirmed runs keep the default", profile.delayUs == P::DEFAULT_DELAY_US);
+
+    for (uint32_t i = 0; i + 1 < P::CLEAN_RUNS; i++) profile.Update(Confirmed());
+    ExpectTrue("steps down only after clean runs", profile.delayUs == P::DEFAULT_DELAY_US &&
+                                                   profile.Update(Confirmed()) &&
+                                                   profile.delayUs == P::DEFAULT_DELAY_US / 2);
+
+    for (int i = 0; i < 200; i++) profile.Update(Confirmed());
+    ExpectTrue("fast app reaches the minimum", profile.delayUs == P::MIN_DELAY_US && profile.floorUs == 0);
+
+    profile = P();
+    profile.delayUs = 4000;
+    ExpectTrue("drop doubles the delay", profile.Update(Dropped()) && profile.delayUs == 8000 && profile.floorUs == 4000);
+    for (int i = 0; i < 200; i++) profile.Update(Confirmed());
+    ExpectTrue("converges just above the overrun", profile.delayUs > 4000 && profile.delayUs <= 4000 + P::RESOLUTION_US);
+
+    InjectionFeedback backlog = Confirmed();
+    backlog.consumeUs = 2 * profile.delayUs + P::SLACK_US;
+    uint32_t before = profile.delayUs;
+    ExpectTrue("backlog counts as overrun", profile.Update(backlog) && profile.delayUs == 2 * before &&
+                                            profile.floorUs == before);
+    backlog.consumeUs = P::SLACK_US;
+    profile.Update(backlog);
+    ExpectTrue("small consume time is clean", profile.cleanRuns == 1);
+
+    for (uint32_t i = 0; i < P::FLOOR_EXPIRY_RUNS; i++) profile.Update(Confirmed());
+    ExpectTrue("floor expires", profile.floorUs == before / 2);
+
+    profile = P();
+    profile.delayUs = 37000;
+    profile.floorUs = 3100;
+    P unpacked = P::Unpack(profile.Pack());
+    ExpectTrue("pack round trip", unpacked.delayUs == 37000 && unpacked.floorUs == 3100 && unpacked.heldUs == 0);
+    profile.delayUs = 3700;
+    unpacked = P::Unpack(profile.Pack());
+    ExpectTrue("step down packed as a candidate", unpacked.delayUs == P::DEFAULT_DELAY_US && unpacked.heldUs == 3700);
+    ExpectTrue("unpack defaults", P::Unpack(0).delayUs == P::DEFAULT_DELAY_US &&
+                                  P::Unpack(0x80000001u).delayUs == P::MIN_DELAY_US);
+    ExpectTrue("legacy step down discarded", P::Unpack(40).delayUs == P::DEFAULT_DELAY_US &&
+                                             P::Unpack(400).delayUs == 40000);
+
+    // Pacer: profiles loaded by app name on first use, saved when they change
+    std::map<std::wstring, uint32_t> store;
+    store[L"term.exe"] = 0x80000000u | 40;  // 4 ms, confirmed by an earlier session
+    auto load = [&](const std::wstring& app, uint32_t& packed) {
+        auto it = store.find(app);
+        if (it == store.end()) return false;
+        packed = it->second;
+        return true;
+    };
+    auto save = [&](const std::wstring& app, uint32_t packed) { store[app] = packed; };
+    InjectionPacer pacer;
+    pacer.SetStore(load, save);
+    pacer.SetAppName(1, L"term.exe");
+    pacer.SetAppName(2, L"notepad.exe");
+    ExpectTrue("saved profile loaded", pacer.Pacing(1).eventDelayUs == 4000 &&
+                                       pacer.Pacing(2).eventDelayUs == P::DEFAULT_DELAY_US);
+    pacer.Report(2, Dropped());
+    ExpectTrue("raise saved at once", store.count(L"notepad.exe") == 1 &&
+                                      P::Unpack(store[L"notepad.exe"]).delayUs == 2 * P::DEFAULT_DELAY_US);
+    pacer.Report(0, Dropped());
+    ExpectTrue("unknown app not saved", store.size() == 2 && pacer.Profile(0).delayUs == 2 * P::DEFAULT_DELAY_US);
+
+    // A step down is kept for the next session only once a second one reaches it
+    pacer.SetAppName(3, L"fast.exe");
+    for (int i = 0; i < 200; i++) pacer.Report(3, Confirmed());
+    ExpectTrue("step down not saved in its session", pacer.Profile(3).delayUs == P::MIN_DELAY_US &&
+                                                     P::Unpack(store[L"fast.exe"]).delayUs == P::DEFAULT_DELAY_US);
+    InjectionPacer second;
+    second.SetStore(load, save);
+    second.SetAppName(3, L"fast.exe");
+    ExpectTrue("next session starts at the default", second.Pacing(3).eventDelayUs == P::DEFAULT_DELAY_US);
+    for (int i = 0; i < 200; i++) second.Report(3, Confirmed());
+    ExpectTrue("step down saved once it held", P::Unpack(store[L"fast.exe"]).delayUs == P::MIN_DELAY_US);
+}
+
+// ============================================================
+// Clipboard paste state machine (portable, synthetic clock)
+// ============================================================
+
+// Drive a paste until it waits or finishes; returns the actions taken
+static std::vector<PasteAction> Step(ClipboardPaste& paste, uint64_t now, bool ok = true) {
+    std::vector<PasteAction> actions;
+    for (PasteAction action; (action = paste.Next(now)) != PasteAction::Wait && action != PasteAction::Done;) {
+        actions.push_back(action);
+        paste.Complete(ok, now);
+    }
+    return actions;
+}
+
+static void RunClipboardPasteChecks() {
+    std::printf("Clipboard paste\n");
+    using A = PasteAction;
+    using C = ClipboardPaste;
+    InjectionPacing pacing = {1000, 2000};
+
+    // Clipboard work overlaps the backspace settle; Ctrl+V waits for it, and
+    // the user's clipboard comes back as soon as the target reads our text
+    C paste(3, true, pacing, 0);
+    ExpectTrue("saves while backspaces settle",
+               Step(paste, 0) == std::vector<A>({A::SendBackspaces, A::SaveClipboard, A::OfferText}) &&
+               paste.WakeUs() == 2000);
+    ExpectTrue("ctrl+v after the settle", Step(paste, 2000) == std::vector<A>({A::PasteKeysDown}) &&
+                                          paste.WakeUs() == 3000);
+    ExpectTrue("waits for the read", Step(paste, 3000) == std::vector<A>({A::PasteKeysUp}) &&
+                                     paste.WakeUs() == 3000 + C::RENDER_TIMEOUT_US);
+    paste.Rendered(3400);
+    ExpectTrue("restores on read", Step(paste, 3400) == std::vector<A>({A::RestoreClipboard}) && paste.IsDone());
+    ExpectTrue("read time is the consume time", paste.Feedback().consumeUs == 1400 &&
+                                                paste.Feedback().events == 10 && !paste.Feedback().dropped);
+
+    // A busy clipboard is retried on a timer, then given up for typing
+    C busy(0, true, pacing, 0);
+    Step(busy, 0, false);
+    ExpectTrue("busy clipboard retried later", busy.WakeUs() == C::RETRY_US && busy.Next(C::RETRY_US - 1) == A::Wait);
+    uint64_t now = 0;
+    std::vector<A> actions;
+    while (!busy.IsDone() && now < C::RENDER_TIMEOUT_US) {
+        now = busy.WakeUs();
+        actions = Step(busy, now, false);
+    }
+    ExpectTrue("gives up after the retries", now == C::RETRY_US * C::MAX_RETRIES &&
+                                             actions == std::vector<A>({A::SaveClipboard, A::TypeText}));
+
+    // Target never reads: restore after the timeout, and tell the pacer
+    C lost(0, true, pacing, 0);
+    Step(lost, 0);
+    Step(lost, 1000);
+    ExpectTrue("restores after the timeout", Step(lost, 1000 + C::RENDER_TIMEOUT_US) == std::vector<A>({A::RestoreClipboard}) &&
+                                             lost.Feedback().dropped);
+
+    // Read before Ctrl+V (a clipboard history app): no signal will follow
+    C early(1, true, pacing, 0);
+    Step(early, 0);
+    early.Rendered(10);
+    Step(early, 2000);
+    Step(early, 3000);
+    ExpectTrue("early read restores on a fixed delay", early.WakeUs() == 3000 + C::UNSIGNALED_RESTORE_US &&
+                                                       !early.IsDone());
+    Step(early, early.WakeUs());
+    ExpectTrue("early read is not a drop", early.IsDone() && !early.Feedback().dropped);
+
+    C erase(2, false, pacing, 0);
+    ExpectTrue("backspaces only", Step(erase, 0) == std::vector<A>({A::SendBackspaces}) && erase.IsDone());
+}
+
+// Drive a selection copy until it waits or finishes; returns the actions taken
+static std::vector<CopyAction> Step(SelectionCopy& copy, uint64_t now, bool ok = true) {
+    std::vector<CopyAction> actions;
+    for (CopyAction action; (action = copy.Next(now)) != CopyAction::Wait && action != CopyAction::Done;) {
+        actions.push_back(action);
+        copy.Complete(ok, now);
+    }
+    return actions;
+}
+
+static void RunSelectionCopyChecks() {
+    std::printf("Selection copy\n");
+    using A = CopyAction;
+    using C = SelectionCopy;
+
+    // The target copies after Ctrl+C: read the text, then the user's clipboard back
+    C copy(0);
+    ExpectTrue("saves, then ctrl+c", Step(copy, 0) == std::vector<A>({A::SaveClipboard, A::CopyKeysDown, A::CopyKeysUp}) &&
+                                     copy.IsAwaitingCopy() && copy.WakeUs() == C::POLL_US);
+    ExpectTrue("polls for the copy", Step(copy, C::POLL_US).empty() && copy.WakeUs() == 2 * C::POLL_US);
+    copy.Copied(7000);
+    ExpectTrue("reads on the change", Step(copy, 7000) == std::vector<A>({A::ReadClipboard, A::RestoreClipboard}) &&
+                                      copy.IsDone() && copy.HasText() && !copy.IsFailed());
+
+    // Copied while the keys were still going out: no wait at all
+    C quick(0);
+    quick.Next(0);
+    quick.Complete(true, 0);
+    quick.Next(0);
+    quick.Complete(true, 0);
+    quick.Copied(0);
+    ExpectTrue("copied on key down", Step(quick, 0) == std::vector<A>({A::CopyKeysUp, A::ReadClipboard, A::RestoreClipboard}) &&
+                                     quick.HasText());
+
+    // Nothing selected: nothing changes, the clipboard comes back on the timeout
+    C none(0);
+    Step(none, 0);
+    uint64_t now = 0;
+    while (!none.IsDone() && now <= C::COPY_TIMEOUT_US) {
+        now = none.WakeUs();
+        Step(none, now);
+    }
+    ExpectTrue("no selection times out", none.IsDone() && now == C::COPY_TIMEOUT_US && !none.HasText() && !none.IsFailed());
+
+    // A clipboard that stays busy fails the copy before any key goes out
+    C busy(0);
+    std::vector<A> actions;
+    for (now = 0; !busy.IsDone(); now = busy.WakeUs()) {
+        for (A action : Step(busy, now, false)) actions.push_back(action);
+    }
+    ExpectTrue("busy clipboard fails", busy.IsFailed() && actions.size() == C::MAX_RETRIES + 1 &&
+                                       actions.back() == A::SaveClipboard);
+
+    // Conversion stops at the next chunk once cancelled
+    std::wstring text(3 * SelectionConverter::CHUNK_UNITS, L'a');
+    std::wstring out;
+    std::atomic<bool> cancel{false};
+    ExpectTrue("converts in chunks", SelectionConverter::Convert(text, VietEncoding::TCVN3, VietEncoding::Unicode, out, cancel) &&
+                                     out == text);
+    cancel = true;
+    ExpectTrue("cancelled conversion stops", !SelectionConverter::Convert(text, VietEncoding::TCVN3, VietEncoding::Unicode, out, cancel) &&
+                                             out.empty());
+}
+
+// ============================================================
+// Pending edit fold (portable, randomized)
+// ============================================================
+
+// Reference screen: one backspace erases one character (a surrogate pair whole)
+static void ApplyEdit(std::wstring& screen, int backspaces, const std::wstring& text) {
+    for (int i = 0; i < backspaces && !screen.empty(); i++) {
+        size_t cut = 1;
+        if (screen.length() >= 2 && screen.back() >= 0xDC00 && screen.back() <= 0xDFFF &&
+            screen[screen.length() - 2] >= 0xD800 && screen[screen.length() - 2] <= 0xDBFF) {
+            cut = 2;
+        }
+        screen.resize(screen.length() - cut);
+    }
+    screen += text;
+}
+
+struct Edit {
+    int backspaces;
+    std::wstring text;
+};
+
+static std::wstring RandomText(std::mt19937& random, size_t maxChars) {
+    static const wchar_t* const pieces[] = {L"a", L"ă", L"ệ", L" ", L"\xD83D\xDE00"};
+    std::wstring text;
+    for (size_t n = random() % (maxChars + 1); n > 0; n--) text += pieces[random() % 5];
+    return text;
+}
+
+static void RunPendingEditChecks() {
+    std::printf("Pending edit fold\n");
+    std::mt19937 random(2026);
+    bool sameScreen = true, splitFolds = true, bounded = true;
+    for (int run = 0; run < 20000; run++) {
+        std::wstring screen = RandomText(random, 8);
+        std::vector<Edit> edits(1 + random() % 12);
+        for (Edit& edit : edits) {
+            edit.backspaces = static_cast<int>(random() % 5);
+            edit.text = RandomText(random, 4);
+        }
+
+        // Injecting the fold once leaves the same screen as each edit in turn
+        PendingEdit fold;
+        std::wstring sequential = screen;
+        int totalBackspaces = 0;
+        size_t totalText = 0;
+        for (const Edit& edit : edits) {
+            fold.Fold(edit.backspaces, edit.text.c_str(), edit.text.length());
+            ApplyEdit(sequential, edit.backspaces, edit.text);
+            totalBackspaces += edit.backspaces;
+            totalText += edit.text.length();
+        }
+        std::wstring folded = screen;
+        ApplyEdit(folded, fold.Backspaces(), fold.Text());
+        sameScreen = sameScreen && folded == sequential && fold.Count() == edits.size();
+
+        // Folding is associative: fold the tail separately, then fold it in
+        size_t split = random() % (edits.size() + 1);
+        PendingEdit head, tail;
+        for (size_t i = 0; i < edits.size(); i++) {
+            PendingEdit& part = i < split ? head : tail;
+            part.Fold(edits[i].backspaces, edits[i].text.c_str(), edits[i].text.length());
+        }
+        head.Fold(tail.Backspaces(), tail.Text().c_str(), tail.Text().length());
+        splitFolds = splitFolds && head.Backspaces() == fold.Backspaces() && head.Text() == fold.Text();
+
+        // Never more work than the edits themselves
+        bounded = bounded && fold.Backspaces() <= totalBackspaces && fold.Text().length() <= totalText;
+    }
+    ExpectTrue("fold leaves the same screen", sameScreen);
+    ExpectTrue("fold is associative", splitFolds);
+    ExpectTrue("fold never adds work", bounded);
+
+    PendingEdit pair;
+    pair.Fold(0, L"x\xD83D\xDE00", 3);
+    pair.Fold(1, L"y", 1);
+    ExpectTrue("backspace cancels a whole pair", pair.Text() == L"xy" && pair.Backspaces() == 0);
+    pair.Reset();
+    ExpectTrue("reset", pair.Text().empty() && pair.Backspaces() == 0 && pair.Count() == 0);
+}
+
+// ============================================================
+// Encoding converter
+// ============================================================
+
+static std::wstring Widen(const char16_t* text, size_t count) {
+    return std::wstring(text, text + count);
+}
+
+// Convert through the table one character at a time (reference for the ASCII fast path)
+template <typename Table>
+static std::wstring MapEach(const Table& table, const std::wstring& text) {
+    std::wstring result;
+    for (wchar_t c : text) result += static_cast<wchar_t>(table.Map(static_cast<uint32_t>(c)));
+    return result;
+}
+
+// Convert through EncodingStream in chunks of the given sizes (cycled)
+static std::wstring StreamChunks(const std::wstring& text, VietEncoding from, VietEncoding to,
+                                 const std::vector<size_t>& sizes) {
+    EncodingStream stream(from, to);
+    std::wstring result;
+    wchar_t out[EncodingStream::MaxOutput(64)];
+    size_t at = 0;
+    for (size_t i = 0; at < text.length(); i++) {
+        size_t length = std::min(sizes[i % sizes.size()], text.length() - at);
+        result.append(out, stream.Push(text.data() + at, length, out));
+        at += length;
+    }
+    result.append(out, stream.Finish(out));
+    return result;
+}
+
+#ifdef VIKEY_BENCH_ICU
+// ICU normalization of BMP text (NFC or NFD)
+static std::wstring IcuNormalize(const std::wstring& text, bool compose) {
+    UErrorCode error = U_ZERO_ERROR;
+    const UNormalizer2* normalizer = compose ? unorm2_getNFCInstance(&error) : unorm2_getNFDInstance(&error);
+    std::u16string in(text.begin(), text.end());
+    std::u16string out(text.size() * 3 + 16, u'\0');
+    int32_t length = unorm2_normalize(normalizer, in.data(), static_cast<int32_t>(in.size()), &out[0],
+                                      static_cast<int32_t>(out.size()), &error);
+    if (U_FAILURE(error)) return L"<ICU error>";
+    return std::wstring(out.begin(), out.begin() + length);
+}
+#endif
+
+// Vietnamese prose for detection (every letter class: hats, horns, đ, all tones)
+static std::wstring DetectPassage() {
+    return L"Mùa thu năm ấy, trời trong xanh, gió nhẹ thổi qua những rặng tre đầu làng. Ông bà tôi kể rằng "
+           L"ngày xưa người ta đi chợ bằng thuyền, mua cá, mua rau rồi về nấu cơm chiều. Những đứa trẻ chạy nhảy "
+           L"trên bờ đê, tiếng cười vang cả một khoảng trời. Hà Nội, Huế, Sài Gòn: mỗi nơi một vẻ, mỗi miền một "
+           L"giọng nói riêng. Độc lập - Tự do - Hạnh phúc. Tiếng Việt được viết bằng chữ Quốc ngữ với các dấu "
+           L"thanh và dấu phụ trên nguyên âm; ĐẠI HỌC QUỐC GIA, Ủy ban, khuya, khuỷu tay, quẫy đuôi.";
+}
+
+static void RunConverterChecks() {
+    std::printf("Encoding converter\n");
+    using namespace EncodingTables;
+    EncodingConverter& converter = EncodingConverter::Instance();
+    const VietEncoding U = VietEncoding::Unicode;
+    const VietEncoding TCVN3 = VietEncoding::TCVN3;
+    const VietEncoding VNI = VietEncoding::VNI_Windows;
+    const VietEncoding NFD = VietEncoding::Unicode_Comp;
+    const VietEncoding VISCII = VietEncoding::VISCII;
+    const VietEncoding CP1258 = VietEncoding::CP1258;
+    const VietEncoding VIQR = VietEncoding::VIQR;
+
+    // TCVN3 has a code for every lowercase letter and for Ă Â Ê Ô Ơ Ư Đ
+    std::wstring lower = Widen(UNICODE_LETTERS, LETTER_COUNT / 2);
+    std::wstring plainUpper = L"ĂÂÊÔƠƯĐ";
+    Expect("TCVN3 round trip (lowercase)", converter.Convert(converter.Convert(lower, U, TCVN3), TCVN3, U), lower);
+    Expect("TCVN3 round trip (Ă..Đ)", converter.Convert(converter.Convert(plainUpper, U, TCVN3), TCVN3, U),
+           plainUpper);
+    Expect("TCVN3 ệ", converter.Convert(L"ệ", U, TCVN3), L"\xD6");
+    Expect("TCVN3 toned capital uses the lowercase code", converter.Convert(L"Ế", U, TCVN3), L"\xD5");
+
+    // ASCII is never touched (the old tables turned 'U' into 'Ï' on the way to VNI)
+    std::wstring ascii;
+    for (wchar_t c = 0x20; c < 0x7F; c++) ascii += c;
+    const VietEncoding encodings[] = {U, VNI, TCVN3, NFD, VISCII, CP1258, VIQR};
+    bool asciiKept = true;
+    for (VietEncoding from : encodings) {
+        for (VietEncoding to : encodings) {
+            if (converter.Convert(ascii, from, to) != ascii) asciiKept = false;
+        }
+    }
+    ExpectTrue("ASCII unchanged for every pair", asciiKept);
+    Expect("other scripts unchanged", converter.Convert(L"€ 😀 日本 Ω", U, TCVN3), L"€ 😀 日本 Ω");
+
+    // ASCII runs of every length and alignment around the 16-byte fast path
+    std::mt19937 random(2016);
+    std::wstring mixed;
+    for (int i = 0; i < 4000; i++) {
+        if (random() % 3 == 0) {
+            mixed += static_cast<wchar_t>(UNICODE_LETTERS[random() % LETTER_COUNT]);
+        } else {
+            mixed.append(random() % 40, static_cast<wchar_t>(L'a' + random() % 26));
+        }
+    }
+    Expect("fast path matches per-character (to TCVN3)", converter.Convert(mixed, U, TCVN3),
+           MapEach(UNICODE_TO_TCVN3, mixed));
+    std::wstring tcvn3 = MapEach(UNICODE_TO_TCVN3, mixed);
+    Expect("fast path matches per-character (from TCVN3)", converter.Convert(tcvn3, TCVN3, U),
+           MapEach(TCVN3_TO_UNICODE, tcvn3));
+
+    // VNI Windows: toned letters are a base and a mark, every letter round trips
+    std::wstring letters = Widen(UNICODE_LETTERS, LETTER_COUNT);
+    Expect("VNI round trip (all letters)", converter.Convert(converter.Convert(letters, U, VNI), VNI, U),
+           letters);
+    Expect("VNI two-unit letters", converter.Convert(L"Tiếng Việt đẹp", U, VNI), L"Tieáng Vieät ñeïp");
+    Expect("VNI single-unit letters", converter.Convert(L"Ơn ích lợi", U, VNI), L"Ôn ích lôïi");
+    Expect("VNI decode", converter.Convert(L"Coäng hoøa xaõ hoäi", VNI, U), L"Cộng hòa xã hội");
+    Expect("VNI mark without a base kept", converter.Convert(L"ä", VNI, U), L"ä");
+    std::wstring vni = converter.Convert(mixed, U, VNI);
+    Expect("VNI round trip (mixed)", converter.Convert(vni, VNI, U), mixed);
+    Expect("VNI to TCVN3 in one pass", converter.Convert(vni, VNI, TCVN3), tcvn3);
+    Expect("TCVN3 to VNI in one pass", converter.Convert(converter.Convert(lower, U, TCVN3), TCVN3, VNI),
+           converter.Convert(lower, U, VNI));
+
+    // Unicode Composite: the built-in NFD/NFC of the Vietnamese letters
+    std::wstring nfd = converter.Convert(letters, U, NFD);
+    Expect("NFD round trip (all letters)", converter.Convert(nfd, NFD, U), letters);
+    Expect("NFD mark order", converter.Convert(L"Tiếng Việt ợ Ặ đ", U, NFD),
+           L"Tie\u0302\u0301ng Vie\u0323\u0302t o\u031B\u0323 A\u0323\u0306 đ");
+    Expect("NFC of other mark orders", converter.Convert(L"e\u0302\u0323 o\u0300\u031B u\u0323\u031B", NFD, U),
+           L"ệ ờ ự");
+    Expect("NFC of partly composed letters", converter.Convert(L"\u00E2\u0301 \u1EA1\u0302 \u01A1\u0323 ò\u031B", NFD, U),
+           L"ấ ậ ợ ờ");
+    Expect("NFC keeps what does not compose", converter.Convert(L"á\u0302 a\u0301\u0301 \u0301x đ\u0301", NFD, U),
+           L"á\u0302 á\u0301 \u0301x đ\u0301");
+    Expect("NFD to VNI in one pass", converter.Convert(nfd, NFD, VNI), converter.Convert(letters, U, VNI));
+    Expect("TCVN3 to NFD in one pass", converter.Convert(tcvn3, TCVN3, NFD),
+           converter.Convert(converter.Convert(tcvn3, TCVN3, U), U, NFD));
+#ifdef VIKEY_BENCH_ICU
+    std::wstring forms;
+    for (size_t i = 0; i < COMPOSITE_FORMS.count; i++) {
+        for (uint64_t units = COMPOSITE_FORMS.entries[i].sequence; units != 0; units >>= 16) {
+            forms += static_cast<wchar_t>(units & 0xFFFF);
+        }
+        forms += L' ';
+    }
+    Expect("NFD matches ICU", nfd, IcuNormalize(letters, false));
+    Expect("NFC matches ICU (every accepted form)", converter.Convert(forms, NFD, U), IcuNormalize(forms, true));
+#endif
+
+    // Direct tables give what two passes through Unicode give, for any unit
+    const wchar_t marks[] = {GRAVE, ACUTE, CIRCUMFLEX, TILDE, BREVE, HOOK_ABOVE, HORN, DOT_BELOW};
+    std::wstring soup;
+    for (int i = 0; i < 20000; i++) {
+        int kind = random() % 8;
+        soup += kind == 0 ? static_cast<wchar_t>(UNICODE_LETTERS[random() % LETTER_COUNT])
+              : kind == 1 ? marks[random() % 8]
+                          : static_cast<wchar_t>(0x20 + random() % 0xE0);
+    }
+    bool direct = true;
+    for (VietEncoding from : encodings) {
+        for (VietEncoding to : encodings) {
+            direct = direct && (from == to || converter.Convert(soup, from, to) ==
+                                                   converter.Convert(converter.Convert(soup, from, U), U, to));
+        }
+    }
+    ExpectTrue("direct tables match two passes", direct);
+
+    // Chunk boundaries: a base at the end of a chunk waits for its mark
+    const std::wstring word = L"Vieät Nam ñeïp ôû";
+    bool everySplit = true;
+    for (size_t split = 0; split <= word.length(); split++) {
+        everySplit = everySplit && StreamChunks(word, VNI, U, {split, word.length()}) ==
+                                       L"Việt Nam đẹp ở";
+    }
+    ExpectTrue("VNI stream split anywhere", everySplit);
+    const std::wstring decomposed = L"Vie\u0323\u0302t o\u031B\u0300";
+    bool nfdSplit = true;
+    for (size_t first = 0; first <= decomposed.length(); first++) {
+        for (size_t second = 1; second <= 3; second++) {
+            nfdSplit = nfdSplit && StreamChunks(decomposed, NFD, U, {first, second, decomposed.length()}) == L"Việt ờ";
+        }
+    }
+    ExpectTrue("NFD stream split anywhere", nfdSplit);
+    bool chunked = true;
+    for (size_t size = 1; size <= 17; size++) {
+        chunked = chunked && StreamChunks(vni, VNI, U, {size, 64 - size}) == mixed &&
+                  StreamChunks(vni, VNI, TCVN3, {size}) == tcvn3 && StreamChunks(mixed, U, VNI, {size}) == vni &&
+                  StreamChunks(converter.Convert(vni, VNI, NFD), NFD, U, {size}) == mixed;
+    }
+    ExpectTrue("chunked streams match one pass", chunked);
+
+    // Codec registry: VISCII, Windows-1258 and VIQR run on the same tables
+    Expect("VISCII round trip (all letters)", converter.Convert(converter.Convert(letters, U, VISCII), VISCII, U), letters);
+    Expect("VISCII letters on control codes", converter.Convert(L"\x02\tỴ\r\n", U, VISCII), L"\x02\t\x1E\r\n");
+    std::wstring viscii = converter.Convert(mixed + L"\nẲẴẪỶỸỴ\t", U, VISCII);
+    Expect("VISCII printable fast path matches per-character", converter.Convert(viscii, VISCII, U),
+           MapEach(VISCII_TO_UNICODE, viscii));
+    Expect("Windows-1258 round trip (all letters)", converter.Convert(converter.Convert(letters, U, CP1258), CP1258, U),
+           letters);
+    Expect("Windows-1258 as Windows writes it", converter.Convert(L"Việt à ý", U, CP1258), L"Vi\xEA\xF2t \xE0 y\xEC");
+    Expect("Windows-1258 tone after a precomposable letter", converter.Convert(L"a\xCC e\xEC \xE0\xCC", CP1258, U),
+           L"à é à\xCC");
+    Expect("VIQR round trip (all letters)", converter.Convert(converter.Convert(letters, U, VIQR), VIQR, U), letters);
+    Expect("VIQR mnemonics", converter.Convert(L"Tiếng Việt, Đường ơi", U, VIQR), L"Tie^'ng Vie^.t, DDu+o+`ng o+i");
+    Expect("VIQR escapes", converter.Convert(L"Ha\\. d\\d a\\\\", VIQR, U), L"Ha. dd a\\");
+    Expect("VIQR to VNI in one pass", converter.Convert(L"Vie^.t Nam dde^'n", VIQR, VNI), L"Vieät Nam ñeán");
+    const std::wstring mnemonics = L"Tie^'ng Vie^.t ddu+o+`ng";
+    bool viqrSplit = true;
+    for (size_t first = 0; first <= mnemonics.length(); first++) {
+        for (size_t second = 1; second <= 3; second++) {
+            viqrSplit = viqrSplit && StreamChunks(mnemonics, VIQR, U, {first, second, mnemonics.length()}) ==
+                                         L"Tiếng Việt đường";
+        }
+    }
+    ExpectTrue("VIQR stream split anywhere", viqrSplit);
+    std::wstring cp1258 = converter.Convert(mixed, U, CP1258);
+    bool codecChunks = true;
+    for (size_t size = 1; size <= 17; size++) {
+        codecChunks = codecChunks && StreamChunks(cp1258, CP1258, U, {size}) == mixed &&
+                      StreamChunks(viscii, VISCII, TCVN3, {size}) == converter.Convert(viscii, VISCII, TCVN3) &&
+                      StreamChunks(converter.Convert(mixed, U, VIQR), VIQR, U, {size, 64 - size}) ==
+                          converter.Convert(converter.Convert(mixed, U, VIQR), VIQR, U);
+    }
+    ExpectTrue("chunked streams match one pass (new codecs)", codecChunks);
+
+    // Detection: slices of a passage in each encoding rank their own first.
+    // Small-letter VISCII prose also reads as TCVN3 (ties go to TCVN3), so
+    // it needs longer slices; VIQR is ASCII and never detected.
+    const std::wstring passage = DetectPassage();
+    bool detected = true;
+    for (VietEncoding encoding : {U, VNI, TCVN3, NFD, VISCII, CP1258}) {
+        for (size_t shortest : {30, 60, 400}) {
+            size_t length = encoding == VISCII ? std::max<size_t>(shortest, 120) : shortest;
+            for (size_t at = 0; at + length <= passage.length(); at += 37) {
+                std::wstring slice = converter.Convert(passage.substr(at, length), U, encoding);
+                std::vector<EncodingGuess> guesses = EncodingConverter::Detect(slice);
+                if (guesses.front().encoding != encoding || guesses.size() != 6) {
+                    std::printf("        %s misread as %s: %s\n", ToUtf8(EncodingConverter::GetEncodingName(encoding)).c_str(),
+                                ToUtf8(EncodingConverter::GetEncodingName(guesses.front().encoding)).c_str(),
+                                ToUtf8(slice).c_str());
+                    detected = false;
+                }
+            }
+        }
+    }
+    ExpectTrue("detect ranks the source encoding first (30+ chars)", detected);
+    std::vector<EncodingGuess> plain = EncodingConverter::Detect(ascii);
+    ExpectTrue("detect: ASCII fits every encoding, Unicode first",
+               plain.front().encoding == U && std::all_of(plain.begin(), plain.end(), [](const EncodingGuess& g) {
+                   return g.confidence == 1.0f;
+               }));
+    std::vector<EncodingGuess> sure = EncodingConverter::Detect(converter.Convert(passage, U, VNI));
+    ExpectTrue("detect: confidence ranks the rest below", sure[0].confidence == 1.0f && sure[1].confidence < 0.7f);
+    ExpectTrue("detect: empty text", EncodingConverter::Detect(L"", 0).front().encoding == U);
+
+    EncodingStream held(VNI, U);
+    wchar_t out[EncodingStream::MaxOutput(1)];
+    size_t pushed = held.Push(L"o", 1, out);
+    ExpectTrue("stream holds a trailing base until Finish", pushed == 0 && held.Finish(out) == 1 &&
+                                                                          out[0] == L'o' && held.Finish(out) == 0);
+}
+
+// ============================================================
+// Text transforms
+// ============================================================
+
+// Transform through TextTransform in chunks of the given sizes (cycled)
+static std::wstring TransformChunks(const std::wstring& text, const std::vector<TransformStage>& stages,
+                                    const std::vector<size_t>& sizes) {
+    TextTransform transform(stages);
+    std::wstring result;
+    wchar_t out[TextTransform::MaxOutput(64)];
+    size_t at = 0;
+    for (size_t i = 0; at < text.length(); i++) {
+        size_t length = std::min(sizes[i % sizes.size()], text.length() - at);
+        result.append(out, transform.Push(text.data() + at, length, out));
+        at += length;
+    }
+    result.append(out, transform.Finish(out));
+    return result;
+}
+
+static void RunTransformChecks() {
+    std::printf("Text transforms\n");
+    using TS = TransformStage;
+    const VietEncoding U = VietEncoding::Unicode, NFD = VietEncoding::Unicode_Comp;
+    EncodingConverter& converter = EncodingConverter::Instance();
+    auto apply = [](const std::wstring& text, std::vector<TS> stages) { return TextTransform(stages).Apply(text); };
+
+    Expect("strip diacritics", apply(L"Đường phố Hà Nội, khuỷu tay, QUẪY ĐUÔI", {TS::StripDiacritics}),
+           L"Duong pho Ha Noi, khuyu tay, QUAY DUOI");
+    Expect("upper", apply(L"tiếng việt đẹp, ưu tiên ă ơ ỹ; ça va", {TS::Upper}), L"TIẾNG VIỆT ĐẸP, ƯU TIÊN Ă Ơ Ỹ; ÇA VA");
+    Expect("lower", apply(L"ĐẠI HỌC QUỐC GIA Ủy Ban ÀÉ", {TS::Lower}), L"đại học quốc gia ủy ban àé");
+    Expect("title", apply(L"hà nội - sài GÒN, đại học 2nd ấp", {TS::Title}), L"Hà Nội - Sài Gòn, Đại Học 2nd Ấp");
+    Expect("empty pipeline", apply(L"Tiếng Việt", {}), L"Tiếng Việt");
+
+    // Independent references on the passage: stripping is NFD without its
+    // marks (đ to d); upper case of NFC is the NFC of the upper-cased NFD,
+    // whose bases are ASCII
+    const std::wstring passage = DetectPassage();
+    const std::wstring nfd = converter.Convert(passage, U, NFD);
+    std::wstring bare;
+    for (wchar_t c : nfd) {
+        if (c >= 0x300 && c < 0x370) continue;
+        bare += c == L'đ' ? L'd' : c == L'Đ' ? L'D' : c;
+    }
+    Expect("strip: NFD without its marks", apply(passage, {TS::StripDiacritics}), bare);
+    Expect("strip reads NFD letters too", apply(nfd, {TS::StripDiacritics}), bare);
+    Expect("upper: NFD upper-cased unit by unit, composed",
+           converter.Convert(apply(nfd, {TS::Upper}), NFD, U), apply(passage, {TS::Upper}));
+    Expect("lower undoes upper", apply(apply(passage, {TS::Upper}), {TS::Lower}), apply(passage, {TS::Lower}));
+    Expect("NFC repair", apply(nfd, {TS::ComposeNfc}), passage);
+    std::wstring reordered = L"a\u0302\u0323 \u1EA1\u0302 \u00E2\u0323 o\u0301\u031B \u00F3\u031B \u00F4\u0300";
+    Expect("NFC repair: equivalent orders and half-composed", apply(reordered, {TS::ComposeNfc}),
+           L"\u1EAD \u1EAD \u1EAD \u1EDB \u1EDB \u1ED3");
+
+    // One fused pass matches the stages run one after another, in one call
+    // or in chunks that split decomposed letters anywhere
+    const std::vector<std::vector<TS>> pipelines = {
+        {TS::ComposeNfc, TS::StripDiacritics, TS::Upper},
+        {TS::ComposeNfc, TS::Title},
+        {TS::StripDiacritics, TS::Lower},
+        {TS::Upper, TS::ComposeNfc},
+        {TS::Title, TS::StripDiacritics},
+        {TS::Lower, TS::Title}};
+    std::mt19937 random(7);
+    std::vector<size_t> sizes;
+    for (int i = 0; i < 200; i++) sizes.push_back(1 + random() % 9);
+    bool fused = true, chunked = true;
+    for (const auto& stages : pipelines) {
+        for (const std::wstring& text : {passage, nfd, nfd + L" " + passage}) {
+            std::wstring sequential = text;
+            for (TS stage : stages) sequential = apply(sequential, {stage});
+            std::wstring once = apply(text, stages);
+            fused = fused && once == sequential;
+            chunked = chunked && TransformChunks(text, stages, sizes) == once &&
+                      TransformChunks(text, stages, {1}) == once;
+        }
+    }
+    ExpectTrue("fused pipeline matches sequential stages", fused);
+    ExpectTrue("chunked pipeline matches one pass", chunked);
+
+    // The library call transforms the Unicode text between two encodings
+    std::wstring vni = converter.Convert(passage, U, VietEncoding::VNI_Windows);
+    Expect("convert with stages: VNI to TCVN3, stripped",
+           converter.Convert(vni, VietEncoding::VNI_Windows, VietEncoding::TCVN3, {TS::StripDiacritics}),
+           converter.Convert(apply(passage, {TS::StripDiacritics}), U, VietEncoding::TCVN3));
+    Expect("convert with stages: NFD to VNI, title case",
+           converter.Convert(nfd, NFD, VietEncoding::VNI_Windows, {TS::Title}),
+           converter.Convert(apply(passage, {TS::Title}), U, VietEncoding::VNI_Windows));
+    Expect("convert with stages: Unicode to Unicode", converter.Convert(nfd, U, U, {TS::ComposeNfc, TS::Upper}),
+           apply(passage, {TS::Upper}));
+}
+
+// ============================================================
+// Byte conversion
+// ============================================================
+
+static std::string Utf8Of(const std::wstring& text) {
+    std::string bytes(text.size() * Utf8Codec::MAX_BYTES_PER_UNIT, '\0');
+    bytes.resize(Utf8Codec::Encode(text.data(), text.size(), &bytes[0]));
+    return bytes;
+}
+
+static std::wstring FromUtf8(const std::string& bytes) {
+    std::wstring text(bytes.size(), L'\0');
+    text.resize(Utf8Codec::Decode(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), &text[0]));
+    return text;
+}
+
+static void RunByteConverterChecks() {
+    std::printf("Byte conversion\n");
+    EncodingConverter& converter = EncodingConverter::Instance();
+
+    // UTF-8 codec against known bytes
+    const std::wstring emoji = sizeof(wchar_t) == 2 ? std::wstring(L"\xD83D\xDE00") : std::wstring(1, static_cast<wchar_t>(0x1F600));
+    ExpectTrue("utf8: encode", Utf8Of(L"Việt đ à A") + Utf8Of(emoji) ==
+                                   "Vi\xE1\xBB\x87t \xC4\x91 \xC3\xA0 A\xF0\x9F\x98\x80");
+    Expect("utf8: decode", FromUtf8("Vi\xE1\xBB\x87t \xC4\x91 \xF0\x9F\x98\x80"), L"Việt đ " + emoji);
+    Expect("utf8: malformed bytes are U+FFFD each",
+           FromUtf8("a\x80" "b\xC0\xAF" "c\xED\xA0\x80" "d\xF8\xBB\xB1" "e\xE1\xBA"),
+           L"a�b��c���d���e��");
+    Expect("utf8: lone surrogate encodes as U+FFFD", FromUtf8(Utf8Of(std::wstring(1, static_cast<wchar_t>(0xDC00)) + L"x")),
+           L"�x");
+    const uint8_t cut[] = {'a', 0xE1, 0xBB};
+    const uint8_t whole[] = {'a', 0xC3, 0xA0};
+    ExpectTrue("utf8: chunk ends before a cut sequence",
+               Utf8Codec::WholeLength(cut, 3) == 1 && Utf8Codec::WholeLength(whole, 3) == 3);
+    std::wstring sample;
+    std::mt19937 random(11);
+    for (int i = 0; i < 20000; i++) {
+        uint32_t kind = random() % 4;
+        uint32_t cp = kind == 0 ? random() % 0x80 : kind == 1 ? 0x80 + random() % 0x780 : 0x800 + random() % 0xD000;
+        if (kind == 3) sample += emoji;
+        else sample += static_cast<wchar_t>(cp);
+    }
+    Expect("utf8: round trip (ASCII blocks and every length)", FromUtf8(Utf8Of(sample)), sample);
+
+    // Bytes in, bytes out: the same as widening, converting and narrowing,
+    // on text long enough to cross the converter's chunks anywhere
+    std::wstring passage = DetectPassage() + L" " + emoji + L" 中 ";
+    std::wstring text;
+    while (text.size() < 40000) text += passage;
+    auto bytesOf = [&](const std::wstring& units, VietEncoding encoding) {
+        if (encoding == VietEncoding::Unicode || encoding == VietEncoding::Unicode_Comp) return Utf8Of(units);
+        std::string bytes;
+        for (wchar_t c : units) bytes += static_cast<uint32_t>(c) <= 0xFF ? static_cast<char>(c) : '?';
+        return bytes;
+    };
+    bool same = true;
+    for (int from = 0; from < VIET_ENCODING_COUNT; from++) {
+        for (int to = 0; to < VIET_ENCODING_COUNT; to++) {
+            VietEncoding f = static_cast<VietEncoding>(from), t = static_cast<VietEncoding>(to);
+            std::wstring source = converter.Convert(text, VietEncoding::Unicode, f);
+            std::string in = bytesOf(source, f);
+            std::string out;
+            StringSink sink(out);
+            bool ok = converter.Convert(in.data(), in.size(), sink, f, t);
+            std::wstring widened;
+            if (f == VietEncoding::Unicode || f == VietEncoding::Unicode_Comp) widened = FromUtf8(in);
+            else for (unsigned char c : in) widened += static_cast<wchar_t>(c);
+            if (!ok || out != bytesOf(converter.Convert(widened, f, t), t)) {
+                std::printf("        %s -> %s differs\n", ToUtf8(EncodingConverter::GetEncodingName(f)).c_str(),
+                            ToUtf8(EncodingConverter::GetEncodingName(t)).c_str());
+                same = false;
+            }
+        }
+    }
+    ExpectTrue("bytes convert like wide strings (every pair)", same);
+
+    // Into a fixed buffer (prose VNI can hold whole)
+    std::wstring prose;
+    while (prose.size() < 40000) prose += DetectPassage() + L" ";
+    std::string vni = bytesOf(converter.Convert(prose, VietEncoding::Unicode, VietEncoding::VNI_Windows), VietEncoding::VNI_Windows);
+    std::string want = Utf8Of(prose);
+    std::vector<char> buffer(want.size());
+    BufferSink exact(buffer.data(), buffer.size());
+    ExpectTrue("caller buffer of the exact size",
+               converter.Convert(vni.data(), vni.size(), exact, VietEncoding::VNI_Windows, VietEncoding::Unicode) &&
+                   exact.Length() == want.size() && std::string(buffer.begin(), buffer.end()) == want);
+    BufferSink small(buffer.data(), buffer.size() - 1);
+    ExpectTrue("caller buffer too small: fails, what fit is kept",
+               !converter.Convert(vni.data(), vni.size(), small, VietEncoding::VNI_Windows, VietEncoding::Unicode) &&
+                   small.Length() < want.size() && want.compare(0, small.Length(), buffer.data(), small.Length()) == 0);
+    std::string repaired;
+    StringSink repairedSink(repaired);
+    converter.Convert("ok\xFF", 3, repairedSink, VietEncoding::Unicode, VietEncoding::Unicode);
+    ExpectTrue("UTF-8 to UTF-8 repairs malformed bytes", repaired == "ok\xEF\xBF\xBD");
+}
+
+// Default settings, applied to the processor (in-memory store starts empty)
+static void ResetSettings() {
+    Settings& settings = Settings::Instance();
+    settings.enabled = true;
+    settings.method = InputMethod::Telex;
+    settings.smartSwitch = false;
+    settings.clipboardMode = false;
+    settings.slowMode = false;
+    settings.shortcuts.clear();
+    settings.excludedApps.clear();
+    settings.appRules.clear();
+    ImeProcessor::Instance().ApplySettings();
+}
+
+// Fresh foreground window (own typing context and text field)
+static HWND Focus(SimPlatform& sim, const wchar_t* app, const wchar_t* windowClass = L"SimWindow") {
+    HWND window = sim.AddWindow(app, windowClass);
+    sim.SetForeground(window);
+    return window;
+}
+
+static void RunScenarios(SimPlatform& sim) {
+    std::printf("Scenarios\n");
+
+    ResetSettings();
+    Focus(sim, L"notepad.exe");
+    sim.TypeText("Vieejt Nam laf mootj quoocs gia\n");
+    sim.PumpMessages();
+    Expect("telex words", sim.FocusedField().text, L"Việt Nam là một quốc gia\n");
+
+    Focus(sim, L"notepad.exe");
+    sim.TypeText("tieengs\b\bn");
+    sim.PumpMessages();
+    Expect("backspace edits", sim.FocusedField().text, L"tiến");
+
+    Settings::Instance().method = InputMethod::VNI;
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"notepad.exe");
+    sim.TypeText("Tie6ng1 Vie65t ");
+    sim.PumpMessages();
+    Expect("vni method", sim.FocusedField().text, L"Tiếng Việt ");
+    ResetSettings();
+
+    // Long shortcut expansion goes through the clipboard paste; keys typed
+    // before the output thread runs it queue behind it instead of overtaking
+    Settings::Instance().shortcuts.push_back({L"ko", L"không có gì đâu bạn ơi"});
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"notepad.exe");
+    sim.clipboard = L"user clipboard";
+    sim.TypeText("ko tooi ");
+    Expect("paste pending", sim.FocusedField().text, L"ko");
+    sim.PumpMessages();
+    Expect("held keys after paste", sim.FocusedField().text, L"không có gì đâu bạn ơi tôi ");
+    Expect("clipboard restored", sim.clipboard, L"user clipboard");
+
+    // Ctrl+V pressed while the expansion is still queued pastes after it
+    Focus(sim, L"notepad.exe");
+    sim.TypeText("ko ");
+    sim.SetKeyDown(VK_CONTROL_KEY, true);
+    bool heldShortcut = sim.PressKey(VK_A_KEY + ('v' - 'a'));
+    sim.SetKeyDown(VK_CONTROL_KEY, false);
+    sim.PumpMessages();
+    ExpectTrue("ctrl+v held behind queued output", heldShortcut);
+    Expect("ctrl+v after the expansion", sim.FocusedField().text, L"không có gì đâu bạn ơi user clipboard");
+    ResetSettings();
+
+    // Clipboard formats (RTF, a DIB) survive a paste, and a clipboard another app
+    // holds is retried instead of dropping the expansion
+    Settings::Instance().shortcuts.push_back({L"ko", L"không có gì đâu bạn ơi"});
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"notepad.exe");
+    sim.clipboard = L"user clipboard";
+    sim.clipboardFormats = {{0xC001, "{\\rtf1 user}"}, {8, std::string(4096, '\x7f')}};
+    std::map<unsigned, std::string> formats = sim.clipboardFormats;
+    sim.clipboardBusy = 3;
+    uint64_t retries = sim.clipboardRetries;
+    sim.TypeText("ko ");
+    sim.PumpMessages();
+    Expect("busy clipboard paste", sim.FocusedField().text, L"không có gì đâu bạn ơi ");
+    ExpectTrue("busy clipboard retried", sim.clipboardRetries - retries == 3);
+    ExpectTrue("all clipboard formats restored", sim.clipboard == L"user clipboard" && sim.clipboardFormats == formats);
+    sim.clipboardFormats.clear();
+    ResetSettings();
+
+    // The selection hotkey converts a Word selection in place on its worker:
+    // the hotkey returns at once even for megabytes, and the clipboard
+    // comes back after both the copy and the paste
+    {
+        SelectionConverter selection;
+        SelectionStatus status = SelectionStatus::Failed;
+        selection.SetCallback([&status](SelectionStatus done) { status = done; });
+        std::wstring unicode;
+        while (unicode.size() < 2 * 1024 * 1024) unicode += L"Tiếng Việt là ngôn ngữ chính thức của Việt Nam. ";
+        std::wstring legacy = EncodingConverter::Instance().Convert(unicode, VietEncoding::Unicode, VietEncoding::TCVN3);
+        Focus(sim, L"winword.exe");
+        sim.FocusedField().text = L"Đầu đề: " + legacy;
+        sim.FocusedField().selected = legacy.size();
+        sim.clipboard = L"user clipboard";
+        sim.clipboardFormats = {{0xC001, "{\\rtf1 user}"}};
+        formats = sim.clipboardFormats;
+        auto start = std::chrono::steady_clock::now();
+        bool started = selection.Toggle(VietEncoding::TCVN3, VietEncoding::Unicode);
+        auto handedOver = std::chrono::steady_clock::now() - start;
+        selection.Wait();
+        ExpectTrue("selection hotkey returns at once",
+                   started && handedOver < std::chrono::milliseconds(20));
+        ExpectTrue("selection converted in place", status == SelectionStatus::Converted &&
+                                                   sim.FocusedField().text == L"Đầu đề: " + unicode);
+        ExpectTrue("clipboard restored after selection",
+                   sim.clipboard == L"user clipboard" && sim.clipboardFormats == formats);
+
+        // Nothing selected: the app copies nothing, the text stays
+        sim.FocusedField().text = L"abc";
+        selection.Toggle(VietEncoding::TCVN3, VietEncoding::Unicode);
+        selection.Wait();
+        ExpectTrue("no selection left alone", status == SelectionStatus::NoSelection &&
+                                              sim.FocusedField().text == L"abc" && sim.clipboard == L"user clipboard");
+
+        // The hotkey pressed again (its modifiers still held) cancels the job
+        sim.FocusedField().selected = 3;
+        sim.SetKeyDown(VK_SHIFT_KEY, true);
+        uint64_t copies = sim.copies;
+        bool first = selection.Toggle(VietEncoding::VNI_Windows, VietEncoding::Unicode);
+        bool second = selection.Toggle(VietEncoding::VNI_Windows, VietEncoding::Unicode);
+        selection.Wait();
+        sim.SetKeyDown(VK_SHIFT_KEY, false);
+        ExpectTrue("second press cancels", first && !second && status == SelectionStatus::Cancelled &&
+                                           sim.copies == copies && sim.FocusedField().text == L"abc");
+
+        // A key typed while the copy runs waits for the paste instead of
+        // typing over the selection being copied
+        std::wstring word = EncodingConverter::Instance().Convert(L"Việt", VietEncoding::Unicode, VietEncoding::TCVN3);
+        sim.FocusedField().text = word;
+        sim.FocusedField().selected = word.size();
+        sim.injectDelayUs = 300000;  // The copy takes 300ms
+        selection.Toggle(VietEncoding::TCVN3, VietEncoding::Unicode);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        bool keyHeld = sim.PressKey(VK_A_KEY + ('k' - 'a'));
+        selection.Wait();
+        sim.injectDelayUs = 0;
+        sim.PumpMessages();
+        ExpectTrue("key held behind selection copy", keyHeld && status == SelectionStatus::Converted);
+        Expect("key typed after the paste", sim.FocusedField().text, L"Việtk");
+        sim.clipboardFormats.clear();
+    }
+
+    // Keys typed while a slow injection is still running fold into one net
+    // edit: "đ" and the 10-key burst behind it reach the terminal at once
+    Settings::Instance().slowMode = true;
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"notepad.exe");
+    sim.consumerKeyUs = 4000;
+    sim.consumerBuffer = 8;
+    uint64_t injections = sim.injections;
+    sim.TypeText("dd");
+    sim.TypeText("aay laf ai");
+    sim.PumpMessages();
+    Expect("burst folded", sim.FocusedField().text, L"đây là ai");
+    ExpectTrue("burst injected once", sim.injections - injections == 1);
+    sim.consumerKeyUs = 0;
+    sim.consumerBuffer = 64;
+    ResetSettings();
+
+    // Ctrl or Delete pressed behind a queued slow-mode edit waits for it:
+    // Ctrl reaching the app first would make the queued backspaces erase a
+    // word, a held "a" would become Ctrl+A after the edit, not before it
+    Settings::Instance().slowMode = true;
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"notepad.exe");
+    sim.FocusedField().text = L"xin ";
+    sim.TypeText("vieetj");
+    bool ctrlHeld = sim.HoldKey(VK_CONTROL_KEY);
+    bool ctrlSeen = sim.IsKeyDown(VK_CONTROL_KEY);
+    bool comboHeld = sim.PressKey(VK_A_KEY);
+    bool ctrlReleased = sim.ReleaseKey(VK_CONTROL_KEY);
+    sim.PumpMessages();
+    ExpectTrue("ctrl held behind queued output", ctrlHeld && !ctrlSeen && comboHeld && ctrlReleased);
+    Expect("queued backspaces before ctrl", sim.FocusedField().text, L"xin việt");
+    ExpectTrue("held ctrl released", !sim.IsKeyDown(VK_CONTROL_KEY) && !sim.HoldKey(VK_CONTROL_KEY));
+    sim.ReleaseKey(VK_CONTROL_KEY);
+
+    // Ctrl already down when the edit runs is lifted around it, then restored
+    sim.TypeText(" vieetj");
+    sim.SetKeyDown(VK_CONTROL_KEY, true);
+    sim.PumpMessages();
+    Expect("backspaces under ctrl stay single", sim.FocusedField().text, L"xin việt việt");
+    ExpectTrue("ctrl restored after the edit", sim.IsKeyDown(VK_CONTROL_KEY));
+    sim.SetKeyDown(VK_CONTROL_KEY, false);
+
+    sim.TypeText(" vieetj");
+    bool deleteHeld = sim.PressKey(VK_DELETE_KEY);
+    sim.PumpMessages();
+    ExpectTrue("delete held behind queued output", deleteHeld);
+    Expect("edit lands before delete", sim.FocusedField().text, L"xin việt việt việt");
+    ResetSettings();
+
+    // Clipboard edits queued behind one another go out as a single paste
+    Settings::Instance().clipboardMode = true;
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"notepad.exe");
+    uint64_t pastesBefore = sim.pastes;
+    sim.TypeText("vieejt");
+    sim.PumpMessages();
+    Expect("merged clipboard edits", sim.FocusedField().text, L"việt");
+    ExpectTrue("merged into one paste", sim.pastes - pastesBefore == 1);
+    ResetSettings();
+
+    // Characters outside the BMP are injected as a full surrogate pair
+    Settings::Instance().shortcuts.push_back({L"hihi", L"😀 hi"});
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"notepad.exe");
+    sim.TypeText("hihi ");
+    sim.PumpMessages();
+    Expect("emoji shortcut", sim.FocusedField().text, L"😀 hi ");
+    ResetSettings();
+
+    // Slow mode paces a shortcut retype into a terminal (loses keys once 8
+    // are waiting). Only our hook sees paced keys, so a fast one keeps the
+    // default delay; a slow one raises it, saved at once
+    Settings::Instance().shortcuts.push_back({L"tks", L"cảm ơn nhiều"});
+    ImeProcessor::Instance().ApplySettings();
+    AppDetector::Instance().SetRules(L"exe:term.exe|injection=slow\nexe:slowterm.exe|injection=slow");
+    sim.consumerKeyUs = 4000;
+    sim.consumerBuffer = 8;
+    Focus(sim, L"term.exe");
+    uint64_t dropped = sim.droppedKeys;
+    for (int i = 0; i < 100; i++) {
+        sim.TypeText("tks ");
+        sim.PumpMessages();
+    }
+    Expect("paced retypes", sim.FocusedField().text.substr(0, 13), L"cảm ơn nhiều ");
+    uint32_t packed = 0;
+    bool saved = AppDetector::Instance().GetAppPacing(L"term.exe", packed);
+    ExpectTrue("unconfirmed pacing keeps the default", !saved);
+    ExpectTrue("no keys dropped at the default", sim.droppedKeys == dropped);
+
+    sim.consumerKeyUs = 25000;
+    Focus(sim, L"slowterm.exe");
+    for (int i = 0; i < 20; i++) {
+        sim.TypeText("tks ");
+        sim.PumpMessages();
+    }
+    saved = AppDetector::Instance().GetAppPacing(L"slowterm.exe", packed);
+    ExpectTrue("slow app raise saved", saved && PacingProfile::Unpack(packed).delayUs > PacingProfile::DEFAULT_DELAY_US);
+    dropped = sim.droppedKeys;
+    sim.FocusedField().text.clear();
+    sim.TypeText("tks ");
+    sim.PumpMessages();
+    Expect("raised pacing retypes", sim.FocusedField().text, L"cảm ơn nhiều ");
+    ExpectTrue("no keys dropped once raised", sim.droppedKeys == dropped);
+    sim.consumerKeyUs = 0;
+    AppDetector::Instance().SetRules(L"");
+    ResetSettings();
+
+    // Per-app output encoding (TextSender converts before injecting)
+    AppDetector::Instance().SetAppEncoding(L"legacy.exe", static_cast<int>(OutputEncoding::TCVN3));
+    Focus(sim, L"legacy.exe");
+    sim.TypeText("Vieejt Nam ");
+    sim.PumpMessages();
+    Expect("tcvn3 output", sim.FocusedField().text,
+           EncodingConverter::Instance().Convert(L"Việt Nam ", VietEncoding::Unicode, VietEncoding::TCVN3));
+
+    // VNI output writes a toned letter as base + mark, so replacing it takes
+    // two backspaces: retyped letters and changed tones, key by key and
+    // folded behind a busy output
+    {
+        AppDetector::Instance().SetAppEncoding(L"vnifont.exe", static_cast<int>(OutputEncoding::VNI));
+        const char* keys = "Tieengs Vieejt raats ddepj, tosf hoir nuwax ";
+        std::wstring want = EncodingConverter::Instance().Convert(L"Tiếng Việt rất đẹp, tò hỏi nữa ",
+                                                                  VietEncoding::Unicode, VietEncoding::VNI_Windows);
+        Focus(sim, L"vnifont.exe");
+        for (const char* key = keys; *key; key++) {
+            const char typed[2] = {*key, 0};
+            sim.TypeText(typed);
+            sim.PumpMessages();
+        }
+        Expect("vni output", sim.FocusedField().text, want);
+        Focus(sim, L"vnifont.exe");
+        sim.TypeText(keys);
+        sim.PumpMessages();
+        Expect("vni output (folded)", sim.FocusedField().text, want);
+    }
+
+    // Each window keeps its in-progress word across a focus change
+    HWND first = Focus(sim, L"notepad.exe");
+    sim.TypeText("vie");
+    HWND second = Focus(sim, L"word.exe");
+    sim.TypeText("ddaau ");
+    sim.SetForeground(first);
+    sim.TypeText("etj ");
+    sim.PumpMessages();
+    Expect("context kept (first window)", sim.Field(first).text, L"việt ");
+    Expect("context kept (second window)", sim.Field(second).text, L"đâu ");
+
+    // A half-typed word in a VNI-font app too: its toned letters still take
+    // two backspaces each when the word is finished after the switch back
+    AppDetector::Instance().SetAppEncoding(L"vnifont.exe", static_cast<int>(OutputEncoding::VNI));
+    HWND vniWindow = Focus(sim, L"vnifont.exe");
+    sim.TypeText("tieen");
+    Focus(sim, L"notepad.exe");
+    sim.TypeText("xin ");
+    sim.SetForeground(vniWindow);
+    sim.TypeText("gs ");
+    sim.PumpMessages();
+    Expect("vni word kept across windows", sim.Field(vniWindow).text,
+           EncodingConverter::Instance().Convert(L"tiếng ", VietEncoding::Unicode, VietEncoding::VNI_Windows));
+
+    // Excluded apps get raw keys; smart switch restores the state per app
+    Settings::Instance().excludedApps.push_back(L"game.exe");
+    Settings::Instance().smartSwitch = true;
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"game.exe");
+    sim.TypeText("vieejt ");
+    sim.PumpMessages();
+    Expect("excluded app", sim.FocusedField().text, L"vieejt ");
+    Focus(sim, L"notepad.exe");
+    sim.TypeText("vieejt ");
+    sim.PumpMessages();
+    Expect("re-enabled after excluded app", sim.FocusedField().text, L"việt ");
+    ResetSettings();
+
+    // Per-app rules pick the injection mode (window class), the encoding
+    // (install path) and the input method (glob) at the foreground switch
+    Settings::Instance().appRules = L"class:ConsoleWindowClass|injection=clipboard\n"
+                                    L"path:c:\\legacy\\|encoding=tcvn3\n"
+                                    L"glob:*vni*.exe|method=vni\n";
+    ImeProcessor::Instance().ApplySettings();
+    {
+        uint64_t pastesBefore = sim.pastes;
+        Focus(sim, L"cmd.exe", L"ConsoleWindowClass");
+        sim.TypeText("Vieejt ");
+        sim.PumpMessages();
+        Expect("class rule", sim.FocusedField().text, L"Việt ");
+        ExpectTrue("class rule pastes", sim.pastes > pastesBefore);
+
+        sim.SetForeground(sim.AddWindow(L"old.exe", L"SimWindow", L"c:\\legacy\\"));
+        sim.TypeText("Vieejt ");
+        sim.PumpMessages();
+        Expect("path rule", sim.FocusedField().text,
+               EncodingConverter::Instance().Convert(L"Việt ", VietEncoding::Unicode, VietEncoding::TCVN3));
+
+        Focus(sim, L"myvni.exe");
+        sim.TypeText("Vie65t ");
+        sim.PumpMessages();
+        Expect("glob rule", sim.FocusedField().text, L"Việt ");
+
+        Focus(sim, L"notepad.exe");
+        sim.TypeText("Vieejt ");
+        sim.PumpMessages();
+        Expect("method restored in other apps", sim.FocusedField().text, L"Việt ");
+    }
+    ResetSettings();
+
+    // Real output thread and a slow target app: the hook returns at once,
+    // and keys it would pass through wait for the injections ahead of them
+    Settings::Instance().shortcuts.push_back({L"ko", L"không có gì đâu bạn ơi"});
+    ImeProcessor::Instance().ApplySettings();
+    Focus(sim, L"notepad.exe");
+    sim.injectDelayUs = 2000;
+    TextSender::Instance().StartOutput();
+    sim.TypeText("Vieejt ko tooi, OK.\n");
+    sim.PumpMessages();
+    TextSender::Instance().StopOutput();
+    sim.injectDelayUs = 0;
+    Expect("output thread keeps order", sim.FocusedField().text, L"Việt không có gì đâu bạn ơi tôi, OK.\n");
+    ResetSettings();
+
+    // Foreground changes are resolved once per process: windows of known
+    // apps come from the cache, entries past the TTL are looked up again
+    ForegroundTracker& tracker = ForegroundTracker::Instance();
+    HWND mail = Focus(sim, L"mail.exe");
+    HWND editor = Focus(sim, L"editor.exe");
+    uint64_t queries = sim.appQueries;
+    for (int i = 0; i < 5; i++) {
+        sim.SetForeground(mail);
+        sim.SetForeground(editor);
+    }
+    Focus(sim, L"mail.exe");
+    ExpectTrue("process names cached", sim.appQueries == queries);
+    sim.clockOffsetNs += ForegroundTracker::PROCESS_TTL_NS;
+    sim.SetForeground(mail);
+    const ForegroundSnapshot& foreground = tracker.Current();
+    ExpectTrue("stale process name looked up again", sim.appQueries == queries + 1);
+    ExpectTrue("snapshot names the app", foreground.appName == L"mail.exe" && foreground.window == mail &&
+                                         foreground.appId != 0);
+
+    // With the resolver thread, a stalled process query delays the switch,
+    // not the keystrokes typed meanwhile
+    const uint64_t queryDelayNs = 20000000;
+    HWND slow = sim.AddWindow(L"slow.exe");
+    sim.appQueryDelayUs = static_cast<unsigned>(queryDelayNs / 1000);
+    tracker.StartResolver();
+    uint64_t start = sim.TimestampNs();
+    sim.SetForeground(slow);
+    sim.TypeText("vieejt ");
+    uint64_t typing = sim.TimestampNs() - start;
+    tracker.StopResolver();
+    sim.appQueryDelayUs = 0;
+    sim.PumpMessages();
+    ExpectTrue("hook never waits for the process query", typing < queryDelayNs);
+    Expect("typed during the query", sim.FocusedField().text, L"việt ");
+    ExpectTrue("switch published after the query", tracker.Current().appName == L"slow.exe");
+
+    // A stalled machine pushes the hook past its timeout: the processor
+    // stops detecting apps and injects in fast mode until the latency has
+    // been low for a while
+    ImeProcessor& processor = ImeProcessor::Instance();
+    HookWatchdog& watchdog = processor.Watchdog();
+    uint32_t timeoutMs = watchdog.GetTimeoutMs();
+    Settings::Instance().excludedApps.push_back(L"game.exe");
+    Settings::Instance().clipboardMode = true;
+    processor.ApplySettings();
+    watchdog.SetTimeoutMs(5);
+    sim.log.clear();
+    Focus(sim, L"notepad.exe");
+    sim.keyStateDelayUs = 2000;
+    sim.TypeText("a ");
+    sim.keyStateDelayUs = 0;
+    uint64_t pastes = sim.pastes;
+    Focus(sim, L"game.exe");
+    sim.TypeText("vieejt ");
+    sim.PumpMessages();
+    ExpectTrue("degraded on slow hook", watchdog.IsDegraded() && sim.log.size() == 1 &&
+                                        sim.log[0].find(L"near the system timeout") != std::wstring::npos);
+    Expect("degraded skips app detection", sim.FocusedField().text, L"việt ");
+    ExpectTrue("degraded forces fast injection", sim.pastes == pastes);
+
+    sim.clockOffsetNs += HookWatchdog::MIN_DEGRADED_NS + 10 * LatencyRing::WINDOW_NS;
+    Focus(sim, L"notepad.exe");
+    sim.TypeText("a ");
+    Focus(sim, L"game.exe");
+    sim.TypeText("vieejt ");
+    sim.PumpMessages();
+    ExpectTrue("recovered after quiet period", !watchdog.IsDegraded() && sim.log.size() == 2);
+    Expect("app detection restored", sim.FocusedField().text, L"vieejt ");
+    ExpectTrue("diagnostics report", processor.DiagnosticsReport().find(L"inject") != std::wstring::npos);
+    watchdog.SetTimeoutMs(timeoutMs);
+    ResetSettings();
+}
+
+// ============================================================
+// Benchmark
+// ============================================================
+
+struct Stroke {
+    int vk;
+    bool shift;
+};
+
+static bool LoadStrokes(const std::string& path, std::vector<Stroke>& strokes) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.rfind("#!", 0) == 0) continue;
+        line.push_back('\n');
+        for (char c : line) {
+            Stroke s{0, false};
+            if (SimPlatform::VkFromAscii(c, s.vk, s.shift)) strokes.push_back(s);
+        }
+    }
+    return true;
+}
+
+struct BenchResult {
+    const char* name;
+    size_t keys = 0;
+    double p50 = 0, p99 = 0, mean = 0, keysPerSec = 0, eventsPerKey = 0, injectMean = 0;
+};
+
+// encoding: per-app output encoding; switchEvery: change foreground window
+// after every Nth Space (0 = never), so CheckAppChange takes its slow path
+static BenchResult RunBench(SimPlatform& sim, const char* name, const std::vector<Stroke>& strokes,
+                            int repeat, OutputEncoding encoding, int switchEvery) {
+    using Clock = std::chrono::steady_clock;
+
+    std::wstring app = std::wstring(L"bench_") + std::wstring(name, name + std::strlen(name)) + L".exe";
+    AppDetector::Instance().SetAppEncoding(app, static_cast<int>(encoding));
+    HWND windows[2] = {sim.AddWindow(app), sim.AddWindow(L"other.exe")};
+
+    std::vector<uint32_t> ns;
+    ns.reserve(strokes.size() * static_cast<size_t>(repeat));
+    uint64_t eventsBefore = 0;
+    Clock::duration busy{};
+    Clock::duration injecting{};
+    int spaces = 0;
+    int active = 0;
+
+    // Warm-up pass (not recorded)
+    for (int pass = -1; pass < repeat; pass++) {
+        sim.SetForeground(windows[0]);
+        active = 0;
+        sim.Field(windows[0]).text.clear();
+        sim.Field(windows[1]).text.clear();
+        if (pass == 0) eventsBefore = sim.injectedEvents;
+
+        for (const Stroke& s : strokes) {
+            Clock::time_point t0 = Clock::now();
+            sim.PressKey(s.vk, s.shift);
+            Clock::time_point t1 = Clock::now();
+            sim.PumpMessages();  // The output thread's share, timed separately
+            Clock::time_point t2 = Clock::now();
+            if (pass >= 0) {
+                busy += t1 - t0;
+                injecting += t2 - t1;
+                ns.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+            }
+            if (switchEvery > 0 && s.vk == VK_SPACE && ++spaces % switchEvery == 0) {
+                active ^= 1;
+                sim.SetForeground(windows[active]);
+            }
+        }
+    }
+
+    BenchResult r;
+    r.name = name;
+    r.keys = ns.size();
+    if (ns.empty()) return r;
+    uint64_t total = 0;
+    for (uint32_t v : ns) total += v;
+    r.mean = static_cast<double>(total) / static_cast<double>(ns.size());
+    r.injectMean = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(injecting).count()) /
+                   static_cast<double>(ns.size());
+    std::sort(ns.begin(), ns.end());
+    r.p50 = ns[ns.size() / 2];
+    r.p99 = ns[static_cast<size_t>(0.99 * static_cast<double>(ns.size() - 1) + 0.5)];
+    double seconds = std::chrono::duration<double>(busy).count();
+    r.keysPerSec = seconds > 0 ? static_cast<double>(ns.size()) / seconds : 0;
+    r.eventsPerKey = static_cast<double>(sim.injectedEvents - eventsBefore) / static_cast<double>(ns.size());
+    return r;
+}
+
+// ns per call of op(i), i = 0..count-1
+template <typename Op>
+static double NsPerOp(size_t count, Op op) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point t0 = Clock::now();
+    for (size_t i = 0; i < count; i++) op(i);
+    Clock::time_point t1 = Clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()) /
+           static_cast<double>(count);
+}
+
+// Hot path (per key) against the work a foreground change costs; the sim's
+// process query is a table lookup, so "uncached" excludes OpenProcess itself
+static void RunForegroundBench(SimPlatform& sim) {
+    ForegroundTracker& tracker = ForegroundTracker::Instance();
+    volatile uint64_t sink = 0;
+
+    double read = NsPerOp(10000000, [&](size_t) { sink = sink + tracker.Current().sequence; });
+
+    LruCache<DWORD, uint32_t> cache(ForegroundTracker::PROCESS_CACHE_SIZE);
+    for (DWORD pid = 0; pid < ForegroundTracker::PROCESS_CACHE_SIZE; pid++) cache.Put(pid, pid);
+    double lruHit = NsPerOp(1000000, [&](size_t i) {
+        sink = sink + *cache.Get(static_cast<DWORD>(i % ForegroundTracker::PROCESS_CACHE_SIZE));
+    });
+    double lruMiss = NsPerOp(1000000, [&](size_t i) {
+        cache.Put(static_cast<DWORD>(ForegroundTracker::PROCESS_CACHE_SIZE + i), 0);
+    });
+
+    HWND known[2] = {sim.AddWindow(L"bench_a.exe"), sim.AddWindow(L"bench_b.exe")};
+    double switchCached = NsPerOp(200000, [&](size_t i) { tracker.OnForegroundChanged(known[i & 1]); });
+
+    // More processes than cache slots, visited round-robin: every switch misses
+    std::vector<HWND> many;
+    for (size_t i = 0; i < ForegroundTracker::PROCESS_CACHE_SIZE * 2; i++) {
+        many.push_back(sim.AddWindow(L"bench_proc" + std::to_wstring(i) + L".exe"));
+    }
+    double switchUncached = NsPerOp(20000, [&](size_t i) { tracker.OnForegroundChanged(many[i % many.size()]); });
+    tracker.OnForegroundChanged(sim.GetForegroundWindow());
+
+    // App rules at managed-deployment scale
+    std::vector<AppRule> rules;
+    for (int i = 0; i < 5000; i++) {
+        AppRule rule;
+        rule.kind = static_cast<AppRuleKind>(i % 3);
+        rule.pattern = i % 3 == 0 ? L"app" + std::to_wstring(i) + L".exe" :
+                       i % 3 == 1 ? L"tool" + std::to_wstring(i) + L"-*.exe" :
+                                    L"c:\\corp\\dept" + std::to_wstring(i) + L"\\";
+        rule.policy.enabled = 0;
+        rules.push_back(rule);
+    }
+    AppRuleSet set;
+    double compile = NsPerOp(10, [&](size_t) { set.Compile(rules); });
+    AppIdentity app;
+    app.path = L"c:\\program files\\vendor\\editor.exe";
+    app.exeName = AppExeName(app.path);
+    app.windowClass = L"EditorWindow";
+    double match = NsPerOp(1000, [&](size_t) { sink = sink + static_cast<uint64_t>(set.Match(app).enabled + 1); });
+    AppRuleCache ruleCache;
+    ruleCache.SetRules(std::make_shared<AppRuleSet>(set), 1);
+    AppRulePolicy policy;
+    double lookup = NsPerOp(1000000, [&](size_t) { sink = sink + ruleCache.Lookup(app, policy); });
+
+    std::printf("\nForeground tracking (ns per call)\n");
+    std::printf("%-34s %9.1f\n", "snapshot read (per key)", read);
+    std::printf("%-34s %9.1f\n", "lru hit", lruHit);
+    std::printf("%-34s %9.1f\n", "lru insert + evict", lruMiss);
+    std::printf("%-34s %9.1f\n", "switch, cached process", switchCached);
+    std::printf("%-34s %9.1f\n", "switch, uncached process (sim)", switchUncached);
+    std::printf("%-34s %9.1f\n", "rules: compile 5000", compile);
+    std::printf("%-34s %9.1f\n", "rules: match new app (5000)", match);
+    std::printf("%-34s %9.1f\n", "rules: interned app lookup", lookup);
+}
+
+// Slow mode against terminals of different speeds: how long a 13-character
+// shortcut retype blocks the output thread before and after learning
+static void RunPacingBench(SimPlatform& sim) {
+    Settings::Instance().shortcuts.push_back({L"tks", L"cảm ơn nhiều"});
+    Settings::Instance().slowMode = true;
+    ImeProcessor::Instance().ApplySettings();
+
+    std::printf("\nSlow mode pacing (13-char retype, virtual time)\n");
+    std::printf("%-20s %12s %12s %12s %9s\n", "app ms/key", "first ms", "learned ms", "delay ms", "dropped");
+    const unsigned speeds[] = {500, 1000, 4000, 10000};
+    for (unsigned keyUs : speeds) {
+        sim.consumerKeyUs = keyUs;
+        sim.consumerBuffer = 8;
+        Focus(sim, (L"bench_term" + std::to_wstring(keyUs) + L".exe").c_str());
+        uint64_t dropped = sim.droppedKeys;
+        uint64_t waited = 0;
+        uint64_t first = 0;
+        for (int i = 0; i < 120; i++) {
+            waited = sim.pacedWaitUs;
+            sim.TypeText("tks ");
+            sim.PumpMessages();
+            if (i == 0) first = sim.pacedWaitUs - waited;
+        }
+        uint64_t last = sim.pacedWaitUs - waited;
+        uint32_t packed = 0;
+        AppDetector::Instance().GetAppPacing(AppDetector::Instance().GetForegroundAppName(), packed);
+        std::printf("%-20.1f %12.1f %12.1f %12.2f %9llu\n", keyUs / 1000.0, first / 1000.0, last / 1000.0,
+                    PacingProfile::Unpack(packed).delayUs / 1000.0,
+                    static_cast<unsigned long long>(sim.droppedKeys - dropped));
+    }
+    sim.consumerKeyUs = 0;
+    ResetSettings();
+}
+
+// Encoder throughput for a typical edit and a long shortcut expansion
+static void RunEncoderBench() {
+    InjectionEncoder<KeyEventRecordTraits> encoder(INJECTED_KEY_MARKER);
+    volatile uint64_t sink = 0;
+    size_t count = 0;
+
+    const std::wstring word = L"việt ";
+    const std::wstring expansion = L"Cộng hòa xã hội chủ nghĩa Việt Nam 😀 Độc lập - Tự do - Hạnh phúc";
+    double keyNs = NsPerOp(2000000, [&](size_t) {
+        sink = sink + encoder.Encode(word.c_str(), word.length(), 2, count)->scan;
+    });
+    size_t keyEvents = count;
+    double expansionNs = NsPerOp(500000, [&](size_t) {
+        sink = sink + encoder.Encode(expansion.c_str(), expansion.length(), 3, count)->scan;
+    });
+    size_t expansionEvents = count;
+
+    std::printf("\nInjection encoder\n");
+    std::printf("%-34s %9s %9s %12s\n", "edit", "events", "ns", "events/us");
+    std::printf("%-34s %9zu %9.1f %12.1f\n", "word (2 bs + 5 chars)", keyEvents, keyNs, keyEvents * 1000.0 / keyNs);
+    std::printf("%-34s %9zu %9.1f %12.1f\n", "expansion (3 bs + 64 chars)", expansionEvents, expansionNs,
+                expansionEvents * 1000.0 / expansionNs);
+}
+
+// Converter throughput (UTF-16 input bytes) against the per-character hash
+// map lookups it replaced
+static void RunConverterBench() {
+    using namespace EncodingTables;
+    EncodingConverter& converter = EncodingConverter::Instance();
+    const std::wstring paragraph =
+        L"Cộng hòa xã hội chủ nghĩa Việt Nam. Độc lập - Tự do - Hạnh phúc. Tiếng Việt là ngôn ngữ "
+        L"chính thức, được viết bằng chữ Quốc ngữ với các dấu thanh và dấu phụ trên nguyên âm. ";
+    const std::wstring code = L"for (size_t i = 0; i < length; i++) { out[i] = table.Map(in[i]); } // ascii\n";
+    std::wstring prose, ascii;
+    while (prose.size() < (4u << 20)) prose += paragraph;
+    while (ascii.size() < (4u << 20)) ascii += code;
+    std::wstring prose3 = converter.Convert(prose, VietEncoding::Unicode, VietEncoding::TCVN3);
+    std::wstring proseVni = converter.Convert(prose, VietEncoding::Unicode, VietEncoding::VNI_Windows);
+
+    std::unordered_map<wchar_t, wchar_t> hashMap;
+    for (size_t i = 0; i < LETTER_COUNT; i++) hashMap.emplace(UNICODE_LETTERS[i], TCVN3_LETTERS[i]);
+    auto hashConvert = [&](const std::wstring& text) {
+        std::wstring result;
+        for (wchar_t c : text) {
+            auto it = hashMap.find(c);
+            result += it != hashMap.end() ? it->second : c;
+        }
+        return result;
+    };
+
+    volatile size_t sink = 0;
+    auto mbPerSec = [&](const std::wstring& text, auto convert) {
+        const size_t rounds = 8;
+        double ns = NsPerOp(rounds, [&](size_t) { sink = sink + convert(text).size(); });
+        return text.size() * sizeof(wchar_t) / (ns / 1000.0);
+    };
+    auto to = [&](VietEncoding from, VietEncoding target) {
+        return [&converter, from, target](const std::wstring& text) { return converter.Convert(text, from, target); };
+    };
+
+    std::printf("\nEncoding converter (4M chars)\n");
+    std::printf("%-34s %9s\n", "conversion", "MB/s");
+    std::printf("%-34s %9.0f\n", "prose Unicode -> TCVN3 (hash map)", mbPerSec(prose, hashConvert));
+    std::printf("%-34s %9.0f\n", "prose Unicode -> TCVN3", mbPerSec(prose, to(VietEncoding::Unicode, VietEncoding::TCVN3)));
+    std::printf("%-34s %9.0f\n", "prose TCVN3 -> Unicode", mbPerSec(prose3, to(VietEncoding::TCVN3, VietEncoding::Unicode)));
+    std::printf("%-34s %9.0f\n", "prose Unicode -> VNI", mbPerSec(prose, to(VietEncoding::Unicode, VietEncoding::VNI_Windows)));
+    std::printf("%-34s %9.0f\n", "prose VNI -> Unicode", mbPerSec(proseVni, to(VietEncoding::VNI_Windows, VietEncoding::Unicode)));
+    std::printf("%-34s %9.0f\n", "prose VNI -> TCVN3", mbPerSec(proseVni, to(VietEncoding::VNI_Windows, VietEncoding::TCVN3)));
+    // Fixed output buffer: memory use does not grow with the document
+    std::vector<wchar_t> chunk(EncodingStream::MaxOutput(1 << 16));
+    double streamNs = NsPerOp(8, [&](size_t) {
+        EncodingStream stream(VietEncoding::VNI_Windows, VietEncoding::Unicode);
+        for (size_t at = 0; at < proseVni.size(); at += 1 << 16) {
+            size_t length = std::min<size_t>(1 << 16, proseVni.size() - at);
+            sink = sink + stream.Push(proseVni.data() + at, length, chunk.data());
+        }
+        sink = sink + stream.Finish(chunk.data());
+    });
+    std::printf("%-34s %9.0f\n", "prose VNI -> Unicode (64K chunks)", proseVni.size() * sizeof(wchar_t) / (streamNs / 1000.0));
+    std::printf("%-34s %9.0f\n", "ASCII Unicode -> TCVN3 (hash map)", mbPerSec(ascii, hashConvert));
+    std::printf("%-34s %9.0f\n", "ASCII Unicode -> TCVN3", mbPerSec(ascii, to(VietEncoding::Unicode, VietEncoding::TCVN3)));
+
+    // Every codec in the registry, on the same prose
+    std::printf("\nPer-codec throughput (4M chars, MB/s)\n");
+    std::printf("%-34s %9s %9s %9s\n", "codec", "encode", "decode", "to TCVN3");
+    for (int e = 1; e < VIET_ENCODING_COUNT; e++) {
+        VietEncoding codec = static_cast<VietEncoding>(e);
+        std::wstring encoded = converter.Convert(prose, VietEncoding::Unicode, codec);
+        char toTcvn3[16] = "-";
+        if (codec != VietEncoding::TCVN3) {
+            std::snprintf(toTcvn3, sizeof(toTcvn3), "%.0f", mbPerSec(encoded, to(codec, VietEncoding::TCVN3)));
+        }
+        std::printf("%-34s %9.0f %9.0f %9s\n", ToUtf8(EncodingConverter::GetEncodingName(codec)).c_str(),
+                    mbPerSec(prose, to(VietEncoding::Unicode, codec)), mbPerSec(encoded, to(codec, VietEncoding::Unicode)),
+                    toTcvn3);
+    }
+
+    // Built-in NFD/NFC tables against ICU's normalizer (into a preallocated
+    // buffer, UTF-16 input converted up front)
+    std::wstring proseNfd = converter.Convert(prose, VietEncoding::Unicode, VietEncoding::Unicode_Comp);
+    std::printf("\nNormalization (4M chars)\n");
+    std::printf("%-34s %9s\n", "conversion", "MB/s");
+    std::printf("%-34s %9.0f\n", "NFC -> NFD (tables)", mbPerSec(prose, to(VietEncoding::Unicode, VietEncoding::Unicode_Comp)));
+    std::printf("%-34s %9.0f\n", "NFD -> NFC (tables)", mbPerSec(proseNfd, to(VietEncoding::Unicode_Comp, VietEncoding::Unicode)));
+#ifdef VIKEY_BENCH_ICU
+    UErrorCode error = U_ZERO_ERROR;
+    const UNormalizer2* icuNfd = unorm2_getNFDInstance(&error);
+    const UNormalizer2* icuNfc = unorm2_getNFCInstance(&error);
+    std::u16string icuIn(prose.begin(), prose.end()), icuInNfd(proseNfd.begin(), proseNfd.end());
+    std::u16string icuOut(proseNfd.size() + 16, u'\0');
+    auto icuMbPerSec = [&](const UNormalizer2* normalizer, const std::u16string& text) {
+        double ns = NsPerOp(8, [&](size_t) {
+            sink = sink + unorm2_normalize(normalizer, text.data(), static_cast<int32_t>(text.size()), &icuOut[0],
+                                           static_cast<int32_t>(icuOut.size()), &error);
+        });
+        return U_SUCCESS(error) ? text.size() * sizeof(char16_t) / (ns / 1000.0) : 0.0;
+    };
+    std::printf("%-34s %9.0f\n", "NFC -> NFD (ICU)", icuMbPerSec(icuNfd, icuIn));
+    std::printf("%-34s %9.0f\n", "NFD -> NFC (ICU)", icuMbPerSec(icuNfc, icuInNfd));
+#endif
+    proseNfd.clear();
+    proseNfd.shrink_to_fit();
+
+    // Files and clipboard bytes: the byte overloads against widening to a
+    // string, converting and narrowing (MB/s of input bytes)
+    std::printf("\nBytes (4M chars)\n");
+    std::printf("%-34s %9s %9s\n", "conversion", "wide", "bytes");
+    {
+        std::string utf8 = Utf8Of(prose);
+        std::string vniBytes(proseVni.begin(), proseVni.end());
+        std::string out;
+        out.reserve(utf8.size() * 2);
+        auto bytesMbPerSec = [&](const std::string& in, auto convert) {
+            double ns = NsPerOp(8, [&](size_t) { sink = sink + convert(in); });
+            return in.size() / (ns / 1000.0);
+        };
+        auto viaBytes = [&](VietEncoding from, VietEncoding target) {
+            return [&, from, target](const std::string& in) {
+                out.clear();
+                StringSink bytes(out);
+                converter.Convert(in.data(), in.size(), bytes, from, target);
+                return out.size();
+            };
+        };
+        auto viaWide = [&](VietEncoding from, VietEncoding target) {
+            return [&, from, target](const std::string& in) {
+                std::wstring text = from == VietEncoding::Unicode ? FromUtf8(in) : std::wstring(in.size(), L'\0');
+                if (from != VietEncoding::Unicode) {
+                    for (size_t i = 0; i < in.size(); i++) text[i] = static_cast<wchar_t>(static_cast<unsigned char>(in[i]));
+                }
+                std::wstring converted = converter.Convert(text, from, target);
+                if (target == VietEncoding::Unicode) return Utf8Of(converted).size();
+                std::string narrow(converted.size(), '\0');
+                for (size_t i = 0; i < converted.size(); i++) narrow[i] = static_cast<char>(converted[i]);
+                return narrow.size();
+            };
+        };
+        const VietEncoding U = VietEncoding::Unicode, VNI = VietEncoding::VNI_Windows;
+        std::printf("%-34s %9.0f %9.0f\n", "UTF-8 -> VNI", bytesMbPerSec(utf8, viaWide(U, VNI)),
+                    bytesMbPerSec(utf8, viaBytes(U, VNI)));
+        std::printf("%-34s %9.0f %9.0f\n", "VNI -> UTF-8", bytesMbPerSec(vniBytes, viaWide(VNI, U)),
+                    bytesMbPerSec(vniBytes, viaBytes(VNI, U)));
+        std::printf("%-34s %9.0f %9.0f\n", "UTF-8 -> UTF-8 (validate)", bytesMbPerSec(utf8, viaWide(U, U)),
+                    bytesMbPerSec(utf8, viaBytes(U, U)));
+    }
+
+    // Detection: cost on the whole 4M chars (a bounded sample is read) and
+    // accuracy on short slices of a passage
+    std::printf("\nEncoding detection\n");
+    std::printf("%-34s %9s %9s %9s %9s\n", "source", "us/call", "8 chars", "16 chars", "30 chars");
+    const std::wstring passage = DetectPassage();
+    const VietEncoding detected[] = {VietEncoding::Unicode, VietEncoding::VNI_Windows, VietEncoding::TCVN3,
+                                     VietEncoding::Unicode_Comp, VietEncoding::VISCII, VietEncoding::CP1258};
+    for (VietEncoding encoding : detected) {
+        std::wstring text = converter.Convert(prose, VietEncoding::Unicode, encoding);
+        double us = NsPerOp(100, [&](size_t) { sink = sink + static_cast<size_t>(EncodingConverter::Detect(text).front().encoding); }) / 1000.0;
+        double accuracy[3];
+        const size_t lengths[3] = {8, 16, 30};
+        for (int k = 0; k < 3; k++) {
+            size_t right = 0, total = 0;
+            for (size_t at = 0; at + lengths[k] <= passage.size(); at++, total++) {
+                std::wstring slice = converter.Convert(passage.substr(at, lengths[k]), VietEncoding::Unicode, encoding);
+                if (EncodingConverter::Detect(slice).front().encoding == encoding) right++;
+            }
+            accuracy[k] = 100.0 * right / total;
+        }
+        std::printf("%-34s %9.1f %8.1f%% %8.1f%% %8.1f%%\n", ToUtf8(EncodingConverter::GetEncodingName(encoding)).c_str(), us,
+                    accuracy[0], accuracy[1], accuracy[2]);
+    }
+    prose.clear();
+    prose.shrink_to_fit();
+    ascii.clear();
+    ascii.shrink_to_fit();
+
+    // Legacy to legacy on a 100 MB corpus (one byte per unit in a file):
+    // the pair's own table against two passes through Unicode
+    const size_t corpusUnits = 100u << 20;
+    std::printf("\nLegacy to legacy (100 MB)\n");
+    std::printf("%-34s %9s %9s\n", "conversion", "s", "MB/s");
+    const VietEncoding pairs[2][2] = {{VietEncoding::VNI_Windows, VietEncoding::TCVN3},
+                                      {VietEncoding::TCVN3, VietEncoding::VNI_Windows}};
+    for (const auto& pair : pairs) {
+        std::wstring unit = converter.Convert(paragraph, VietEncoding::Unicode, pair[0]);
+        std::wstring corpus;
+        corpus.reserve(corpusUnits + unit.size());
+        while (corpus.size() < corpusUnits) corpus += unit;
+        double twoPassNs = NsPerOp(1, [&](size_t) {
+            sink = sink + converter.Convert(converter.Convert(corpus, pair[0], VietEncoding::Unicode),
+                                            VietEncoding::Unicode, pair[1]).size();
+        });
+        double directNs = NsPerOp(1, [&](size_t) { sink = sink + converter.Convert(corpus, pair[0], pair[1]).size(); });
+        std::string name = pair[0] == VietEncoding::VNI_Windows ? "VNI -> TCVN3" : "TCVN3 -> VNI";
+        std::printf("%-34s %9.2f %9.0f\n", (name + " (two passes)").c_str(), twoPassNs / 1e9,
+                    corpus.size() / (twoPassNs / 1000.0));
+        std::printf("%-34s %9.2f %9.0f\n", (name + " (direct)").c_str(), directNs / 1e9, corpus.size() / (directNs / 1000.0));
+    }
+
+    // NFC repair, strip diacritics and upper case on 100 MB of decomposed
+    // prose: one fused pass against the three stages one after another
+    std::printf("\nTransform pipeline (100 MB)\n");
+    std::printf("%-34s %9s %9s\n", "transform", "s", "MB/s");
+    {
+        using TS = TransformStage;
+        std::wstring unit = converter.Convert(paragraph, VietEncoding::Unicode, VietEncoding::Unicode_Comp);
+        std::wstring corpus;
+        corpus.reserve(corpusUnits + unit.size());
+        while (corpus.size() < corpusUnits) corpus += unit;
+        const std::vector<TS> stages = {TS::ComposeNfc, TS::StripDiacritics, TS::Upper};
+        double sequentialNs = NsPerOp(1, [&](size_t) {
+            std::wstring text = TextTransform({stages[0]}).Apply(corpus);
+            for (size_t i = 1; i < stages.size(); i++) text = TextTransform({stages[i]}).Apply(text);
+            sink = sink + text.size();
+        });
+        double fusedNs = NsPerOp(1, [&](size_t) { sink = sink + TextTransform(stages).Apply(corpus).size(); });
+        std::printf("%-34s %9.2f %9.0f\n", "NFC + strip + upper (3 passes)", sequentialNs / 1e9,
+                    corpus.size() / (sequentialNs / 1000.0));
+        std::printf("%-34s %9.2f %9.0f\n", "NFC + strip + upper (fused)", fusedNs / 1e9, corpus.size() / (fusedNs / 1000.0));
+    }
+}
+
+int main(int argc, char** argv) {
+    int repeat = 50;
+    bool checksOnly = false;
+    std::string corePath;
+    std::string corpusPath = std::string(VIKEY_BENCH_CORPUS_DIR) + "/telex_prose.txt";
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--core") == 0 && i + 1 < argc) {
+            corePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--checks-only") == 0) {
+            checksOnly = true;
+        } else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            std::printf("Usage: %s [--repeat N] [--core PATH] [--checks-only] [corpus.txt]\n", argv[0]);
+            return 0;
+        } else {
+            corpusPath = argv[i];
+        }
+    }
+
+    SimPlatform sim(corePath);
+    Platform::Install(&sim);
+
+    Settings::Instance().Load();
+    AppDetector::Instance().Load();
+    ImeProcessor& processor = ImeProcessor::Instance();
+    if (!processor.Initialize()) return 1;
+    processor.Start();
+    // Inject on this thread, at PumpMessages(): SimPlatform's fields are not
+    // synchronized and the scenarios check what is pending at each step
+    TextSender::Instance().StopOutput();
+    ForegroundTracker::Instance().StopResolver();
+
+    RunQueueChecks();
+    RunWatchdogChecks();
+    RunForegroundChecks();
+    RunAppRuleChecks();
+    RunEncoderChecks();
+    RunPacingChecks();
+    RunClipboardPasteChecks();
+    RunSelectionCopyChecks();
+    RunPendingEditChecks();
+    RunConverterChecks();
+    RunTransformChecks();
+    RunByteConverterChecks();
+    RunScenarios(sim);
+
+    if (!checksOnly) {
+        std::vector<Stroke> strokes;
+        if (!LoadStrokes(corpusPath, strokes)) {
+            std::fprintf(stderr, "Cannot read corpus: %s\n", corpusPath.c_str());
+            return 1;
+        }
+
+        std::vector<BenchResult> results;
+        results.push_back(RunBench(sim, "unicode", strokes, repeat, OutputEncoding::Unicode, 0));
+        results.push_back(RunBench(sim, "tcvn3", strokes, repeat, OutputEncoding::TCVN3, 0));
+        results.push_back(RunBench(sim, "vni", strokes, repeat, OutputEncoding::VNI, 0));
+        results.push_back(RunBench(sim, "app-switch", strokes, repeat, OutputEncoding::Unicode, 1));
+
+        std::printf("\nHook cost per key (app check → engine → queue); inject = output thread (encode → inject)\n");
+        std::printf("%-12s %9s %9s %9s %9s %12s %10s %11s\n",
+                    "scenario", "keys", "p50 ns", "p99 ns", "mean ns", "keys/sec", "inject ns", "events/key");
+        for (const BenchResult& r : results) {
+            std::printf("%-12s %9zu %9.0f %9.0f %9.0f %12.0f %10.0f %11.2f\n",
+                        r.name, r.keys, r.p50, r.p99, r.mean, r.keysPerSec, r.injectMean, r.eventsPerKey);
+        }
+
+        RunForegroundBench(sim);
+        RunEncoderBench();
+        RunConverterBench();
+        RunPacingBench(sim);
+    }
+
+    processor.Stop();
+    RustBridge::Instance().Shutdown();
+    Platform::Install(nullptr);
+
+    if (g_failures > 0) {
+        std::printf("\n%d scenario check(s) failed\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -3,82 +3,41 @@
 // Project: ViKey | Author: Tran Cong Sinh | https://github.com/kmis8x/ViKey
 
 #include "app_detector.h"
-#include <psapi.h>
+#include "foreground_tracker.h"
 #include <algorithm>
-
-#pragma comment(lib, "psapi.lib")
+#include <cwctype>
 
 AppDetector& AppDetector::Instance() {
     static AppDetector instance;
     return instance;
 }
 
-AppDetector::AppDetector()
-    : m_lastHwnd(nullptr) {
-}
-
 std::wstring AppDetector::GetForegroundAppName() {
-    HWND hwnd = GetForegroundWindow();
-    if (!hwnd) return L"";
-
-    DWORD processId = 0;
-    GetWindowThreadProcessId(hwnd, &processId);
-    if (processId == 0) return L"";
-
-    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
-    if (!hProcess) return L"";
-
-    wchar_t exePath[MAX_PATH] = {};
-    DWORD size = MAX_PATH;
-    std::wstring appName;
-
-    if (QueryFullProcessImageNameW(hProcess, 0, exePath, &size)) {
-        // Extract filename from full path
-        std::wstring fullPath(exePath);
-        size_t lastSlash = fullPath.find_last_of(L"\\");
-        if (lastSlash != std::wstring::npos) {
-            appName = fullPath.substr(lastSlash + 1);
-        } else {
-            appName = fullPath;
-        }
-        // Convert to lowercase for consistency
-        std::transform(appName.begin(), appName.end(), appName.begin(), ::towlower);
-    }
-
-    CloseHandle(hProcess);
-    return appName;
-}
-
-bool AppDetector::HasAppChanged() {
-    HWND hwnd = GetForegroundWindow();
-    if (hwnd != m_lastHwnd) {
-        m_lastHwnd = hwnd;
-        std::wstring currentApp = GetForegroundAppName();
-        if (currentApp != m_lastAppName) {
-            m_lastAppName = currentApp;
-            return true;
-        }
+    const ForegroundSnapshot& foreground = ForegroundTracker::Instance().Current();
+    if (foreground.sequence != 0) {
+        return foreground.appName;
     }
-    return false;
+    // Tracker not started yet: ask the platform directly
+    Platform& platform = Platform::Current();
+    HWND window = platform.GetForegroundWindow();
+    return window ? AppExeName(platform.GetProcessImagePath(platform.GetWindowProcessId(window))) : L"";
 }
 
 void AppDetector::SaveAppState(const std::wstring& app, bool enabled) {
     if (app.empty()) return;
-    m_appStates[app].enabled = enabled;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_appStates[app].enabled = enabled;
+    }
 
     // Save to registry
-    HKEY hKey;
-    if (RegCreateKeyExW(HKEY_CURRENT_USER, APP_STATES_PATH, 0, nullptr,
-                        REG_OPTION_NON_VOLATILE, KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
-        DWORD value = enabled ? 1 : 0;
-        RegSetValueExW(hKey, app.c_str(), 0, REG_DWORD, (LPBYTE)&value, sizeof(value));
-        RegCloseKey(hKey);
-    }
+    Platform::Current().WriteDword(APP_STATES_PATH, app.c_str(), enabled ? 1 : 0);
 }
 
 bool AppDetector::GetAppState(const std::wstring& app, bool defaultEnabled) {
     if (app.empty()) return defaultEnabled;
 
+    std::lock_guard<std::mutex> lock(m_mutex);
     auto it = m_appStates.find(app);
     if (it != m_appStates.end()) {
         return it->second.enabled;
@@ -86,144 +45,172 @@ bool AppDetector::GetAppState(const std::wstring& app, bool defaultEnabled) {
     return defaultEnabled;
 }
 
+int8_t AppDetector::GetSavedState(const std::wstring& app) {
+    if (app.empty()) return -1;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_appStates.find(app);
+    if (it == m_appStates.end()) return -1;
+    return it->second.enabled ? 1 : 0;
+}
+
 void AppDetector::ClearAppState(const std::wstring& app) {
     if (app.empty()) return;
-    m_appStates.erase(app);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_appStates.erase(app);
+    }
 
     // Remove from registry
-    HKEY hKey;
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, APP_STATES_PATH, 0, KEY_WRITE, &hKey) == ERROR_SUCCESS) {
-        RegDeleteValueW(hKey, app.c_str());
-        RegCloseKey(hKey);
-    }
+    Platform::Current().DeleteValue(APP_STATES_PATH, app.c_str());
 }
 
 void AppDetector::SetExcludedApps(const std::vector<std::wstring>& apps) {
-    m_excludedApps = apps;
-    // Pre-lowercase excluded apps so IsAppExcluded() doesn't do it per-call
-    for (auto& app : m_excludedApps) {
-        std::transform(app.begin(), app.end(), app.begin(), ::towlower);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_excludedApps = apps;
+        for (auto& app : m_excludedApps) {
+            std::transform(app.begin(), app.end(), app.begin(), ::towlower);
+        }
     }
+    RebuildRules();
 }
 
-bool AppDetector::IsAppExcluded(const std::wstring& appName) {
-    if (appName.empty()) return false;
-
-    for (const auto& excluded : m_excludedApps) {
-        if (appName == excluded) {
-            return true;
-        }
+void AppDetector::SetAppEncoding(const std::wstring& app, int encoding) {
+    if (app.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_appStates[app].encoding = encoding;
     }
-    return false;
+
+    RebuildRules();
+
+    // Save to registry
+    Platform::Current().WriteDword(APP_ENCODINGS_PATH, app.c_str(), static_cast<DWORD>(encoding));
 }
 
-void AppDetector::SetAppEncoding(const std::wstring& app, int encoding) {
+bool AppDetector::GetAppPacing(const std::wstring& app, uint32_t& packed) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_appPacing.find(app);
+    if (it == m_appPacing.end()) return false;
+    packed = it->second;
+    return true;
+}
+
+void AppDetector::SaveAppPacing(const std::wstring& app, uint32_t packed) {
     if (app.empty()) return;
-    m_appStates[app].encoding = encoding;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_appPacing[app] = packed;
+    }
 
     // Save to registry
-    HKEY hKey;
-    if (RegCreateKeyExW(HKEY_CURRENT_USER, APP_ENCODINGS_PATH, 0, nullptr,
-                        REG_OPTION_NON_VOLATILE, KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
-        DWORD value = static_cast<DWORD>(encoding);
-        RegSetValueExW(hKey, app.c_str(), 0, REG_DWORD, (LPBYTE)&value, sizeof(value));
-        RegCloseKey(hKey);
+    Platform::Current().WriteDword(APP_PACING_PATH, app.c_str(), static_cast<DWORD>(packed));
+}
+
+bool AppDetector::SetRules(const std::wstring& text) {
+    std::vector<AppRule> rules;
+    bool ok = ParseAppRules(text, rules);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_userRules = std::move(rules);
     }
+    RebuildRules();
+    return ok;
 }
 
-int AppDetector::GetAppEncoding(const std::wstring& app, int defaultEncoding) {
-    if (app.empty()) return defaultEncoding;
+std::shared_ptr<const AppRuleSet> AppDetector::GetRules(uint64_t& generation) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    generation = m_rulesGeneration.load(std::memory_order_relaxed);
+    return m_rules;
+}
 
-    auto it = m_appStates.find(app);
-    if (it != m_appStates.end() && it->second.encoding != 0) {
-        return it->second.encoding;
+size_t AppDetector::RuleCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rules ? m_rules->RuleCount() : 0;
+}
+
+void AppDetector::RebuildRules() {
+    std::vector<AppRule> rules;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        rules.reserve(m_excludedApps.size() + m_appStates.size() + m_userRules.size());
+        for (const auto& app : m_excludedApps) {
+            AppRule rule;
+            rule.kind = AppRuleKind::Exe;
+            rule.pattern = app;
+            rule.policy.enabled = 0;
+            rules.push_back(std::move(rule));
+        }
+        for (const auto& state : m_appStates) {
+            if (state.second.encoding == 0) continue;
+            AppRule rule;
+            rule.kind = AppRuleKind::Exe;
+            rule.pattern = state.first;
+            rule.policy.encoding = static_cast<int8_t>(state.second.encoding);
+            rules.push_back(std::move(rule));
+        }
+        rules.insert(rules.end(), m_userRules.begin(), m_userRules.end());
     }
-    return defaultEncoding;
+
+    // Compile outside the lock: the resolver keeps using the old set meanwhile
+    auto compiled = std::make_shared<AppRuleSet>();
+    compiled->Compile(rules);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rules = std::move(compiled);
+    m_rulesGeneration.fetch_add(1, std::memory_order_release);
 }
 
 void AppDetector::Load() {
+    Platform& platform = Platform::Current();
+    std::unique_lock<std::mutex> lock(m_mutex);
+
     // Load all app states from registry
-    HKEY hKey;
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, APP_STATES_PATH, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
-        wchar_t valueName[256];
-        DWORD valueNameSize;
-        DWORD valueData;
-        DWORD valueDataSize;
-        DWORD type;
-        DWORD index = 0;
-
-        for (;;) {
-            valueNameSize = 256;
-            valueDataSize = sizeof(valueData);
-            LONG result = RegEnumValueW(hKey, index++, valueName, &valueNameSize,
-                                         nullptr, &type, (LPBYTE)&valueData, &valueDataSize);
-            if (result != ERROR_SUCCESS) break;
-            if (type == REG_DWORD) {
-                m_appStates[valueName].enabled = (valueData != 0);
-            }
-        }
-        RegCloseKey(hKey);
-    }
+    platform.EnumDwords(APP_STATES_PATH, [this](const wchar_t* app, DWORD value) {
+        m_appStates[app].enabled = (value != 0);
+    });
 
     // Load all app encodings from registry
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, APP_ENCODINGS_PATH, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
-        wchar_t valueName[256];
-        DWORD valueNameSize;
-        DWORD valueData;
-        DWORD valueDataSize;
-        DWORD type;
-        DWORD index = 0;
-
-        for (;;) {
-            valueNameSize = 256;
-            valueDataSize = sizeof(valueData);
-            LONG result = RegEnumValueW(hKey, index++, valueName, &valueNameSize,
-                                         nullptr, &type, (LPBYTE)&valueData, &valueDataSize);
-            if (result != ERROR_SUCCESS) break;
-            if (type == REG_DWORD) {
-                m_appStates[valueName].encoding = static_cast<int>(valueData);
-            }
-        }
-        RegCloseKey(hKey);
-    }
+    platform.EnumDwords(APP_ENCODINGS_PATH, [this](const wchar_t* app, DWORD value) {
+        m_appStates[app].encoding = static_cast<int>(value);
+    });
+
+    // Load learned injection pacing
+    platform.EnumDwords(APP_PACING_PATH, [this](const wchar_t* app, DWORD value) {
+        m_appPacing[app] = static_cast<uint32_t>(value);
+    });
 
     // Load excluded apps
-    HKEY hMainKey;
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, REGISTRY_PATH, 0, KEY_READ, &hMainKey) == ERROR_SUCCESS) {
-        wchar_t buffer[4096] = {};
-        DWORD size = sizeof(buffer);
-        DWORD type = REG_SZ;
-        if (RegQueryValueExW(hMainKey, L"ExcludedApps", nullptr, &type, (LPBYTE)buffer, &size) == ERROR_SUCCESS) {
-            // Parse pipe-delimited list
-            std::wstring apps(buffer);
-            m_excludedApps.clear();
-            size_t pos = 0;
-            while (pos < apps.length()) {
-                size_t pipe = apps.find(L'|', pos);
-                if (pipe == std::wstring::npos) pipe = apps.length();
-                std::wstring app = apps.substr(pos, pipe - pos);
-                if (!app.empty()) {
-                    m_excludedApps.push_back(app);
-                }
-                pos = pipe + 1;
+    std::wstring apps;
+    if (platform.ReadString(REGISTRY_PATH, L"ExcludedApps", apps)) {
+        // Parse pipe-delimited list
+        m_excludedApps.clear();
+        size_t pos = 0;
+        while (pos < apps.length()) {
+            size_t pipe = apps.find(L'|', pos);
+            if (pipe == std::wstring::npos) pipe = apps.length();
+            std::wstring app = apps.substr(pos, pipe - pos);
+            if (!app.empty()) {
+                m_excludedApps.push_back(app);
             }
+            pos = pipe + 1;
         }
-        RegCloseKey(hMainKey);
     }
+
+    lock.unlock();
+    RebuildRules();
 }
 
 void AppDetector::Save() {
     // Save excluded apps to registry
-    HKEY hKey;
-    if (RegCreateKeyExW(HKEY_CURRENT_USER, REGISTRY_PATH, 0, nullptr,
-                        REG_OPTION_NON_VOLATILE, KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
-        std::wstring apps;
+    std::wstring apps;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
         for (size_t i = 0; i < m_excludedApps.size(); i++) {
             if (i > 0) apps += L'|';
             apps += m_excludedApps[i];
         }
-        RegSetValueExW(hKey, L"ExcludedApps", 0, REG_SZ,
-                       (LPBYTE)apps.c_str(), static_cast<DWORD>((apps.length() + 1) * sizeof(wchar_t)));
-        RegCloseKey(hKey);
     }
+    Platform::Current().WriteString(REGISTRY_PATH, L"ExcludedApps", apps);
 }
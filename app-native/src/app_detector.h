@@ -1,12 +1,19 @@
 // ViKey - App Detector (Feature 2: Smart Switch per App)
 // app_detector.h
-// Detects foreground app changes and manages per-app IME states
+// Per-app IME states, exclusions, encodings and rules, compiled into an
+// AppRuleSet that ForegroundTracker matches on each foreground change
 
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
+#include "app_rules.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 // Per-app state storage
 struct AppState {
@@ -18,42 +25,62 @@ class AppDetector {
 public:
     static AppDetector& Instance();
 
-    // Get current foreground app name (e.g., "notepad.exe")
+    // Get current foreground app name (e.g., "notepad.exe"), as last
+    // published by ForegroundTracker
     std::wstring GetForegroundAppName();
 
-    // Check if foreground app has changed since last call
-    bool HasAppChanged();
-
     // Smart Switch per App (Feature 2)
     void SaveAppState(const std::wstring& app, bool enabled);
     bool GetAppState(const std::wstring& app, bool defaultEnabled);
     void ClearAppState(const std::wstring& app);
 
-    // Exclusion list (Feature 3)
+    // Saved smart switch state: -1 = none, 0/1 (resolver thread)
+    int8_t GetSavedState(const std::wstring& app);
+
+    // Exclusion list (Feature 3), compiled as "exe:<app>|enabled=off" rules
     void SetExcludedApps(const std::vector<std::wstring>& apps);
-    bool IsAppExcluded(const std::wstring& appName);
     const std::vector<std::wstring>& GetExcludedApps() const { return m_excludedApps; }
 
-    // App Encoding Memory (Feature 8)
+    // App Encoding Memory (Feature 8), compiled as "exe:<app>|encoding=..." rules
     void SetAppEncoding(const std::wstring& app, int encoding);
-    int GetAppEncoding(const std::wstring& app, int defaultEncoding);
 
-    // Load/Save to registry
+    // Learned injection pacing (PacingProfile::Pack()), saved as it changes
+    bool GetAppPacing(const std::wstring& app, uint32_t& packed);
+    void SaveAppPacing(const std::wstring& app, uint32_t packed);
+
+    // User rules text (see ParseAppRules). Returns false if a line was
+    // malformed; the other lines still apply.
+    bool SetRules(const std::wstring& text);
+
+    // Compiled rules: exclusions first, then app encodings, then user rules.
+    // The generation changes with every recompile.
+    std::shared_ptr<const AppRuleSet> GetRules(uint64_t& generation) const;
+    uint64_t RulesGeneration() const { return m_rulesGeneration.load(std::memory_order_acquire); }
+    size_t RuleCount() const;
+
+    // Load/Save to the platform settings store (registry on Win32)
     void Load();
     void Save();
 
 private:
-    AppDetector();
+    AppDetector() = default;
     ~AppDetector() = default;
     AppDetector(const AppDetector&) = delete;
     AppDetector& operator=(const AppDetector&) = delete;
 
-    HWND m_lastHwnd;
-    std::wstring m_lastAppName;
+    // Compile the current exclusions, encodings and user rules
+    void RebuildRules();
+
+    mutable std::mutex m_mutex;  // Guards the fields below (UI, hook and resolver threads)
     std::unordered_map<std::wstring, AppState> m_appStates;
+    std::unordered_map<std::wstring, uint32_t> m_appPacing;  // Not in m_appStates: an entry there is a saved smart switch state
     std::vector<std::wstring> m_excludedApps;
+    std::vector<AppRule> m_userRules;
+    std::shared_ptr<const AppRuleSet> m_rules;
+    std::atomic<uint64_t> m_rulesGeneration{0};
 
     static constexpr const wchar_t* REGISTRY_PATH = L"SOFTWARE\\ViKey";
     static constexpr const wchar_t* APP_STATES_PATH = L"SOFTWARE\\ViKey\\AppStates";
     static constexpr const wchar_t* APP_ENCODINGS_PATH = L"SOFTWARE\\ViKey\\AppEncodings";
+    static constexpr const wchar_t* APP_PACING_PATH = L"SOFTWARE\\ViKey\\AppPacing";
 };
@@ -0,0 +1,285 @@
+// ViKey - Per-App Rules Implementation
+// app_rules.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "app_rules.h"
+#include "rust_bridge.h"
+#include "text_sender.h"
+#include <algorithm>
+#include <cwctype>
+
+void AppRulePolicy::Fill(const AppRulePolicy& other) {
+    if (enabled < 0) enabled = other.enabled;
+    if (encoding < 0) encoding = other.encoding;
+    if (injection < 0) injection = other.injection;
+    if (method < 0) method = other.method;
+}
+
+static std::wstring Lower(const std::wstring& text) {
+    std::wstring out = text;
+    std::transform(out.begin(), out.end(), out.begin(), ::towlower);
+    return out;
+}
+
+static std::wstring NormalizePath(const std::wstring& path) {
+    std::wstring out = Lower(path);
+    std::replace(out.begin(), out.end(), L'/', L'\\');
+    return out;
+}
+
+static std::wstring Trim(const std::wstring& text) {
+    size_t begin = 0;
+    size_t end = text.length();
+    while (begin < end && iswspace(text[begin])) begin++;
+    while (end > begin && iswspace(text[end - 1])) end--;
+    return text.substr(begin, end - begin);
+}
+
+std::wstring AppExeName(const std::wstring& path) {
+    size_t slash = path.find_last_of(L"\\/");
+    return slash == std::wstring::npos ? path : path.substr(slash + 1);
+}
+
+bool GlobMatch(const wchar_t* pattern, const wchar_t* text) {
+    // Iterative: on mismatch, let the last '*' swallow one more character
+    const wchar_t* star = nullptr;
+    const wchar_t* resume = nullptr;
+    while (*text) {
+        if (*pattern == L'*') {
+            star = pattern++;
+            resume = text;
+        } else if (*pattern == L'?' || *pattern == *text) {
+            pattern++;
+            text++;
+        } else if (star) {
+            pattern = star + 1;
+            text = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == L'*') pattern++;
+    return *pattern == 0;
+}
+
+// ============================================================
+// Parsing
+// ============================================================
+
+struct NamedValue {
+    const wchar_t* name;
+    int8_t value;
+};
+
+static const NamedValue ENABLED_VALUES[] = {
+    {L"on", 1}, {L"off", 0}, {L"1", 1}, {L"0", 0}, {L"true", 1}, {L"false", 0},
+};
+static const NamedValue ENCODING_VALUES[] = {
+    {L"unicode", static_cast<int8_t>(OutputEncoding::Unicode)},
+    {L"vni", static_cast<int8_t>(OutputEncoding::VNI)},
+    {L"tcvn3", static_cast<int8_t>(OutputEncoding::TCVN3)},
+};
+static const NamedValue INJECTION_VALUES[] = {
+    {L"fast", static_cast<int8_t>(InjectionMode::Fast)},
+    {L"slow", static_cast<int8_t>(InjectionMode::Slow)},
+    {L"clipboard", static_cast<int8_t>(InjectionMode::Clipboard)},
+};
+static const NamedValue METHOD_VALUES[] = {
+    {L"telex", static_cast<int8_t>(InputMethod::Telex)},
+    {L"vni", static_cast<int8_t>(InputMethod::VNI)},
+};
+
+template <size_t N>
+static bool FindValue(const NamedValue (&values)[N], const std::wstring& name, int8_t& out) {
+    for (const NamedValue& v : values) {
+        if (name == v.name) {
+            out = v.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseField(const std::wstring& field, AppRulePolicy& policy) {
+    size_t eq = field.find(L'=');
+    if (eq == std::wstring::npos) return false;
+    std::wstring name = Lower(Trim(field.substr(0, eq)));
+    std::wstring value = Lower(Trim(field.substr(eq + 1)));
+
+    if (name == L"enabled") return FindValue(ENABLED_VALUES, value, policy.enabled);
+    if (name == L"encoding") return FindValue(ENCODING_VALUES, value, policy.encoding);
+    if (name == L"injection") return FindValue(INJECTION_VALUES, value, policy.injection);
+    if (name == L"method") return FindValue(METHOD_VALUES, value, policy.method);
+    return false;
+}
+
+static bool ParseRule(const std::wstring& line, AppRule& rule) {
+    size_t bar = line.find(L'|');
+    std::wstring head = line.substr(0, bar);
+    size_t colon = head.find(L':');
+    if (colon == std::wstring::npos) return false;
+
+    std::wstring kind = Lower(Trim(head.substr(0, colon)));
+    if (kind == L"exe") rule.kind = AppRuleKind::Exe;
+    else if (kind == L"glob") rule.kind = AppRuleKind::Glob;
+    else if (kind == L"path") rule.kind = AppRuleKind::PathPrefix;
+    else if (kind == L"class") rule.kind = AppRuleKind::WindowClass;
+    else return false;
+
+    rule.pattern = Trim(head.substr(colon + 1));
+    if (rule.pattern.empty()) return false;
+
+    while (bar != std::wstring::npos) {
+        size_t next = line.find(L'|', bar + 1);
+        std::wstring field = line.substr(bar + 1, next == std::wstring::npos ? std::wstring::npos : next - bar - 1);
+        if (!ParseField(field, rule.policy)) return false;
+        bar = next;
+    }
+    return !rule.policy.IsEmpty();
+}
+
+bool ParseAppRules(const std::wstring& text, std::vector<AppRule>& rules, std::vector<size_t>* badLines) {
+    bool ok = true;
+    size_t lineNumber = 0;
+    size_t pos = 0;
+    while (pos <= text.length()) {
+        size_t end = text.find(L'\n', pos);
+        if (end == std::wstring::npos) end = text.length();
+        std::wstring line = Trim(text.substr(pos, end - pos));
+        pos = end + 1;
+        lineNumber++;
+
+        if (line.empty() || line[0] == L'#') continue;
+        AppRule rule;
+        if (ParseRule(line, rule)) {
+            rules.push_back(std::move(rule));
+        } else {
+            ok = false;
+            if (badLines) badLines->push_back(lineNumber);
+        }
+    }
+    return ok;
+}
+
+// ============================================================
+// Compiled rule set
+// ============================================================
+
+void AppRuleSet::Compile(const std::vector<AppRule>& rules) {
+    m_classes.clear();
+    m_exes.clear();
+    m_prefixes.clear();
+    m_prefixLengths.clear();
+    m_globs.clear();
+    m_ruleCount = 0;
+
+    // A default policy sets nothing, so Fill() keeps the first rule's fields
+    for (const AppRule& rule : rules) {
+        if (rule.pattern.empty() || rule.policy.IsEmpty()) continue;
+        switch (rule.kind) {
+        case AppRuleKind::Exe:
+            m_exes[Lower(rule.pattern)].Fill(rule.policy);
+            break;
+        case AppRuleKind::WindowClass:
+            m_classes[rule.pattern].Fill(rule.policy);
+            break;
+        case AppRuleKind::PathPrefix: {
+            std::wstring prefix = NormalizePath(rule.pattern);
+            m_prefixes[prefix].Fill(rule.policy);
+            m_prefixLengths.push_back(prefix.length());
+            break;
+        }
+        case AppRuleKind::Glob: {
+            Glob glob;
+            glob.pattern = NormalizePath(rule.pattern);
+            size_t first = glob.pattern.find_first_of(L"*?");
+            size_t last = glob.pattern.find_last_of(L"*?");
+            glob.prefix = glob.pattern.substr(0, first);
+            // No wildcard: the prefix already is the whole pattern
+            glob.suffix = last == std::wstring::npos ? std::wstring() : glob.pattern.substr(last + 1);
+            glob.fullPath = glob.pattern.find(L'\\') != std::wstring::npos;
+            glob.policy = rule.policy;
+            m_globs.push_back(std::move(glob));
+            break;
+        }
+        }
+        m_ruleCount++;
+    }
+
+    std::sort(m_prefixLengths.begin(), m_prefixLengths.end(), std::greater<size_t>());
+    m_prefixLengths.erase(std::unique(m_prefixLengths.begin(), m_prefixLengths.end()), m_prefixLengths.end());
+}
+
+AppRulePolicy AppRuleSet::Match(const AppIdentity& app) const {
+    AppRulePolicy policy;
+
+    if (!app.windowClass.empty()) {
+        auto it = m_classes.find(app.windowClass);
+        if (it != m_classes.end()) policy.Fill(it->second);
+    }
+
+    if (!app.exeName.empty()) {
+        auto it = m_exes.find(app.exeName);
+        if (it != m_exes.end()) policy.Fill(it->second);
+    }
+
+    // One hash lookup per distinct prefix length, longest first
+    if (!app.path.empty() && !m_prefixes.empty()) {
+        std::wstring prefix;
+        for (size_t length : m_prefixLengths) {
+            if (policy.IsComplete()) break;
+            if (length > app.path.length()) continue;
+            prefix.assign(app.path, 0, length);
+            auto it = m_prefixes.find(prefix);
+            if (it != m_prefixes.end()) policy.Fill(it->second);
+        }
+    }
+
+    // Globs with a backslash match the full path, the others the exe name
+    for (const Glob& glob : m_globs) {
+        if (policy.IsComplete()) break;
+        const std::wstring& text = glob.fullPath ? app.path : app.exeName;
+        if (text.length() < glob.prefix.length() + glob.suffix.length() ||
+            text.compare(0, glob.prefix.length(), glob.prefix) != 0 ||
+            text.compare(text.length() - glob.suffix.length(), glob.suffix.length(), glob.suffix) != 0) {
+            continue;
+        }
+        if (GlobMatch(glob.pattern.c_str(), text.c_str())) policy.Fill(glob.policy);
+    }
+    return policy;
+}
+
+// ============================================================
+// Interned app cache
+// ============================================================
+
+void AppRuleCache::SetRules(std::shared_ptr<const AppRuleSet> rules, uint64_t generation) {
+    m_rules = std::move(rules);
+    m_generation = generation;
+}
+
+uint32_t AppRuleCache::Lookup(const AppIdentity& app, AppRulePolicy& policy) {
+    m_key.assign(app.path.empty() ? app.exeName : app.path);
+    m_key += L'|';
+    m_key += app.windowClass;
+
+    uint32_t id = 0;
+    bool fresh = false;
+    auto it = m_ids.find(m_key);
+    if (it != m_ids.end()) {
+        id = it->second;
+    } else {
+        m_entries.emplace_back();
+        id = static_cast<uint32_t>(m_entries.size());
+        m_ids.emplace(m_key, id);
+        fresh = true;
+    }
+
+    Entry& entry = m_entries[id - 1];
+    if (fresh || entry.generation != m_generation) {
+        entry.policy = m_rules ? m_rules->Match(app) : AppRulePolicy();
+        entry.generation = m_generation;
+    }
+    policy = entry.policy;
+    return id;
+}
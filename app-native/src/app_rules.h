@@ -0,0 +1,121 @@
+// ViKey - Per-App Rules
+// app_rules.h
+// Rules that pick per-app settings (IME on/off, output encoding, injection
+// mode, input method) by exact exe name, glob, full-path prefix or window
+// class. Rules are compiled into hash tables whenever settings change;
+// AppRuleCache then interns each distinct app so a foreground change costs
+// one hash lookup. Portable (no Win32 calls).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class AppRuleKind : uint8_t {
+    Exe = 0,      // exe:notepad.exe
+    Glob,         // glob:*term*.exe   ('*' and '?'; the full path if the pattern has a '\')
+    PathPrefix,   // path:c:\program files\jetbrains\   (full image path)
+    WindowClass   // class:ConsoleWindowClass   (exact, case-sensitive)
+};
+
+// Settings a rule can set; -1 leaves the field to lower-precedence rules
+struct AppRulePolicy {
+    int8_t enabled = -1;    // 0 = exclude (IME off), 1 = force on
+    int8_t encoding = -1;   // OutputEncoding
+    int8_t injection = -1;  // InjectionMode
+    int8_t method = -1;     // InputMethod
+
+    // Take the fields this policy does not set yet from other
+    void Fill(const AppRulePolicy& other);
+    bool IsComplete() const { return enabled >= 0 && encoding >= 0 && injection >= 0 && method >= 0; }
+    bool IsEmpty() const { return enabled < 0 && encoding < 0 && injection < 0 && method < 0; }
+};
+
+struct AppRule {
+    AppRuleKind kind = AppRuleKind::Exe;
+    std::wstring pattern;
+    AppRulePolicy policy;
+};
+
+// What the rules are matched against (exe and path lowercase)
+struct AppIdentity {
+    std::wstring exeName;      // "notepad.exe"
+    std::wstring path;         // "c:\windows\system32\notepad.exe" (may be empty)
+    std::wstring windowClass;  // "Notepad" (may be empty)
+};
+
+// Executable name of a full image path ("c:\dir\app.exe" -> "app.exe")
+std::wstring AppExeName(const std::wstring& path);
+
+// '*' matches any run of characters, '?' exactly one
+bool GlobMatch(const wchar_t* pattern, const wchar_t* text);
+
+// Parse rules, one per line: "<kind>:<pattern>|<field>=<value>|..."
+//   kinds:  exe, glob, path, class
+//   fields: enabled=on|off, encoding=unicode|vni|tcvn3,
+//           injection=fast|slow|clipboard, method=telex|vni
+// Blank lines and lines starting with '#' are skipped. Returns false if any
+// line was malformed (its 1-based number is appended to badLines); the
+// valid lines are still returned.
+bool ParseAppRules(const std::wstring& text, std::vector<AppRule>& rules, std::vector<size_t>* badLines = nullptr);
+
+class AppRuleSet {
+public:
+    // Build the lookup tables. Precedence, per field: window class, exact
+    // exe, longest path prefix, then globs; among equal rules the first in
+    // the list wins.
+    void Compile(const std::vector<AppRule>& rules);
+
+    // Merged policy for one app (hash lookups plus a scan of the globs)
+    AppRulePolicy Match(const AppIdentity& app) const;
+
+    size_t RuleCount() const { return m_ruleCount; }
+
+private:
+    struct Glob {
+        std::wstring pattern;
+        std::wstring prefix;  // Literal head before the first wildcard (quick reject)
+        std::wstring suffix;  // Literal tail after the last wildcard (quick reject)
+        bool fullPath;        // Pattern has a backslash: match the image path
+        AppRulePolicy policy;
+    };
+
+    std::unordered_map<std::wstring, AppRulePolicy> m_classes;
+    std::unordered_map<std::wstring, AppRulePolicy> m_exes;
+    std::unordered_map<std::wstring, AppRulePolicy> m_prefixes;
+    std::vector<size_t> m_prefixLengths;  // Distinct prefix lengths, longest first
+    std::vector<Glob> m_globs;
+    size_t m_ruleCount = 0;
+};
+
+// Interns apps (exe path + window class) to stable ids and memoizes their
+// matched policy. Ids are never reused, also across rule changes; a new
+// rule set only re-matches each app the next time it is looked up.
+// Single-threaded (ForegroundTracker's resolver).
+class AppRuleCache {
+public:
+    // Use these rules from now on (generation: any value that changes with them)
+    void SetRules(std::shared_ptr<const AppRuleSet> rules, uint64_t generation);
+    uint64_t Generation() const { return m_generation; }
+
+    // App id (> 0) and its policy; one hash lookup for an app seen before
+    uint32_t Lookup(const AppIdentity& app, AppRulePolicy& policy);
+
+    size_t AppCount() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        AppRulePolicy policy;
+        uint64_t generation = 0;
+    };
+
+    std::shared_ptr<const AppRuleSet> m_rules;
+    uint64_t m_generation = 0;
+    std::unordered_map<std::wstring, uint32_t> m_ids;
+    std::vector<Entry> m_entries;  // Index = id - 1
+    std::wstring m_key;            // Reused lookup key
+};
@@ -0,0 +1,132 @@
+// ViKey - Clipboard Paste Implementation
+// clipboard_paste.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "clipboard_paste.h"
+#include <algorithm>
+
+ClipboardPaste::ClipboardPaste(int backspaces, bool hasText, const InjectionPacing& pacing, uint64_t nowUs)
+    : m_state(backspaces > 0 ? State::Backspaces : hasText ? State::Save : State::Done)
+    , m_backspaces(backspaces > 0 ? backspaces : 0)
+    , m_hasText(hasText)
+    , m_pacing(pacing)
+    , m_wakeUs(nowUs)
+    , m_pasteNotBeforeUs(nowUs)
+    , m_pastedUs(0)
+    , m_retries(0)
+    , m_renderedEarly(false)
+    , m_rendered(false) {
+}
+
+PasteAction ClipboardPaste::Next(uint64_t nowUs) {
+    if (m_state == State::Done) return PasteAction::Done;
+    if (nowUs < m_wakeUs) return PasteAction::Wait;
+
+    switch (m_state) {
+    case State::Backspaces: return PasteAction::SendBackspaces;
+    case State::Save: return PasteAction::SaveClipboard;
+    case State::Offer: return PasteAction::OfferText;
+    case State::PasteDown: return PasteAction::PasteKeysDown;
+    case State::PasteUp: return PasteAction::PasteKeysUp;
+    case State::AwaitRender:
+        // Timed out: the target never asked for our text
+        if (!m_renderedEarly) {
+            m_feedback.dropped = true;
+            m_feedback.consumeUs = RENDER_TIMEOUT_US;
+        }
+        m_state = State::Restore;
+        m_retries = 0;
+        return PasteAction::RestoreClipboard;
+    case State::Restore: return PasteAction::RestoreClipboard;
+    case State::Type: return PasteAction::TypeText;
+    default: return PasteAction::Done;
+    }
+}
+
+void ClipboardPaste::Retry(uint64_t nowUs, State giveUp) {
+    if (++m_retries > MAX_RETRIES) {
+        m_state = giveUp;
+        m_retries = 0;
+        m_wakeUs = nowUs;
+        return;
+    }
+    m_wakeUs = nowUs + RETRY_US;
+}
+
+void ClipboardPaste::Complete(bool ok, uint64_t nowUs) {
+    switch (m_state) {
+    case State::Backspaces:
+        m_feedback.events += 2 * static_cast<uint32_t>(m_backspaces);
+        if (!ok) m_feedback.dropped = true;
+        // The clipboard work overlaps the settle delay; only Ctrl+V waits for it
+        m_pasteNotBeforeUs = nowUs + m_pacing.settleDelayUs;
+        m_state = m_hasText ? State::Save : State::Done;
+        m_wakeUs = nowUs;
+        break;
+    case State::Save:
+        if (!ok) {
+            Retry(nowUs, State::Type);
+            break;
+        }
+        m_state = State::Offer;
+        m_retries = 0;
+        m_wakeUs = nowUs;
+        break;
+    case State::Offer:
+        if (!ok) {
+            Retry(nowUs, State::Type);
+            break;
+        }
+        m_state = State::PasteDown;
+        m_retries = 0;
+        m_wakeUs = std::max(nowUs, m_pasteNotBeforeUs);
+        break;
+    case State::PasteDown:
+        m_feedback.events += 2;
+        if (!ok) m_feedback.dropped = true;
+        m_pastedUs = nowUs;
+        m_state = State::PasteUp;
+        m_wakeUs = nowUs + m_pacing.eventDelayUs;
+        break;
+    case State::PasteUp:
+        m_feedback.events += 2;
+        if (!ok) m_feedback.dropped = true;
+        if (m_rendered) {
+            m_state = State::Restore;
+            m_wakeUs = nowUs;
+        } else {
+            m_state = State::AwaitRender;
+            m_wakeUs = nowUs + (m_renderedEarly ? UNSIGNALED_RESTORE_US : RENDER_TIMEOUT_US);
+        }
+        break;
+    case State::Restore:
+        if (!ok) {
+            Retry(nowUs, State::Done);  // Give up: our text stays on the clipboard
+            break;
+        }
+        m_state = State::Done;
+        break;
+    case State::Type:
+        m_state = State::Done;
+        break;
+    default:
+        break;
+    }
+}
+
+void ClipboardPaste::Rendered(uint64_t nowUs) {
+    if (m_state == State::Save || m_state == State::Offer || m_state == State::PasteDown) {
+        // Read before our Ctrl+V: later reads get the rendered copy, unsignaled
+        m_renderedEarly = true;
+        return;
+    }
+    if (m_rendered || m_pastedUs == 0) return;
+    m_rendered = true;
+    m_feedback.consumeUs = static_cast<uint32_t>(nowUs - m_pastedUs);
+    m_feedback.confirmed = true;  // The app read the clipboard: it handled the paste
+    if (m_state == State::AwaitRender) {
+        m_state = State::Restore;
+        m_retries = 0;
+        m_wakeUs = nowUs;
+    }
+}
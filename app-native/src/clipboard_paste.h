@@ -0,0 +1,71 @@
+// ViKey - Clipboard Paste
+// clipboard_paste.h
+// One clipboard paste (backspaces, our text on the clipboard, Ctrl+V, the
+// user's clipboard back) as a state machine. The backend performs each
+// action it asks for and, in between, waits on its own event source (window
+// messages on Win32, the virtual clock in the sim) until WakeUs() instead of
+// sleeping a fixed chain of delays. The user's clipboard is restored as soon
+// as the target has read our text (Rendered(), from delayed rendering on
+// Win32); a busy clipboard is retried on a timer. Portable.
+
+#pragma once
+
+#include "injection_pacer.h"
+#include <cstdint>
+
+enum class PasteAction : uint8_t {
+    SendBackspaces,    // Inject the backspaces (one batch)
+    SaveClipboard,     // Snapshot the clipboard's global-memory formats
+    OfferText,         // Put our text on the clipboard (delay-rendered where possible)
+    PasteKeysDown,     // Ctrl down, V down
+    PasteKeysUp,       // V up, Ctrl up
+    RestoreClipboard,  // Put the snapshot back
+    TypeText,          // Clipboard unavailable: inject the text as keys (drop the snapshot)
+    Wait,              // Nothing to do before WakeUs()
+    Done
+};
+
+class ClipboardPaste {
+public:
+    static constexpr uint32_t RETRY_US = 10000;             // Clipboard held by another app
+    static constexpr uint32_t MAX_RETRIES = 15;             // Then give up (150 ms, as the old 3 × 50 ms)
+    static constexpr uint32_t RENDER_TIMEOUT_US = 500000;   // Target never read our text: restore anyway
+    static constexpr uint32_t UNSIGNALED_RESTORE_US = 150000;  // Read before Ctrl+V (clipboard history): no signal left
+
+    ClipboardPaste(int backspaces, bool hasText, const InjectionPacing& pacing, uint64_t nowUs);
+
+    // Action to perform at nowUs (Wait: call again at WakeUs() or on Rendered())
+    PasteAction Next(uint64_t nowUs);
+
+    // Outcome of the action Next() returned: false if the clipboard could not
+    // be opened, or if SendInput refused key events
+    void Complete(bool ok, uint64_t nowUs);
+
+    // Our text was read off the clipboard
+    void Rendered(uint64_t nowUs);
+
+    uint64_t WakeUs() const { return m_wakeUs; }
+    bool IsDone() const { return m_state == State::Done; }
+
+    // For InjectionPacer: consumeUs = Ctrl+V to the target reading the
+    // clipboard; dropped if it never did
+    const InjectionFeedback& Feedback() const { return m_feedback; }
+
+private:
+    enum class State : uint8_t { Backspaces, Save, Offer, PasteDown, PasteUp, AwaitRender, Restore, Type, Done };
+
+    // Clipboard busy: try again later, or take `giveUp` after MAX_RETRIES
+    void Retry(uint64_t nowUs, State giveUp);
+
+    State m_state;
+    int m_backspaces;
+    bool m_hasText;
+    InjectionPacing m_pacing;
+    uint64_t m_wakeUs;
+    uint64_t m_pasteNotBeforeUs;  // Backspaces settle before Ctrl+V
+    uint64_t m_pastedUs;          // Ctrl+V down
+    uint32_t m_retries;
+    bool m_renderedEarly;         // Read before Ctrl+V (a clipboard history app)
+    bool m_rendered;
+    InjectionFeedback m_feedback;
+};
@@ -202,6 +202,20 @@ void ShowAboutDialog() {
     isOpen = false;
 }
 
+// ============================================================
+// Diagnostics
+// ============================================================
+
+void ShowDiagnosticsDialog() {
+    static bool isOpen = false;
+    if (isOpen) return;
+    isOpen = true;
+    // Ctrl+C in the message box copies the report for bug reports
+    std::wstring report = ImeProcessor::Instance().DiagnosticsReport();
+    MessageBoxW(g_hWnd, report.c_str(), L"ViKey - Ch\u1EA9n \u0111o\u00E1n", MB_OK | MB_ICONINFORMATION);
+    isOpen = false;
+}
+
 // ============================================================
 // Import/Export Settings
 // ============================================================
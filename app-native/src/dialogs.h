@@ -18,6 +18,7 @@ void ShowExcludeAppsDialog();
 void ShowConverterDialog();
 void ShowShortcutsDialog();
 void ShowUpdateDialog(const UpdateInfo& info);
+void ShowDiagnosticsDialog();
 
 // Import/Export settings
 void ExportSettings();
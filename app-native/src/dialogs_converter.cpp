@@ -11,6 +11,7 @@
 #include "hotkey.h"
 #include "app_detector.h"
 #include "encoding_converter.h"
+#include "text_transform.h"
 #include <commctrl.h>
 #include <commdlg.h>
 
@@ -18,6 +19,76 @@
 // Converter Dialog
 // ============================================================
 
+// The "from" encoding follows the source text until the user picks one
+static bool s_fromChosen = false;
+
+// Select the most likely encoding of the source text and show how sure it is
+static void DetectSource(HWND hDlg) {
+    int len = GetWindowTextLengthW(GetDlgItem(hDlg, IDC_EDIT_SOURCE));
+    std::wstring source(len + 1, L'\0');
+    GetDlgItemTextW(hDlg, IDC_EDIT_SOURCE, &source[0], len + 1);
+    source.resize(len);
+    if (source.empty()) {
+        SetDlgItemTextW(hDlg, IDC_STATIC_DETECT, L"");
+        return;
+    }
+    EncodingGuess best = EncodingConverter::Detect(source).front();
+    SendMessageW(GetDlgItem(hDlg, IDC_COMBO_FROM), CB_SETCURSEL, static_cast<int>(best.encoding), 0);
+    wchar_t status[64];
+    swprintf_s(status, L"%s (%d%%)", EncodingConverter::GetEncodingName(best.encoding),
+               static_cast<int>(best.confidence * 100.0f + 0.5f));
+    SetDlgItemTextW(hDlg, IDC_STATIC_DETECT, status);
+}
+
+// Label of the selection hotkey checkbox, e.g. "Ctrl+Shift+F9: chuyển vùng chọn"
+static void ShowSelectionHotkey(HWND hDlg, const HotkeyConfig& config) {
+    std::wstring label;
+    if (config.ctrl) label += L"Ctrl+";
+    if (config.shift) label += L"Shift+";
+    if (config.alt) label += L"Alt+";
+    if (config.win) label += L"Win+";
+    if (config.vkCode >= VK_F1 && config.vkCode <= VK_F24) {
+        label += L"F" + std::to_wstring(config.vkCode - VK_F1 + 1);
+    } else if ((config.vkCode >= 0x30 && config.vkCode <= 0x39) || (config.vkCode >= 0x41 && config.vkCode <= 0x5A)) {
+        label += static_cast<wchar_t>(config.vkCode);
+    } else {
+        label += L"?";
+    }
+    label += L": chuy\u1EC3n v\u00F9ng ch\u1ECDn";
+    SetDlgItemTextW(hDlg, IDC_CHECK_SELECTION, label.c_str());
+}
+
+// The selection hotkey converts with the pair last shown in the dialog
+static void SaveSelectionPair(HWND hDlg) {
+    Settings& settings = Settings::Instance();
+    int fromIdx = (int)SendMessageW(GetDlgItem(hDlg, IDC_COMBO_FROM), CB_GETCURSEL, 0, 0);
+    int toIdx = (int)SendMessageW(GetDlgItem(hDlg, IDC_COMBO_TO), CB_GETCURSEL, 0, 0);
+    bool enabled = IsDlgButtonChecked(hDlg, IDC_CHECK_SELECTION) == BST_CHECKED;
+    if (fromIdx < 0 || toIdx < 0) return;
+    if (enabled == settings.selectionConvert && static_cast<VietEncoding>(fromIdx) == settings.selectionFrom &&
+        static_cast<VietEncoding>(toIdx) == settings.selectionTo) {
+        return;
+    }
+    settings.selectionFrom = static_cast<VietEncoding>(fromIdx);
+    settings.selectionTo = static_cast<VietEncoding>(toIdx);
+    if (enabled != settings.selectionConvert) {
+        settings.selectionConvert = enabled;
+        HotkeyManager::Instance().UpdateHotkey(g_hWnd);
+    }
+    settings.Save();
+}
+
+// Transforms ticked under the target: NFC repair, then stripping, then case
+static std::vector<TransformStage> SelectedStages(HWND hDlg) {
+    static const TransformStage CASES[] = {TransformStage::Upper, TransformStage::Lower, TransformStage::Title};
+    std::vector<TransformStage> stages;
+    if (IsDlgButtonChecked(hDlg, IDC_CHECK_NFC) == BST_CHECKED) stages.push_back(TransformStage::ComposeNfc);
+    if (IsDlgButtonChecked(hDlg, IDC_CHECK_STRIP) == BST_CHECKED) stages.push_back(TransformStage::StripDiacritics);
+    int caseIdx = (int)SendMessageW(GetDlgItem(hDlg, IDC_COMBO_CASE), CB_GETCURSEL, 0, 0);
+    if (caseIdx >= 1 && caseIdx <= 3) stages.push_back(CASES[caseIdx - 1]);
+    return stages;
+}
+
 static INT_PTR CALLBACK ConverterDialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
     UNREFERENCED_PARAMETER(lParam);
     INT_PTR darkResult = HandleDarkModeColors(message, wParam);
@@ -29,22 +100,48 @@ static INT_PTR CALLBACK ConverterDialogProc(HWND hDlg, UINT message, WPARAM wPar
         SetWindowTextW(hDlg, L"Chuy\u1EC3n m\u00E3 ti\u1EBFng Vi\u1EC7t");
         SetDlgItemTextW(hDlg, IDC_BTN_CONVERT, L"Chuy\u1EC3n \u0111\u1ED5i");
         SetDlgItemTextW(hDlg, IDC_BTN_COPY, L"Sao ch\u00E9p");
+        SetDlgItemTextW(hDlg, IDC_BTN_DETECT, L"Nh\u1EADn d\u1EA1ng");
         SetDlgItemTextW(hDlg, IDCANCEL, L"\u0110\u00F3ng");
+        SetDlgItemTextW(hDlg, IDC_CHECK_STRIP, L"B\u1ECF d\u1EA5u");
+        SetDlgItemTextW(hDlg, IDC_CHECK_NFC, L"S\u1EEDa NFD");
+        s_fromChosen = false;
 
         HWND hFrom = GetDlgItem(hDlg, IDC_COMBO_FROM);
         HWND hTo = GetDlgItem(hDlg, IDC_COMBO_TO);
-        for (int i = 0; i <= 3; i++) {
+        for (int i = 0; i < VIET_ENCODING_COUNT; i++) {
             const wchar_t* name = EncodingConverter::GetEncodingName(static_cast<VietEncoding>(i));
             SendMessageW(hFrom, CB_ADDSTRING, 0, (LPARAM)name);
             SendMessageW(hTo, CB_ADDSTRING, 0, (LPARAM)name);
         }
-        SendMessageW(hFrom, CB_SETCURSEL, 1, 0);
-        SendMessageW(hTo, CB_SETCURSEL, 0, 0);
+        HWND hCase = GetDlgItem(hDlg, IDC_COMBO_CASE);
+        SendMessageW(hCase, CB_ADDSTRING, 0, (LPARAM)L"Gi\u1EEF nguy\u00EAn");
+        SendMessageW(hCase, CB_ADDSTRING, 0, (LPARAM)L"CH\u1EEE HOA");
+        SendMessageW(hCase, CB_ADDSTRING, 0, (LPARAM)L"ch\u1EEF th\u01B0\u1EDDng");
+        SendMessageW(hCase, CB_ADDSTRING, 0, (LPARAM)L"Hoa \u0110\u1EA7u T\u1EEB");
+        SendMessageW(hCase, CB_SETCURSEL, 0, 0);
+        const Settings& settings = Settings::Instance();
+        SendMessageW(hFrom, CB_SETCURSEL, static_cast<int>(settings.selectionFrom), 0);
+        SendMessageW(hTo, CB_SETCURSEL, static_cast<int>(settings.selectionTo), 0);
+        ShowSelectionHotkey(hDlg, settings.selectionHotkey);
+        CheckDlgButton(hDlg, IDC_CHECK_SELECTION, settings.selectionConvert ? BST_CHECKED : BST_UNCHECKED);
         return TRUE;
     }
 
     case WM_COMMAND:
         switch (LOWORD(wParam)) {
+        case IDC_EDIT_SOURCE:
+            if (HIWORD(wParam) == EN_CHANGE && !s_fromChosen) DetectSource(hDlg);
+            return TRUE;
+        case IDC_COMBO_FROM:
+            if (HIWORD(wParam) == CBN_SELCHANGE) {
+                s_fromChosen = true;
+                SetDlgItemTextW(hDlg, IDC_STATIC_DETECT, L"");
+            }
+            return TRUE;
+        case IDC_BTN_DETECT:
+            s_fromChosen = false;
+            DetectSource(hDlg);
+            return TRUE;
         case IDC_BTN_CONVERT: {
             int len = GetWindowTextLengthW(GetDlgItem(hDlg, IDC_EDIT_SOURCE));
             if (len > 0) {
@@ -55,7 +152,7 @@ static INT_PTR CALLBACK ConverterDialogProc(HWND hDlg, UINT message, WPARAM wPar
                 int toIdx = (int)SendMessageW(GetDlgItem(hDlg, IDC_COMBO_TO), CB_GETCURSEL, 0, 0);
                 VietEncoding from = static_cast<VietEncoding>(fromIdx);
                 VietEncoding to = static_cast<VietEncoding>(toIdx);
-                std::wstring result = EncodingConverter::Instance().Convert(source, from, to);
+                std::wstring result = EncodingConverter::Instance().Convert(source, from, to, SelectedStages(hDlg));
                 SetDlgItemTextW(hDlg, IDC_EDIT_TARGET, result.c_str());
             }
             return TRUE;
@@ -67,6 +164,8 @@ static INT_PTR CALLBACK ConverterDialogProc(HWND hDlg, UINT message, WPARAM wPar
             int toIdx = (int)SendMessageW(hTo, CB_GETCURSEL, 0, 0);
             SendMessageW(hFrom, CB_SETCURSEL, toIdx, 0);
             SendMessageW(hTo, CB_SETCURSEL, fromIdx, 0);
+            s_fromChosen = true;
+            SetDlgItemTextW(hDlg, IDC_STATIC_DETECT, L"");
             return TRUE;
         }
         case IDC_BTN_COPY: {
@@ -91,7 +190,11 @@ static INT_PTR CALLBACK ConverterDialogProc(HWND hDlg, UINT message, WPARAM wPar
             }
             return TRUE;
         }
+        case IDC_CHECK_SELECTION:
+            SaveSelectionPair(hDlg);
+            return TRUE;
         case IDCANCEL:
+            SaveSelectionPair(hDlg);
             EndDialog(hDlg, IDCANCEL);
             return TRUE;
         }
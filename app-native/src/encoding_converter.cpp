@@ -3,46 +3,35 @@
 // Project: ViKey | Author: Tran Cong Sinh | https://github.com/kmis8x/ViKey
 
 #include "encoding_converter.h"
-#include <unordered_map>
-
-// VNI Windows mapping (VNI char -> Unicode char)
-static const std::unordered_map<wchar_t, wchar_t> g_vniToUnicode = {
-    // Lowercase vowels with diacritics
-    {0x00E1, 0x00E1}, // a acute - same
-    {0x00E0, 0x00E0}, // a grave - same
-    {0x1EA3, 0x1EA3}, // a hook - same
-    {0x00E3, 0x00E3}, // a tilde - same
-    {0x1EA1, 0x1EA1}, // a dot - same
-    // VNI specific characters
-    {0x00E2, 0x00E2}, // a circumflex - same
-    {0x0103, 0x0103}, // a breve - same
-    // ... more mappings
-};
+#include "encoding_stream.h"
+#include "encoding_tables.h"
+#include "utf8_codec.h"
+#include <algorithm>
+#include <cstring>
 
-// Unicode characters for Vietnamese
-static const wchar_t UNICODE_VIET[] = L"aàảãáạăằẳẵắặâầẩẫấậeèẻẽéẹêềểễếệiìỉĩíịoòỏõóọôồổỗốộơờởỡớợuùủũúụưừửữứựyỳỷỹýỵđAÀẢÃÁẠĂẰẲẴẮẶÂẦẨẪẤẬEÈẺẼÉẸÊỀỂỄẾỆIÌỈĨÍỊOÒỎÕÓỌÔỒỔỖỐỘƠỜỞỠỚỢUÙỦŨÚỤƯỪỬỮỨỰYỲỶỸÝỴĐ";
-
-// VNI Windows character codes (corresponding to UNICODE_VIET)
-static const wchar_t VNI_VIET[] = L"aµ¶·¸¹¨»¼½¾¿©ÇÈÉÊËeÌÍÎÏÐª«Ñ®ÒÓiÔÕÖ×Øo¹º»¼½¤åæçèé¥êëìíîuïðñòó¦ôõö÷øyùúûüýđAÙÚÛÜÝ¡ßàáâã¢äåæçèEéêëìí£ïðñòóIôõö÷øO¿ÀÁÂÃ¬ÄÅÆÇÈÊËÌÍÎUÏÐÑÒÓYôõö÷øD";
-
-// TCVN3 character codes
-static const unsigned char TCVN3_VIET[] = {
-    0x61, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xA8, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF,
-    0xA9, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0x65, 0xCC, 0xCD, 0xCE, 0xCF, 0xD0,
-    0xAA, 0xD1, 0xD2, 0xD3, 0xD4, 0xD5, 0x69, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
-    0x6F, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF, 0xA4, 0xE0, 0xE1, 0xE2, 0xE3, 0xE4,
-    0xA5, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0x75, 0xEA, 0xEB, 0xEC, 0xED, 0xEE,
-    0xA6, 0xEF, 0xF0, 0xF1, 0xF2, 0xF3, 0x79, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
-    0xAE, // d
-    // Uppercase
-    0x41, 0x80, 0x81, 0x82, 0x83, 0x84, 0xA1, 0x85, 0x86, 0x87, 0x88, 0x89,
-    0xA2, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x45, 0x8F, 0x90, 0x91, 0x92, 0x93,
-    0xA3, 0x94, 0x95, 0x96, 0x97, 0x98, 0x49, 0x99, 0x9A, 0x9B, 0x9C, 0x9D,
-    0x4F, 0x9E, 0x9F, 0xA0, 0xAF, 0xB0, 0xAC, 0xB1, 0xB2, 0xB3, 0xB4, 0xBA,
-    0xAD, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0x55, 0xC5, 0xC6, 0xFA, 0xFB, 0xFC,
-    0xFD, 0xFE, 0x59, 0xFF,
-    0xD0 // D
-};
+// Input units per step: buffers stay in cache
+static constexpr size_t CHUNK = 4096;
+
+// Toned letters as a base and marks take more units; prose stays well under 1.5x
+static size_t Reserve(size_t length, VietEncoding to) {
+    bool expands = to == VietEncoding::VNI_Windows || to == VietEncoding::Unicode_Comp ||
+                   to == VietEncoding::CP1258 || to == VietEncoding::VIQR;
+    return expands ? length + length / 2 : length;
+}
+
+// Convert in one pass through EncodingStream, a cache-sized chunk at a time
+static std::wstring Stream(const std::wstring& text, VietEncoding from, VietEncoding to) {
+    EncodingStream stream(from, to);
+    wchar_t out[EncodingStream::MaxOutput(CHUNK)];
+    std::wstring result;
+    result.reserve(Reserve(text.size(), to));
+    for (size_t at = 0; at < text.size(); at += CHUNK) {
+        size_t length = text.size() - at < CHUNK ? text.size() - at : CHUNK;
+        result.append(out, stream.Push(text.data() + at, length, out));
+    }
+    result.append(out, stream.Finish(out));
+    return result;
+}
 
 EncodingConverter& EncodingConverter::Instance() {
     static EncodingConverter instance;
@@ -55,6 +44,9 @@ const wchar_t* EncodingConverter::GetEncodingName(VietEncoding enc) {
         case VietEncoding::VNI_Windows: return L"VNI Windows";
         case VietEncoding::TCVN3: return L"TCVN3 (ABC)";
         case VietEncoding::Unicode_Comp: return L"Unicode Composite";
+        case VietEncoding::VISCII: return L"VISCII";
+        case VietEncoding::CP1258: return L"Windows-1258";
+        case VietEncoding::VIQR: return L"VIQR";
         default: return L"Unknown";
     }
 }
@@ -62,166 +54,224 @@ const wchar_t* EncodingConverter::GetEncodingName(VietEncoding enc) {
 std::wstring EncodingConverter::Convert(const std::wstring& text, VietEncoding from, VietEncoding to) {
     if (from == to) return text;
 
-    // First convert to Unicode (intermediate format)
-    std::wstring unicode;
-    switch (from) {
-        case VietEncoding::Unicode:
-            unicode = text;
-            break;
-        case VietEncoding::VNI_Windows:
-            unicode = VNIToUnicode(text);
-            break;
-        case VietEncoding::TCVN3:
-            unicode = TCVN3ToUnicode(text);
-            break;
-        case VietEncoding::Unicode_Comp:
-            unicode = CompositeToUnicode(text);
-            break;
-    }
-
-    // Then convert from Unicode to target encoding
-    switch (to) {
-        case VietEncoding::Unicode:
-            return unicode;
-        case VietEncoding::VNI_Windows:
-            return UnicodeToVNI(unicode);
-        case VietEncoding::TCVN3:
-            return UnicodeToTCVN3(unicode);
-        case VietEncoding::Unicode_Comp:
-            return UnicodeToComposite(unicode);
-    }
-
-    return text;
+    // Every pair, Composite (NFD) included, converts directly with the
+    // built-in tables, without an intermediate Unicode string
+    return Stream(text, from, to);
 }
 
-// Lazily-built O(1) lookup tables for encoding conversion
-static const std::unordered_map<wchar_t, wchar_t>& GetUnicodeToVNIMap() {
-    static auto map = []() {
-        std::unordered_map<wchar_t, wchar_t> m;
-        size_t len = wcslen(UNICODE_VIET);
-        size_t vniLen = wcslen(VNI_VIET);
-        for (size_t i = 0; i < len && i < vniLen; i++) {
-            m[UNICODE_VIET[i]] = VNI_VIET[i];
-        }
-        return m;
-    }();
-    return map;
-}
+std::wstring EncodingConverter::Convert(const std::wstring& text, VietEncoding from, VietEncoding to,
+                                        const std::vector<TransformStage>& stages) {
+    if (stages.empty()) return Convert(text, from, to);
+    if (from == VietEncoding::Unicode && to == VietEncoding::Unicode) return TextTransform(stages).Apply(text);
 
-static const std::unordered_map<wchar_t, wchar_t>& GetVNIToUnicodeMap() {
-    static auto map = []() {
-        std::unordered_map<wchar_t, wchar_t> m;
-        size_t vniLen = wcslen(VNI_VIET);
-        size_t uniLen = wcslen(UNICODE_VIET);
-        for (size_t i = 0; i < vniLen && i < uniLen; i++) {
-            m[VNI_VIET[i]] = UNICODE_VIET[i];
-        }
-        return m;
-    }();
-    return map;
+    // Each chunk is decoded, transformed and encoded while it is in cache
+    constexpr size_t DECODED = EncodingStream::MaxOutput(CHUNK);
+    constexpr size_t TRANSFORMED = TextTransform::MaxOutput(DECODED);
+    EncodingStream decoder(from, VietEncoding::Unicode);
+    TextTransform transform(stages);
+    EncodingStream encoder(VietEncoding::Unicode, to);
+    std::vector<wchar_t> decoded(DECODED), transformed(TRANSFORMED), out(EncodingStream::MaxOutput(TRANSFORMED));
+    std::wstring result;
+    result.reserve(Reserve(text.size(), to));
+    auto encode = [&](size_t length) { result.append(out.data(), encoder.Push(transformed.data(), length, out.data())); };
+    auto pass = [&](size_t length) { encode(transform.Push(decoded.data(), length, transformed.data())); };
+    for (size_t at = 0; at < text.size(); at += CHUNK) {
+        size_t length = text.size() - at < CHUNK ? text.size() - at : CHUNK;
+        pass(decoder.Push(text.data() + at, length, decoded.data()));
+    }
+    pass(decoder.Finish(decoded.data()));
+    encode(transform.Finish(transformed.data()));
+    result.append(out.data(), encoder.Finish(out.data()));
+    return result;
 }
 
-static const std::unordered_map<wchar_t, wchar_t>& GetUnicodeToTCVN3Map() {
-    static auto map = []() {
-        std::unordered_map<wchar_t, wchar_t> m;
-        size_t uniLen = wcslen(UNICODE_VIET);
-        size_t tcvnLen = sizeof(TCVN3_VIET);
-        for (size_t i = 0; i < uniLen && i < tcvnLen; i++) {
-            m[UNICODE_VIET[i]] = static_cast<wchar_t>(TCVN3_VIET[i]);
-        }
-        return m;
-    }();
-    return map;
-}
+// ============================================================
+// Bytes
+// ============================================================
 
-static const std::unordered_map<unsigned char, wchar_t>& GetTCVN3ToUnicodeMap() {
-    static auto map = []() {
-        std::unordered_map<unsigned char, wchar_t> m;
-        size_t tcvnLen = sizeof(TCVN3_VIET);
-        size_t uniLen = wcslen(UNICODE_VIET);
-        for (size_t i = 0; i < tcvnLen && i < uniLen; i++) {
-            m[TCVN3_VIET[i]] = UNICODE_VIET[i];
-        }
-        return m;
-    }();
-    return map;
+// Unicode and Unicode Composite travel as UTF-8, the rest one byte per unit
+static bool IsUtf8(VietEncoding encoding) {
+    return encoding == VietEncoding::Unicode || encoding == VietEncoding::Unicode_Comp;
 }
 
-std::wstring EncodingConverter::UnicodeToVNI(const std::wstring& text) {
-    const auto& map = GetUnicodeToVNIMap();
-    std::wstring result;
-    result.reserve(text.size());
-    for (wchar_t c : text) {
-        auto it = map.find(c);
-        result += (it != map.end()) ? it->second : c;
-    }
-    return result;
+static size_t Widen(const uint8_t* data, size_t length, wchar_t* out) {
+    for (size_t i = 0; i < length; i++) out[i] = static_cast<wchar_t>(data[i]);
+    return length;
 }
 
-std::wstring EncodingConverter::VNIToUnicode(const std::wstring& text) {
-    const auto& map = GetVNIToUnicodeMap();
-    std::wstring result;
-    result.reserve(text.size());
-    for (wchar_t c : text) {
-        auto it = map.find(c);
-        result += (it != map.end()) ? it->second : c;
+static size_t Narrow(const wchar_t* text, size_t length, char* out) {
+    for (size_t i = 0; i < length; i++) {
+        uint32_t unit = static_cast<uint32_t>(text[i]);
+        out[i] = unit <= 0xFF ? static_cast<char>(unit) : '?';
     }
-    return result;
+    return length;
 }
 
-std::wstring EncodingConverter::UnicodeToTCVN3(const std::wstring& text) {
-    const auto& map = GetUnicodeToTCVN3Map();
-    std::wstring result;
-    result.reserve(text.size());
-    for (wchar_t c : text) {
-        auto it = map.find(c);
-        result += (it != map.end()) ? it->second : c;
-    }
-    return result;
-}
+bool EncodingConverter::Convert(const uint8_t* in, size_t length, OutputSink& out, VietEncoding from, VietEncoding to) {
+    // A chunk never cuts a UTF-8 sequence, and decodes to at most one unit
+    // per byte; the stream holds back a letter cut at its end
+    const bool utf8In = IsUtf8(from), utf8Out = IsUtf8(to);
+    const size_t bytesPerUnit = utf8Out ? Utf8Codec::MAX_BYTES_PER_UNIT : 1;
+    EncodingStream stream(from, to);
+    std::vector<wchar_t> units(CHUNK), converted(EncodingStream::MaxOutput(CHUNK));
+    std::vector<char> staging;
 
-std::wstring EncodingConverter::TCVN3ToUnicode(const std::wstring& text) {
-    const auto& map = GetTCVN3ToUnicodeMap();
-    std::wstring result;
-    result.reserve(text.size());
-    for (wchar_t c : text) {
-        auto it = map.find(static_cast<unsigned char>(c));
-        result += (it != map.end()) ? it->second : c;
+    // text[0, count) into the sink: straight into its memory when it has
+    // room for the longest output, through staging when it may be nearly full
+    auto write = [&](const wchar_t* text, size_t count) {
+        if (count == 0) return true;
+        char* dest = out.Reserve(count * bytesPerUnit);
+        char* buffer = dest;
+        if (!buffer) {
+            staging.resize(count * bytesPerUnit);
+            buffer = staging.data();
+        }
+        size_t bytes = utf8Out ? Utf8Codec::Encode(text, count, buffer) : Narrow(text, count, buffer);
+        if (!dest) {
+            dest = out.Reserve(bytes);
+            if (!dest) return false;
+            std::memcpy(dest, buffer, bytes);
+        }
+        out.Commit(bytes);
+        return true;
+    };
+
+    for (size_t at = 0; at < length;) {
+        size_t take = length - at < CHUNK ? length - at : CHUNK;
+        if (utf8In && at + take < length) take = Utf8Codec::WholeLength(in + at, take);
+        size_t count = utf8In ? Utf8Codec::Decode(in + at, take, units.data()) : Widen(in + at, take, units.data());
+        at += take;
+        // Same encoding: decoding and encoding again is all there is (bad UTF-8 repaired)
+        bool written = from == to ? write(units.data(), count)
+                                  : write(converted.data(), stream.Push(units.data(), count, converted.data()));
+        if (!written) return false;
     }
-    return result;
+    return write(converted.data(), stream.Finish(converted.data()));
 }
 
-std::wstring EncodingConverter::UnicodeToComposite(const std::wstring& text) {
-    // Unicode NFC -> NFD conversion (precomposed -> decomposed)
-    // Using Windows API
-    int len = NormalizeString(NormalizationD, text.c_str(), -1, nullptr, 0);
-    if (len <= 0) return text;
+// ============================================================
+// Detection
+// ============================================================
 
-    std::wstring result(len, L'\0');
-    int actualLen = NormalizeString(NormalizationD, text.c_str(), -1, &result[0], len);
-    if (actualLen <= 0) return text;
+namespace {
 
-    // Remove trailing null
-    while (!result.empty() && result.back() == L'\0') {
-        result.pop_back();
-    }
+// What reading a sample as one encoding explains, in non-ASCII units
+struct Evidence {
+    size_t letters = 0;    // Read as (part of) a Vietnamese letter
+    size_t invalid = 0;    // Below U+2000 but no letter in this encoding
+    size_t sequences = 0;  // Letters of two or more units (base + marks)
+};
 
-    return result;
+// Capital letter (first unit of a decoded letter)
+bool IsCapital(uint64_t letter) {
+    uint32_t c = static_cast<uint32_t>(letter & 0xFFFF);
+    if (c < 0x80) return c >= 'A' && c <= 'Z';
+    if (c < 0x100) return c >= 0xC0 && c <= 0xDE && c != 0xD7;
+    if (c == 0x1AF || c == 0x1B0) return c == 0x1AF;  // Ư ư break the even/odd pattern
+    return c % 2 == 0;  // Latin Extended-A/B and Additional: capital, then small
 }
 
-std::wstring EncodingConverter::CompositeToUnicode(const std::wstring& text) {
-    // Unicode NFD -> NFC conversion (decomposed -> precomposed)
-    int len = NormalizeString(NormalizationC, text.c_str(), -1, nullptr, 0);
-    if (len <= 0) return text;
+// Tally how an encoding's table to Unicode reads text at the non-ASCII
+// units listed: the longest match at each, starting at the unit before it
+// if that is a base the unit continues. Units from U+2000 up (punctuation,
+// symbols, other scripts) read the same in every encoding and count for none.
+// A capital right after a small letter is no letter either: misread
+// bytes come out in random case (TCVN3 read as VISCII, and the reverse).
+void Read(const EncodingTables::DecodeTrie& table, const wchar_t* text, size_t length,
+          const uint16_t* positions, size_t count, Evidence& evidence) {
+    using EncodingTables::NODE_SHIFT;
+    using EncodingTables::OUTPUT_MASK;
+    size_t consumed = 0;  // Units before this were read as part of a letter
+    size_t smallEnd = 0;  // Just after the last small letter read
+    bool sequences = table.nodeCount > 1;
+    for (size_t p = 0; p < count; p++) {
+        size_t i = positions[p];
+        if (i < consumed) continue;
+        uint32_t c = static_cast<uint32_t>(text[i]);
+        size_t end = i + 1;
+        uint64_t entry = 0;
+        if (sequences && i > 0 && static_cast<uint32_t>(text[i - 1]) < 0x80) {
+            uint64_t base = table.Start(static_cast<uint32_t>(text[i - 1]));
+            if ((base >> NODE_SHIFT) != 0) entry = table.Next(static_cast<uint32_t>(base >> NODE_SHIFT), c);
+        }
+        bool sequence = entry != 0;
+        if (!sequence) entry = table.Start(c);
+        while ((entry >> NODE_SHIFT) != 0 && end < length) {
+            uint64_t next = table.Next(static_cast<uint32_t>(entry >> NODE_SHIFT), static_cast<uint32_t>(text[end]));
+            if (next == 0) break;
+            entry = next;
+            sequence = true;
+            end++;
+        }
+        uint64_t letter = entry & OUTPUT_MASK;
+        bool capital = letter != 0 && IsCapital(letter);
+        if (sequence) {
+            evidence.sequences++;
+            evidence.letters += end - i;
+        } else if (letter != 0 && !(capital && (i == smallEnd || (i > 0 && text[i - 1] >= L'a' && text[i - 1] <= L'z')))) {
+            evidence.letters++;
+        } else if (c < 0x2000) {
+            evidence.invalid++;
+        }
+        if (letter != 0 && !capital) smallEnd = end;
+        consumed = end;
+    }
+}
+
+// Each encoding read through its table to Unicode. Unicode itself reads
+// through its NFD table, which maps exactly the precomposed letters. VIQR
+// is plain ASCII, which the sample does not look at: it is never a guess.
+struct Reader {
+    VietEncoding encoding;
+    const EncodingTables::DecodeTrie& table;
+};
+
+const Reader READERS[] = {
+    {VietEncoding::Unicode, EncodingTables::UNICODE_TO_COMPOSITE},
+    {VietEncoding::VNI_Windows, EncodingTables::VNI_TO_UNICODE},
+    {VietEncoding::TCVN3, EncodingTables::TCVN3_TO_UNICODE},
+    {VietEncoding::Unicode_Comp, EncodingTables::COMPOSITE_TO_UNICODE},
+    {VietEncoding::VISCII, EncodingTables::VISCII_TO_UNICODE},
+    {VietEncoding::CP1258, EncodingTables::CP1258_TO_UNICODE},
+};
 
-    std::wstring result(len, L'\0');
-    int actualLen = NormalizeString(NormalizationC, text.c_str(), -1, &result[0], len);
-    if (actualLen <= 0) return text;
+} // namespace
 
-    // Remove trailing null
-    while (!result.empty() && result.back() == L'\0') {
-        result.pop_back();
+std::vector<EncodingGuess> EncodingConverter::Detect(const wchar_t* text, size_t length) {
+    // Sample: up to four 2K windows spread evenly over the text. One SIMD
+    // pass over each lists its non-ASCII units; every reader then looks at
+    // those alone.
+    constexpr size_t WINDOW = 2048;
+    constexpr size_t WINDOWS = 4;
+    constexpr size_t READER_COUNT = sizeof(READERS) / sizeof(READERS[0]);
+    Evidence evidence[READER_COUNT];
+    uint16_t positions[WINDOW];
+    for (size_t w = 0; w < WINDOWS; w++) {
+        size_t start = length <= WINDOW * WINDOWS ? w * WINDOW : w * (length - WINDOW) / (WINDOWS - 1);
+        if (start >= length) break;
+        const wchar_t* window = text + start;
+        size_t size = std::min(WINDOW, length - start);
+        size_t count = EncodingStream::NonAscii(window, size, positions);
+        for (size_t r = 0; r < READER_COUNT; r++) Read(READERS[r].table, window, size, positions, count, evidence[r]);
     }
 
-    return result;
+    // Letters read, less units that make no sense, with letters built from
+    // marks (the VNI and NFD tell) counting once more; scaled by what the
+    // best structured reading could have reached
+    size_t mostSequences = 0;
+    for (const Evidence& e : evidence) mostSequences = std::max(mostSequences, e.sequences);
+    std::vector<EncodingGuess> guesses;
+    for (size_t r = 0; r < READER_COUNT; r++) {
+        const Evidence& e = evidence[r];
+        size_t judged = e.letters + e.invalid;
+        float confidence = 1.0f;
+        if (judged != 0) {
+            double score = static_cast<double>(e.letters + e.sequences) - static_cast<double>(e.invalid);
+            confidence = static_cast<float>(std::max(0.0, score / static_cast<double>(judged + mostSequences)));
+        }
+        guesses.push_back({READERS[r].encoding, confidence});
+    }
+    std::stable_sort(guesses.begin(), guesses.end(),
+                     [](const EncodingGuess& a, const EncodingGuess& b) { return a.confidence > b.confidence; });
+    return guesses;
 }
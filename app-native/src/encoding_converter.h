@@ -4,15 +4,75 @@
 
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
+#include "text_transform.h"
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 // Supported Vietnamese encodings
 enum class VietEncoding {
     Unicode = 0,      // UTF-16/UTF-8 (default)
     VNI_Windows = 1,  // VNI Windows
     TCVN3 = 2,        // TCVN3 (ABC)
-    Unicode_Comp = 3  // Unicode Composite (NFD)
+    Unicode_Comp = 3, // Unicode Composite (NFD of the Vietnamese letters)
+    VISCII = 4,       // VISCII (RFC 1456)
+    CP1258 = 5,       // Windows-1258 (base letter + combining tone)
+    VIQR = 6          // VIQR (RFC 1456 ASCII mnemonics: a^' = ấ)
+};
+constexpr int VIET_ENCODING_COUNT = 7;
+
+// Where the byte overloads of Convert write. The converter asks for room,
+// fills it and commits what it used, so output lands in the caller's memory
+// with no intermediate string.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    // Room for length more bytes, or null if the sink cannot take them
+    virtual char* Reserve(size_t length) = 0;
+
+    // Of the bytes last reserved, the first length hold output
+    virtual void Commit(size_t length) = 0;
+};
+
+// Appends to a string
+class StringSink : public OutputSink {
+public:
+    explicit StringSink(std::string& out) : m_out(out), m_reserved(0) {}
+    char* Reserve(size_t length) override {
+        m_reserved = m_out.size();
+        m_out.resize(m_reserved + length);
+        return &m_out[m_reserved];
+    }
+    void Commit(size_t length) override { m_out.resize(m_reserved + length); }
+
+private:
+    std::string& m_out;
+    size_t m_reserved;  // Size before the last Reserve()
+};
+
+// Fills a caller-supplied buffer; Convert fails once the output no longer fits
+class BufferSink : public OutputSink {
+public:
+    BufferSink(char* data, size_t capacity) : m_data(data), m_capacity(capacity), m_length(0) {}
+    char* Reserve(size_t length) override { return m_capacity - m_length >= length ? m_data + m_length : nullptr; }
+    void Commit(size_t length) override { m_length += length; }
+
+    // Bytes written so far
+    size_t Length() const { return m_length; }
+
+private:
+    char* m_data;
+    size_t m_capacity;
+    size_t m_length;
+};
+
+// An encoding text may be in (EncodingConverter::Detect)
+struct EncodingGuess {
+    VietEncoding encoding;
+    float confidence;  // 0..1: how much of the non-ASCII text reads as Vietnamese letters
 };
 
 class EncodingConverter {
@@ -22,6 +82,29 @@ public:
     // Convert text between encodings
     std::wstring Convert(const std::wstring& text, VietEncoding from, VietEncoding to);
 
+    // Convert and run the Unicode text through a transform pipeline on the
+    // way (strip diacritics, case, NFC repair), chunk by chunk in one pass
+    std::wstring Convert(const std::wstring& text, VietEncoding from, VietEncoding to,
+                         const std::vector<TransformStage>& stages);
+
+    // Convert bytes as files and the clipboard hold them: UTF-8 for Unicode
+    // and Unicode Composite, one byte per unit for the legacy encodings
+    // (units a byte cannot hold become '?'). UTF-8 is decoded and encoded a
+    // cache-sized chunk at a time, never as a whole wide string; malformed
+    // UTF-8 becomes U+FFFD. Returns false if out ran out of room (what fit
+    // stays written).
+    bool Convert(const uint8_t* in, size_t length, OutputSink& out, VietEncoding from, VietEncoding to);
+    bool Convert(const char* in, size_t length, OutputSink& out, VietEncoding from, VietEncoding to) {
+        return Convert(reinterpret_cast<const uint8_t*>(in), length, out, from, to);
+    }
+
+    // Rank the encodings text may be in, most likely first. Only a bounded
+    // sample is read (a few windows spread over the text), so the cost does
+    // not grow with the length. Text with nothing that tells them apart
+    // (ASCII, symbols, other scripts) gets confidence 1 for all, Unicode first.
+    static std::vector<EncodingGuess> Detect(const wchar_t* text, size_t length);
+    static std::vector<EncodingGuess> Detect(const std::wstring& text) { return Detect(text.data(), text.size()); }
+
     // Get encoding name for display
     static const wchar_t* GetEncodingName(VietEncoding enc);
 
@@ -30,12 +113,4 @@ private:
     ~EncodingConverter() = default;
     EncodingConverter(const EncodingConverter&) = delete;
     EncodingConverter& operator=(const EncodingConverter&) = delete;
-
-    // Conversion helpers
-    std::wstring UnicodeToVNI(const std::wstring& text);
-    std::wstring VNIToUnicode(const std::wstring& text);
-    std::wstring UnicodeToTCVN3(const std::wstring& text);
-    std::wstring TCVN3ToUnicode(const std::wstring& text);
-    std::wstring UnicodeToComposite(const std::wstring& text);
-    std::wstring CompositeToUnicode(const std::wstring& text);
 };
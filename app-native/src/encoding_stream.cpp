@@ -0,0 +1,187 @@
+// ViKey - Encoding Stream Implementation
+// encoding_stream.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "encoding_stream.h"
+#include "encoding_tables.h"
+#include <array>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VIKEY_CONVERTER_SSE2 1
+#endif
+
+using EncodingTables::DecodeTrie;
+
+size_t EncodingStream::AsciiRun(const wchar_t* text, size_t length) {
+    size_t i = 0;
+#ifdef VIKEY_CONVERTER_SSE2
+    constexpr size_t LANES = 16 / sizeof(wchar_t);
+    const __m128i nonAscii = sizeof(wchar_t) == 2 ? _mm_set1_epi16(static_cast<short>(0xFF80))
+                                                  : _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + LANES <= length; i += LANES) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(chunk, nonAscii), zero)) != 0xFFFF) break;
+    }
+#endif
+    while (i < length && static_cast<uint32_t>(text[i]) < 0x80) i++;
+    return i;
+}
+
+size_t EncodingStream::TextRun(const wchar_t* text, size_t length) {
+    size_t i = 0;
+#ifdef VIKEY_CONVERTER_SSE2
+    // A lane stops the run if it is not ASCII, or a control code other than
+    // tab, line feed and carriage return
+    constexpr size_t LANES = 16 / sizeof(wchar_t);
+    const bool wide = sizeof(wchar_t) == 4;
+    auto all = [wide](uint32_t value) {
+        return wide ? _mm_set1_epi32(static_cast<int>(value)) : _mm_set1_epi16(static_cast<short>(value));
+    };
+    auto equal = [wide](__m128i a, __m128i b) { return wide ? _mm_cmpeq_epi32(a, b) : _mm_cmpeq_epi16(a, b); };
+    const __m128i nonAscii = all(0xFFFFFF80);
+    const __m128i nonControl = all(0xFFFFFFE0);
+    const __m128i tab = all('\t'), lineFeed = all('\n'), carriageReturn = all('\r');
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + LANES <= length; i += LANES) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i breaks = _mm_or_si128(_mm_or_si128(equal(chunk, tab), equal(chunk, lineFeed)), equal(chunk, carriageReturn));
+        __m128i control = _mm_andnot_si128(breaks, equal(_mm_and_si128(chunk, nonControl), zero));
+        __m128i stop = _mm_or_si128(control, _mm_xor_si128(equal(_mm_and_si128(chunk, nonAscii), zero), all(0xFFFFFFFF)));
+        if (_mm_movemask_epi8(stop) != 0) break;
+    }
+#endif
+    while (i < length && EncodingTables::IsText(static_cast<uint32_t>(text[i]))) i++;
+    return i;
+}
+
+size_t EncodingStream::NonAscii(const wchar_t* text, size_t length, uint16_t* offsets) {
+    size_t count = 0;
+    size_t i = 0;
+#ifdef VIKEY_CONVERTER_SSE2
+    // One movemask per 16 bytes; a set lane bit pair/quad marks a non-ASCII unit
+    constexpr size_t LANES = 16 / sizeof(wchar_t);
+    const __m128i nonAscii = sizeof(wchar_t) == 2 ? _mm_set1_epi16(static_cast<short>(0xFF80))
+                                                  : _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + LANES <= length; i += LANES) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        unsigned mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(chunk, nonAscii), zero)) & 0xFFFF;
+        while (mask != 0) {
+            unsigned byte = 0;
+            while ((mask & (1u << byte)) == 0) byte++;
+            size_t lane = byte / sizeof(wchar_t);
+            offsets[count++] = static_cast<uint16_t>(i + lane);
+            mask &= ~(((1u << sizeof(wchar_t)) - 1) << (lane * sizeof(wchar_t)));
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        if (static_cast<uint32_t>(text[i]) >= 0x80) offsets[count++] = static_cast<uint16_t>(i);
+    }
+    return count;
+}
+
+static_assert(EncodingTables::CODEC_COUNT == VIET_ENCODING_COUNT &&
+              EncodingTables::CODEC_COMPOSITE == static_cast<size_t>(VietEncoding::Unicode_Comp) &&
+              EncodingTables::CODEC_VIQR == static_cast<size_t>(VietEncoding::VIQR),
+              "codec registry in VietEncoding order");
+
+// Row of the pair table: the tables from one encoding to each of them
+template <size_t From, size_t... To>
+static constexpr std::array<const DecodeTrie*, sizeof...(To)> TableRow(std::index_sequence<To...>) {
+    return {EncodingTables::PairTable<From, To>()...};
+}
+
+template <size_t... From>
+static constexpr std::array<std::array<const DecodeTrie*, sizeof...(From)>, sizeof...(From)> TableRows(
+    std::index_sequence<From...> codecs) {
+    return {TableRow<From>(codecs)...};
+}
+
+// Direct table for each pair of encodings (null: unchanged)
+static const DecodeTrie* Table(VietEncoding from, VietEncoding to) {
+    static constexpr auto TABLES = TableRows(std::make_index_sequence<EncodingTables::CODEC_COUNT>());
+    return TABLES[static_cast<size_t>(from)][static_cast<size_t>(to)];
+}
+
+EncodingStream::EncodingStream(VietEncoding from, VietEncoding to)
+    : m_table(Table(from, to))
+    , m_asciiFast(!m_table || m_table->asciiUnchanged)
+    , m_textFast(!m_asciiFast && m_table->textUnchanged)
+    , m_node(0)
+    , m_matched(0) {
+}
+
+// Write a packed sequence (one to three units)
+static inline wchar_t* Emit(uint64_t units, wchar_t* out) {
+    out[0] = static_cast<wchar_t>(units & 0xFFFF);
+    if (units <= 0xFFFF) return out + 1;
+    out[1] = static_cast<wchar_t>((units >> 16) & 0xFFFF);
+    if (units <= 0xFFFFFFFF) return out + 2;
+    out[2] = static_cast<wchar_t>(units >> 32);
+    return out + 3;
+}
+
+size_t EncodingStream::Push(const wchar_t* text, size_t length, wchar_t* out) {
+    using EncodingTables::NODE_SHIFT;
+    using EncodingTables::OUTPUT_MASK;
+    wchar_t* start = out;
+    size_t i = 0;
+    while (i < length) {
+        uint32_t c = static_cast<uint32_t>(text[i]);
+        if (m_node != 0) {
+            uint64_t entry = m_table->Next(m_node, c);
+            if (entry != 0) {
+                // c continues the letter: hold on if it can grow further
+                i++;
+                m_node = static_cast<uint32_t>(entry >> NODE_SHIFT);
+                m_matched = entry & OUTPUT_MASK;
+                if (m_node == 0) out = Emit(m_matched, out);
+                continue;
+            }
+            out = Emit(m_matched, out);
+            m_node = 0;
+        }
+        if (m_asciiFast && c < 0x80) {
+            // Copy all but the last unit of the run: only it can start a
+            // letter with the unit that follows
+            size_t run = AsciiRun(text + i, length - i) - 1;
+            std::memcpy(out, text + i, run * sizeof(wchar_t));
+            out += run;
+            i += run;
+            c = static_cast<uint32_t>(text[i]);
+        } else if (m_textFast && EncodingTables::IsText(c)) {
+            size_t run = TextRun(text + i, length - i) - 1;
+            std::memcpy(out, text + i, run * sizeof(wchar_t));
+            out += run;
+            i += run;
+            c = static_cast<uint32_t>(text[i]);
+        }
+        i++;
+        if (!m_table) {
+            *out++ = static_cast<wchar_t>(c);
+            continue;
+        }
+        uint64_t entry = m_table->Start(c);
+        uint64_t mapped = entry & OUTPUT_MASK;
+        if ((entry >> NODE_SHIFT) != 0) {
+            m_node = static_cast<uint32_t>(entry >> NODE_SHIFT);
+            m_matched = mapped != 0 ? mapped : c;
+        } else if (mapped != 0) {
+            out = Emit(mapped, out);
+        } else {
+            *out++ = static_cast<wchar_t>(c);  // Unchanged (any code point)
+        }
+    }
+    return static_cast<size_t>(out - start);
+}
+
+size_t EncodingStream::Finish(wchar_t* out) {
+    if (m_node == 0) return 0;
+    m_node = 0;
+    return static_cast<size_t>(Emit(m_matched, out) - out);
+}
@@ -0,0 +1,56 @@
+// ViKey - Encoding Stream
+// encoding_stream.h
+// Converts text between Unicode, Unicode Composite (NFD) and the legacy
+// encodings in one pass, chunk by chunk: each unit maps straight into the
+// target encoding through the pair's own table, with no intermediate
+// Unicode string. The only state across chunks is the start of a letter
+// (up to two units) that may still continue into the next chunk. Portable.
+
+#pragma once
+
+#include "encoding_converter.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace EncodingTables {
+struct DecodeTrie;
+}
+
+class EncodingStream {
+public:
+    // Longest output for one input unit (decomposed letters take three)
+    static constexpr size_t MAX_EXPANSION = 3;
+
+    // Output capacity Push() or Finish() may need for length input units
+    static constexpr size_t MaxOutput(size_t length) { return (length + 2) * MAX_EXPANSION; }
+
+    EncodingStream(VietEncoding from, VietEncoding to);
+
+    // Convert the next chunk into out (MaxOutput(length) units); returns
+    // the units written. Trailing units that may still be part of a longer
+    // letter are held for the next chunk.
+    size_t Push(const wchar_t* text, size_t length, wchar_t* out);
+
+    // End of input: write the held letter, if any, and start over
+    size_t Finish(wchar_t* out);
+
+    // Drop the held letter
+    void Reset() { m_node = 0; }
+
+    // Length of the pure ASCII prefix of text (16 bytes per step with SSE2)
+    static size_t AsciiRun(const wchar_t* text, size_t length);
+
+    // Same for printable ASCII, tab and line breaks (no other control codes)
+    static size_t TextRun(const wchar_t* text, size_t length);
+
+    // Write the offsets of the non-ASCII units of text (at most 0x10000
+    // units) to offsets; returns how many there are
+    static size_t NonAscii(const wchar_t* text, size_t length, uint16_t* offsets);
+
+private:
+    const EncodingTables::DecodeTrie* m_table;  // Null: text is unchanged
+    bool m_asciiFast;                           // ASCII runs are copied as they are
+    bool m_textFast;                            // Printable ASCII runs are (VISCII)
+    uint32_t m_node;                            // Trie node of the held units, 0 if none
+    uint64_t m_matched;                         // Output for the held units as they are
+};
@@ -0,0 +1,624 @@
+// ViKey - Encoding Tables
+// encoding_tables.h
+// Character tables for EncodingConverter, generated at compile time from the
+// letter lists below. A table is two-level and dense: the high byte of a
+// character picks a 256-entry page (Latin-1, Latin Extended-A/B, combining
+// marks and Latin Extended Additional are all Vietnamese needs), so a lookup
+// is two loads and a select instead of a hash. Letters of several code units
+// (VNI, Windows-1258, VIQR, and decomposed Unicode: base + up to two marks)
+// decode through a small trie; each pair of encodings has its own table, so
+// no conversion goes through Unicode. Portable.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace EncodingTables {
+
+// Vietnamese letters (precomposed Unicode), six per vowel: plain, grave,
+// hook, tilde, acute, dot below
+constexpr char16_t UNICODE_LETTERS[] =
+    u"aàảãáạăằẳẵắặâầẩẫấậeèẻẽéẹêềểễếệiìỉĩíịoòỏõóọôồổỗốộơờởỡớợuùủũúụưừửữứựyỳỷỹýỵđ"
+    u"AÀẢÃÁẠĂẰẲẴẮẶÂẦẨẪẤẬEÈẺẼÉẸÊỀỂỄẾỆIÌỈĨÍỊOÒỎÕÓỌÔỒỔỖỐỘƠỜỞỠỚỢUÙỦŨÚỤƯỪỬỮỨỰYỲỶỸÝỴĐ";
+constexpr size_t LETTER_COUNT = sizeof(UNICODE_LETTERS) / sizeof(char16_t) - 1;
+static_assert(LETTER_COUNT == 146, "73 lowercase and 73 uppercase letters");
+
+// TCVN3 (ABC) byte for each letter above. TCVN3 has no uppercase toned
+// letters (ABC fonts draw them from the lowercase codes): they encode to
+// the lowercase byte and decode back lowercase.
+constexpr char16_t TCVN3_LETTERS[LETTER_COUNT] = {
+    0x61, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9,  0xA8, 0xBB, 0xBC, 0xBD, 0xBE, 0xC6,  // a ă
+    0xA9, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB,  0x65, 0xCC, 0xCE, 0xCF, 0xD0, 0xD1,  // â e
+    0xAA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6,  0x69, 0xD7, 0xD8, 0xDC, 0xDD, 0xDE,  // ê i
+    0x6F, 0xDF, 0xE1, 0xE2, 0xE3, 0xE4,  0xAB, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9,  // o ô
+    0xAC, 0xEA, 0xEB, 0xEC, 0xED, 0xEE,  0x75, 0xEF, 0xF1, 0xF2, 0xF3, 0xF4,  // ơ u
+    0xAD, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9,  0x79, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE,  // ư y
+    0xAE,                                                                      // đ
+    0x41, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9,  0xA1, 0xBB, 0xBC, 0xBD, 0xBE, 0xC6,  // A Ă
+    0xA2, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB,  0x45, 0xCC, 0xCE, 0xCF, 0xD0, 0xD1,  // Â E
+    0xA3, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6,  0x49, 0xD7, 0xD8, 0xDC, 0xDD, 0xDE,  // Ê I
+    0x4F, 0xDF, 0xE1, 0xE2, 0xE3, 0xE4,  0xA4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9,  // O Ô
+    0xA5, 0xEA, 0xEB, 0xEC, 0xED, 0xEE,  0x55, 0xEF, 0xF1, 0xF2, 0xF3, 0xF4,  // Ơ U
+    0xA6, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9,  0x59, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE,  // Ư Y
+    0xA7,                                                                      // Đ
+};
+
+// VNI Windows code units for each letter above: a base, then a mark for
+// the tone and hat (0 if the letter is a single unit). Marks follow the
+// case of the base.
+constexpr char16_t VNI_LETTERS[LETTER_COUNT][2] = {
+    {u'a', 0}, {u'a', u'ø'}, {u'a', u'û'}, {u'a', u'õ'}, {u'a', u'ù'}, {u'a', u'ï'},  // a
+    {u'a', u'ê'}, {u'a', u'è'}, {u'a', u'ú'}, {u'a', u'ü'}, {u'a', u'é'}, {u'a', u'ë'},  // ă
+    {u'a', u'â'}, {u'a', u'à'}, {u'a', u'å'}, {u'a', u'ã'}, {u'a', u'á'}, {u'a', u'ä'},  // â
+    {u'e', 0}, {u'e', u'ø'}, {u'e', u'û'}, {u'e', u'õ'}, {u'e', u'ù'}, {u'e', u'ï'},  // e
+    {u'e', u'â'}, {u'e', u'à'}, {u'e', u'å'}, {u'e', u'ã'}, {u'e', u'á'}, {u'e', u'ä'},  // ê
+    {u'i', 0}, {u'ì', 0}, {u'æ', 0}, {u'ó', 0}, {u'í', 0}, {u'ò', 0},                  // i
+    {u'o', 0}, {u'o', u'ø'}, {u'o', u'û'}, {u'o', u'õ'}, {u'o', u'ù'}, {u'o', u'ï'},  // o
+    {u'o', u'â'}, {u'o', u'à'}, {u'o', u'å'}, {u'o', u'ã'}, {u'o', u'á'}, {u'o', u'ä'},  // ô
+    {u'ô', 0}, {u'ô', u'ø'}, {u'ô', u'û'}, {u'ô', u'õ'}, {u'ô', u'ù'}, {u'ô', u'ï'},  // ơ
+    {u'u', 0}, {u'u', u'ø'}, {u'u', u'û'}, {u'u', u'õ'}, {u'u', u'ù'}, {u'u', u'ï'},  // u
+    {u'ö', 0}, {u'ö', u'ø'}, {u'ö', u'û'}, {u'ö', u'õ'}, {u'ö', u'ù'}, {u'ö', u'ï'},  // ư
+    {u'y', 0}, {u'y', u'ø'}, {u'y', u'û'}, {u'y', u'õ'}, {u'y', u'ù'}, {u'î', 0},     // y
+    {u'ñ', 0},                                                                          // đ
+    {u'A', 0}, {u'A', u'Ø'}, {u'A', u'Û'}, {u'A', u'Õ'}, {u'A', u'Ù'}, {u'A', u'Ï'},  // A
+    {u'A', u'Ê'}, {u'A', u'È'}, {u'A', u'Ú'}, {u'A', u'Ü'}, {u'A', u'É'}, {u'A', u'Ë'},  // Ă
+    {u'A', u'Â'}, {u'A', u'À'}, {u'A', u'Å'}, {u'A', u'Ã'}, {u'A', u'Á'}, {u'A', u'Ä'},  // Â
+    {u'E', 0}, {u'E', u'Ø'}, {u'E', u'Û'}, {u'E', u'Õ'}, {u'E', u'Ù'}, {u'E', u'Ï'},  // E
+    {u'E', u'Â'}, {u'E', u'À'}, {u'E', u'Å'}, {u'E', u'Ã'}, {u'E', u'Á'}, {u'E', u'Ä'},  // Ê
+    {u'I', 0}, {u'Ì', 0}, {u'Æ', 0}, {u'Ó', 0}, {u'Í', 0}, {u'Ò', 0},                  // I
+    {u'O', 0}, {u'O', u'Ø'}, {u'O', u'Û'}, {u'O', u'Õ'}, {u'O', u'Ù'}, {u'O', u'Ï'},  // O
+    {u'O', u'Â'}, {u'O', u'À'}, {u'O', u'Å'}, {u'O', u'Ã'}, {u'O', u'Á'}, {u'O', u'Ä'},  // Ô
+    {u'Ô', 0}, {u'Ô', u'Ø'}, {u'Ô', u'Û'}, {u'Ô', u'Õ'}, {u'Ô', u'Ù'}, {u'Ô', u'Ï'},  // Ơ
+    {u'U', 0}, {u'U', u'Ø'}, {u'U', u'Û'}, {u'U', u'Õ'}, {u'U', u'Ù'}, {u'U', u'Ï'},  // U
+    {u'Ö', 0}, {u'Ö', u'Ø'}, {u'Ö', u'Û'}, {u'Ö', u'Õ'}, {u'Ö', u'Ù'}, {u'Ö', u'Ï'},  // Ư
+    {u'Y', 0}, {u'Y', u'Ø'}, {u'Y', u'Û'}, {u'Y', u'Õ'}, {u'Y', u'Ù'}, {u'Î', 0},     // Y
+    {u'Ñ', 0},                                                                          // Đ
+};
+
+// VISCII (RFC 1456) byte for each letter: one byte per letter, the six
+// letters that do not fit in 0x80-0xFF on C0 control codes (Ẳ Ẵ Ẫ Ỷ Ỹ Ỵ)
+constexpr char16_t VISCII_LETTERS[LETTER_COUNT] = {
+    0x61, 0xE0, 0xE4, 0xE3, 0xE1, 0xD5,  0xE5, 0xA2, 0xC6, 0xC7, 0xA1, 0xA3,  // a ă
+    0xE2, 0xA5, 0xA6, 0xE7, 0xA4, 0xA7,  0x65, 0xE8, 0xEB, 0xA8, 0xE9, 0xA9,  // â e
+    0xEA, 0xAB, 0xAC, 0xAD, 0xAA, 0xAE,  0x69, 0xEC, 0xEF, 0xEE, 0xED, 0xB8,  // ê i
+    0x6F, 0xF2, 0xF6, 0xF5, 0xF3, 0xF7,  0xF4, 0xB0, 0xB1, 0xB2, 0xAF, 0xB5,  // o ô
+    0xBD, 0xB6, 0xB7, 0xDE, 0xBE, 0xFE,  0x75, 0xF9, 0xFC, 0xFB, 0xFA, 0xF8,  // ơ u
+    0xDF, 0xD7, 0xD8, 0xE6, 0xD1, 0xF1,  0x79, 0xCF, 0xD6, 0xDB, 0xFD, 0xDC,  // ư y
+    0xF0,                                                                      // đ
+    0x41, 0xC0, 0xC4, 0xC3, 0xC1, 0x80,  0xC5, 0x82, 0x02, 0x05, 0x81, 0x83,  // A Ă
+    0xC2, 0x85, 0x86, 0x06, 0x84, 0x87,  0x45, 0xC8, 0xCB, 0x88, 0xC9, 0x89,  // Â E
+    0xCA, 0x8B, 0x8C, 0x8D, 0x8A, 0x8E,  0x49, 0xCC, 0x9B, 0xCE, 0xCD, 0x98,  // Ê I
+    0x4F, 0xD2, 0x99, 0xA0, 0xD3, 0x9A,  0xD4, 0x90, 0x91, 0x92, 0x8F, 0x93,  // O Ô
+    0xB4, 0x96, 0x97, 0xB3, 0x95, 0x94,  0x55, 0xD9, 0x9C, 0x9D, 0xDA, 0x9E,  // Ơ U
+    0xBF, 0xBB, 0xBC, 0xFF, 0xBA, 0xB9,  0x59, 0x9F, 0x14, 0x19, 0xDD, 0x1E,  // Ư Y
+    0xD0,                                                                      // Đ
+};
+
+// Windows-1258 bytes for each letter, as Windows writes them: the
+// precomposed byte where the code page has one, else the toneless letter
+// and a combining tone mark (0 if the letter is a single byte)
+constexpr char16_t CP1258_LETTERS[LETTER_COUNT][2] = {
+    {0x61, 0}, {0xE0, 0}, {0x61, 0xD2}, {0x61, 0xDE}, {0xE1, 0}, {0x61, 0xF2},  // a
+    {0xE3, 0}, {0xE3, 0xCC}, {0xE3, 0xD2}, {0xE3, 0xDE}, {0xE3, 0xEC}, {0xE3, 0xF2},  // ă
+    {0xE2, 0}, {0xE2, 0xCC}, {0xE2, 0xD2}, {0xE2, 0xDE}, {0xE2, 0xEC}, {0xE2, 0xF2},  // â
+    {0x65, 0}, {0xE8, 0}, {0x65, 0xD2}, {0x65, 0xDE}, {0xE9, 0}, {0x65, 0xF2},  // e
+    {0xEA, 0}, {0xEA, 0xCC}, {0xEA, 0xD2}, {0xEA, 0xDE}, {0xEA, 0xEC}, {0xEA, 0xF2},  // ê
+    {0x69, 0}, {0x69, 0xCC}, {0x69, 0xD2}, {0x69, 0xDE}, {0xED, 0}, {0x69, 0xF2},  // i
+    {0x6F, 0}, {0x6F, 0xCC}, {0x6F, 0xD2}, {0x6F, 0xDE}, {0xF3, 0}, {0x6F, 0xF2},  // o
+    {0xF4, 0}, {0xF4, 0xCC}, {0xF4, 0xD2}, {0xF4, 0xDE}, {0xF4, 0xEC}, {0xF4, 0xF2},  // ô
+    {0xF5, 0}, {0xF5, 0xCC}, {0xF5, 0xD2}, {0xF5, 0xDE}, {0xF5, 0xEC}, {0xF5, 0xF2},  // ơ
+    {0x75, 0}, {0xF9, 0}, {0x75, 0xD2}, {0x75, 0xDE}, {0xFA, 0}, {0x75, 0xF2},  // u
+    {0xFD, 0}, {0xFD, 0xCC}, {0xFD, 0xD2}, {0xFD, 0xDE}, {0xFD, 0xEC}, {0xFD, 0xF2},  // ư
+    {0x79, 0}, {0x79, 0xCC}, {0x79, 0xD2}, {0x79, 0xDE}, {0x79, 0xEC}, {0x79, 0xF2},  // y
+    {0xF0, 0},  // đ
+    {0x41, 0}, {0xC0, 0}, {0x41, 0xD2}, {0x41, 0xDE}, {0xC1, 0}, {0x41, 0xF2},  // A
+    {0xC3, 0}, {0xC3, 0xCC}, {0xC3, 0xD2}, {0xC3, 0xDE}, {0xC3, 0xEC}, {0xC3, 0xF2},  // Ă
+    {0xC2, 0}, {0xC2, 0xCC}, {0xC2, 0xD2}, {0xC2, 0xDE}, {0xC2, 0xEC}, {0xC2, 0xF2},  // Â
+    {0x45, 0}, {0xC8, 0}, {0x45, 0xD2}, {0x45, 0xDE}, {0xC9, 0}, {0x45, 0xF2},  // E
+    {0xCA, 0}, {0xCA, 0xCC}, {0xCA, 0xD2}, {0xCA, 0xDE}, {0xCA, 0xEC}, {0xCA, 0xF2},  // Ê
+    {0x49, 0}, {0x49, 0xCC}, {0x49, 0xD2}, {0x49, 0xDE}, {0xCD, 0}, {0x49, 0xF2},  // I
+    {0x4F, 0}, {0x4F, 0xCC}, {0x4F, 0xD2}, {0x4F, 0xDE}, {0xD3, 0}, {0x4F, 0xF2},  // O
+    {0xD4, 0}, {0xD4, 0xCC}, {0xD4, 0xD2}, {0xD4, 0xDE}, {0xD4, 0xEC}, {0xD4, 0xF2},  // Ô
+    {0xD5, 0}, {0xD5, 0xCC}, {0xD5, 0xD2}, {0xD5, 0xDE}, {0xD5, 0xEC}, {0xD5, 0xF2},  // Ơ
+    {0x55, 0}, {0xD9, 0}, {0x55, 0xD2}, {0x55, 0xDE}, {0xDA, 0}, {0x55, 0xF2},  // U
+    {0xDD, 0}, {0xDD, 0xCC}, {0xDD, 0xD2}, {0xDD, 0xDE}, {0xDD, 0xEC}, {0xDD, 0xF2},  // Ư
+    {0x59, 0}, {0x59, 0xCC}, {0x59, 0xD2}, {0x59, 0xDE}, {0x59, 0xEC}, {0x59, 0xF2},  // Y
+    {0xD0, 0},  // Đ
+};
+
+// Windows-1258 combining tone mark for each of the six letters of a vowel row
+constexpr char16_t CP1258_TONES[6] = {0, 0xCC, 0xD2, 0xDE, 0xEC, 0xF2};
+
+
+// Combining marks of decomposed (NFD) Vietnamese
+constexpr char16_t GRAVE = 0x0300;
+constexpr char16_t ACUTE = 0x0301;
+constexpr char16_t CIRCUMFLEX = 0x0302;
+constexpr char16_t TILDE = 0x0303;
+constexpr char16_t BREVE = 0x0306;
+constexpr char16_t HOOK_ABOVE = 0x0309;
+constexpr char16_t HORN = 0x031B;
+constexpr char16_t DOT_BELOW = 0x0323;
+
+// Tone mark for each of the six letters of a vowel row (0: none)
+constexpr char16_t TONE_MARKS[6] = {0, GRAVE, HOOK_ABOVE, TILDE, ACUTE, DOT_BELOW};
+
+// Per vowel row of UNICODE_LETTERS (a ă â e ê i o ô ơ u ư y): base letter,
+// hat or horn mark, and the row of the base letter
+constexpr char VOWEL_BASES[] = "aaaeeiooouuy";
+constexpr size_t VOWEL_ROWS = sizeof(VOWEL_BASES) - 1;
+constexpr char16_t VOWEL_MODIFIERS[VOWEL_ROWS] = {0, BREVE, CIRCUMFLEX, 0, CIRCUMFLEX, 0, 0, CIRCUMFLEX, HORN, 0, HORN, 0};
+constexpr uint8_t PLAIN_ROWS[VOWEL_ROWS] = {0, 0, 0, 3, 3, 5, 6, 6, 6, 9, 9, 11};
+constexpr size_t CASE_LETTERS = LETTER_COUNT / 2;  // Vowel rows, then đ
+
+// VIQR (RFC 1456) mnemonics: the hat, breve or horn after the base letter,
+// then the tone; đ is "dd". A backslash keeps the next character literal.
+constexpr char VIQR_MODIFIERS[VOWEL_ROWS] = {0, '(', '^', 0, '^', 0, 0, '^', '+', 0, '+', 0};
+constexpr char VIQR_TONES[6] = {0, '`', '?', '~', '\'', '.'};
+constexpr char VIQR_ESCAPED[] = "(^+`?~'.\\dD";
+
+// Canonical combining class of the marks above: NFD puts the horn (216) and
+// the dot below (220) before the marks drawn above the letter (230)
+constexpr int CombiningClass(uint32_t mark) {
+    return mark == HORN ? 216 : mark == DOT_BELOW ? 220 : 230;
+}
+
+// Up to three code units packed into one value, first unit lowest
+constexpr uint64_t Pack(uint64_t first, uint64_t second = 0, uint64_t third = 0) {
+    return first | (second << 16) | (third << 32);
+}
+
+constexpr size_t SequenceLength(uint64_t sequence) {
+    return sequence > 0xFFFFFFFF ? 3 : sequence > 0xFFFF ? 2 : 1;
+}
+
+// Table entries: packed output sequence (0: the unit is unchanged) in the
+// low 48 bits, trie node that continues the match (0: none) above
+constexpr uint64_t OUTPUT_MASK = 0xFFFFFFFFFFFF;
+constexpr unsigned NODE_SHIFT = 48;
+
+// Map of characters to T. Characters below 0x2000 go through the page their
+// high byte selects; 0 in a page, and anything above, means no entry.
+template <typename T>
+struct PagedTable {
+    static constexpr uint32_t PAGED_LIMIT = 0x2000;
+    static constexpr size_t PAGE_COUNT = 4;  // Page 0 stays all zero
+
+    uint8_t pageOf[PAGED_LIMIT >> 8];
+    T pages[PAGE_COUNT][256];
+    uint8_t used;  // Pages in use, page 0 included (0 in an empty table)
+
+    constexpr T Get(uint32_t c) const {
+        uint32_t page = c < PAGED_LIMIT ? pageOf[c >> 8] : 0;
+        return pages[page][c & 0xFF];
+    }
+
+    // Entry for c, allocating its page
+    constexpr T& Slot(uint32_t c) {
+        if (c >= PAGED_LIMIT) throw "character outside the paged blocks";
+        if (used == 0) used = 1;
+        uint8_t& page = pageOf[c >> 8];
+        if (page == 0) {
+            if (used == PAGE_COUNT) throw "too many pages";
+            page = used++;
+        }
+        return pages[page][c & 0xFF];
+    }
+};
+
+// Character map to code unit sequences
+struct CharTable {
+    PagedTable<uint64_t> entries;
+    bool asciiUnchanged;  // ASCII runs can be copied without lookups
+
+    // Packed sequence for c, or c itself
+    constexpr uint64_t Map(uint32_t c) const {
+        uint64_t mapped = entries.Get(c) & OUTPUT_MASK;
+        return mapped != 0 ? mapped : c;
+    }
+
+    // Add a mapping unless c already has one (identities included: TCVN3
+    // ý is U+00FD itself, Ý must not take it over)
+    constexpr void Add(uint32_t c, uint64_t mapped) {
+        if (c == 0) return;
+        uint64_t& slot = entries.Slot(c);
+        if ((slot & OUTPUT_MASK) == 0) slot |= mapped;
+    }
+};
+
+// Transcoding trie from one encoding to another, where a letter may take up
+// to three code units: the unit that starts a sequence selects a node, each
+// following unit an edge out of it. Values are packed sequences in the
+// target encoding; the longest match wins, and every prefix of a sequence
+// is a letter of its own, so a match that stops early emits its prefix.
+struct DecodeTrie {
+    static constexpr size_t MAX_TRANSITIONS = 1024;  // Nodes × edges; node 0: no sequence
+
+    CharTable single;              // Unit on its own (entry with its node)
+    PagedTable<uint8_t> edgeOf;    // Unit → edge if it continues a sequence (0: none)
+    uint16_t edgeCount;            // Edges per node, edge 0 included
+    uint16_t nodeCount;            // Node 0 included
+    uint64_t next[MAX_TRANSITIONS];  // node * edgeCount + edge → entry (0: no sequence)
+    bool asciiUnchanged;           // ASCII maps to itself and continues no sequence
+    bool textUnchanged;            // So do printable ASCII, tab and line breaks
+
+    constexpr uint64_t Map(uint32_t c) const { return single.Map(c); }
+
+    // Entry for c at the start of a letter
+    constexpr uint64_t Start(uint32_t c) const { return single.entries.Get(c); }
+
+    // Entry for c after the units that led to node, 0 if the match ends
+    constexpr uint64_t Next(uint32_t node, uint32_t c) const { return next[node * edgeCount + edgeOf.Get(c)]; }
+
+    // Output for a whole packed sequence, 0 if it is not a letter
+    constexpr uint64_t Match(uint64_t sequence) const {
+        uint64_t entry = Start(sequence & 0xFFFF);
+        for (sequence >>= 16; sequence != 0; sequence >>= 16) {
+            if ((entry >> NODE_SHIFT) == 0) return 0;
+            entry = Next(static_cast<uint32_t>(entry >> NODE_SHIFT), sequence & 0xFFFF);
+        }
+        return entry & OUTPUT_MASK;
+    }
+};
+
+constexpr bool AsciiUnchanged(const CharTable& table) {
+    for (uint32_t c = 0; c < 0x80; c++) {
+        if (table.Map(c) != c) return false;
+    }
+    return true;
+}
+
+// Encoding table from parallel lists of letters and packed sequences
+constexpr CharTable MakeEncoder(const char16_t* letters, const uint64_t* sequences, size_t count) {
+    CharTable table = {};
+    for (size_t i = 0; i < count; i++) table.Add(letters[i], sequences[i]);
+    table.asciiUnchanged = AsciiUnchanged(table);
+    return table;
+}
+
+constexpr bool AsciiUnchanged(const DecodeTrie& trie) {
+    for (uint32_t c = 0; c < 0x80; c++) {
+        if (trie.edgeOf.Get(c) != 0) return false;
+    }
+    return trie.single.asciiUnchanged;
+}
+
+// Printable ASCII, tab and line breaks: what plain text is made of
+constexpr bool IsText(uint32_t c) {
+    return (c >= 0x20 && c < 0x80) || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Like AsciiUnchanged, for a table that maps control codes (VISCII letters)
+constexpr bool TextUnchanged(const DecodeTrie& trie) {
+    for (uint32_t c = 0; c < 0x80; c++) {
+        if (IsText(c) && (trie.edgeOf.Get(c) != 0 || trie.single.Map(c) != c)) return false;
+    }
+    return true;
+}
+
+// Sequences a decoder accepts, each with the letter it stands for
+struct SequenceList {
+    static constexpr size_t CAPACITY = 512;
+
+    struct Entry {
+        uint64_t sequence;
+        uint32_t letter;
+    };
+    Entry entries[CAPACITY];
+    size_t count;
+
+    constexpr void Add(uint64_t sequence, uint32_t letter) {
+        if (count == CAPACITY) throw "too many sequences";
+        entries[count++] = {sequence, letter};
+    }
+};
+
+// Decoding trie (to Unicode); the first sequence listed for a letter wins
+inline constexpr DecodeTrie MakeDecoder(const SequenceList& list) {
+    DecodeTrie trie = {};
+    trie.edgeCount = 1;
+    trie.nodeCount = 1;
+    for (size_t i = 0; i < list.count; i++) {
+        for (uint64_t rest = list.entries[i].sequence >> 16; rest != 0; rest >>= 16) {
+            uint8_t& edge = trie.edgeOf.Slot(rest & 0xFFFF);
+            if (edge != 0) continue;
+            if (trie.edgeCount == 0xFF) throw "too many edges";
+            edge = static_cast<uint8_t>(trie.edgeCount++);
+        }
+    }
+    for (size_t i = 0; i < list.count; i++) {
+        uint64_t sequence = list.entries[i].sequence;
+        uint64_t* slot = &trie.single.entries.Slot(sequence & 0xFFFF);
+        for (sequence >>= 16; sequence != 0; sequence >>= 16) {
+            uint64_t node = *slot >> NODE_SHIFT;
+            if (node == 0) {
+                if ((trie.nodeCount + 1u) * trie.edgeCount > DecodeTrie::MAX_TRANSITIONS) throw "too many nodes";
+                node = trie.nodeCount++;
+                *slot |= node << NODE_SHIFT;
+            }
+            slot = &trie.next[node * trie.edgeCount + trie.edgeOf.Get(sequence & 0xFFFF)];
+        }
+        if ((*slot & OUTPUT_MASK) == 0) *slot |= list.entries[i].letter;
+    }
+    // A match that stops early emits its prefix: it has to be a letter
+    for (size_t i = 0; i < static_cast<size_t>(trie.nodeCount) * trie.edgeCount; i++) {
+        if (trie.next[i] != 0 && (trie.next[i] & OUTPUT_MASK) == 0) throw "prefix without a letter";
+    }
+    trie.single.asciiUnchanged = AsciiUnchanged(trie.single);
+    trie.asciiUnchanged = AsciiUnchanged(trie);
+    trie.textUnchanged = TextUnchanged(trie);
+    return trie;
+}
+
+// Unicode to an encoding: one-unit input, no sequences to match
+inline constexpr DecodeTrie FromUnicode(const CharTable& encoder) {
+    DecodeTrie trie = {};
+    trie.single = encoder;
+    trie.edgeCount = 1;
+    trie.nodeCount = 1;
+    trie.asciiUnchanged = encoder.asciiUnchanged;
+    trie.textUnchanged = TextUnchanged(trie);
+    return trie;
+}
+
+// One encoding to another: every value the decoder gives is encoded at
+// build time, so each unit converts with one lookup and no Unicode step
+inline constexpr DecodeTrie Compose(const DecodeTrie& decoder, const CharTable& encoder) {
+    DecodeTrie trie = decoder;
+    trie.single = {};
+    // Units either table changes (Unicode letters in legacy text too)
+    for (uint32_t high = 0; high < (PagedTable<uint64_t>::PAGED_LIMIT >> 8); high++) {
+        if (decoder.single.entries.pageOf[high] == 0 && encoder.entries.pageOf[high] == 0) continue;
+        for (uint32_t c = high << 8; c < ((high + 1) << 8); c++) {
+            uint64_t node = decoder.Start(c) >> NODE_SHIFT;
+            uint64_t mapped = encoder.Map(static_cast<uint32_t>(decoder.Map(c)));
+            if (mapped != c) trie.single.Add(c, mapped);
+            if (node != 0) trie.single.entries.Slot(c) |= node << NODE_SHIFT;
+        }
+    }
+    for (size_t i = 0; i < static_cast<size_t>(decoder.nodeCount) * decoder.edgeCount; i++) {
+        uint64_t entry = decoder.next[i];
+        if (entry == 0) continue;
+        trie.next[i] = (entry & ~OUTPUT_MASK) | encoder.Map(static_cast<uint32_t>(entry & OUTPUT_MASK));
+    }
+    trie.single.asciiUnchanged = AsciiUnchanged(trie.single);
+    trie.asciiUnchanged = AsciiUnchanged(trie);
+    trie.textUnchanged = TextUnchanged(trie);
+    return trie;
+}
+
+// Packed sequences of each encoding, in UNICODE_LETTERS order
+struct LetterSequences {
+    uint64_t units[LETTER_COUNT];
+};
+
+constexpr LetterSequences TCVN3_SEQUENCES = [] {
+    LetterSequences s = {};
+    for (size_t i = 0; i < LETTER_COUNT; i++) s.units[i] = TCVN3_LETTERS[i];
+    return s;
+}();
+
+constexpr LetterSequences VNI_SEQUENCES = [] {
+    LetterSequences s = {};
+    for (size_t i = 0; i < LETTER_COUNT; i++) s.units[i] = Pack(VNI_LETTERS[i][0], VNI_LETTERS[i][1]);
+    return s;
+}();
+
+constexpr LetterSequences VISCII_SEQUENCES = [] {
+    LetterSequences s = {};
+    for (size_t i = 0; i < LETTER_COUNT; i++) s.units[i] = VISCII_LETTERS[i];
+    return s;
+}();
+
+constexpr LetterSequences CP1258_SEQUENCES = [] {
+    LetterSequences s = {};
+    for (size_t i = 0; i < LETTER_COUNT; i++) s.units[i] = Pack(CP1258_LETTERS[i][0], CP1258_LETTERS[i][1]);
+    return s;
+}();
+
+// VIQR: base, hat/breve/horn, tone, all ASCII. Text written to VIQR is not
+// escaped: a full stop or question mark right after a vowel reads back as
+// a tone, as it does in every VIQR reader.
+constexpr LetterSequences VIQR_SEQUENCES = [] {
+    LetterSequences s = {};
+    for (size_t i = 0; i < LETTER_COUNT; i++) {
+        size_t row = (i % CASE_LETTERS) / 6;
+        uint64_t base = static_cast<uint64_t>(row == VOWEL_ROWS ? 'd' : VOWEL_BASES[row]) - (i < CASE_LETTERS ? 0 : 0x20);
+        if (row == VOWEL_ROWS) {  // dd, DD
+            s.units[i] = Pack(base, base);
+            continue;
+        }
+        uint64_t modifier = static_cast<uint64_t>(VIQR_MODIFIERS[row]);
+        uint64_t tone = static_cast<uint64_t>(VIQR_TONES[(i % CASE_LETTERS) % 6]);
+        s.units[i] = modifier == 0 ? Pack(base, tone) : Pack(base, modifier, tone);
+    }
+    return s;
+}();
+
+// Canonical decomposition (NFD) of each letter: base, marks by combining
+// class, hat or horn before the tone when the classes are equal. đ has none.
+constexpr LetterSequences COMPOSITE_SEQUENCES = [] {
+    LetterSequences s = {};
+    for (size_t i = 0; i < LETTER_COUNT; i++) {
+        size_t row = (i % CASE_LETTERS) / 6;
+        if (row == VOWEL_ROWS) {  // đ
+            s.units[i] = UNICODE_LETTERS[i];
+            continue;
+        }
+        uint64_t base = static_cast<uint64_t>(VOWEL_BASES[row]) - (i < CASE_LETTERS ? 0 : 0x20);
+        uint64_t modifier = VOWEL_MODIFIERS[row];
+        uint64_t tone = TONE_MARKS[(i % CASE_LETTERS) % 6];
+        if (modifier == 0) {
+            s.units[i] = Pack(base, tone);
+        } else if (tone != 0 && CombiningClass(static_cast<uint32_t>(tone)) < CombiningClass(static_cast<uint32_t>(modifier))) {
+            s.units[i] = Pack(base, tone, modifier);
+        } else {
+            s.units[i] = Pack(base, modifier, tone);
+        }
+    }
+    return s;
+}();
+
+// Each letter with its sequence
+constexpr SequenceList LetterForms(const LetterSequences& sequences) {
+    SequenceList list = {};
+    for (size_t i = 0; i < LETTER_COUNT; i++) list.Add(sequences.units[i], UNICODE_LETTERS[i]);
+    return list;
+}
+
+// Decomposed text as other tools write it: the canonical sequences, then
+// the equivalent ones NFC composes to the same letter. Marks of different
+// classes may come in either order, and a hat/horn letter or a letter with
+// the tone may be precomposed already (ấ = â + acute, ậ = ạ + circumflex).
+constexpr SequenceList COMPOSITE_FORMS = [] {
+    SequenceList list = LetterForms(COMPOSITE_SEQUENCES);
+    for (size_t i = 0; i < LETTER_COUNT; i++) {
+        size_t caseStart = i < CASE_LETTERS ? 0 : CASE_LETTERS;
+        size_t row = (i - caseStart) / 6;
+        size_t column = (i - caseStart) % 6;
+        if (row == VOWEL_ROWS) continue;
+        uint64_t modifier = VOWEL_MODIFIERS[row];
+        uint64_t tone = TONE_MARKS[column];
+        if (modifier == 0 || tone == 0) continue;
+        uint64_t canonical = COMPOSITE_SEQUENCES.units[i];
+        bool reorders = CombiningClass(static_cast<uint32_t>(modifier)) != CombiningClass(static_cast<uint32_t>(tone));
+        if (reorders) {
+            list.Add(Pack(canonical & 0xFFFF, canonical >> 32, (canonical >> 16) & 0xFFFF), UNICODE_LETTERS[i]);
+        }
+        list.Add(Pack(UNICODE_LETTERS[caseStart + row * 6], tone), UNICODE_LETTERS[i]);
+        if (reorders) list.Add(Pack(UNICODE_LETTERS[caseStart + PLAIN_ROWS[row] * 6 + column], modifier), UNICODE_LETTERS[i]);
+    }
+    return list;
+}();
+
+// Windows-1258 as other tools write it: a toneless letter and the tone
+// mark also stand for the letters the code page has precomposed (a + grave = à)
+constexpr SequenceList CP1258_FORMS = [] {
+    SequenceList list = LetterForms(CP1258_SEQUENCES);
+    for (size_t i = 0; i < LETTER_COUNT; i++) {
+        size_t column = (i % CASE_LETTERS) % 6;
+        if ((i % CASE_LETTERS) / 6 == VOWEL_ROWS || column == 0 || CP1258_LETTERS[i][1] != 0) continue;
+        list.Add(Pack(CP1258_LETTERS[i - column][0], CP1258_TONES[column]), UNICODE_LETTERS[i]);
+    }
+    return list;
+}();
+
+// VIQR with its escapes: a backslash before a mnemonic character keeps it
+// literal ("a\." is an a and a full stop)
+constexpr SequenceList VIQR_FORMS = [] {
+    SequenceList list = LetterForms(VIQR_SEQUENCES);
+    for (const char* c = VIQR_ESCAPED; *c != 0; c++) list.Add(Pack('\\', static_cast<uint64_t>(*c)), static_cast<uint32_t>(*c));
+    return list;
+}();
+
+constexpr CharTable TCVN3_ENCODER = MakeEncoder(UNICODE_LETTERS, TCVN3_SEQUENCES.units, LETTER_COUNT);
+constexpr CharTable VNI_ENCODER = MakeEncoder(UNICODE_LETTERS, VNI_SEQUENCES.units, LETTER_COUNT);
+constexpr CharTable COMPOSITE_ENCODER = MakeEncoder(UNICODE_LETTERS, COMPOSITE_SEQUENCES.units, LETTER_COUNT);
+constexpr CharTable VISCII_ENCODER = MakeEncoder(UNICODE_LETTERS, VISCII_SEQUENCES.units, LETTER_COUNT);
+constexpr CharTable CP1258_ENCODER = MakeEncoder(UNICODE_LETTERS, CP1258_SEQUENCES.units, LETTER_COUNT);
+constexpr CharTable VIQR_ENCODER = MakeEncoder(UNICODE_LETTERS, VIQR_SEQUENCES.units, LETTER_COUNT);
+
+// Tables to and from Unicode (inline: one copy for all the files that use
+// them). Composite to Unicode is NFC composition of the Vietnamese letters;
+// Unicode to Composite is their NFD.
+inline constexpr DecodeTrie UNICODE_TO_TCVN3 = FromUnicode(TCVN3_ENCODER);
+inline constexpr DecodeTrie UNICODE_TO_VNI = FromUnicode(VNI_ENCODER);
+inline constexpr DecodeTrie UNICODE_TO_COMPOSITE = FromUnicode(COMPOSITE_ENCODER);
+inline constexpr DecodeTrie UNICODE_TO_VISCII = FromUnicode(VISCII_ENCODER);
+inline constexpr DecodeTrie UNICODE_TO_CP1258 = FromUnicode(CP1258_ENCODER);
+inline constexpr DecodeTrie UNICODE_TO_VIQR = FromUnicode(VIQR_ENCODER);
+inline constexpr DecodeTrie TCVN3_TO_UNICODE = MakeDecoder(LetterForms(TCVN3_SEQUENCES));
+inline constexpr DecodeTrie VNI_TO_UNICODE = MakeDecoder(LetterForms(VNI_SEQUENCES));
+inline constexpr DecodeTrie COMPOSITE_TO_UNICODE = MakeDecoder(COMPOSITE_FORMS);
+inline constexpr DecodeTrie VISCII_TO_UNICODE = MakeDecoder(LetterForms(VISCII_SEQUENCES));
+inline constexpr DecodeTrie CP1258_TO_UNICODE = MakeDecoder(CP1258_FORMS);
+inline constexpr DecodeTrie VIQR_TO_UNICODE = MakeDecoder(VIQR_FORMS);
+
+// ============================================================
+// Codec registry
+// ============================================================
+
+// Encodings in VietEncoding order. An encoding is its letter list and the
+// two tables above; the tables between it and every other encoding are
+// generated from them, so each pair still converts in one lookup per unit.
+enum Codec : size_t {
+    CODEC_UNICODE,
+    CODEC_VNI,
+    CODEC_TCVN3,
+    CODEC_COMPOSITE,
+    CODEC_VISCII,
+    CODEC_CP1258,
+    CODEC_VIQR,
+    CODEC_COUNT
+};
+
+constexpr const DecodeTrie* DECODERS[CODEC_COUNT] = {
+    nullptr, &VNI_TO_UNICODE, &TCVN3_TO_UNICODE, &COMPOSITE_TO_UNICODE,
+    &VISCII_TO_UNICODE, &CP1258_TO_UNICODE, &VIQR_TO_UNICODE,
+};
+constexpr const CharTable* ENCODERS[CODEC_COUNT] = {
+    nullptr, &VNI_ENCODER, &TCVN3_ENCODER, &COMPOSITE_ENCODER,
+    &VISCII_ENCODER, &CP1258_ENCODER, &VIQR_ENCODER,
+};
+constexpr const DecodeTrie* FROM_UNICODE[CODEC_COUNT] = {
+    nullptr, &UNICODE_TO_VNI, &UNICODE_TO_TCVN3, &UNICODE_TO_COMPOSITE,
+    &UNICODE_TO_VISCII, &UNICODE_TO_CP1258, &UNICODE_TO_VIQR,
+};
+
+// Direct table between two encodings other than Unicode
+template <size_t From, size_t To>
+inline constexpr DecodeTrie LEGACY_PAIR = Compose(*DECODERS[From], *ENCODERS[To]);
+
+// Table for any pair (null: the text is unchanged)
+template <size_t From, size_t To>
+constexpr const DecodeTrie* PairTable() {
+    if constexpr (From == To) {
+        return nullptr;
+    } else if constexpr (From == CODEC_UNICODE) {
+        return FROM_UNICODE[To];
+    } else if constexpr (To == CODEC_UNICODE) {
+        return DECODERS[From];
+    } else {
+        return &LEGACY_PAIR<From, To>;
+    }
+}
+
+static_assert(UNICODE_TO_TCVN3.Map(u'ệ') == 0xD6 && TCVN3_TO_UNICODE.Map(0xD6) == u'ệ', "TCVN3 round trip");
+static_assert(TCVN3_TO_UNICODE.Map(0xFD) == u'ý', "TCVN3 toned capitals decode lowercase");
+static_assert(UNICODE_TO_VNI.Map(u'ệ') == Pack(u'e', u'ä') && VNI_TO_UNICODE.Match(Pack(u'e', u'ä')) == u'ệ', "VNI pair");
+static_assert(UNICODE_TO_VNI.Map(u'ơ') == u'ô' && VNI_TO_UNICODE.Map(u'ô') == u'ơ' &&
+              (VNI_TO_UNICODE.Start(u'ô') >> NODE_SHIFT) != 0, "VNI single unit that starts sequences");
+static_assert(LEGACY_PAIR<CODEC_VNI, CODEC_TCVN3>.Match(Pack(u'e', u'ä')) == 0xD6 && LEGACY_PAIR<CODEC_TCVN3, CODEC_VNI>.Map(0xD6) == Pack(u'e', u'ä') &&
+              LEGACY_PAIR<CODEC_TCVN3, CODEC_VNI>.Map(0xFD) == Pack(u'y', u'ù'), "direct legacy tables");
+static_assert(UNICODE_TO_COMPOSITE.Map(u'ệ') == Pack(u'e', DOT_BELOW, CIRCUMFLEX) &&
+              UNICODE_TO_COMPOSITE.Map(u'Ấ') == Pack(u'A', CIRCUMFLEX, ACUTE) &&
+              UNICODE_TO_COMPOSITE.Map(u'ợ') == Pack(u'o', HORN, DOT_BELOW) &&
+              UNICODE_TO_COMPOSITE.Map(u'đ') == u'đ', "NFD order");
+static_assert(COMPOSITE_TO_UNICODE.Match(Pack(u'e', DOT_BELOW, CIRCUMFLEX)) == u'ệ' &&
+              COMPOSITE_TO_UNICODE.Match(Pack(u'e', CIRCUMFLEX, DOT_BELOW)) == u'ệ' &&
+              COMPOSITE_TO_UNICODE.Match(Pack(u'â', ACUTE)) == u'ấ' &&
+              COMPOSITE_TO_UNICODE.Match(Pack(u'ọ', HORN)) == u'ợ' &&
+              COMPOSITE_TO_UNICODE.Match(Pack(u'á', CIRCUMFLEX)) == 0, "NFC composition");
+static_assert(LEGACY_PAIR<CODEC_COMPOSITE, CODEC_VNI>.Match(Pack(u'e', DOT_BELOW, CIRCUMFLEX)) == Pack(u'e', u'ä') &&
+              LEGACY_PAIR<CODEC_VNI, CODEC_COMPOSITE>.Match(Pack(u'e', u'ä')) == Pack(u'e', DOT_BELOW, CIRCUMFLEX), "direct composite tables");
+static_assert(UNICODE_TO_VISCII.Map(u'Ỵ') == 0x1E && VISCII_TO_UNICODE.Map(0x1E) == u'Ỵ' &&
+              VISCII_TO_UNICODE.Map(0xA0) == u'Õ', "VISCII pair");
+static_assert(UNICODE_TO_CP1258.Map(u'ấ') == Pack(0xE2, 0xEC) && UNICODE_TO_CP1258.Map(u'à') == 0xE0 &&
+              CP1258_TO_UNICODE.Match(Pack(0xE2, 0xEC)) == u'ấ' && CP1258_TO_UNICODE.Match(Pack(u'a', 0xCC)) == u'à',
+              "CP1258 pair");
+static_assert(UNICODE_TO_VIQR.Map(u'Ấ') == Pack(u'A', u'^', u'\'') && VIQR_TO_UNICODE.Match(Pack(u'A', u'^', u'\'')) == u'Ấ' &&
+              VIQR_TO_UNICODE.Match(Pack(u'o', u'+')) == u'ơ' && VIQR_TO_UNICODE.Match(Pack(u'D', u'D')) == u'Đ' &&
+              VIQR_TO_UNICODE.Match(Pack(u'\\', u'.')) == u'.', "VIQR pair");
+static_assert(LEGACY_PAIR<CODEC_VIQR, CODEC_VNI>.Match(Pack(u'e', u'^', u'.')) == Pack(u'e', u'ä') &&
+              LEGACY_PAIR<CODEC_CP1258, CODEC_VISCII>.Match(Pack(u'a', 0xCC)) == 0xE0, "direct tables of new codecs");
+static_assert(UNICODE_TO_TCVN3.asciiUnchanged && TCVN3_TO_UNICODE.asciiUnchanged && UNICODE_TO_VNI.asciiUnchanged &&
+              VNI_TO_UNICODE.asciiUnchanged && UNICODE_TO_COMPOSITE.asciiUnchanged && COMPOSITE_TO_UNICODE.asciiUnchanged &&
+              UNICODE_TO_VISCII.asciiUnchanged && UNICODE_TO_CP1258.asciiUnchanged && CP1258_TO_UNICODE.asciiUnchanged &&
+              UNICODE_TO_VIQR.asciiUnchanged && LEGACY_PAIR<CODEC_CP1258, CODEC_TCVN3>.asciiUnchanged &&
+              LEGACY_PAIR<CODEC_COMPOSITE, CODEC_VIQR>.asciiUnchanged,
+              "ASCII passes through");
+static_assert(!VISCII_TO_UNICODE.asciiUnchanged && VISCII_TO_UNICODE.textUnchanged &&
+              LEGACY_PAIR<CODEC_VISCII, CODEC_VNI>.textUnchanged, "VISCII: printable ASCII passes through");
+
+} // namespace EncodingTables
@@ -0,0 +1,145 @@
+// ViKey - Foreground Tracker Implementation
+// foreground_tracker.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "foreground_tracker.h"
+
+ForegroundTracker& ForegroundTracker::Instance() {
+    static ForegroundTracker instance;
+    return instance;
+}
+
+ForegroundTracker::ForegroundTracker()
+    : m_processes(PROCESS_CACHE_SIZE)
+    , m_sequence(0)
+    , m_pendingWindow(nullptr)
+    , m_pending(false)
+    , m_stopping(false)
+    , m_cacheHits(0)
+    , m_cacheMisses(0) {
+}
+
+ForegroundTracker::~ForegroundTracker() {
+    StopResolver();
+}
+
+void ForegroundTracker::Start() {
+    Platform& platform = Platform::Current();
+    StartResolver();
+    platform.InstallForegroundHook();
+    OnForegroundChanged(platform.GetForegroundWindow());
+}
+
+void ForegroundTracker::Stop() {
+    Platform::Current().RemoveForegroundHook();
+    StopResolver();
+}
+
+void ForegroundTracker::StartResolver() {
+    if (m_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = false;
+    }
+    m_thread = std::thread(&ForegroundTracker::ResolverLoop, this);
+}
+
+void ForegroundTracker::StopResolver() {
+    if (!m_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+
+    // A change that arrived while stopping is resolved here
+    HWND window = nullptr;
+    bool pending = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pending = m_pending;
+        window = m_pendingWindow;
+        m_pending = false;
+    }
+    if (pending) Resolve(window);
+}
+
+void ForegroundTracker::OnForegroundChanged(HWND window) {
+    if (!m_thread.joinable()) {
+        Resolve(window);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingWindow = window;
+        m_pending = true;
+    }
+    m_wake.notify_one();
+}
+
+void ForegroundTracker::ResolverLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_pending || m_stopping; });
+        if (m_stopping) return;
+
+        // Changes that pile up while a slow process query runs collapse
+        // into the latest one
+        HWND window = m_pendingWindow;
+        m_pending = false;
+        lock.unlock();
+        Resolve(window);
+        lock.lock();
+    }
+}
+
+void ForegroundTracker::Resolve(HWND window) {
+    Platform& platform = Platform::Current();
+    AppDetector& detector = AppDetector::Instance();
+    DWORD processId = window ? platform.GetWindowProcessId(window) : 0;
+
+    CachedProcess* process = nullptr;
+    if (processId != 0) {
+        uint64_t now = platform.TimestampNs();
+        process = m_processes.Get(processId);
+        if (process && now - process->resolvedAt < PROCESS_TTL_NS) {
+            m_cacheHits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // Miss or expired entry (the PID may belong to a new process)
+            m_cacheMisses.fetch_add(1, std::memory_order_relaxed);
+            CachedProcess entry;
+            entry.path = platform.GetProcessImagePath(processId);
+            entry.exeName = AppExeName(entry.path);
+            entry.resolvedAt = now;
+            process = &m_processes.Put(processId, std::move(entry));
+        }
+    }
+
+    // Settings changed since the last switch: match apps against the new rules
+    if (detector.RulesGeneration() != m_rules.Generation()) {
+        uint64_t generation = 0;
+        std::shared_ptr<const AppRuleSet> rules = detector.GetRules(generation);
+        m_rules.SetRules(std::move(rules), generation);
+    }
+
+    // Every field is rewritten: the back slot holds an older snapshot
+    ForegroundSnapshot& next = m_snapshots.Back();
+    next.sequence = ++m_sequence;
+    next.window = window;
+    next.processId = processId;
+    if (process && !process->exeName.empty()) {
+        m_identity.exeName.assign(process->exeName);
+        m_identity.path.assign(process->path);
+        m_identity.windowClass = platform.GetWindowClassName(window);
+        next.appId = m_rules.Lookup(m_identity, next.policy);
+        next.appName.assign(process->exeName);
+        next.savedEnabled = detector.GetSavedState(process->exeName);
+    } else {
+        next.appId = 0;
+        next.appName.clear();
+        next.policy = AppRulePolicy();
+        next.savedEnabled = -1;
+    }
+    m_snapshots.Publish();
+}
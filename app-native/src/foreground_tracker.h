@@ -0,0 +1,98 @@
+// ViKey - Foreground Tracker
+// foreground_tracker.h
+// Follows foreground window changes (EVENT_SYSTEM_FOREGROUND on Win32) and
+// resolves the window's app off the hook thread: process id → image path via
+// an LRU cache, then the app id and policy from the compiled app rules. The
+// hook thread only reads the latest published snapshot, one atomic
+// operation per key.
+
+#pragma once
+
+#include "platform.h"
+#include "app_detector.h"
+#include "app_rules.h"
+#include "lru_cache.h"
+#include "snapshot_exchange.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Foreground app as resolved by the tracker
+struct ForegroundSnapshot {
+    uint64_t sequence = 0;  // Bumped on every publish; 0 = nothing resolved yet
+    HWND window = nullptr;
+    DWORD processId = 0;
+    uint32_t appId = 0;     // Interned app (image path + window class); 0 = unknown
+    std::wstring appName;   // Lowercase executable name (e.g. "notepad.exe")
+    AppRulePolicy policy;   // Matched app rules
+    int8_t savedEnabled = -1;  // Smart switch state saved for the app (-1 = none)
+};
+
+class ForegroundTracker {
+public:
+    static ForegroundTracker& Instance();
+
+    // Cached process names older than this are looked up again (PID reuse)
+    static constexpr uint64_t PROCESS_TTL_NS = 60000000000ULL;  // 60 s
+    static constexpr size_t PROCESS_CACHE_SIZE = 64;
+
+    // Install the foreground hook, start the resolver thread and publish the
+    // current foreground window. Stop() removes the hook and joins the thread.
+    void Start();
+    void Stop();
+
+    // Without the resolver thread, changes are resolved on the calling
+    // thread (headless runs keep everything on one thread)
+    void StartResolver();
+    void StopResolver();
+
+    // Platform callback: the foreground window changed (cheap, never blocks
+    // on the process query)
+    void OnForegroundChanged(HWND window);
+
+    // Latest snapshot. Reader side of a single-reader exchange: call from the
+    // hook/UI thread only; the reference is valid until the next call.
+    const ForegroundSnapshot& Current() { return m_snapshots.Read(); }
+
+    // Process name cache statistics (Diagnostics)
+    uint64_t CacheHits() const { return m_cacheHits.load(std::memory_order_relaxed); }
+    uint64_t CacheMisses() const { return m_cacheMisses.load(std::memory_order_relaxed); }
+
+private:
+    ForegroundTracker();
+    ~ForegroundTracker();
+    ForegroundTracker(const ForegroundTracker&) = delete;
+    ForegroundTracker& operator=(const ForegroundTracker&) = delete;
+
+    struct CachedProcess {
+        std::wstring path;
+        std::wstring exeName;
+        uint64_t resolvedAt = 0;
+    };
+
+    void ResolverLoop();
+
+    // Look up the window's app and publish a snapshot (resolver side only)
+    void Resolve(HWND window);
+
+    // Resolver side
+    LruCache<DWORD, CachedProcess> m_processes;
+    AppRuleCache m_rules;
+    AppIdentity m_identity;  // Reused per change
+    uint64_t m_sequence;
+    SnapshotExchange<ForegroundSnapshot> m_snapshots;
+
+    // Pending request: only the latest window matters
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    HWND m_pendingWindow;
+    bool m_pending;
+    bool m_stopping;
+    std::thread m_thread;
+
+    std::atomic<uint64_t> m_cacheHits;
+    std::atomic<uint64_t> m_cacheMisses;
+};
@@ -0,0 +1,118 @@
+// ViKey - Hook Latency Watchdog Implementation
+// hook_watchdog.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "hook_watchdog.h"
+#include <cwchar>
+
+HookWatchdog::HookWatchdog()
+    : m_timeoutMs(DEFAULT_TIMEOUT_MS)
+    , m_degraded(false)
+    , m_degradeCount(0)
+    , m_degradedSince(0)
+    , m_lastEvaluated(0) {
+}
+
+void HookWatchdog::SetTimeoutMs(uint32_t timeoutMs) {
+    m_timeoutMs = timeoutMs > 0 ? timeoutMs : DEFAULT_TIMEOUT_MS;
+}
+
+bool HookWatchdog::Record(const HookTiming& timing) {
+    uint64_t now = timing.outputDone;
+    m_stages[static_cast<int>(HookStage::AppCheck)].Record(now, timing.appChecked - timing.entry);
+    m_stages[static_cast<int>(HookStage::Engine)].Record(now, timing.engineDone - timing.appChecked);
+    m_stages[static_cast<int>(HookStage::Output)].Record(now, timing.outputDone - timing.engineDone);
+    m_stages[static_cast<int>(HookStage::Total)].Record(now, timing.outputDone - timing.entry);
+
+    // A single callback past the timeout got us unhooked already: act now.
+    // Otherwise re-check the moving p99 once per window.
+    uint64_t total = timing.outputDone - timing.entry;
+    uint64_t window = now / LatencyRing::WINDOW_NS + 1;
+    if (total < uint64_t(m_timeoutMs) * 1000000ULL && window == m_lastEvaluated) {
+        return false;
+    }
+    m_lastEvaluated = window;
+    return Evaluate(now);
+}
+
+bool HookWatchdog::Evaluate(uint64_t nowNs) {
+    LatencySnapshot total = Snapshot(HookStage::Total, nowNs);
+    uint64_t timeoutNs = uint64_t(m_timeoutMs) * 1000000ULL;
+
+    if (!IsDegraded()) {
+        bool slow = total.count >= MIN_SAMPLES && total.p99 >= timeoutNs * DEGRADE_PERCENT / 100;
+        if (!slow && total.max < timeoutNs) return false;
+        m_degraded.store(true, std::memory_order_relaxed);
+        m_degradeCount.fetch_add(1, std::memory_order_relaxed);
+        m_degradedSince = nowNs;
+        return true;
+    }
+
+    if (nowNs - m_degradedSince < MIN_DEGRADED_NS) return false;
+    if (total.count > 0 && total.p99 >= timeoutNs * RECOVER_PERCENT / 100) return false;
+    m_degraded.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+LatencySnapshot HookWatchdog::Snapshot(HookStage stage, uint64_t nowNs) const {
+    return m_stages[static_cast<int>(stage)].Snapshot(nowNs);
+}
+
+const wchar_t* HookStageName(HookStage stage) {
+    switch (stage) {
+    case HookStage::AppCheck: return L"app check";
+    case HookStage::Engine:   return L"engine";
+    case HookStage::Output:   return L"output";
+    case HookStage::Total:    return L"total";
+    default:                  return L"?";
+    }
+}
+
+static void AppendDuration(std::wstring& out, uint64_t ns) {
+    wchar_t buf[32];
+    if (ns < 10000) {
+        swprintf(buf, 32, L"%llu ns", static_cast<unsigned long long>(ns));
+    } else if (ns < 10000000) {
+        swprintf(buf, 32, L"%.1f \u00B5s", ns / 1000.0);
+    } else {
+        swprintf(buf, 32, L"%.1f ms", ns / 1000000.0);
+    }
+    out += buf;
+}
+
+std::wstring FormatLatency(const LatencySnapshot& snapshot) {
+    if (snapshot.count == 0) return L"-";
+    std::wstring out = L"p50 ";
+    AppendDuration(out, snapshot.p50);
+    out += L"  p99 ";
+    AppendDuration(out, snapshot.p99);
+    out += L"  max ";
+    AppendDuration(out, snapshot.max);
+    wchar_t buf[32];
+    swprintf(buf, 32, L"  (n=%llu)", static_cast<unsigned long long>(snapshot.count));
+    out += buf;
+    return out;
+}
+
+std::wstring HookWatchdog::Report(uint64_t nowNs) const {
+    wchar_t buf[128];
+    std::wstring out;
+    swprintf(buf, 128, L"Hook timeout: %u ms (degrade at p99 \u2265 %u%%)\n",
+             m_timeoutMs, static_cast<unsigned>(DEGRADE_PERCENT));
+    out += buf;
+    swprintf(buf, 128, L"Mode: %ls, degraded %u time(s)\n",
+             IsDegraded() ? L"degraded" : L"normal", DegradeCount());
+    out += buf;
+    swprintf(buf, 128, L"Hook callbacks: %llu\n",
+             static_cast<unsigned long long>(m_stages[static_cast<int>(HookStage::Total)].Total()));
+    out += buf;
+
+    for (int i = 0; i < static_cast<int>(HookStage::Count); i++) {
+        HookStage stage = static_cast<HookStage>(i);
+        swprintf(buf, 128, L"  %-10ls ", HookStageName(stage));
+        out += buf;
+        out += FormatLatency(Snapshot(stage, nowNs));
+        out += L"\n";
+    }
+    return out;
+}
@@ -0,0 +1,75 @@
+// ViKey - Hook Latency Watchdog
+// hook_watchdog.h
+// Times every hook callback by stage and decides when the processor must
+// shed work to stay clear of LowLevelHooksTimeout (Windows silently removes
+// a hook that exceeds it). Portable: timestamps come from the caller.
+
+#pragma once
+
+#include "latency_histogram.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Timestamps (ns) taken along one hook callback
+struct HookTiming {
+    uint64_t entry = 0;        // Hook callback entered
+    uint64_t appChecked = 0;   // After CheckAppChange
+    uint64_t engineDone = 0;   // After the Rust engine
+    uint64_t outputDone = 0;   // After the edit was queued for injection
+};
+
+enum class HookStage {
+    AppCheck = 0,
+    Engine,
+    Output,
+    Total,
+    Count
+};
+
+class HookWatchdog {
+public:
+    // Default when the registry has no LowLevelHooksTimeout value
+    static constexpr uint32_t DEFAULT_TIMEOUT_MS = 300;
+
+    // Degrade when the moving p99 reaches half the timeout; recover below a
+    // fifth of it, after staying degraded for at least MIN_DEGRADED_NS
+    static constexpr uint32_t DEGRADE_PERCENT = 50;
+    static constexpr uint32_t RECOVER_PERCENT = 20;
+    static constexpr uint64_t MIN_SAMPLES = 20;
+    static constexpr uint64_t MIN_DEGRADED_NS = 30000000000ULL;  // 30 s
+
+    HookWatchdog();
+
+    void SetTimeoutMs(uint32_t timeoutMs);
+    uint32_t GetTimeoutMs() const { return m_timeoutMs; }
+
+    // Record one callback (hook thread only). Returns true if the degraded
+    // state changed; the caller then applies it and logs the transition.
+    bool Record(const HookTiming& timing);
+
+    bool IsDegraded() const { return m_degraded.load(std::memory_order_relaxed); }
+    uint32_t DegradeCount() const { return m_degradeCount.load(std::memory_order_relaxed); }
+
+    // Moving latency of one stage
+    LatencySnapshot Snapshot(HookStage stage, uint64_t nowNs) const;
+
+    // Human-readable summary for the Diagnostics dump
+    std::wstring Report(uint64_t nowNs) const;
+
+private:
+    bool Evaluate(uint64_t nowNs);
+
+    LatencyRing m_stages[static_cast<int>(HookStage::Count)];
+    uint32_t m_timeoutMs;
+    std::atomic<bool> m_degraded;
+    std::atomic<uint32_t> m_degradeCount;
+    uint64_t m_degradedSince;
+    uint64_t m_lastEvaluated;  // Window of the last policy check
+};
+
+// Stage name for reports ("app check", "engine", ...)
+const wchar_t* HookStageName(HookStage stage);
+
+// Format one snapshot as "p50 12.0 us  p99 40.5 us  max 1.2 ms  (n=640)"
+std::wstring FormatLatency(const LatencySnapshot& snapshot);
@@ -11,11 +11,18 @@ HotkeyManager& HotkeyManager::Instance() {
 HotkeyManager::HotkeyManager()
     : m_hWnd(nullptr)
     , m_registered(false)
-    , m_callback(nullptr) {
+    , m_selectionRegistered(false)
+    , m_callback(nullptr)
+    , m_selectionCallback(nullptr) {
 }
 
 bool HotkeyManager::Register(HWND hWnd) {
-    return Register(hWnd, Settings::Instance().toggleHotkey);
+    const Settings& settings = Settings::Instance();
+    if (settings.selectionConvert && !m_selectionRegistered) {
+        const HotkeyConfig& config = settings.selectionHotkey;
+        m_selectionRegistered = RegisterHotKey(hWnd, SELECTION_HOTKEY_ID, config.GetModifiers(), config.vkCode) != FALSE;
+    }
+    return Register(hWnd, settings.toggleHotkey);
 }
 
 bool HotkeyManager::Register(HWND hWnd, const HotkeyConfig& config) {
@@ -32,6 +39,10 @@ void HotkeyManager::Unregister(HWND hWnd) {
         UnregisterHotKey(hWnd, HOTKEY_ID);
         m_registered = false;
     }
+    if (m_selectionRegistered) {
+        UnregisterHotKey(hWnd, SELECTION_HOTKEY_ID);
+        m_selectionRegistered = false;
+    }
 }
 
 bool HotkeyManager::UpdateHotkey(HWND hWnd) {
@@ -46,5 +57,11 @@ bool HotkeyManager::ProcessHotkey(WPARAM wParam) {
         }
         return true;
     }
+    if (static_cast<int>(wParam) == SELECTION_HOTKEY_ID) {
+        if (m_selectionCallback) {
+            m_selectionCallback();
+        }
+        return true;
+    }
     return false;
 }
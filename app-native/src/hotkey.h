@@ -1,6 +1,7 @@
 // ViKey - Global Hotkey Manager
 // hotkey.h
-// Registers configurable global toggle hotkey
+// Registers the configurable global hotkeys: language toggle and
+// selection conversion (SelectionConverter)
 
 #pragma once
 
@@ -12,13 +13,13 @@ class HotkeyManager {
 public:
     static HotkeyManager& Instance();
 
-    // Register toggle hotkey from settings
+    // Register toggle hotkey (and the selection hotkey, if enabled) from settings
     bool Register(HWND hWnd);
 
     // Register with specific config
     bool Register(HWND hWnd, const HotkeyConfig& config);
 
-    // Unregister the hotkey
+    // Unregister both hotkeys
     void Unregister(HWND hWnd);
 
     // Re-register with new settings (call after settings change)
@@ -30,11 +31,15 @@ public:
     // Set callback for hotkey press
     void SetCallback(std::function<void()> callback) { m_callback = callback; }
 
+    // Set callback for selection hotkey press
+    void SetSelectionCallback(std::function<void()> callback) { m_selectionCallback = callback; }
+
     // Process WM_HOTKEY message, returns true if handled
     bool ProcessHotkey(WPARAM wParam);
 
-    // Get hotkey ID
+    // Get hotkey IDs
     static constexpr int HOTKEY_ID = 9000;
+    static constexpr int SELECTION_HOTKEY_ID = 9001;
 
 private:
     HotkeyManager();
@@ -44,5 +49,7 @@ private:
 
     HWND m_hWnd;
     bool m_registered;
+    bool m_selectionRegistered;
     std::function<void()> m_callback;
+    std::function<void()> m_selectionCallback;
 };
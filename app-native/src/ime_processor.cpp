@@ -4,6 +4,7 @@
 
 #include "ime_processor.h"
 #include "keycodes.h"
+#include <cwchar>
 
 ImeProcessor& ImeProcessor::Instance() {
     static ImeProcessor instance;
@@ -12,9 +13,9 @@ ImeProcessor& ImeProcessor::Instance() {
 
 ImeProcessor::ImeProcessor()
     : m_enabled(true)
+    , m_lastAppName(L"")
     , m_method(static_cast<uint8_t>(InputMethod::Telex))
-    , m_initialized(false)
-    , m_lastAppName(L"") {
+    , m_initialized(false) {
 }
 
 bool ImeProcessor::Initialize() {
@@ -30,16 +31,25 @@ bool ImeProcessor::Initialize() {
         OnKeyPressed(event);
     });
 
+    // Windows unhooks a low-level hook that exceeds this (Windows 10 caps it at 1 s)
+    DWORD timeoutMs = HookWatchdog::DEFAULT_TIMEOUT_MS;
+    Platform::Current().ReadDword(L"Control Panel\\Desktop", L"LowLevelHooksTimeout", timeoutMs);
+    m_watchdog.SetTimeoutMs(timeoutMs < 1000 ? timeoutMs : 1000);
+
     m_initialized = true;
     return true;
 }
 
 void ImeProcessor::Start() {
+    TextSender::Instance().StartOutput();
+    ForegroundTracker::Instance().Start();
     KeyboardHook::Instance().Start();
 }
 
 void ImeProcessor::Stop() {
     KeyboardHook::Instance().Stop();
+    ForegroundTracker::Instance().Stop();
+    TextSender::Instance().StopOutput();
 }
 
 void ImeProcessor::SetEnabled(bool enabled) {
@@ -62,6 +72,7 @@ void ImeProcessor::ToggleEnabled() {
 
 void ImeProcessor::SetMethod(InputMethod method) {
     m_method.store(static_cast<uint8_t>(method));
+    m_appMethod = static_cast<uint8_t>(method);
     RustBridge::Instance().SetMethod(method);
 }
 
@@ -80,12 +91,16 @@ void ImeProcessor::ApplySettings() {
     bridge.SetSkipWShortcut(settings.skipWShortcut);
     bridge.SetBracketShortcut(settings.bracketShortcut);
     bridge.SetAllowForeignConsonants(settings.allowForeignConsonants);
+    // TextSender applies every result at the caret, so trimmed edits are safe here
+    bridge.SetMinimalDiff(true);
 
     TextSender::Instance().SetSlowMode(settings.slowMode);
     TextSender::Instance().SetClipboardMode(settings.clipboardMode);
 
-    // Sync excluded apps to AppDetector
+    // Sync excluded apps and per-app rules to AppDetector (recompiled;
+    // applied at the next foreground change)
     AppDetector::Instance().SetExcludedApps(settings.excludedApps);
+    AppDetector::Instance().SetRules(settings.appRules);
 
     // Sync shortcuts enabled state to Rust engine
     bridge.SetShortcutsEnabled(settings.shortcutsEnabled);
@@ -109,51 +124,75 @@ void ImeProcessor::UpdateShortcuts() {
 }
 
 void ImeProcessor::CheckAppChange() {
-    // Fast path: skip expensive syscalls if foreground window hasn't changed
-    HWND currentHwnd = GetForegroundWindow();
-    if (currentHwnd == m_lastHwnd) return;  // Same window, skip
-    m_lastHwnd = currentHwnd;
-
-    Settings& settings = Settings::Instance();
+    // The tracker resolves the app when the foreground changes, off this
+    // thread; until the next change this is a single atomic load
+    const ForegroundSnapshot& foreground = ForegroundTracker::Instance().Current();
+    if (foreground.sequence == m_lastSequence) return;
+    m_lastSequence = foreground.sequence;
 
-    AppDetector& detector = AppDetector::Instance();
-    std::wstring currentApp = detector.GetForegroundAppName();
+    // Each window keeps its own typing context (in-progress word survives Alt+Tab)
+    RustBridge::Instance().SwitchContext(foreground.window);
 
-    if (currentApp.empty()) return;
+    if (foreground.appId == 0 || foreground.appId == m_lastAppId) return;
+    m_lastAppId = foreground.appId;
 
-    if (currentApp != m_lastAppName) {
-        // App changed - save state for old app, restore state for new app
-        if (!m_lastAppName.empty() && settings.smartSwitch) {
-            detector.SaveAppState(m_lastAppName, m_enabled.load());
-        }
-
-        m_lastAppName = currentApp;
-
-        // Check if new app is in exclusion list (Feature 3)
-        if (detector.IsAppExcluded(currentApp)) {
-            if (m_enabled.load()) {
-                m_enabled.store(false);
-                RustBridge::Instance().SetEnabled(false);
-            }
-        } else if (settings.smartSwitch) {
-            // Restore state for new app (Feature 2)
-            bool newState = detector.GetAppState(currentApp, settings.enabled);
-            if (newState != m_enabled.load()) {
-                m_enabled.store(newState);
-                RustBridge::Instance().SetEnabled(newState);
-            }
-        }
+    // App changed - save state for old app, restore state for new app
+    Settings& settings = Settings::Instance();
+    if (!m_lastAppName.empty() && settings.smartSwitch) {
+        AppDetector::Instance().SaveAppState(m_lastAppName, m_enabled.load());
+    }
+    m_lastAppName.assign(foreground.appName);
+
+    // Excluded (Feature 3) or forced on by a rule; otherwise restore the
+    // state saved for the app (Feature 2)
+    const AppRulePolicy& policy = foreground.policy;
+    bool newState = m_enabled.load();
+    if (policy.enabled >= 0) {
+        newState = policy.enabled != 0;
+    } else if (settings.smartSwitch) {
+        newState = foreground.savedEnabled >= 0 ? foreground.savedEnabled != 0 : settings.enabled;
+    }
+    if (newState != m_enabled.load()) {
+        m_enabled.store(newState);
+        RustBridge::Instance().SetEnabled(newState);
+    }
 
-        // Apply per-app encoding (Feature 8)
-        int encoding = detector.GetAppEncoding(currentApp, 0);
-        TextSender::Instance().SetOutputEncoding(static_cast<OutputEncoding>(encoding));
+    // Per-app encoding (Feature 8) and injection mode
+    TextSender& sender = TextSender::Instance();
+    sender.SetOutputEncoding(policy.encoding >= 0 ? static_cast<OutputEncoding>(policy.encoding) : OutputEncoding::Unicode);
+    sender.SetAppInjection(policy.injection >= 0 ? static_cast<InjectionMode>(policy.injection) : InjectionMode::Auto);
+    sender.SetApp(foreground.appId, foreground.appName);
+
+    // Per-app input method; other apps get the user's method back
+    uint8_t method = policy.method >= 0 ? static_cast<uint8_t>(policy.method) : m_method.load();
+    if (method != m_appMethod) {
+        m_appMethod = method;
+        RustBridge::Instance().SetMethod(static_cast<InputMethod>(method));
     }
 }
 
 void ImeProcessor::OnKeyPressed(KeyEventData& event) {
-    // Check for app changes (smart switch)
-    CheckAppChange();
+    Platform& platform = Platform::Current();
+    HookTiming timing;
+    timing.entry = event.timestamp != 0 ? event.timestamp : platform.TimestampNs();
+
+    // Check for app changes (smart switch). Skipped while degraded: the hook
+    // then does nothing beyond the engine and the output queue.
+    if (!m_watchdog.IsDegraded()) {
+        CheckAppChange();
+    }
+    timing.appChecked = platform.TimestampNs();
 
+    ProcessKey(event, timing);
+
+    timing.outputDone = platform.TimestampNs();
+    if (timing.engineDone == 0) timing.engineDone = timing.outputDone;
+    if (m_watchdog.Record(timing)) {
+        ApplyWatchdogState(timing.outputDone);
+    }
+}
+
+void ImeProcessor::ProcessKey(KeyEventData& event, HookTiming& timing) {
     // Issue #129: Don't return early when disabled - let keys reach Rust engine
     // for shortcut processing. The engine skips Vietnamese transforms when disabled
     // but still processes shortcuts (word-boundary and immediate).
@@ -184,26 +223,19 @@ void ImeProcessor::OnKeyPressed(KeyEventData& event) {
     // Determine caps state (XOR of Shift and CapsLock)
     bool caps = event.shift ^ event.capsLock;
 
-    // Process through Rust engine
-    ImeResult result = RustBridge::Instance().ProcessKeyExt(macKeycode, caps, false, event.shift);
+    // Process through Rust engine (compact result: UTF-16 text read in place)
+    const ImeCompactResult& result = RustBridge::Instance().ProcessKeyCompact(macKeycode, caps, false, event.shift);
+    timing.engineDone = Platform::Current().TimestampNs();
 
     if (result.action == ImeAction::Send) {
-        if (result.count > 0 || result.backspace > 0) {
+        if (result.Length() > 0 || result.backspace > 0) {
             // Send replacement text (and/or backspaces)
-            // When count==0 but backspace>0: engine wants to delete chars without
+            // When length==0 but backspace>0: engine wants to delete chars without
             // sending new text (e.g., backspace-after-space deleting a space char)
-            std::wstring text = result.GetText();
-            // For shortcut expansion: use clipboard mode for reliability
-            // - backspaces > 4: indicates shortcut expansion (e.g., "vn " -> "Việt Nam ")
-            // - text.length() > 15: long replacement text causes timing issues with SendInput
-            if (result.backspace > 4 || text.length() > 15) {
-                TextSender::Instance().SendTextClipboardDeferred(text, result.backspace);
-            } else {
-                TextSender::Instance().SendText(text, result.backspace);
-            }
+            SendEdit(result.Text(), result.Length(), result.backspace);
         }
         // Block the key: Send action means the engine consumed it
-        // (count==0 && backspace==0 means key absorbed with no visible effect,
+        // (length==0 && backspace==0 means key absorbed with no visible effect,
         // e.g., redundant 'w' in ươ compound)
         event.handled = true;
     } else if (result.IsKeyConsumed()) {
@@ -213,3 +245,58 @@ void ImeProcessor::OnKeyPressed(KeyEventData& event) {
         event.handled = false;
     }
 }
+
+void ImeProcessor::SendEdit(const wchar_t* text, size_t length, int backspaces) {
+    // For shortcut expansion: use clipboard mode for reliability
+    // - backspaces > 4: indicates shortcut expansion (e.g., "vn " -> "Việt Nam ")
+    // - length > 15: long replacement text causes timing issues with SendInput
+    if (backspaces > 4 || length > 15) {
+        TextSender::Instance().SendTextClipboardDeferred(text, length, backspaces);
+    } else {
+        TextSender::Instance().SendText(text, length, backspaces);
+    }
+}
+
+void ImeProcessor::ApplyWatchdogState(uint64_t nowNs) {
+    bool degraded = m_watchdog.IsDegraded();
+    TextSender::Instance().SetForceFast(degraded);
+    if (!degraded) {
+        m_lastSequence = 0;  // Re-apply the foreground snapshot on the next key
+    }
+
+    LatencySnapshot total = m_watchdog.Snapshot(HookStage::Total, nowNs);
+    std::wstring message = degraded ?
+        L"Hook latency near the system timeout, skipping app detection and forcing fast injection: " :
+        L"Hook latency back to normal, app detection and injection modes restored: ";
+    message += FormatLatency(total);
+    Platform::Current().LogEvent(message.c_str());
+}
+
+std::wstring ImeProcessor::DiagnosticsReport() {
+    Platform& platform = Platform::Current();
+    uint64_t now = platform.TimestampNs();
+    TextSender& sender = TextSender::Instance();
+
+    std::wstring report = m_watchdog.Report(now);
+    report += L"  inject     ";
+    report += FormatLatency(sender.InjectLatency(now));
+    report += L"\n\nKeyboard hook: ";
+    report += KeyboardHook::Instance().IsActive() ? L"installed" : L"not installed";
+    report += L"\nOutput queue: ";
+    report += sender.IsOutputBusy() ? L"busy" : L"idle";
+    if (sender.OutputOverflows() > 0) {
+        report += L" (overflowed " + std::to_wstring(sender.OutputOverflows()) + L" times)";
+    }
+
+    ForegroundTracker& tracker = ForegroundTracker::Instance();
+    const ForegroundSnapshot& foreground = tracker.Current();
+    wchar_t buf[128];
+    swprintf(buf, 128, L"\nForeground app: %ls (process cache: %llu hits, %llu misses)\n",
+             foreground.appName.empty() ? L"-" : foreground.appName.c_str(),
+             static_cast<unsigned long long>(tracker.CacheHits()),
+             static_cast<unsigned long long>(tracker.CacheMisses()));
+    report += buf;
+    swprintf(buf, 128, L"App rules: %zu\n", AppDetector::Instance().RuleCount());
+    report += buf;
+    return report;
+}
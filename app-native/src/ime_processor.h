@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
 #include <atomic>
 #include "rust_bridge.h"
 #include "keyboard_hook.h"
@@ -12,6 +12,8 @@
 #include "shortcut_manager.h"
 #include "settings.h"
 #include "app_detector.h"
+#include "foreground_tracker.h"
+#include "hook_watchdog.h"
 
 class ImeProcessor {
 public:
@@ -20,7 +22,7 @@ public:
     // Initialize the processor
     bool Initialize();
 
-    // Start/stop processing
+    // Start/stop processing (keyboard hook, foreground tracker and the output thread)
     void Start();
     void Stop();
 
@@ -41,25 +43,42 @@ public:
     // Update shortcuts from Settings
     void UpdateShortcuts();
 
+    // Hook latency per stage and degradation state (tray "Diagnostics")
+    std::wstring DiagnosticsReport();
+    HookWatchdog& Watchdog() { return m_watchdog; }
+
 private:
     ImeProcessor();
     ~ImeProcessor() = default;
     ImeProcessor(const ImeProcessor&) = delete;
     ImeProcessor& operator=(const ImeProcessor&) = delete;
 
-    // Key press handler
+    // Key press handler: times the callback for the watchdog
     void OnKeyPressed(KeyEventData& event);
 
-    // Check and handle app changes (for smart switch)
+    // Engine decision and output for one key (sets timing.engineDone)
+    void ProcessKey(KeyEventData& event, HookTiming& timing);
+
+    // Degrade or restore after a watchdog state change, and log it
+    void ApplyWatchdogState(uint64_t nowNs);
+
+    // Apply a newly published foreground snapshot (context, smart switch,
+    // exclusion, encoding). One atomic read when nothing changed.
     void CheckAppChange();
 
+    // Inject an engine edit, via clipboard for long replacements
+    void SendEdit(const wchar_t* text, size_t length, int backspaces);
+
     std::atomic<bool> m_enabled;
-    // Thread safety: m_lastAppName is only accessed from the UI/hook thread.
+    // Thread safety: the m_last* fields are only accessed from the UI/hook thread.
     // WH_KEYBOARD_LL callbacks run on the thread that called SetWindowsHookEx
     // (the UI thread), so no concurrent access occurs. Do NOT access from
     // background threads without adding synchronization.
     std::wstring m_lastAppName;
-    HWND m_lastHwnd = nullptr;
+    uint32_t m_lastAppId = 0;
+    uint64_t m_lastSequence = 0;  // Foreground snapshot already applied
+    uint8_t m_appMethod = 0;      // Method set in the engine (per-app rules may override m_method)
     std::atomic<uint8_t> m_method;
     bool m_initialized;
+    HookWatchdog m_watchdog;  // Recorded on the hook thread
 };
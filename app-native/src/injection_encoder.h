@@ -0,0 +1,135 @@
+// ViKey - Injection Encoder
+// injection_encoder.h
+// Turns an edit (backspaces + text) into keyboard events for one SendInput
+// batch without allocating per keystroke. Backspace down/up pairs are copied
+// from precomputed templates; text becomes KEYEVENTF_UNICODE down/up pairs,
+// one pair per UTF-16 unit, so characters outside the BMP go out as their
+// full surrogate pair. Events land in an arena owned by the encoder (one per
+// injecting thread) that only grows for long expansions. Portable: the event
+// type comes from a traits class (INPUT on Win32, KeyEventRecord elsewhere).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <memory>
+
+// Event flags and keys, same values as the Win32 constants
+namespace InjectionKeys {
+constexpr uint32_t FLAG_KEYUP = 0x0002;    // KEYEVENTF_KEYUP
+constexpr uint32_t FLAG_UNICODE = 0x0004;  // KEYEVENTF_UNICODE
+constexpr uint16_t VK_BACKSPACE = 0x08;
+constexpr uint16_t SCAN_BACKSPACE = 0x0E;
+constexpr uint16_t REPLACEMENT_CHAR = 0xFFFD;  // Sent for unpaired surrogates
+}
+
+// Portable keyboard event (the KEYBDINPUT fields the encoder sets)
+struct KeyEventRecord {
+    uint16_t vk;
+    uint16_t scan;
+    uint32_t flags;
+    uintptr_t extraInfo;
+};
+
+struct KeyEventRecordTraits {
+    using Event = KeyEventRecord;
+    static Event Make(uint16_t vk, uint16_t scan, uint32_t flags, uintptr_t extraInfo) {
+        return KeyEventRecord{vk, scan, flags, extraInfo};
+    }
+    static void SetScan(Event& event, uint16_t scan) { event.scan = scan; }
+};
+
+// Number of wchar_t that make up the character at text[0]: 2 for a UTF-16
+// surrogate pair, otherwise 1 (0 if length is 0)
+inline size_t WideCharLength(const wchar_t* text, size_t length) {
+    if (length == 0) return 0;
+    uint32_t c = static_cast<uint32_t>(text[0]);
+    if (c >= 0xD800 && c <= 0xDBFF && length > 1) {
+        uint32_t next = static_cast<uint32_t>(text[1]);
+        if (next >= 0xDC00 && next <= 0xDFFF) return 2;
+    }
+    return 1;
+}
+
+template <typename Traits, size_t InlineEvents = 128>
+class InjectionEncoder {
+public:
+    using Event = typename Traits::Event;
+
+    // extraInfo tags every event (the hook skips its own injections by it)
+    explicit InjectionEncoder(uintptr_t extraInfo) : m_heapCapacity(0) {
+        using namespace InjectionKeys;
+        m_backspace[0] = Traits::Make(VK_BACKSPACE, SCAN_BACKSPACE, 0, extraInfo);
+        m_backspace[1] = Traits::Make(VK_BACKSPACE, SCAN_BACKSPACE, FLAG_KEYUP, extraInfo);
+        m_unicode[0] = Traits::Make(0, 0, FLAG_UNICODE, extraInfo);
+        m_unicode[1] = Traits::Make(0, 0, FLAG_UNICODE | FLAG_KEYUP, extraInfo);
+    }
+    InjectionEncoder(const InjectionEncoder&) = delete;
+    InjectionEncoder& operator=(const InjectionEncoder&) = delete;
+
+    // Events for `backspaces` backspaces followed by `text`. The array is
+    // valid until the next Encode() on this encoder.
+    const Event* Encode(const wchar_t* text, size_t length, int backspaces, size_t& count) {
+        size_t bs = backspaces > 0 ? static_cast<size_t>(backspaces) : 0;
+        // Worst case: every wchar_t is a code point above U+FFFF (32-bit wchar_t)
+        Event* out = Reserve(2 * bs + (WCHAR_MAX > 0xFFFF ? 4 : 2) * length);
+        Event* p = out;
+
+        for (size_t i = 0; i < bs; i++) {
+            p[0] = m_backspace[0];
+            p[1] = m_backspace[1];
+            p += 2;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            uint32_t c = static_cast<uint32_t>(text[i]);
+            if (c > 0xFFFF) {
+                // 32-bit wchar_t holds the code point: split it
+                c -= 0x10000;
+                p = Unit(p, static_cast<uint16_t>(0xD800 + (c >> 10)));
+                p = Unit(p, static_cast<uint16_t>(0xDC00 + (c & 0x3FF)));
+            } else if (c >= 0xD800 && c <= 0xDFFF) {
+                if (WideCharLength(text + i, length - i) == 2) {
+                    p = Unit(p, static_cast<uint16_t>(c));
+                    p = Unit(p, static_cast<uint16_t>(text[++i]));
+                } else {
+                    p = Unit(p, InjectionKeys::REPLACEMENT_CHAR);
+                }
+            } else {
+                p = Unit(p, static_cast<uint16_t>(c));
+            }
+        }
+
+        count = static_cast<size_t>(p - out);
+        return out;
+    }
+
+    // Events the arena holds without growing
+    size_t Capacity() const { return m_heap ? m_heapCapacity : InlineEvents; }
+    bool IsInline() const { return !m_heap; }
+
+private:
+    Event* Unit(Event* p, uint16_t unit) {
+        p[0] = m_unicode[0];
+        p[1] = m_unicode[1];
+        Traits::SetScan(p[0], unit);
+        Traits::SetScan(p[1], unit);
+        return p + 2;
+    }
+
+    Event* Reserve(size_t count) {
+        if (count <= Capacity()) return m_heap ? m_heap.get() : m_inline;
+        size_t capacity = Capacity() * 2;
+        if (capacity < count) capacity = count;
+        m_heap.reset(new Event[capacity]);
+        m_heapCapacity = capacity;
+        return m_heap.get();
+    }
+
+    Event m_backspace[2];  // Down, up
+    Event m_unicode[2];    // Down, up (scan = UTF-16 unit)
+    Event m_inline[InlineEvents];
+    std::unique_ptr<Event[]> m_heap;
+    size_t m_heapCapacity;
+};
@@ -0,0 +1,151 @@
+// ViKey - Injection Pacer Implementation
+// injection_pacer.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "injection_pacer.h"
+#include <algorithm>
+
+// ============================================================
+// Per-app profile
+// ============================================================
+
+bool PacingProfile::Update(const InjectionFeedback& feedback) {
+    // Keys go out at least one delay apart; an app still busy well after the
+    // last one is falling behind even if nothing was lost yet
+    bool overrun = feedback.dropped || feedback.consumeUs > delayUs + std::max(delayUs, SLACK_US);
+    if (overrun) {
+        floorUs = std::max(floorUs, delayUs);
+        delayUs = std::min(MAX_DELAY_US, delayUs * 2);
+        cleanRuns = 0;
+        steadyRuns = 0;
+        return true;
+    }
+
+    // An overrun long ago (a busy moment, an app update) should not pin the delay forever
+    bool changed = false;
+    if (floorUs > 0 && ++steadyRuns >= FLOOR_EXPIRY_RUNS) {
+        floorUs = floorUs / 2 < MIN_DELAY_US ? 0 : floorUs / 2;
+        steadyRuns = 0;
+        changed = true;
+    }
+
+    if (++cleanRuns < CLEAN_RUNS) return changed;
+    cleanRuns = 0;
+
+    // Halve the distance to the fastest delay known to overrun. Below the
+    // default only on the app's word: our hook seeing the events says
+    // nothing about whether the app kept up with them
+    uint32_t lowest = feedback.confirmed ? MIN_DELAY_US : DEFAULT_DELAY_US;
+    if (delayUs <= lowest || delayUs - floorUs <= RESOLUTION_US) return changed;
+    uint32_t next = std::max(lowest, floorUs + (delayUs - floorUs) / 2);
+    if (next == delayUs) return changed;
+    delayUs = next;
+    return true;
+}
+
+static constexpr uint32_t PACK_V2 = 0x80000000u;
+static constexpr uint32_t PACK_FIELD = 0x3FF;
+
+static uint32_t PackField(uint32_t us) {
+    return std::min<uint32_t>(PACK_FIELD, (us + 50) / 100);
+}
+
+uint32_t PacingProfile::Pack() const {
+    // A raise is trusted at once; a step down becomes the saved delay only
+    // as far as an earlier session also reached, the rest waits as the candidate
+    uint32_t saved = delayUs;
+    uint32_t candidate = 0;
+    if (delayUs < savedUs) {
+        saved = heldUs != 0 ? std::min(savedUs, std::max(heldUs, delayUs)) : savedUs;
+        candidate = delayUs;
+    } else if (delayUs == savedUs) {
+        candidate = heldUs;
+    }
+    return PACK_V2 | PackField(saved) | (PackField(floorUs) << 10) | (PackField(candidate) << 20);
+}
+
+PacingProfile PacingProfile::Unpack(uint32_t packed) {
+    PacingProfile profile;
+    uint32_t delay, floor, candidate = 0;
+    if (packed & PACK_V2) {
+        delay = (packed & PACK_FIELD) * 100;
+        floor = ((packed >> 10) & PACK_FIELD) * 100;
+        candidate = ((packed >> 20) & PACK_FIELD) * 100;
+    } else {
+        // Learned before the app had to confirm a step down: keep only raises
+        delay = (packed & 0xFFFF) * 100;
+        floor = (packed >> 16) * 100;
+        if (delay < DEFAULT_DELAY_US) delay = 0;
+    }
+    if (delay != 0) profile.delayUs = std::min(MAX_DELAY_US, std::max(MIN_DELAY_US, delay));
+    profile.floorUs = std::min(profile.delayUs, floor);
+    profile.savedUs = profile.delayUs;
+    if (candidate != 0 && candidate < profile.delayUs) profile.heldUs = std::max(MIN_DELAY_US, candidate);
+    return profile;
+}
+
+// ============================================================
+// Pacer
+// ============================================================
+
+void InjectionPacer::SetStore(LoadFn load, SaveFn save) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_load = std::move(load);
+    m_save = std::move(save);
+}
+
+void InjectionPacer::SetAppName(uint32_t appId, const std::wstring& name) {
+    if (appId == 0) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    App& app = m_apps[appId];
+    if (app.name != name) {
+        app.name = name;
+        app.loaded = false;
+    }
+}
+
+InjectionPacer::App& InjectionPacer::Find(uint32_t appId) {
+    App& app = m_apps[appId];
+    if (!app.loaded) {
+        // Profiles are saved per executable name, so apps sharing one share it
+        app.loaded = true;
+        uint32_t packed = 0;
+        if (!app.name.empty() && m_load && m_load(app.name, packed)) {
+            app.profile = PacingProfile::Unpack(packed);
+            app.packed = packed;
+        } else {
+            app.profile = PacingProfile();
+            app.packed = app.profile.Pack();
+        }
+    }
+    return app;
+}
+
+InjectionPacing InjectionPacer::Pacing(uint32_t appId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return Find(appId).profile.Pacing();
+}
+
+void InjectionPacer::Report(uint32_t appId, const InjectionFeedback& feedback) {
+    std::wstring name;
+    uint32_t packed = 0;
+    SaveFn save;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        App& app = Find(appId);
+        if (!app.profile.Update(feedback) || app.name.empty() || !m_save) return;
+        // A step down not yet worth saving leaves the stored form as it was
+        packed = app.profile.Pack();
+        if (packed == app.packed) return;
+        app.packed = packed;
+        name = app.name;
+        save = m_save;
+    }
+    // Settings store write outside the lock (the hook may be switching apps)
+    save(name, packed);
+}
+
+PacingProfile InjectionPacer::Profile(uint32_t appId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return Find(appId).profile;
+}
@@ -0,0 +1,99 @@
+// ViKey - Injection Pacer
+// injection_pacer.h
+// Learns, per app, the smallest delay between injected key events that the
+// app still keeps up with (slow mode and clipboard mode). The platform
+// reports after each paced injection whether events were dropped and how
+// long the app took to consume them after the last one; the delay steps
+// down (binary search toward the fastest overrun seen) after clean runs and
+// doubles on an overrun. Our own hook seeing the events only proves they
+// left the input queue, so without the app confirming it handled them (a
+// clipboard read) the delay never goes below the default: only clipboard
+// mode learns a lower one, slow mode just raises it for slower apps.
+// Profiles are persisted per app (AppDetector): a raise is saved at once, a
+// step down only once a later session reached it again.
+// Portable (no Win32 calls).
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Delays a paced or clipboard injection waits
+struct InjectionPacing {
+    uint32_t eventDelayUs;   // After each key event
+    uint32_t settleDelayUs;  // Between backspaces and text (or the paste)
+};
+
+// What the platform observed for one paced or clipboard injection
+struct InjectionFeedback {
+    uint32_t events = 0;     // Key events sent
+    bool dropped = false;    // Events were lost or never consumed (timeout)
+    uint32_t consumeUs = 0;  // Time from the last event until the app caught up
+    bool confirmed = false;  // The app itself showed it handled the input, not just our hook
+};
+
+struct PacingProfile {
+    static constexpr uint32_t DEFAULT_DELAY_US = 15000;  // Unlearned app (the old fixed delay)
+    static constexpr uint32_t MIN_DELAY_US = 500;
+    static constexpr uint32_t MAX_DELAY_US = 100000;
+    static constexpr uint32_t RESOLUTION_US = 500;   // Close enough to the floor: stop stepping down
+    static constexpr uint32_t SLACK_US = 2000;       // Consume time always tolerated
+    static constexpr uint32_t CLEAN_RUNS = 4;        // Clean injections before each step down
+    static constexpr uint32_t FLOOR_EXPIRY_RUNS = 256;  // Clean injections before the floor is halved
+
+    uint32_t delayUs = DEFAULT_DELAY_US;
+    uint32_t floorUs = 0;  // Fastest delay that overran the app (0 = none seen)
+    uint32_t cleanRuns = 0;
+    uint32_t steadyRuns = 0;
+    uint32_t savedUs = DEFAULT_DELAY_US;  // Delay the store held when the session started
+    uint32_t heldUs = 0;  // Lower delay an earlier session reached (0 = none), not yet trusted
+
+    InjectionPacing Pacing() const { return {delayUs, 2 * delayUs}; }
+
+    // Learn from one injection made with Pacing(). Returns true if the
+    // delay or the floor changed (worth persisting).
+    bool Update(const InjectionFeedback& feedback);
+
+    // Persisted form, 100 µs units in 10 bits each: delay, floor and the
+    // step down awaiting a second session, with bit 31 set. Older values
+    // (delay | floor << 16) load with a delay no lower than the default.
+    uint32_t Pack() const;
+    static PacingProfile Unpack(uint32_t packed);
+};
+
+class InjectionPacer {
+public:
+    // Persistence: load returns false for an app without a saved profile
+    using LoadFn = std::function<bool(const std::wstring& app, uint32_t& packed)>;
+    using SaveFn = std::function<void(const std::wstring& app, uint32_t packed)>;
+    void SetStore(LoadFn load, SaveFn save);
+
+    // Hook thread, on an app change: the name profiles of appId are saved under
+    void SetAppName(uint32_t appId, const std::wstring& name);
+
+    // Output thread: pacing for the next injection into appId, and what it
+    // observed. App id 0 (unknown) learns too, but is never persisted.
+    InjectionPacing Pacing(uint32_t appId);
+    void Report(uint32_t appId, const InjectionFeedback& feedback);
+
+    PacingProfile Profile(uint32_t appId);
+
+private:
+    struct App {
+        std::wstring name;
+        PacingProfile profile;
+        uint32_t packed = 0;  // What the store holds for name
+        bool loaded = false;
+    };
+
+    // Caller holds m_mutex
+    App& Find(uint32_t appId);
+
+    std::mutex m_mutex;  // Guards the fields below (hook and output threads)
+    std::unordered_map<uint32_t, App> m_apps;
+    LoadFn m_load;
+    SaveFn m_save;
+};
@@ -5,27 +5,7 @@
 #include "keyboard_hook.h"
 #include "keycodes.h"
 #include "rust_bridge.h"
-
-// Win32 Constants
-// WH_KEYBOARD_LL is defined in Windows.h as 13
-#ifndef WH_KEYBOARD_LL
-#define WH_KEYBOARD_LL 13
-#endif
-constexpr int WM_KEYDOWN_MSG = 0x0100;
-constexpr int WM_SYSKEYDOWN_MSG = 0x0104;
-constexpr DWORD LLKHF_INJECTED_FLAG = 0x10;
-
-// Static instance pointer for callback
-static KeyboardHook* g_instance = nullptr;
-
-// Global keyboard hook procedure (not a class member)
-// Use __declspec(noinline) to prevent optimization that might affect the callback
-__declspec(noinline) static LRESULT CALLBACK GlobalLowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (g_instance) {
-        return g_instance->ProcessKey(nCode, wParam, lParam);
-    }
-    return CallNextHookEx(nullptr, nCode, wParam, lParam);
-}
+#include "text_sender.h"
 
 KeyboardHook& KeyboardHook::Instance() {
     static KeyboardHook instance;
@@ -33,124 +13,159 @@ KeyboardHook& KeyboardHook::Instance() {
 }
 
 KeyboardHook::KeyboardHook()
-    : m_hookId(nullptr)
+    : m_installed(false)
     , m_isProcessing(false)
     , m_callback(nullptr) {
-    g_instance = this;
 }
 
 KeyboardHook::~KeyboardHook() {
     Stop();
-    g_instance = nullptr;
 }
 
 bool KeyboardHook::Start() {
-    if (m_hookId != nullptr) return true;
-
-    SetLastError(0);
-
-    // For WH_KEYBOARD_LL, use user32.dll module handle (already loaded in GUI apps — no refcount leak)
-    HMODULE hMod = GetModuleHandleW(L"user32.dll");
-
-    m_hookId = SetWindowsHookExW(
-        WH_KEYBOARD_LL,
-        GlobalLowLevelKeyboardProc,
-        hMod,
-        0
-    );
+    if (m_installed) return true;
 
-    if (m_hookId == nullptr) {
-        MessageBoxW(nullptr, L"Failed to install keyboard hook!", L"Hook Error", MB_ICONERROR);
+    m_installed = Platform::Current().InstallKeyboardHook();
+    if (!m_installed) {
+        Platform::Current().ShowError(L"Hook Error", L"Failed to install keyboard hook!");
     }
 
-    return m_hookId != nullptr;
+    return m_installed;
 }
 
 void KeyboardHook::Stop() {
-    if (m_hookId != nullptr) {
-        UnhookWindowsHookEx(m_hookId);
-        m_hookId = nullptr;
+    if (m_installed) {
+        Platform::Current().RemoveKeyboardHook();
+        m_installed = false;
     }
 }
 
-LRESULT KeyboardHook::ProcessKey(int nCode, WPARAM wParam, LPARAM lParam) {
+bool KeyboardHook::OnKeyDown(int vkCode, ULONG_PTR extraInfo) {
+    Platform& platform = Platform::Current();
+    uint64_t entryTime = platform.TimestampNs();
+
     // Prevent recursion
     if (m_isProcessing) {
-        return CallNextHookEx(m_hookId, nCode, wParam, lParam);
-    }
-
-    // Only process key down events
-    if (nCode >= 0 && (wParam == WM_KEYDOWN_MSG || wParam == WM_SYSKEYDOWN_MSG)) {
-        auto* hookStruct = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
-
-        // Skip ONLY our own injected keys (identified by our marker)
-        // Don't skip other injected keys - they may come from remote desktop/AnyDesk
-        if (hookStruct->dwExtraInfo == INJECTED_KEY_MARKER) {
-            return CallNextHookEx(m_hookId, nCode, wParam, lParam);
-        }
-
-        int vkCode = static_cast<int>(hookStruct->vkCode);
-
-        // Clear buffer on Ctrl key press
-        if (vkCode == VK_CONTROL_KEY) {
-            RustBridge::Instance().Clear();
-            return CallNextHookEx(m_hookId, nCode, wParam, lParam);
-        }
-
-        // Only process relevant keys
-        if (KeyCodes::IsRelevantKey(vkCode)) {
-            bool shift = IsKeyDown(VK_SHIFT_KEY);
-            bool capsLock = IsCapsLockOn();
-            bool ctrl = IsKeyDown(VK_CONTROL_KEY);
-            bool alt = IsKeyDown(VK_MENU_KEY);
-
-            // Skip Ctrl/Alt combinations (shortcuts)
-            if (ctrl || alt) {
-                if (ctrl) RustBridge::Instance().Clear();
-                return CallNextHookEx(m_hookId, nCode, wParam, lParam);
-            }
-
-            // Clear buffer on word boundary keys (except Space which needs shortcut check)
-            bool isBufferClearKey = KeyCodes::IsBufferClearKey(vkCode);
-            if (isBufferClearKey && vkCode != VK_SPACE_KEY) {
-                RustBridge::Instance().Clear();
-                return CallNextHookEx(m_hookId, nCode, wParam, lParam);
-            }
-
-            // Process through callback if set
-            if (m_callback) {
-                KeyEventData event(vkCode, shift, capsLock);
-
-                m_isProcessing = true;
-                m_callback(event);
-                m_isProcessing = false;
-
-                // Clear buffer after processing word boundary keys
-                if (isBufferClearKey) {
-                    RustBridge::Instance().Clear();
-                }
-
-                // Block original key if handled
-                if (event.handled) {
-                    return 1;
-                }
-            }
-        }
-    }
-
-    return CallNextHookEx(m_hookId, nCode, wParam, lParam);
+        return false;
+    }
+
+    // Skip ONLY our own injected keys (identified by our marker)
+    // Don't skip other injected keys - they may come from remote desktop/AnyDesk
+    if (extraInfo == INJECTED_KEY_MARKER) {
+        return false;
+    }
+
+    // Modifiers: Ctrl starts a shortcut, the word is over. A modifier that
+    // reached the app ahead of queued output would turn the queued
+    // backspaces into Ctrl+Backspace (a whole word) or a held "a" into Ctrl+A
+    uint8_t modifier = KeyCodes::ModifierBit(vkCode);
+    if (modifier != 0) {
+        if (modifier == MODIFIER_CTRL) RustBridge::Instance().Clear();
+        return HoldModifier(modifier);
+    }
+
+    // Shift/Ctrl/Alt as the app will see them: blocked ones are only down here
+    bool shift = platform.IsKeyDown(VK_SHIFT_KEY) || (m_heldModifiers & MODIFIER_SHIFT);
+    bool capsLock = platform.IsCapsLockOn();
+    bool ctrl = platform.IsKeyDown(VK_CONTROL_KEY) || (m_heldModifiers & MODIFIER_CTRL);
+    bool alt = platform.IsKeyDown(VK_MENU_KEY) || (m_heldModifiers & MODIFIER_ALT);
+    m_usedModifiers |= m_heldModifiers;
+
+    // The Windows key belongs to the shell (Win+L, Win+D): never held
+    if (vkCode == VK_LWIN_KEY || vkCode == VK_RWIN_KEY) {
+        return false;
+    }
+
+    // Keys the engine does not handle (Delete, Home/End, F-keys, numpad)
+    // still wait for the output queued ahead of them. Caret keys end the word.
+    if (!KeyCodes::IsRelevantKey(vkCode)) {
+        if (KeyCodes::IsCaretKey(vkCode)) RustBridge::Instance().Clear();
+        return HoldIfOutputBusy(vkCode, shift, ctrl, alt);
+    }
+
+    // Ctrl/Alt combinations (shortcuts) skip the engine, but Ctrl+V or
+    // Ctrl+Z must still wait for the edits queued ahead of them
+    if (ctrl || alt) {
+        if (ctrl) RustBridge::Instance().Clear();
+        return HoldIfOutputBusy(vkCode, shift, ctrl, alt);
+    }
+
+    // Clear buffer on word boundary keys (except Space which needs shortcut check)
+    bool isBufferClearKey = KeyCodes::IsBufferClearKey(vkCode);
+    if (isBufferClearKey && vkCode != VK_SPACE_KEY) {
+        RustBridge::Instance().Clear();
+        return HoldIfOutputBusy(vkCode, shift);
+    }
+
+    // Process through callback if set
+    if (!m_callback) {
+        return HoldIfOutputBusy(vkCode, shift);
+    }
+
+    KeyEventData event(vkCode, shift, capsLock, entryTime);
+
+    m_isProcessing = true;
+    m_callback(event);
+    m_isProcessing = false;
+
+    // Clear buffer after processing word boundary keys
+    if (isBufferClearKey) {
+        RustBridge::Instance().Clear();
+    }
+
+    // Block original key if handled
+    return event.handled || HoldIfOutputBusy(vkCode, shift);
 }
 
-bool KeyboardHook::IsKeyDown(int vKey) {
-    return (GetAsyncKeyState(vKey) & 0x8000) != 0;
+bool KeyboardHook::OnKeyUp(int vkCode, ULONG_PTR extraInfo) {
+    if (extraInfo == INJECTED_KEY_MARKER) {
+        return false;
+    }
+    uint8_t modifier = KeyCodes::ModifierBit(vkCode);
+    if ((m_heldModifiers & modifier) == 0) {
+        return false;  // Not a modifier, or its press reached the app
+    }
+
+    // The app never saw the press: block the release too. A lone tap
+    // (Alt opens the menu bar) is replayed in order behind the queued output.
+    m_heldModifiers &= ~modifier;
+    if ((m_usedModifiers & modifier) == 0) {
+        TextSender::Instance().SendKey(vkCode, false);
+    }
+    m_usedModifiers &= ~modifier;
+    return true;
 }
 
-bool KeyboardHook::IsCapsLockOn() {
-    return (GetKeyState(VK_CAPITAL_KEY) & 0x0001) != 0;
+bool KeyboardHook::HoldModifier(uint8_t modifier) {
+    if (m_heldModifiers & modifier) {
+        return true;  // Auto-repeat of a modifier already held
+    }
+    if (!TextSender::Instance().IsOutputBusy()) {
+        return false;
+    }
+    m_heldModifiers |= modifier;
+    m_usedModifiers &= ~modifier;
+    return true;
+}
+
+bool KeyboardHook::HoldIfOutputBusy(int vkCode, bool shift, bool ctrl, bool alt) {
+    // A key passed through now would reach the app before the injections
+    // still queued on the output thread: block it and replay it after them.
+    // Under a held modifier it is replayed even once the queue is empty
+    // (the app would otherwise get it without the modifier).
+    TextSender& sender = TextSender::Instance();
+    sender.NoteKey(vkCode, ctrl || alt);
+    if (!sender.IsOutputBusy() && m_heldModifiers == 0) {
+        return false;
+    }
+    // Letters and Space can join the queued text edits (one injection)
+    wchar_t typed = ctrl || alt ? 0 : KeyCodes::TypedChar(vkCode, shift, Platform::Current().IsCapsLockOn());
+    sender.SendKey(vkCode, shift, typed, ctrl, alt);
+    return true;
 }
 
 bool KeyboardHook::EnsureInstalled() {
-    if (m_hookId != nullptr) return true;  // Still installed
+    if (m_installed) return true;  // Still installed
     // Hook was removed — re-install
     return Start();
 }
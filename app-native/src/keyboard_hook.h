@@ -1,10 +1,11 @@
 // ViKey - Low-level Keyboard Hook
 // keyboard_hook.h
-// Uses SetWindowsHookEx with WH_KEYBOARD_LL
+// Key filtering for the low-level hook installed by Platform
+// (SetWindowsHookEx with WH_KEYBOARD_LL on Win32)
 
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
 #include <functional>
 #include <cstdint>
 
@@ -17,19 +18,16 @@ struct KeyEventData {
     bool shift;
     bool capsLock;
     bool handled;
+    uint64_t timestamp;  // Platform::TimestampNs() when the hook callback was entered
 
-    KeyEventData(int vk, bool s, bool caps)
-        : vkCode(vk), shift(s), capsLock(caps), handled(false) {}
+    KeyEventData(int vk, bool s, bool caps, uint64_t time = 0)
+        : vkCode(vk), shift(s), capsLock(caps), handled(false), timestamp(time) {}
 };
 
 // Callback function type for key events
 using KeyPressedCallback = std::function<void(KeyEventData&)>;
 
-// Forward declaration
-static LRESULT CALLBACK GlobalLowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
-
 class KeyboardHook {
-    friend LRESULT CALLBACK GlobalLowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
 public:
     static KeyboardHook& Instance();
 
@@ -40,7 +38,7 @@ public:
     void Stop();
 
     // Check if hook is active
-    bool IsActive() const { return m_hookId != nullptr; }
+    bool IsActive() const { return m_installed; }
 
     // Re-install hook if it was silently removed by Windows
     bool EnsureInstalled();
@@ -48,20 +46,30 @@ public:
     // Set callback for key events
     void SetCallback(KeyPressedCallback callback) { m_callback = callback; }
 
+    // Handle a key-down delivered by the platform hook.
+    // Returns true if the key must be blocked from reaching the application.
+    bool OnKeyDown(int vkCode, ULONG_PTR extraInfo);
+
+    // Handle a key-up: true for the release of a modifier whose press was blocked
+    bool OnKeyUp(int vkCode, ULONG_PTR extraInfo);
+
 private:
     KeyboardHook();
     ~KeyboardHook();
     KeyboardHook(const KeyboardHook&) = delete;
     KeyboardHook& operator=(const KeyboardHook&) = delete;
 
-    // Process key event
-    LRESULT ProcessKey(int nCode, WPARAM wParam, LPARAM lParam);
+    // Pass-through verdict: true (block) if the key was queued behind pending output
+    bool HoldIfOutputBusy(int vkCode, bool shift, bool ctrl = false, bool alt = false);
 
-    // Check key states
-    static bool IsKeyDown(int vKey);
-    static bool IsCapsLockOn();
+    // Shift/Ctrl/Alt pressed while output is queued: blocked, so the app
+    // (and Platform::IsKeyDown) never sees it; the hook keeps it logically
+    // down and applies it to the keys held until its release
+    bool HoldModifier(uint8_t modifier);
 
-    HHOOK m_hookId;
+    bool m_installed;
     bool m_isProcessing;
     KeyPressedCallback m_callback;
+    uint8_t m_heldModifiers = 0;  // MODIFIER_* bits blocked and not yet released (hook thread)
+    uint8_t m_usedModifiers = 0;  // Held modifiers that joined a combination (no lone tap to replay)
 };
@@ -2,6 +2,7 @@
 // keycodes.cpp
 
 #include "keycodes.h"
+#include <cctype>
 
 // macOS keycodes (from core/src/data/keys.rs)
 namespace MacKeyCodes {
@@ -174,6 +175,29 @@ bool IsBufferClearKey(int vkCode) {
            (vkCode >= VK_LEFT_KEY && vkCode <= VK_DOWN_KEY);
 }
 
+bool IsCaretKey(int vkCode) {
+    return vkCode >= VK_PRIOR_KEY && vkCode <= VK_DELETE_KEY;
+}
+
+uint8_t ModifierBit(int vkCode) {
+    switch (vkCode) {
+    case VK_SHIFT_KEY:
+    case VK_LSHIFT_KEY:
+    case VK_RSHIFT_KEY:
+        return MODIFIER_SHIFT;
+    case VK_CONTROL_KEY:
+    case VK_LCONTROL_KEY:
+    case VK_RCONTROL_KEY:
+        return MODIFIER_CTRL;
+    case VK_MENU_KEY:
+    case VK_LMENU_KEY:
+    case VK_RMENU_KEY:
+        return MODIFIER_ALT;
+    default:
+        return 0;
+    }
+}
+
 char ToChar(int vkCode, bool shift, bool capsLock) {
     bool upper = shift ^ capsLock;
 
@@ -196,4 +220,10 @@ char ToChar(int vkCode, bool shift, bool capsLock) {
     return 0;
 }
 
+wchar_t TypedChar(int vkCode, bool shift, bool capsLock) {
+    if (IsLetter(vkCode)) return static_cast<wchar_t>(ToChar(vkCode, shift, capsLock));
+    if (vkCode == VK_SPACE_KEY) return L' ';
+    return 0;
+}
+
 } // namespace KeyCodes
@@ -4,7 +4,6 @@
 
 #pragma once
 
-#include <windows.h>
 #include <cstdint>
 
 // Windows VK codes - Control keys
@@ -17,16 +16,34 @@ constexpr int VK_MENU_KEY = 0x12;    // Alt key
 constexpr int VK_CAPITAL_KEY = 0x14; // Caps Lock
 constexpr int VK_ESCAPE_KEY = 0x1B;
 constexpr int VK_SPACE_KEY = 0x20;
+constexpr int VK_PRIOR_KEY = 0x21;   // Page Up (first of the caret keys)
 constexpr int VK_LEFT_KEY = 0x25;
 constexpr int VK_UP_KEY = 0x26;
 constexpr int VK_RIGHT_KEY = 0x27;
 constexpr int VK_DOWN_KEY = 0x28;
+constexpr int VK_DELETE_KEY = 0x2E;  // Last of the caret keys (Insert, Delete)
 
 // Windows VK codes - Alphanumeric
 constexpr int VK_0_KEY = 0x30;
 constexpr int VK_9_KEY = 0x39;
 constexpr int VK_A_KEY = 0x41;
 constexpr int VK_Z_KEY = 0x5A;
+constexpr int VK_LWIN_KEY = 0x5B;
+constexpr int VK_RWIN_KEY = 0x5C;
+constexpr int VK_F9_KEY = 0x78;
+
+// Windows VK codes - Left/right modifiers (what the low-level hook reports)
+constexpr int VK_LSHIFT_KEY = 0xA0;
+constexpr int VK_RSHIFT_KEY = 0xA1;
+constexpr int VK_LCONTROL_KEY = 0xA2;
+constexpr int VK_RCONTROL_KEY = 0xA3;
+constexpr int VK_LMENU_KEY = 0xA4;
+constexpr int VK_RMENU_KEY = 0xA5;
+
+// Modifier bits (KeyCodes::ModifierBit)
+constexpr uint8_t MODIFIER_SHIFT = 0x01;
+constexpr uint8_t MODIFIER_CTRL = 0x02;
+constexpr uint8_t MODIFIER_ALT = 0x04;
 
 // Windows VK codes - OEM keys
 constexpr int VK_OEM_1_KEY = 0xBA;      // ;:
@@ -57,7 +74,19 @@ namespace KeyCodes {
     // Check if key should clear the typing buffer (word boundary)
     bool IsBufferClearKey(int vkCode);
 
+    // Check if key moves the caret or edits around it (Page Up through
+    // Delete: navigation, Insert, Delete)
+    bool IsCaretKey(int vkCode);
+
+    // MODIFIER_* bit of Shift, Ctrl or Alt (either side, or the generic
+    // code), 0 for any other key
+    uint8_t ModifierBit(int vkCode);
+
     // Convert VK code to character (for shortcut tracking)
     // Returns 0 if not a valid character key
     char ToChar(int vkCode, bool shift, bool capsLock);
+
+    // Character a key types whatever the Latin layout (letters, Space), or 0
+    // if it depends on the layout (digits, punctuation) or types none
+    wchar_t TypedChar(int vkCode, bool shift, bool capsLock);
 }
@@ -0,0 +1,104 @@
+// ViKey - Latency Histogram Ring Implementation
+// latency_histogram.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "latency_histogram.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static unsigned HighestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+LatencyRing::LatencyRing() : m_total(0) {
+    for (Window& window : m_windows) {
+        window.epoch.store(0, std::memory_order_relaxed);
+        window.max.store(0, std::memory_order_relaxed);
+        for (std::atomic<uint32_t>& count : window.counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t LatencyRing::BucketOf(uint64_t valueNs) {
+    if (valueNs < 4) return static_cast<size_t>(valueNs);
+    unsigned octave = HighestBit(valueNs);
+    size_t sub = static_cast<size_t>((valueNs >> (octave - 2)) & 3);
+    size_t bucket = 4 * (octave - 1) + sub;
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint64_t LatencyRing::BucketUpperBound(size_t bucket) {
+    if (bucket < 4) return bucket;
+    unsigned octave = static_cast<unsigned>(bucket / 4 + 1);
+    uint64_t sub = bucket % 4;
+    uint64_t lower = (4 + sub) << (octave - 2);
+    return lower + (uint64_t(1) << (octave - 2)) - 1;
+}
+
+void LatencyRing::Record(uint64_t nowNs, uint64_t valueNs) {
+    uint64_t epoch = nowNs / WINDOW_NS + 1;
+    Window& window = m_windows[epoch % WINDOWS];
+
+    // Single writer: plain load + store instead of read-modify-write
+    if (window.epoch.load(std::memory_order_relaxed) != epoch) {
+        for (std::atomic<uint32_t>& count : window.counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        window.max.store(0, std::memory_order_relaxed);
+        window.epoch.store(epoch, std::memory_order_release);
+    }
+
+    std::atomic<uint32_t>& count = window.counts[BucketOf(valueNs)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (valueNs > window.max.load(std::memory_order_relaxed)) {
+        window.max.store(valueNs, std::memory_order_relaxed);
+    }
+    m_total.store(m_total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+LatencySnapshot LatencyRing::Snapshot(uint64_t nowNs) const {
+    uint64_t current = nowNs / WINDOW_NS + 1;
+    uint64_t merged[BUCKETS] = {};
+    LatencySnapshot snapshot;
+
+    for (const Window& window : m_windows) {
+        uint64_t epoch = window.epoch.load(std::memory_order_acquire);
+        if (epoch == 0 || epoch > current || current - epoch >= WINDOWS) continue;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            uint32_t count = window.counts[i].load(std::memory_order_relaxed);
+            merged[i] += count;
+            snapshot.count += count;
+        }
+        uint64_t max = window.max.load(std::memory_order_relaxed);
+        if (max > snapshot.max) snapshot.max = max;
+    }
+    if (snapshot.count == 0) return snapshot;
+
+    // Rank of the percentile sample (1-based), rounded up
+    uint64_t rank50 = (snapshot.count * 50 + 99) / 100;
+    uint64_t rank99 = (snapshot.count * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        if (merged[i] == 0) continue;
+        uint64_t before = seen;
+        seen += merged[i];
+        if (before < rank50 && seen >= rank50) snapshot.p50 = BucketUpperBound(i);
+        if (before < rank99 && seen >= rank99) {
+            snapshot.p99 = BucketUpperBound(i);
+            break;
+        }
+    }
+    // Bucket bounds overshoot by up to 25%: never report more than the max
+    if (snapshot.p50 > snapshot.max) snapshot.p50 = snapshot.max;
+    if (snapshot.p99 > snapshot.max) snapshot.p99 = snapshot.max;
+    return snapshot;
+}
@@ -0,0 +1,55 @@
+// ViKey - Latency Histogram Ring
+// latency_histogram.h
+// Always-on latency recording for the hook path. Values go into log-linear
+// buckets (4 per power of two, ≤25% error) inside a ring of short time
+// windows, so the moving p99 covers the last few seconds only. Fixed size,
+// no allocation, no locks: one writer thread, readers on any thread.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Summary of the recent windows (nanoseconds)
+struct LatencySnapshot {
+    uint64_t count = 0;
+    uint64_t p50 = 0;
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+};
+
+class LatencyRing {
+public:
+    static constexpr size_t BUCKETS = 156;        // Up to ~2^39 ns (9 minutes)
+    static constexpr size_t WINDOWS = 8;
+    static constexpr uint64_t WINDOW_NS = 500000000ULL;  // 8 x 0.5 s = 4 s moving span
+
+    LatencyRing();
+    LatencyRing(const LatencyRing&) = delete;
+    LatencyRing& operator=(const LatencyRing&) = delete;
+
+    // Writer (one thread only). nowNs: monotonic timestamp of the sample.
+    void Record(uint64_t nowNs, uint64_t valueNs);
+
+    // Reader: merge the windows still inside the moving span at nowNs.
+    // Approximate while the writer is rolling a window over.
+    LatencySnapshot Snapshot(uint64_t nowNs) const;
+
+    // Samples recorded since construction
+    uint64_t Total() const { return m_total.load(std::memory_order_relaxed); }
+
+    // Bucket mapping (exposed for tests)
+    static size_t BucketOf(uint64_t valueNs);
+    static uint64_t BucketUpperBound(size_t bucket);
+
+private:
+    struct Window {
+        std::atomic<uint64_t> epoch;  // nowNs / WINDOW_NS + 1 (0 = never used)
+        std::atomic<uint64_t> max;
+        std::atomic<uint32_t> counts[BUCKETS];
+    };
+
+    Window m_windows[WINDOWS];
+    std::atomic<uint64_t> m_total;
+};
@@ -0,0 +1,71 @@
+// ViKey - LRU Cache
+// lru_cache.h
+// Small fixed-capacity least-recently-used map. Not thread-safe: owned by
+// one thread (the foreground tracker's resolver).
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+template <typename Key, typename Value>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1) {
+        m_index.reserve(m_capacity);
+    }
+
+    // Value for key (now most recently used), or nullptr
+    Value* Get(const Key& key) {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return nullptr;
+        m_order.splice(m_order.begin(), m_order, it->second);
+        return &it->second->second;
+    }
+
+    // Insert or replace; evicts the least recently used entry when full
+    Value& Put(const Key& key, Value value) {
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            it->second->second = std::move(value);
+            m_order.splice(m_order.begin(), m_order, it->second);
+            return it->second->second;
+        }
+        if (m_order.size() == m_capacity) {
+            // Reuse the evicted node: no allocation once the cache is full
+            auto last = std::prev(m_order.end());
+            m_index.erase(last->first);
+            last->first = key;
+            last->second = std::move(value);
+            m_order.splice(m_order.begin(), m_order, last);
+        } else {
+            m_order.emplace_front(key, std::move(value));
+        }
+        m_index[key] = m_order.begin();
+        return m_order.front().second;
+    }
+
+    void Erase(const Key& key) {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return;
+        m_order.erase(it->second);
+        m_index.erase(it);
+    }
+
+    void Clear() {
+        m_order.clear();
+        m_index.clear();
+    }
+
+    size_t Size() const { return m_order.size(); }
+    size_t Capacity() const { return m_capacity; }
+
+private:
+    using Entry = std::pair<Key, Value>;
+
+    size_t m_capacity;
+    std::list<Entry> m_order;  // Most recently used first
+    std::unordered_map<Key, typename std::list<Entry>::iterator> m_index;
+};
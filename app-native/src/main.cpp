@@ -24,6 +24,7 @@
 #include "keyboard_hook.h"
 #include "app_detector.h"
 #include "updater.h"
+#include "selection_convert.h"
 
 // Application name and class
 constexpr const wchar_t* APP_NAME = L"ViKey";
@@ -38,6 +39,9 @@ HINSTANCE g_hInstance = nullptr;
 HWND g_hWnd = nullptr;
 ULONG_PTR g_gdiplusToken = 0;
 
+// Selection hotkey jobs (worker thread; reports to the window)
+static SelectionConverter g_selection;
+
 // Forward declarations
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 bool InitInstance(HINSTANCE hInstance);
@@ -199,6 +203,13 @@ bool InitInstance(HINSTANCE hInstance) {
         Settings::Instance().Save();
         UpdateUI();
     });
+    g_selection.SetCallback([](SelectionStatus status) {
+        PostMessage(g_hWnd, WM_SELECTION_DONE, static_cast<WPARAM>(status), 0);
+    });
+    hotkey.SetSelectionCallback([]() {
+        const Settings& settings = Settings::Instance();
+        g_selection.Toggle(settings.selectionFrom, settings.selectionTo);
+    });
 
     ImeProcessor::Instance().Start();
     SetTimer(g_hWnd, TIMER_HOOK_CHECK, 5000, nullptr);
@@ -228,6 +239,7 @@ void CleanupInstance() {
     }
 
     ImeProcessor::Instance().Stop();
+    g_selection.Stop();
 
     if (g_hWnd) {
         HotkeyManager::Instance().Unregister(g_hWnd);
@@ -0,0 +1,134 @@
+// ViKey - Output Worker Implementation
+// output_worker.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "output_worker.h"
+
+OutputWorker::OutputWorker(Sink sink)
+    : m_sink(std::move(sink))
+    , m_pending(0)
+    , m_spilled(0)
+    , m_overflows(0)
+    , m_overflowHead(new OverflowNode)
+    , m_overflowTail(m_overflowHead)
+    , m_filling(nullptr)
+    , m_executingSpilled(false)
+    , m_merged(0)
+    , m_sleeping(false)
+    , m_stopping(false) {
+}
+
+OutputWorker::~OutputWorker() {
+    Stop();
+    while (m_overflowHead) {
+        OverflowNode* next = m_overflowHead->next.load(std::memory_order_relaxed);
+        delete m_overflowHead;
+        m_overflowHead = next;
+    }
+}
+
+void OutputWorker::Start() {
+    if (m_thread.joinable()) return;
+    m_stopping = false;
+    m_thread = std::thread(&OutputWorker::Run, this);
+}
+
+void OutputWorker::Stop() {
+    if (!m_thread.joinable()) {
+        Flush();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+OutputCommand& OutputWorker::Begin() {
+    for (;;) {
+        OutputCommand* slot = m_spilled.load(std::memory_order_acquire) == 0 ? m_queue.Reserve() : nullptr;
+        if (slot) return *slot;
+        // Full: the output thread is behind (slow mode, paste). Spill rather
+        // than wait for it, the hook must return at once. Without a thread,
+        // make room by executing the oldest command here.
+        if (m_thread.joinable()) {
+            m_filling = new OverflowNode;
+            m_overflows.fetch_add(1, std::memory_order_relaxed);
+            return m_filling->cmd;
+        }
+        ExecuteFront();
+    }
+}
+
+void OutputWorker::Submit() {
+    m_pending.fetch_add(1, std::memory_order_acq_rel);
+    if (m_filling) {
+        m_spilled.fetch_add(1, std::memory_order_acq_rel);
+        m_overflowTail->next.store(m_filling, std::memory_order_release);
+        m_overflowTail = m_filling;
+        m_filling = nullptr;
+    } else {
+        m_queue.Commit();
+    }
+
+    // Only wake the thread if it is (about to go) asleep. Pairs with the
+    // fence in Run(): either it sees the new item or we see m_sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_wake.notify_one();
+    }
+}
+
+void OutputWorker::Flush() {
+    if (m_thread.joinable()) {
+        while (IsBusy()) std::this_thread::yield();
+        return;
+    }
+    while (ExecuteFront()) {}
+}
+
+bool OutputWorker::HasWork() {
+    return !m_queue.Empty() || m_overflowHead->next.load(std::memory_order_acquire) != nullptr;
+}
+
+bool OutputWorker::ExecuteFront() {
+    OutputCommand* cmd = m_queue.Front();
+    if (!cmd) {
+        // Spilled commands are newer than anything left in the queue
+        OverflowNode* next = m_overflowHead->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        m_merged = 0;
+        m_executingSpilled = true;
+        m_sink(next->cmd);
+        m_executingSpilled = false;
+        delete m_overflowHead;
+        m_overflowHead = next;
+        m_spilled.fetch_sub(1, std::memory_order_acq_rel);
+        m_pending.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+    m_merged = 0;
+    m_sink(*cmd);
+    uint32_t done = 1 + static_cast<uint32_t>(m_merged);
+    m_queue.Pop(done);
+    m_pending.fetch_sub(done, std::memory_order_acq_rel);
+    return true;
+}
+
+void OutputWorker::Run() {
+    for (;;) {
+        if (ExecuteFront()) continue;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping.store(true, std::memory_order_relaxed);
+        m_wake.wait(lock, [this] {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return HasWork() || m_stopping;
+        });
+        m_sleeping.store(false, std::memory_order_relaxed);
+        if (m_stopping && !HasWork()) return;
+    }
+}
@@ -0,0 +1,115 @@
+// ViKey - Output Worker
+// output_worker.h
+// Runs text injection on a dedicated thread so the low-level hook callback
+// only decides swallow/pass. Commands flow through a lock-free SPSC queue
+// (hook thread → output thread) and execute strictly in submission order.
+// The hook thread never waits: when the target app falls so far behind
+// that the queue is full, commands spill into an unbounded overflow list
+// until the output thread has caught up.
+
+#pragma once
+
+#include "spsc_queue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// One injection, filled in place in the queue slot (no allocation on the hook thread)
+struct OutputCommand {
+    enum class Kind : uint8_t {
+        Text,       // Backspaces + text as one batch (fast mode)
+        TextPaced,  // One event at a time with delays (slow mode)
+        Paste,      // Backspaces, then clipboard + Ctrl+V
+        Key         // Replay a virtual key the hook held back
+    };
+
+    static constexpr size_t TEXT_CAPACITY = 512;
+
+    Kind kind;
+    uint8_t encoding;  // OutputEncoding applied before injecting text
+    bool shift;        // Key: the key was pressed with Shift
+    bool ctrl;         // Key: ... with Ctrl (a shortcut such as Ctrl+V)
+    bool alt;          // Key: ... with Alt
+    int backspaces;
+    int vkCode;
+    uint32_t appId;    // Foreground app when queued (paced/clipboard pacing)
+    size_t length;     // Key: 1 if text[0] is the character it types
+    wchar_t text[TEXT_CAPACITY];
+};
+
+class OutputWorker {
+public:
+    using Sink = std::function<void(const OutputCommand&)>;
+    static constexpr size_t QUEUE_CAPACITY = 64;
+
+    explicit OutputWorker(Sink sink);
+    ~OutputWorker();
+    OutputWorker(const OutputWorker&) = delete;
+    OutputWorker& operator=(const OutputWorker&) = delete;
+
+    // Start the output thread. Until then (headless runs), queued commands
+    // execute on the caller's thread in Flush() or when the queue fills up.
+    void Start();
+
+    // Execute everything still queued, then join the output thread
+    void Stop();
+
+    bool IsRunning() const { return m_thread.joinable(); }
+
+    // Producer side (one thread only): fill the returned slot, then Submit().
+    // Never waits: with the queue full (or still spilling) the slot comes
+    // from the overflow list. Without a thread, a full queue executes its
+    // oldest command here instead.
+    OutputCommand& Begin();
+    void Submit();
+
+    // True while commands are queued or executing
+    bool IsBusy() const { return m_pending.load(std::memory_order_acquire) > 0; }
+
+    // Commands that found the queue full and went to the overflow list
+    uint64_t Overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+
+    // Block until every submitted command has executed
+    void Flush();
+
+    // Output thread, inside the sink: the index-th command queued behind the
+    // one executing (0 = the next), or nullptr. MergeQueued(count) marks the
+    // first count of them as executed along with it.
+    const OutputCommand* PeekQueued(size_t index) { return m_executingSpilled ? nullptr : m_queue.Peek(1 + index); }
+    void MergeQueued(size_t count) { m_merged = count; }
+
+private:
+    // Overflow list node; the consumer's head is a spent node, so the list
+    // is never empty and each side only touches its own end
+    struct OverflowNode {
+        OutputCommand cmd;
+        std::atomic<OverflowNode*> next{nullptr};
+    };
+
+    void Run();
+    bool ExecuteFront();
+    bool HasWork();
+
+    Sink m_sink;
+    SpscQueue<OutputCommand, QUEUE_CAPACITY> m_queue;
+    std::atomic<uint32_t> m_pending;
+    // Commands in the overflow list. While any are left the producer keeps
+    // spilling, and the consumer only takes them once the queue is empty,
+    // so order holds across the two.
+    std::atomic<uint32_t> m_spilled;
+    std::atomic<uint64_t> m_overflows;
+    OverflowNode* m_overflowHead;  // Consumer: spent node before the oldest spilled command
+    OverflowNode* m_overflowTail;  // Producer: newest node
+    OverflowNode* m_filling;       // Producer: node between Begin() and Submit(), if any
+    bool m_executingSpilled;       // Consumer: the sink runs a spilled command (nothing to peek)
+    size_t m_merged;  // Output thread: commands the executing one absorbed
+    std::atomic<bool> m_sleeping;
+    bool m_stopping;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+};
@@ -0,0 +1,29 @@
+// ViKey - Pending Edit Implementation
+// pending_edit.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "pending_edit.h"
+
+void PendingEdit::Reset() {
+    m_backspaces = 0;
+    m_text.clear();
+    m_count = 0;
+}
+
+void PendingEdit::Fold(int backspaces, const wchar_t* text, size_t length) {
+    // A backspace erases a whole character: both halves of a surrogate pair
+    int erase = backspaces > 0 ? backspaces : 0;
+    size_t kept = m_text.length();
+    while (erase > 0 && kept > 0) {
+        kept--;
+        if (kept > 0 && m_text[kept] >= 0xDC00 && m_text[kept] <= 0xDFFF &&
+            m_text[kept - 1] >= 0xD800 && m_text[kept - 1] <= 0xDBFF) {
+            kept--;
+        }
+        erase--;
+    }
+    m_text.resize(kept);
+    m_backspaces += erase;
+    m_text.append(text, length);
+    m_count++;
+}
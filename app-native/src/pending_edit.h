@@ -0,0 +1,32 @@
+// ViKey - Pending Edit
+// pending_edit.h
+// Folds a run of (backspaces, text) edits that have not reached the screen
+// yet into one net edit: each edit's backspaces first cancel text still
+// pending, only the rest erase the screen. Injecting the folded edit leaves
+// the same text as injecting the edits one by one. Portable.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class PendingEdit {
+public:
+    // Start a new run with no edits
+    void Reset();
+
+    // Append an edit after the ones folded so far
+    void Fold(int backspaces, const wchar_t* text, size_t length);
+
+    // Net edit: characters to erase on screen, then text to insert
+    int Backspaces() const { return m_backspaces; }
+    const std::wstring& Text() const { return m_text; }
+
+    // Edits folded since Reset()
+    size_t Count() const { return m_count; }
+
+private:
+    int m_backspaces = 0;
+    std::wstring m_text;  // Capacity kept across runs
+    size_t m_count = 0;
+};
@@ -0,0 +1,21 @@
+// ViKey - Platform Interface
+// platform.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "platform.h"
+#ifdef _WIN32
+#include "platform_win32.h"
+#endif
+
+static Platform* g_platform = nullptr;
+
+Platform& Platform::Current() {
+#ifdef _WIN32
+    if (!g_platform) g_platform = &Win32Platform::Instance();
+#endif
+    return *g_platform;
+}
+
+void Platform::Install(Platform* platform) {
+    g_platform = platform;
+}
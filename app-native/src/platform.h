@@ -0,0 +1,101 @@
+// ViKey - Platform Interface
+// platform.h
+// OS services used by the typing pipeline (hook → engine → TextSender):
+// core library loading, keyboard hook, foreground app, text injection and
+// the settings store. Win32 in the app, a simulated backend for headless runs.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+// Headless (non-Windows) builds: the few Win32 types the pipeline headers use
+#include <cstdint>
+typedef void* HWND;
+typedef void* HMODULE;
+typedef uint32_t DWORD;
+typedef uint16_t WORD;
+typedef unsigned int UINT;
+typedef uintptr_t ULONG_PTR;
+#ifndef VK_BACK
+#define VK_BACK 0x08
+#endif
+#ifndef VK_SPACE
+#define VK_SPACE 0x20
+#endif
+#endif
+
+#include "injection_pacer.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class Platform {
+public:
+    virtual ~Platform() = default;
+
+    // Active backend: Win32 by default on Windows; headless builds must Install() one
+    static Platform& Current();
+    static void Install(Platform* platform);
+
+    // Rust core library (core.dll next to the executable on Win32)
+    virtual HMODULE LoadCoreLibrary() = 0;
+    virtual void* GetCoreProc(HMODULE module, const char* name) = 0;
+    virtual void FreeCoreLibrary(HMODULE module) = 0;
+    virtual void ShowError(const wchar_t* title, const wchar_t* message) = 0;
+
+    // Diagnostics: monotonic clock (QueryPerformanceCounter on Win32) and a
+    // one-line event log (debugger output on Win32)
+    virtual uint64_t TimestampNs() = 0;
+    virtual void LogEvent(const wchar_t* message) = 0;
+
+    // Keyboard hook: key-downs are delivered to KeyboardHook::OnKeyDown, key-ups to OnKeyUp
+    virtual bool InstallKeyboardHook() = 0;
+    virtual void RemoveKeyboardHook() = 0;
+    virtual bool IsKeyDown(int vkCode) = 0;
+    virtual bool IsCapsLockOn() = 0;
+
+    // Foreground window, its class and process, and the process's lowercase
+    // image path (e.g. "c:\windows\notepad.exe"). GetProcessImagePath opens
+    // the process and can block: ForegroundTracker calls these on its
+    // resolver thread, never in the hook.
+    virtual HWND GetForegroundWindow() = 0;
+    virtual std::wstring GetWindowClassName(HWND window) = 0;
+    virtual DWORD GetWindowProcessId(HWND window) = 0;
+    virtual std::wstring GetProcessImagePath(DWORD processId) = 0;
+
+    // Foreground changes are delivered to ForegroundTracker::OnForegroundChanged
+    // (SetWinEventHook(EVENT_SYSTEM_FOREGROUND) on Win32)
+    virtual bool InstallForegroundHook() = 0;
+    virtual void RemoveForegroundHook() = 0;
+
+    // Text injection, called on TextSender's output thread (never inside the
+    // hook callback). Every injected event carries INJECTED_KEY_MARKER.
+    // InjectText: backspaces + text as one atomic batch (fast mode)
+    // InjectTextPaced: one event at a time with delays (slow mode, terminals)
+    // InjectKey: replay a user key held back by the hook (with the modifiers
+    //   it was pressed with, if they have been released since)
+    // PasteText: backspaces, then clipboard + Ctrl+V, then clipboard restore
+    //   (driven by ClipboardPaste; the user's global-memory formats come back)
+    // CopySelection: Ctrl+C, then the text it copied, then clipboard restore
+    //   (driven by SelectionCopy); empty if nothing was selected, false if
+    //   the copy could not be made. The selection hotkey's worker thread
+    //   calls it and PasteText too, while the user waits on the conversion.
+    // The paced and clipboard paths wait the given (learned) delays and
+    // report whether the app kept up with the events (InjectionPacer).
+    virtual void InjectText(const wchar_t* text, size_t length, int backspaces) = 0;
+    virtual InjectionFeedback InjectTextPaced(const wchar_t* text, size_t length, int backspaces,
+                                              const InjectionPacing& pacing) = 0;
+    virtual void InjectKey(int vkCode, bool shift, bool ctrl, bool alt) = 0;
+    virtual InjectionFeedback PasteText(const std::wstring& text, int backspaces, const InjectionPacing& pacing) = 0;
+    virtual bool CopySelection(std::wstring& text) = 0;
+
+    // Settings store (HKEY_CURRENT_USER\<path> on Win32)
+    virtual bool ReadDword(const wchar_t* path, const wchar_t* name, DWORD& value) = 0;
+    virtual void WriteDword(const wchar_t* path, const wchar_t* name, DWORD value) = 0;
+    virtual bool ReadString(const wchar_t* path, const wchar_t* name, std::wstring& value) = 0;
+    virtual void WriteString(const wchar_t* path, const wchar_t* name, const std::wstring& value) = 0;
+    virtual void DeleteValue(const wchar_t* path, const wchar_t* name) = 0;
+    virtual void EnumDwords(const wchar_t* path, const std::function<void(const wchar_t*, DWORD)>& visit) = 0;
+};
@@ -0,0 +1,640 @@
+// ViKey - Simulated Platform Backend Implementation
+// platform_sim.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "platform_sim.h"
+#include "clipboard_paste.h"
+#include "foreground_tracker.h"
+#include "keyboard_hook.h"
+#include "keycodes.h"
+#include "selection_convert.h"
+#include "text_sender.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <dlfcn.h>
+#include <thread>
+#include <unistd.h>
+
+// US layout: digits and OEM keys (unshifted, shifted)
+struct SimKeyChars {
+    int vkCode;
+    char normal;
+    char shifted;
+};
+
+static const SimKeyChars SIM_KEYS[] = {
+    {0x30, '0', ')'}, {0x31, '1', '!'}, {0x32, '2', '@'}, {0x33, '3', '#'}, {0x34, '4', '$'},
+    {0x35, '5', '%'}, {0x36, '6', '^'}, {0x37, '7', '&'}, {0x38, '8', '*'}, {0x39, '9', '('},
+    {VK_OEM_1_KEY, ';', ':'}, {VK_OEM_PLUS_KEY, '=', '+'}, {VK_OEM_COMMA_KEY, ',', '<'},
+    {VK_OEM_MINUS_KEY, '-', '_'}, {VK_OEM_PERIOD_KEY, '.', '>'}, {VK_OEM_2_KEY, '/', '?'},
+    {VK_OEM_3_KEY, '`', '~'}, {VK_OEM_4_KEY, '[', '{'}, {VK_OEM_5_KEY, '\\', '|'},
+    {VK_OEM_6_KEY, ']', '}'}, {VK_OEM_7_KEY, '\'', '"'},
+    {VK_SPACE_KEY, ' ', ' '}, {VK_RETURN_KEY, '\n', '\n'}, {VK_TAB_KEY, '\t', '\t'},
+};
+
+bool SimTextField::ReplaceSelection() {
+    if (selected == 0) return false;
+    text.erase(text.length() - std::min(selected, text.length()));
+    selected = 0;
+    return true;
+}
+
+void SimTextField::Apply(const wchar_t* insert, size_t length, int backspaces) {
+    // Typing over a selection replaces it; a backspace only deletes it
+    if ((backspaces > 0 || length > 0) && ReplaceSelection() && backspaces > 0) backspaces--;
+    for (int i = 0; i < backspaces && !text.empty(); i++) {
+        text.pop_back();
+    }
+    text.append(insert, length);
+}
+
+void SimTextField::EraseWord() {
+    if (ReplaceSelection()) return;
+    size_t end = text.find_last_not_of(L' ');
+    if (end == std::wstring::npos) {
+        text.clear();
+        return;
+    }
+    size_t start = text.find_last_of(L' ', end);
+    text.erase(start == std::wstring::npos ? 0 : start + 1);
+}
+
+void SimTextField::ApplyEvents(const KeyEventRecord* events, size_t count, bool ctrl) {
+    for (size_t i = 0; i < count; i++) {
+        const KeyEventRecord& event = events[i];
+        if (event.flags & InjectionKeys::FLAG_KEYUP) continue;
+        if (!(event.flags & InjectionKeys::FLAG_UNICODE)) {
+            if (event.vk != InjectionKeys::VK_BACKSPACE) continue;
+            if (ctrl) {
+                EraseWord();
+            } else if (!ReplaceSelection() && !text.empty()) {
+                text.pop_back();
+            }
+            continue;
+        }
+        ReplaceSelection();
+
+        uint16_t unit = event.scan;
+        if (unit >= 0xD800 && unit <= 0xDBFF) {
+            m_highSurrogate = unit;
+            continue;
+        }
+        uint32_t c = unit;
+        if (unit >= 0xDC00 && unit <= 0xDFFF && m_highSurrogate) {
+            c = 0x10000 + ((static_cast<uint32_t>(m_highSurrogate) - 0xD800) << 10) + (unit - 0xDC00);
+        }
+        m_highSurrogate = 0;
+        if (sizeof(wchar_t) == 2 && c > 0xFFFF) {
+            text.push_back(static_cast<wchar_t>(0xD800 + ((c - 0x10000) >> 10)));
+            text.push_back(static_cast<wchar_t>(0xDC00 + ((c - 0x10000) & 0x3FF)));
+        } else {
+            text.push_back(static_cast<wchar_t>(c));
+        }
+    }
+}
+
+SimPlatform::SimPlatform(const std::string& corePath)
+    : m_corePath(corePath) {
+    if (m_corePath.empty()) {
+        // Mirror the Win32 lookup: core library next to the executable
+        char exe[4096] = {};
+        ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        std::string dir = n > 0 ? std::string(exe, n) : std::string();
+        size_t slash = dir.find_last_of('/');
+        dir = slash != std::string::npos ? dir.substr(0, slash + 1) : std::string("./");
+        m_corePath = dir + "libvikey_core.so";
+    }
+}
+
+// ============================================================
+// Scripted desktop and keyboard
+// ============================================================
+
+HWND SimPlatform::AddWindow(const std::wstring& appName, const std::wstring& windowClass,
+                           const std::wstring& directory) {
+    std::wstring path = directory + appName;
+    auto process = m_processes.find(path);
+    if (process == m_processes.end()) {
+        process = m_processes.emplace(path, m_nextProcessId++).first;
+    }
+    m_windows.push_back(SimWindow{path, windowClass, process->second, SimTextField{}});
+    return reinterpret_cast<HWND>(static_cast<uintptr_t>(m_windows.size()));
+}
+
+void SimPlatform::SetForeground(HWND window) {
+    // Focus changes at human speed: the output thread is done by then
+    PumpMessages();
+    m_foreground = window;
+    if (m_foregroundHookInstalled) {
+        ForegroundTracker::Instance().OnForegroundChanged(window);
+    }
+}
+
+SimTextField& SimPlatform::Field(HWND window) {
+    uintptr_t index = reinterpret_cast<uintptr_t>(window);
+    if (index == 0 || index > m_windows.size()) return m_desktop;
+    return m_windows[index - 1].field;
+}
+
+void SimPlatform::SetKeyDown(int vkCode, bool down) {
+    m_keysDown[vkCode & 0xFF] = down;
+    m_keysHeld[vkCode & 0xFF] = down;
+}
+
+bool SimPlatform::HoldKey(int vkCode) {
+    m_keysHeld[vkCode & 0xFF] = true;
+    bool blocked = m_hookInstalled && KeyboardHook::Instance().OnKeyDown(vkCode, 0);
+    if (!blocked) m_keysDown[vkCode & 0xFF] = true;
+    return blocked;
+}
+
+bool SimPlatform::ReleaseKey(int vkCode) {
+    m_keysHeld[vkCode & 0xFF] = false;
+    bool blocked = m_hookInstalled && KeyboardHook::Instance().OnKeyUp(vkCode, 0);
+    if (!blocked) m_keysDown[vkCode & 0xFF] = false;
+    return blocked;
+}
+
+bool SimPlatform::PressKey(int vkCode, bool shift) {
+    bool wasShift = m_keysDown[VK_SHIFT_KEY];
+    m_keysDown[VK_SHIFT_KEY] = shift;
+
+    bool blocked = m_hookInstalled && KeyboardHook::Instance().OnKeyDown(vkCode, 0);
+    if (!blocked) {
+        DeliverKey(vkCode, shift, m_keysDown[VK_CONTROL_KEY], m_keysDown[VK_MENU_KEY]);
+    }
+
+    m_keysDown[VK_SHIFT_KEY] = wasShift;
+    return blocked;
+}
+
+void SimPlatform::TypeText(const char* ascii) {
+    for (const char* p = ascii; *p; p++) {
+        int vk = 0;
+        bool shift = false;
+        if (VkFromAscii(*p, vk, shift)) {
+            PressKey(vk, shift);
+        }
+    }
+}
+
+void SimPlatform::DeliverKey(int vkCode, bool shift, bool ctrl, bool alt) {
+    SimTextField& field = FocusedField();
+    if (ctrl || alt) {
+        if (ctrl && !alt && vkCode == VK_A_KEY + ('v' - 'a')) field.Apply(clipboard.c_str(), clipboard.length(), 0);
+        if (ctrl && !alt && vkCode == VK_BACK_KEY) field.EraseWord();
+        return;
+    }
+    if (vkCode == VK_BACK_KEY) {
+        field.Apply(nullptr, 0, 1);
+        return;
+    }
+    wchar_t c = CharFromVk(vkCode, shift, m_capsLock);
+    if (c != 0) {
+        field.Apply(&c, 1, 0);
+    }
+}
+
+void SimPlatform::PumpMessages() {
+    TextSender::Instance().FlushOutput();
+}
+
+bool SimPlatform::VkFromAscii(char c, int& vkCode, bool& shift) {
+    if (c >= 'a' && c <= 'z') {
+        vkCode = VK_A_KEY + (c - 'a');
+        shift = false;
+        return true;
+    }
+    if (c >= 'A' && c <= 'Z') {
+        vkCode = VK_A_KEY + (c - 'A');
+        shift = true;
+        return true;
+    }
+    if (c == '\b') {
+        vkCode = VK_BACK_KEY;
+        shift = false;
+        return true;
+    }
+    for (const SimKeyChars& key : SIM_KEYS) {
+        if (key.normal == c || key.shifted == c) {
+            vkCode = key.vkCode;
+            shift = key.normal != c;
+            return true;
+        }
+    }
+    return false;
+}
+
+wchar_t SimPlatform::CharFromVk(int vkCode, bool shift, bool capsLock) {
+    if (vkCode >= VK_A_KEY && vkCode <= VK_Z_KEY) {
+        char c = static_cast<char>('a' + (vkCode - VK_A_KEY));
+        return static_cast<wchar_t>((shift ^ capsLock) ? toupper(c) : c);
+    }
+    for (const SimKeyChars& key : SIM_KEYS) {
+        if (key.vkCode == vkCode) {
+            return static_cast<wchar_t>(shift ? key.shifted : key.normal);
+        }
+    }
+    return 0;
+}
+
+// ============================================================
+// Rust core library
+// ============================================================
+
+HMODULE SimPlatform::LoadCoreLibrary() {
+    return dlopen(m_corePath.c_str(), RTLD_NOW | RTLD_LOCAL);
+}
+
+void* SimPlatform::GetCoreProc(HMODULE module, const char* name) {
+    return dlsym(module, name);
+}
+
+void SimPlatform::FreeCoreLibrary(HMODULE module) {
+    dlclose(module);
+}
+
+uint64_t SimPlatform::TimestampNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count()) + clockOffsetNs;
+}
+
+void SimPlatform::ShowError(const wchar_t* title, const wchar_t* message) {
+    fprintf(stderr, "%ls: %ls\n", title, message);
+    if (const char* err = dlerror()) {
+        fprintf(stderr, "  %s\n", err);
+    }
+}
+
+// ============================================================
+// Keyboard hook and foreground app
+// ============================================================
+
+bool SimPlatform::InstallKeyboardHook() {
+    m_hookInstalled = true;
+    return true;
+}
+
+void SimPlatform::RemoveKeyboardHook() {
+    m_hookInstalled = false;
+}
+
+bool SimPlatform::IsKeyDown(int vkCode) {
+    if (keyStateDelayUs > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(keyStateDelayUs));
+    }
+    return m_keysDown[vkCode & 0xFF];
+}
+
+std::wstring SimPlatform::GetWindowClassName(HWND window) {
+    uintptr_t index = reinterpret_cast<uintptr_t>(window);
+    if (index == 0 || index > m_windows.size()) return L"";
+    return m_windows[index - 1].windowClass;
+}
+
+DWORD SimPlatform::GetWindowProcessId(HWND window) {
+    uintptr_t index = reinterpret_cast<uintptr_t>(window);
+    if (index == 0 || index > m_windows.size()) return 0;
+    return m_windows[index - 1].processId;
+}
+
+std::wstring SimPlatform::GetProcessImagePath(DWORD processId) {
+    if (appQueryDelayUs > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(appQueryDelayUs));
+    }
+    appQueries++;
+    for (const SimWindow& window : m_windows) {
+        if (window.processId == processId) return window.path;
+    }
+    return L"";
+}
+
+bool SimPlatform::InstallForegroundHook() {
+    m_foregroundHookInstalled = true;
+    return true;
+}
+
+void SimPlatform::RemoveForegroundHook() {
+    m_foregroundHookInstalled = false;
+}
+
+// ============================================================
+// Text injection
+// ============================================================
+
+void SimPlatform::Delay() const {
+    if (injectDelayUs > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(injectDelayUs));
+    }
+}
+
+static const int SIM_MODIFIER_KEYS[] = {VK_SHIFT_KEY, VK_CONTROL_KEY, VK_MENU_KEY};
+
+SimPlatform::ModifierGuard::ModifierGuard(SimPlatform& platform, uint8_t keep)
+    : m_platform(platform) {
+    for (int vk : SIM_MODIFIER_KEYS) {
+        if ((KeyCodes::ModifierBit(vk) & keep) || !m_platform.m_keysDown[vk]) continue;
+        m_platform.m_keysDown[vk] = false;
+        m_released |= KeyCodes::ModifierBit(vk);
+    }
+}
+
+SimPlatform::ModifierGuard::~ModifierGuard() {
+    for (int vk : SIM_MODIFIER_KEYS) {
+        if (m_released & KeyCodes::ModifierBit(vk)) m_platform.m_keysDown[vk] = m_platform.m_keysHeld[vk];
+    }
+}
+
+// Same encoder as the Win32 backend, so the fields see the real events
+static InjectionEncoder<KeyEventRecordTraits>& Encoder() {
+    thread_local InjectionEncoder<KeyEventRecordTraits> encoder(INJECTED_KEY_MARKER);
+    return encoder;
+}
+
+// The focused app consuming paced keys, on a virtual clock (µs since the
+// injection started). Each key takes keyUs; a key arriving while `buffer`
+// keys are still waiting is dropped.
+struct SimConsumer {
+    unsigned keyUs;
+    unsigned buffer;
+    uint64_t now = 0;
+    uint64_t busyUntil = 0;
+
+    bool Offer() {
+        if (keyUs == 0) return true;
+        uint64_t waiting = busyUntil > now ? (busyUntil - now + keyUs - 1) / keyUs : 0;
+        if (waiting >= buffer) return false;
+        busyUntil = std::max(busyUntil, now) + keyUs;
+        return true;
+    }
+    void Wait(uint32_t us) { now += us; }
+    uint32_t Backlog() const { return busyUntil > now ? static_cast<uint32_t>(busyUntil - now) : 0; }
+};
+
+// Offer one key (its down/up events) to the consumer and type it if taken
+static void OfferKey(SimConsumer& consumer, SimTextField& field, const KeyEventRecord* events, size_t count,
+                     bool ctrl, InjectionFeedback& feedback, uint64_t& droppedKeys) {
+    feedback.events += static_cast<uint32_t>(count);
+    if (consumer.Offer()) {
+        field.ApplyEvents(events, count, ctrl);
+    } else {
+        feedback.dropped = true;
+        droppedKeys++;
+    }
+}
+
+void SimPlatform::InjectText(const wchar_t* text, size_t length, int backspaces) {
+    Delay();
+    injections++;
+    ModifierGuard guard(*this);
+    size_t count = 0;
+    const KeyEventRecord* events = Encoder().Encode(text, length, backspaces, count);
+    FocusedField().ApplyEvents(events, count, m_keysDown[VK_CONTROL_KEY]);
+    injectedEvents += count;
+}
+
+InjectionFeedback SimPlatform::InjectTextPaced(const wchar_t* text, size_t length, int backspaces,
+                                               const InjectionPacing& pacing) {
+    // Same event order and delays as the Win32 backend, on the virtual clock
+    Delay();
+    injections++;
+    ModifierGuard guard(*this);
+    bool ctrl = m_keysDown[VK_CONTROL_KEY];
+    InjectionFeedback feedback;
+    SimTextField& field = FocusedField();
+    SimConsumer consumer{consumerKeyUs, consumerBuffer};
+    size_t count = 0;
+
+    if (backspaces > 0) {
+        const KeyEventRecord* events = Encoder().Encode(nullptr, 0, 1, count);
+        for (int i = 0; i < backspaces; i++) {
+            OfferKey(consumer, field, events, count, ctrl, feedback, droppedKeys);
+            consumer.Wait(2 * pacing.eventDelayUs);  // After key down and after key up
+        }
+        consumer.Wait(pacing.settleDelayUs);
+    }
+
+    size_t i = 0;
+    while (i < length) {
+        size_t units = WideCharLength(text + i, length - i);
+        const KeyEventRecord* events = Encoder().Encode(text + i, units, 0, count);
+        OfferKey(consumer, field, events, count, ctrl, feedback, droppedKeys);
+        consumer.Wait(pacing.eventDelayUs);
+        i += units;
+    }
+
+    feedback.consumeUs = consumer.Backlog();
+    pacedWaitUs += consumer.now + feedback.consumeUs;
+    injectedEvents += feedback.events;
+    return feedback;
+}
+
+void SimPlatform::InjectKey(int vkCode, bool shift, bool ctrl, bool alt) {
+    // Runs on the output thread: the hook would skip it by marker anyway
+    Delay();
+    injections++;
+    uint8_t keep = (shift ? MODIFIER_SHIFT : 0) | (ctrl ? MODIFIER_CTRL : 0) | (alt ? MODIFIER_ALT : 0);
+    ModifierGuard guard(*this, keep);
+    DeliverKey(vkCode, shift, ctrl, alt);
+    injectedEvents += 2;
+}
+
+bool SimPlatform::OpenClipboard() {
+    if (clipboardBusy == 0) return true;
+    clipboardBusy--;
+    clipboardRetries++;
+    return false;
+}
+
+InjectionFeedback SimPlatform::PasteText(const std::wstring& text, int backspaces, const InjectionPacing& pacing) {
+    // Same state machine as the Win32 backend, on the virtual clock: the
+    // target reads the clipboard when it gets to our Ctrl+V
+    Delay();
+    injections++;
+    ModifierGuard guard(*this);
+    bool ctrl = m_keysDown[VK_CONTROL_KEY];
+    SimTextField& field = FocusedField();
+    SimConsumer consumer{consumerKeyUs, consumerBuffer};
+    ClipboardPaste paste(backspaces, !text.empty(), pacing, 0);
+    InjectionFeedback keys;
+    std::wstring savedText;
+    std::map<unsigned, std::string> savedFormats;
+    uint64_t readAt = UINT64_MAX;
+    size_t count = 0;
+
+    for (;;) {
+        if (readAt <= consumer.now) {
+            field.Apply(clipboard.c_str(), clipboard.length(), 0);
+            paste.Rendered(readAt);
+            readAt = UINT64_MAX;
+        }
+
+        bool ok = true;
+        switch (paste.Next(consumer.now)) {
+        case PasteAction::Wait:
+            consumer.now = std::min<uint64_t>(paste.WakeUs(), std::max(readAt, consumer.now));
+            continue;
+        case PasteAction::SendBackspaces: {
+            const KeyEventRecord* events = Encoder().Encode(nullptr, 0, 1, count);
+            for (int i = 0; i < backspaces; i++) {
+                OfferKey(consumer, field, events, count, ctrl, keys, droppedKeys);
+            }
+            ok = !keys.dropped;
+            break;
+        }
+        case PasteAction::SaveClipboard:
+            ok = OpenClipboard();
+            if (ok) {
+                savedText = clipboard;
+                savedFormats = clipboardFormats;
+            }
+            break;
+        case PasteAction::OfferText:
+            ok = OpenClipboard();
+            if (ok) {
+                clipboard = text;
+                clipboardFormats.clear();
+            }
+            break;
+        case PasteAction::PasteKeysDown:
+            ok = consumer.Offer();
+            if (ok) {
+                readAt = consumer.busyUntil > consumer.now ? consumer.busyUntil : consumer.now;
+            } else {
+                droppedKeys++;
+            }
+            pastes++;
+            break;
+        case PasteAction::PasteKeysUp:
+            break;
+        case PasteAction::RestoreClipboard:
+            ok = OpenClipboard();
+            if (ok) {
+                clipboard = std::move(savedText);
+                clipboardFormats = std::move(savedFormats);
+            }
+            break;
+        case PasteAction::TypeText: {
+            const KeyEventRecord* events = Encoder().Encode(text.c_str(), text.length(), 0, count);
+            field.ApplyEvents(events, count, ctrl);
+            injectedEvents += count;
+            break;
+        }
+        case PasteAction::Done: {
+            InjectionFeedback feedback = paste.Feedback();
+            injectedEvents += feedback.events;
+            pacedWaitUs += consumer.now;
+            return feedback;
+        }
+        }
+        paste.Complete(ok, consumer.now);
+    }
+}
+
+bool SimPlatform::CopySelection(std::wstring& text) {
+    // Same state machine as the Win32 backend, on the virtual clock: the
+    // focused app copies its selection as soon as Ctrl+C goes down
+    Delay();
+    SimTextField& field = FocusedField();
+    SelectionCopy copy(0);
+    uint64_t now = 0;
+    bool changed = false;
+    std::wstring savedText;
+    std::map<unsigned, std::string> savedFormats;
+    text.clear();
+
+    for (;;) {
+        if (changed) {
+            copy.Copied(now);
+            changed = false;
+        }
+
+        bool ok = true;
+        switch (copy.Next(now)) {
+        case CopyAction::Wait:
+            now = copy.WakeUs();
+            continue;
+        case CopyAction::SaveClipboard:
+            ok = OpenClipboard();
+            if (ok) {
+                savedText = clipboard;
+                savedFormats = clipboardFormats;
+            }
+            break;
+        case CopyAction::CopyKeysDown:
+            injectedEvents += 2;
+            copies++;
+            if (field.selected > 0) {
+                clipboard = field.Selection();
+                clipboardFormats.clear();
+                changed = true;
+            }
+            break;
+        case CopyAction::CopyKeysUp:
+            injectedEvents += 2;
+            break;
+        case CopyAction::ReadClipboard:
+            ok = OpenClipboard();
+            if (ok) text = clipboard;
+            break;
+        case CopyAction::RestoreClipboard:
+            ok = OpenClipboard();
+            if (ok) {
+                clipboard = std::move(savedText);
+                clipboardFormats = std::move(savedFormats);
+            }
+            break;
+        case CopyAction::Done:
+            pacedWaitUs += now;
+            return !copy.IsFailed();
+        }
+        copy.Complete(ok, now);
+    }
+}
+
+// ============================================================
+// Settings store (in memory)
+// ============================================================
+
+bool SimPlatform::ReadDword(const wchar_t* path, const wchar_t* name, DWORD& value) {
+    auto key = m_dwords.find(path);
+    if (key == m_dwords.end()) return false;
+    auto it = key->second.find(name);
+    if (it == key->second.end()) return false;
+    value = it->second;
+    return true;
+}
+
+void SimPlatform::WriteDword(const wchar_t* path, const wchar_t* name, DWORD value) {
+    m_dwords[path][name] = value;
+}
+
+bool SimPlatform::ReadString(const wchar_t* path, const wchar_t* name, std::wstring& value) {
+    auto key = m_strings.find(path);
+    if (key == m_strings.end()) return false;
+    auto it = key->second.find(name);
+    if (it == key->second.end()) return false;
+    value = it->second;
+    return true;
+}
+
+void SimPlatform::WriteString(const wchar_t* path, const wchar_t* name, const std::wstring& value) {
+    m_strings[path][name] = value;
+}
+
+void SimPlatform::DeleteValue(const wchar_t* path, const wchar_t* name) {
+    auto dwords = m_dwords.find(path);
+    if (dwords != m_dwords.end()) dwords->second.erase(name);
+    auto strings = m_strings.find(path);
+    if (strings != m_strings.end()) strings->second.erase(name);
+}
+
+void SimPlatform::EnumDwords(const wchar_t* path, const std::function<void(const wchar_t*, DWORD)>& visit) {
+    auto key = m_dwords.find(path);
+    if (key == m_dwords.end()) return;
+    for (const auto& value : key->second) {
+        visit(value.first.c_str(), value.second);
+    }
+}
@@ -0,0 +1,195 @@
+// ViKey - Simulated Platform Backend
+// platform_sim.h
+// Headless Platform: scripted windows with virtual text fields and an
+// in-memory settings store, so the full hook → engine → TextSender pipeline
+// runs (and can be timed) without Windows.
+
+#pragma once
+
+#include "platform.h"
+#include "injection_encoder.h"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Virtual text field: applies injected backspaces and text like an edit control
+struct SimTextField {
+    std::wstring text;
+    size_t selected = 0;  // The last `selected` units are selected: the next edit replaces them
+
+    std::wstring Selection() const { return text.substr(text.length() - std::min(selected, text.length())); }
+
+    void Apply(const wchar_t* insert, size_t length, int backspaces);
+
+    // Replay encoded key events: a backspace key-down erases one character
+    // (the word before it if ctrl is down), KEYEVENTF_UNICODE key-downs type
+    // their UTF-16 unit (pairs are joined)
+    void ApplyEvents(const KeyEventRecord* events, size_t count, bool ctrl = false);
+
+    // Ctrl+Backspace: erase the selection, or the spaces and the word before the caret
+    void EraseWord();
+
+private:
+    // Erase the selection, if any; true if there was one
+    bool ReplaceSelection();
+
+    uint16_t m_highSurrogate = 0;  // First half of a pair still being typed
+};
+
+class SimPlatform : public Platform {
+public:
+    // corePath: Rust core shared library (default: libvikey_core.so next to the executable)
+    explicit SimPlatform(const std::string& corePath = std::string());
+    ~SimPlatform() override = default;
+
+    // Scripted desktop: windows are created with their executable name,
+    // window class and install directory (windows of the same app share one
+    // process id)
+    HWND AddWindow(const std::wstring& appName, const std::wstring& windowClass = L"SimWindow",
+                   const std::wstring& directory = L"c:\\program files\\sim\\");
+    void SetForeground(HWND window);
+    SimTextField& Field(HWND window);
+    SimTextField& FocusedField() { return Field(m_foreground); }
+
+    // Hardware keyboard. PressKey delivers a key-down through the hook and,
+    // unless blocked, types the key into the focused field. Returns true if
+    // blocked. Modifiers other than Shift are held with HoldKey() (through
+    // the hook) or SetKeyDown() (already down, as the app sees it).
+    bool PressKey(int vkCode, bool shift = false);
+    void TypeText(const char* ascii);  // US layout, '\n' = Enter, '\b' = Backspace
+    void SetKeyDown(int vkCode, bool down);
+    bool HoldKey(int vkCode);     // Key-down through the hook; true if blocked
+    bool ReleaseKey(int vkCode);  // Key-up through the hook; true if blocked
+    void SetCapsLock(bool on) { m_capsLock = on; }
+
+    // Run the injections TextSender has queued. The sim leaves the output
+    // thread stopped, so they stay pending (and the hook holds pass-through
+    // keys behind them) until this is called.
+    void PumpMessages();
+
+    // Clipboard content as seen by other apps (restored after each paste
+    // and selection copy): the text, and any other formats (rich text,
+    // images) by format id. Ctrl+C copies the focused field's selection.
+    std::wstring clipboard;
+    std::map<unsigned, std::string> clipboardFormats;
+    // The next clipboardBusy clipboard opens fail (another app holds it)
+    unsigned clipboardBusy = 0;
+
+    // Time each injection takes (emulates a slow target app; 0 = instant)
+    unsigned injectDelayUs = 0;
+
+    // Slow consumer (a terminal): the focused app needs consumerKeyUs per
+    // paced or pasted key and drops keys that arrive while consumerBuffer
+    // keys are still waiting. Paced and clipboard injection wait on a
+    // virtual clock instead of sleeping; fast injection is never dropped.
+    unsigned consumerKeyUs = 0;
+    unsigned consumerBuffer = 64;
+
+    // Time each process name lookup takes (emulates a stalled OpenProcess)
+    unsigned appQueryDelayUs = 0;
+
+    // Time each key-state query takes (emulates a machine under load)
+    unsigned keyStateDelayUs = 0;
+
+    // Process lookups made through GetProcessImagePath()
+    uint64_t appQueries = 0;
+
+    // Added to TimestampNs(): scripts can jump the clock forward
+    uint64_t clockOffsetNs = 0;
+
+    // Lines written through LogEvent()
+    std::vector<std::wstring> log;
+
+    // Injection counters
+    uint64_t injections = 0;      // Inject*/PasteText calls (each a visible update)
+    uint64_t injectedEvents = 0;  // key down/up events sent
+    uint64_t pastes = 0;          // clipboard pastes executed
+    uint64_t copies = 0;          // selection copies (Ctrl+C) executed
+    uint64_t clipboardRetries = 0;  // clipboard opens that found it busy
+    uint64_t droppedKeys = 0;     // paced/pasted keys the slow consumer lost
+    uint64_t pacedWaitUs = 0;     // virtual time paced/clipboard injection blocked
+
+    // US layout mapping used by TypeText and pass-through keys
+    static bool VkFromAscii(char c, int& vkCode, bool& shift);
+    static wchar_t CharFromVk(int vkCode, bool shift, bool capsLock);
+
+    HMODULE LoadCoreLibrary() override;
+    void* GetCoreProc(HMODULE module, const char* name) override;
+    void FreeCoreLibrary(HMODULE module) override;
+    void ShowError(const wchar_t* title, const wchar_t* message) override;
+
+    uint64_t TimestampNs() override;
+    void LogEvent(const wchar_t* message) override { log.push_back(message); }
+
+    bool InstallKeyboardHook() override;
+    void RemoveKeyboardHook() override;
+    bool IsKeyDown(int vkCode) override;
+    bool IsCapsLockOn() override { return m_capsLock; }
+
+    HWND GetForegroundWindow() override { return m_foreground; }
+    std::wstring GetWindowClassName(HWND window) override;
+    DWORD GetWindowProcessId(HWND window) override;
+    std::wstring GetProcessImagePath(DWORD processId) override;
+    bool InstallForegroundHook() override;
+    void RemoveForegroundHook() override;
+
+    void InjectText(const wchar_t* text, size_t length, int backspaces) override;
+    InjectionFeedback InjectTextPaced(const wchar_t* text, size_t length, int backspaces,
+                                      const InjectionPacing& pacing) override;
+    void InjectKey(int vkCode, bool shift, bool ctrl, bool alt) override;
+    InjectionFeedback PasteText(const std::wstring& text, int backspaces, const InjectionPacing& pacing) override;
+    bool CopySelection(std::wstring& text) override;
+
+    bool ReadDword(const wchar_t* path, const wchar_t* name, DWORD& value) override;
+    void WriteDword(const wchar_t* path, const wchar_t* name, DWORD value) override;
+    bool ReadString(const wchar_t* path, const wchar_t* name, std::wstring& value) override;
+    void WriteString(const wchar_t* path, const wchar_t* name, const std::wstring& value) override;
+    void DeleteValue(const wchar_t* path, const wchar_t* name) override;
+    void EnumDwords(const wchar_t* path, const std::function<void(const wchar_t*, DWORD)>& visit) override;
+
+private:
+    // Mirrors Win32Platform::ModifierGuard: modifiers the app sees down are
+    // released for an injection, and down again after it if still held
+    class ModifierGuard {
+    public:
+        ModifierGuard(SimPlatform& platform, uint8_t keep = 0);
+        ~ModifierGuard();
+
+    private:
+        SimPlatform& m_platform;
+        uint8_t m_released = 0;  // MODIFIER_* bits
+    };
+
+    struct SimWindow {
+        std::wstring path;  // Lowercase image path
+        std::wstring windowClass;
+        DWORD processId;
+        SimTextField field;
+    };
+
+    // Key reached the focused application (not blocked by the hook). Of the
+    // Ctrl and Alt combinations only Ctrl+V (pastes the clipboard text) and
+    // Ctrl+Backspace (erases a word) do something.
+    void DeliverKey(int vkCode, bool shift, bool ctrl, bool alt);
+    void Delay() const;
+
+    // Another app holding the clipboard makes an open fail (clipboardBusy)
+    bool OpenClipboard();
+
+    std::string m_corePath;
+    bool m_hookInstalled = false;
+    bool m_foregroundHookInstalled = false;
+    bool m_capsLock = false;
+    bool m_keysDown[256] = {};  // As the application sees them
+    bool m_keysHeld[256] = {};  // Physically held (blocked key-downs included)
+    HWND m_foreground = nullptr;
+    std::deque<SimWindow> m_windows;  // HWND = index + 1 (stable addresses)
+    SimTextField m_desktop;           // Receives input when no window is focused
+    std::map<std::wstring, DWORD> m_processes;  // Image path → process id
+    DWORD m_nextProcessId = 1000;
+    std::map<std::wstring, std::map<std::wstring, DWORD>> m_dwords;
+    std::map<std::wstring, std::map<std::wstring, std::wstring>> m_strings;
+};
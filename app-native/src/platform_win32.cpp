@@ -0,0 +1,837 @@
+// ViKey - Win32 Platform Backend Implementation
+// platform_win32.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "platform_win32.h"
+#include "keyboard_hook.h"
+#include "keycodes.h"
+#include "foreground_tracker.h"
+#include "injection_encoder.h"
+#include "clipboard_paste.h"
+#include "selection_convert.h"
+#include <psapi.h>
+#include <algorithm>
+#include <cwchar>
+#include <vector>
+
+#pragma comment(lib, "psapi.lib")
+
+// Win32 Constants
+// WH_KEYBOARD_LL is defined in Windows.h as 13
+#ifndef WH_KEYBOARD_LL
+#define WH_KEYBOARD_LL 13
+#endif
+constexpr int WM_KEYDOWN_MSG = 0x0100;
+constexpr int WM_KEYUP_MSG = 0x0101;
+constexpr int WM_SYSKEYDOWN_MSG = 0x0104;
+constexpr int WM_SYSKEYUP_MSG = 0x0105;
+constexpr DWORD KEYEVENTF_EXTENDEDKEY_FLAG = 0x0001;
+constexpr DWORD KEYEVENTF_KEYUP_FLAG = 0x0002;
+
+using namespace KeyCodes;
+
+Win32Platform& Win32Platform::Instance() {
+    static Win32Platform instance;
+    return instance;
+}
+
+// ============================================================
+// Rust core library
+// ============================================================
+
+HMODULE Win32Platform::LoadCoreLibrary() {
+    // Load the Rust core DLL using full path (prevent DLL hijacking)
+    wchar_t path[MAX_PATH];
+    GetModuleFileNameW(nullptr, path, MAX_PATH);
+    wchar_t* lastSlash = wcsrchr(path, L'\\');
+    if (!lastSlash) return nullptr;
+    wcscpy_s(lastSlash + 1, MAX_PATH - (lastSlash + 1 - path), L"core.dll");
+    return LoadLibraryW(path);
+}
+
+void* Win32Platform::GetCoreProc(HMODULE module, const char* name) {
+    return reinterpret_cast<void*>(GetProcAddress(module, name));
+}
+
+void Win32Platform::FreeCoreLibrary(HMODULE module) {
+    FreeLibrary(module);
+}
+
+void Win32Platform::ShowError(const wchar_t* title, const wchar_t* message) {
+    MessageBoxW(nullptr, message, title, MB_ICONERROR);
+}
+
+uint64_t Win32Platform::TimestampNs() {
+    static const uint64_t frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return static_cast<uint64_t>(f.QuadPart);
+    }();
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    uint64_t ticks = static_cast<uint64_t>(counter.QuadPart);
+    // Split to avoid overflowing ticks * 1e9
+    return (ticks / frequency) * 1000000000ULL + (ticks % frequency) * 1000000000ULL / frequency;
+}
+
+void Win32Platform::LogEvent(const wchar_t* message) {
+    std::wstring line = L"[ViKey] ";
+    line += message;
+    line += L"\n";
+    OutputDebugStringW(line.c_str());
+}
+
+// ============================================================
+// Keyboard hook
+// ============================================================
+
+// Use __declspec(noinline) to prevent optimization that might affect the callback
+__declspec(noinline) LRESULT CALLBACK Win32Platform::LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    if (nCode >= 0) {
+        auto* hookStruct = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
+        int vkCode = static_cast<int>(hookStruct->vkCode);
+        bool keyDown = wParam == WM_KEYDOWN_MSG || wParam == WM_SYSKEYDOWN_MSG;
+        Win32Platform& platform = Instance();
+
+        // Our own injections reaching the hook: pacing feedback (WaitConsumed).
+        // Modifiers a ModifierGuard releases and presses again are not counted.
+        if (hookStruct->dwExtraInfo == INJECTED_KEY_MARKER) {
+            if (ModifierBit(vkCode) == 0) {
+                platform.m_injectedSeenNs.store(platform.TimestampNs(), std::memory_order_relaxed);
+                platform.m_injectedSeen.fetch_add(1, std::memory_order_release);
+            }
+        } else if (vkCode >= VK_LSHIFT_KEY && vkCode <= VK_RMENU_KEY) {
+            uint8_t bit = static_cast<uint8_t>(1u << (vkCode - VK_LSHIFT_KEY));
+            if (keyDown) {
+                platform.m_physicalModifiers.fetch_or(bit, std::memory_order_relaxed);
+            } else {
+                platform.m_physicalModifiers.fetch_and(static_cast<uint8_t>(~bit), std::memory_order_relaxed);
+            }
+        }
+
+        // Key-ups only matter for modifiers KeyboardHook holds back
+        KeyboardHook& hook = KeyboardHook::Instance();
+        if (keyDown ? hook.OnKeyDown(vkCode, hookStruct->dwExtraInfo)
+                    : (wParam == WM_KEYUP_MSG || wParam == WM_SYSKEYUP_MSG) &&
+                      hook.OnKeyUp(vkCode, hookStruct->dwExtraInfo)) {
+            return 1;  // Block original key
+        }
+    }
+    return CallNextHookEx(Instance().m_hookId, nCode, wParam, lParam);
+}
+
+bool Win32Platform::InstallKeyboardHook() {
+    if (m_hookId != nullptr) return true;
+
+    SetLastError(0);
+
+    // For WH_KEYBOARD_LL, use user32.dll module handle (already loaded in GUI apps — no refcount leak)
+    HMODULE hMod = GetModuleHandleW(L"user32.dll");
+
+    m_hookId = SetWindowsHookExW(
+        WH_KEYBOARD_LL,
+        LowLevelKeyboardProc,
+        hMod,
+        0
+    );
+    return m_hookId != nullptr;
+}
+
+void Win32Platform::RemoveKeyboardHook() {
+    if (m_hookId != nullptr) {
+        UnhookWindowsHookEx(m_hookId);
+        m_hookId = nullptr;
+    }
+}
+
+bool Win32Platform::IsKeyDown(int vkCode) {
+    return (GetAsyncKeyState(vkCode) & 0x8000) != 0;
+}
+
+bool Win32Platform::IsCapsLockOn() {
+    return (GetKeyState(VK_CAPITAL) & 0x0001) != 0;
+}
+
+// ============================================================
+// Foreground app
+// ============================================================
+
+HWND Win32Platform::GetForegroundWindow() {
+    return ::GetForegroundWindow();
+}
+
+std::wstring Win32Platform::GetWindowClassName(HWND window) {
+    wchar_t className[256] = {};
+    int length = window ? GetClassNameW(window, className, 256) : 0;
+    return std::wstring(className, length > 0 ? static_cast<size_t>(length) : 0);
+}
+
+DWORD Win32Platform::GetWindowProcessId(HWND window) {
+    DWORD processId = 0;
+    if (window) {
+        GetWindowThreadProcessId(window, &processId);
+    }
+    return processId;
+}
+
+std::wstring Win32Platform::GetProcessImagePath(DWORD processId) {
+    if (processId == 0) return L"";
+
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!hProcess) return L"";
+
+    wchar_t exePath[MAX_PATH] = {};
+    DWORD size = MAX_PATH;
+    std::wstring path;
+
+    if (QueryFullProcessImageNameW(hProcess, 0, exePath, &size)) {
+        // Lowercase for consistency (rules and app names compare exactly)
+        path.assign(exePath, size);
+        std::transform(path.begin(), path.end(), path.begin(), ::towlower);
+    }
+
+    CloseHandle(hProcess);
+    return path;
+}
+
+void CALLBACK Win32Platform::ForegroundEventProc(HWINEVENTHOOK, DWORD event, HWND window,
+                                                 LONG idObject, LONG, DWORD, DWORD) {
+    if (event == EVENT_SYSTEM_FOREGROUND && idObject == OBJID_WINDOW && window) {
+        ForegroundTracker::Instance().OnForegroundChanged(window);
+    }
+}
+
+bool Win32Platform::InstallForegroundHook() {
+    if (m_foregroundHook != nullptr) return true;
+
+    // Out-of-context: events are posted to this (UI) thread's message loop,
+    // no DLL injection into other processes
+    m_foregroundHook = SetWinEventHook(
+        EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND,
+        nullptr,
+        ForegroundEventProc,
+        0, 0,
+        WINEVENT_OUTOFCONTEXT
+    );
+    return m_foregroundHook != nullptr;
+}
+
+void Win32Platform::RemoveForegroundHook() {
+    if (m_foregroundHook != nullptr) {
+        UnhookWinEvent(m_foregroundHook);
+        m_foregroundHook = nullptr;
+    }
+}
+
+// ============================================================
+// Text injection
+// ============================================================
+
+// INPUT for the injection encoder
+struct Win32InputTraits {
+    using Event = INPUT;
+    static INPUT Make(uint16_t vk, uint16_t scan, uint32_t flags, uintptr_t extraInfo) {
+        INPUT input = {};
+        input.type = INPUT_KEYBOARD;
+        input.ki.wVk = vk;
+        input.ki.wScan = scan;
+        input.ki.dwFlags = flags;
+        input.ki.dwExtraInfo = extraInfo;
+        return input;
+    }
+    static void SetScan(INPUT& input, uint16_t scan) { input.ki.wScan = scan; }
+};
+
+// One encoder per injecting thread (the output worker; the caller when it
+// injects inline): its arena is reused across keystrokes
+static InjectionEncoder<Win32InputTraits>& Encoder() {
+    thread_local InjectionEncoder<Win32InputTraits> encoder(INJECTED_KEY_MARKER);
+    return encoder;
+}
+
+// False if SendInput refused some of the events (UIPI, a full input queue)
+static bool SendEvents(const INPUT* inputs, size_t count) {
+    if (count == 0) return true;
+    return SendInput(static_cast<UINT>(count), const_cast<INPUT*>(inputs), sizeof(INPUT)) == count;
+}
+
+void Win32Platform::SendCounted(const INPUT* inputs, size_t count, InjectionFeedback& feedback) {
+    UINT sent = SendInput(static_cast<UINT>(count), const_cast<INPUT*>(inputs), sizeof(INPUT));
+    feedback.events += static_cast<uint32_t>(count);
+    if (sent < count) feedback.dropped = true;  // Blocked (UIPI) or the input queue is full
+}
+
+// Injected modifier key, right Ctrl and Alt being extended keys
+static INPUT ModifierInput(int vk, DWORD flags) {
+    if (vk == VK_RCONTROL_KEY || vk == VK_RMENU_KEY) flags |= KEYEVENTF_EXTENDEDKEY_FLAG;
+    return Win32InputTraits::Make(static_cast<uint16_t>(vk), 0, flags, INJECTED_KEY_MARKER);
+}
+
+Win32Platform::ModifierGuard::ModifierGuard(uint8_t keep) {
+    INPUT inputs[VK_RMENU_KEY - VK_LSHIFT_KEY + 1];
+    size_t count = 0;
+    for (int vk = VK_LSHIFT_KEY; vk <= VK_RMENU_KEY; vk++) {
+        if ((ModifierBit(vk) & keep) || !(GetAsyncKeyState(vk) & 0x8000)) continue;
+        inputs[count++] = ModifierInput(vk, KEYEVENTF_KEYUP_FLAG);
+        m_released |= static_cast<uint8_t>(1u << (vk - VK_LSHIFT_KEY));
+    }
+    SendEvents(inputs, count);
+}
+
+Win32Platform::ModifierGuard::~ModifierGuard() {
+    // Released meanwhile: the app already saw it go up
+    uint8_t held = m_released & Instance().m_physicalModifiers.load(std::memory_order_relaxed);
+    INPUT inputs[VK_RMENU_KEY - VK_LSHIFT_KEY + 1];
+    size_t count = 0;
+    for (int vk = VK_LSHIFT_KEY; vk <= VK_RMENU_KEY; vk++) {
+        if (held & (1u << (vk - VK_LSHIFT_KEY))) inputs[count++] = ModifierInput(vk, 0);
+    }
+    SendEvents(inputs, count);
+}
+
+// Sleep() rounds up to the timer tick: sleep the whole milliseconds but one,
+// then yield until the deadline
+static void PaceWait(uint32_t delayUs) {
+    if (delayUs == 0) return;
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    LONGLONG deadline = now.QuadPart + frequency.QuadPart * delayUs / 1000000;
+    if (delayUs >= 2000) Sleep(delayUs / 1000 - 1);
+    for (;;) {
+        QueryPerformanceCounter(&now);
+        if (now.QuadPart >= deadline) break;
+        SwitchToThread();
+    }
+}
+
+void Win32Platform::WaitConsumed(HWND target, uint64_t seenBefore, uint64_t lastSendNs, InjectionFeedback& feedback) {
+    // An app that takes longer than this has lost the events as far as pacing goes
+    constexpr uint64_t CONSUME_TIMEOUT_NS = 500000000ULL;  // 500 ms
+    constexpr UINT CONSUME_TIMEOUT_MS = 500;
+
+    uint64_t drainedAt = lastSendNs;
+    if (m_hookId != nullptr) {
+        uint64_t expected = seenBefore + feedback.events;
+        while (m_injectedSeen.load(std::memory_order_acquire) < expected) {
+            if (TimestampNs() - lastSendNs > CONSUME_TIMEOUT_NS) {
+                feedback.dropped = true;
+                feedback.consumeUs = static_cast<uint32_t>(CONSUME_TIMEOUT_NS / 1000);
+                return;
+            }
+            Sleep(1);
+        }
+        drainedAt = std::max(drainedAt, m_injectedSeenNs.load(std::memory_order_relaxed));
+    }
+
+    // The target's thread answers a sent message once it is done with the
+    // message it is handling (possibly one of ours)
+    uint64_t roundTrip = 0;
+    if (target != nullptr) {
+        uint64_t start = TimestampNs();
+        DWORD_PTR result = 0;
+        if (!SendMessageTimeoutW(target, WM_NULL, 0, 0, SMTO_ABORTIFHUNG, CONSUME_TIMEOUT_MS, &result)) {
+            feedback.dropped = true;
+        }
+        roundTrip = TimestampNs() - start;
+    }
+    feedback.consumeUs = static_cast<uint32_t>(std::min<uint64_t>(UINT32_MAX, (drainedAt - lastSendNs + roundTrip) / 1000));
+}
+
+void Win32Platform::InjectText(const wchar_t* text, size_t length, int backspaces) {
+    // Combine backspaces + Unicode chars into a SINGLE SendInput call.
+    // This is atomic: no gaps between events, preventing race conditions
+    // where the hook callback re-enters during Sleep() pauses.
+    ModifierGuard guard;
+    size_t count = 0;
+    const INPUT* inputs = Encoder().Encode(text, length, backspaces, count);
+    SendEvents(inputs, count);
+}
+
+InjectionFeedback Win32Platform::InjectTextPaced(const wchar_t* text, size_t length, int backspaces,
+                                                  const InjectionPacing& pacing) {
+    InjectionFeedback feedback;
+    ModifierGuard guard;
+    HWND target = ::GetForegroundWindow();
+    uint64_t seenBefore = m_injectedSeen.load(std::memory_order_acquire);
+
+    // Backspaces: key down and key up each followed by the delay
+    if (backspaces > 0) {
+        size_t count = 0;
+        const INPUT* inputs = Encoder().Encode(nullptr, 0, 1, count);
+        for (int i = 0; i < backspaces; i++) {
+            SendCounted(inputs, 1, feedback);
+            PaceWait(pacing.eventDelayUs);
+            SendCounted(inputs + 1, 1, feedback);
+            PaceWait(pacing.eventDelayUs);
+        }
+
+        // Longer delay between backspaces and text
+        PaceWait(pacing.settleDelayUs);
+    }
+
+    // One SendInput per character; a surrogate pair goes out as one batch
+    size_t i = 0;
+    while (i < length) {
+        size_t units = WideCharLength(text + i, length - i);
+        size_t count = 0;
+        const INPUT* inputs = Encoder().Encode(text + i, units, 0, count);
+        SendCounted(inputs, count, feedback);
+        PaceWait(pacing.eventDelayUs);
+        i += units;
+    }
+
+    WaitConsumed(target, seenBefore, TimestampNs(), feedback);
+    return feedback;
+}
+
+void Win32Platform::InjectKey(int vkCode, bool shift, bool ctrl, bool alt) {
+    // The key may be replayed after the user released its modifiers: press
+    // them again (a held Ctrl+V must still paste). Modifiers pressed since
+    // it was captured are not part of it.
+    uint8_t keep = (shift ? MODIFIER_SHIFT : 0) | (ctrl ? MODIFIER_CTRL : 0) | (alt ? MODIFIER_ALT : 0);
+    ModifierGuard guard(keep);
+    bool addShift = shift && !IsKeyDown(VK_SHIFT);
+    bool addCtrl = ctrl && !IsKeyDown(VK_CONTROL);
+    bool addAlt = alt && !IsKeyDown(VK_MENU);
+
+    INPUT inputs[8] = {};
+    UINT count = 0;
+    auto add = [&](int vk, DWORD flags) {
+        INPUT& input = inputs[count++];
+        input.type = INPUT_KEYBOARD;
+        input.ki.wVk = static_cast<WORD>(vk);
+        input.ki.dwFlags = flags;
+        input.ki.dwExtraInfo = INJECTED_KEY_MARKER;
+    };
+    if (addCtrl) add(VK_CONTROL, 0);
+    if (addAlt) add(VK_MENU, 0);
+    if (addShift) add(VK_SHIFT, 0);
+    add(vkCode, 0);
+    add(vkCode, KEYEVENTF_KEYUP_FLAG);
+    if (addShift) add(VK_SHIFT, KEYEVENTF_KEYUP_FLAG);
+    if (addAlt) add(VK_MENU, KEYEVENTF_KEYUP_FLAG);
+    if (addCtrl) add(VK_CONTROL, KEYEVENTF_KEYUP_FLAG);
+    SendInput(count, inputs, sizeof(INPUT));
+}
+
+// ============================================================
+// Clipboard paste
+// ============================================================
+
+// The user's clipboard formats whose data is plain global memory, copied
+// before we replace it. Restore() hands the copies back as they are (no
+// second copy). Dropped, and so gone after a paste: GDI handles (bitmaps,
+// palettes, metafiles including EMF), owner-display and private formats,
+// text the system synthesizes again from CF_UNICODETEXT, and any format
+// over MAX_FORMAT_BYTES (a huge image costs more to copy than it is worth).
+class ClipboardSnapshot {
+public:
+    ClipboardSnapshot() = default;
+    ClipboardSnapshot(const ClipboardSnapshot&) = delete;
+    ClipboardSnapshot& operator=(const ClipboardSnapshot&) = delete;
+    ~ClipboardSnapshot() { Clear(); }
+
+    // Clipboard open
+    void Capture() {
+        Clear();
+        bool hasUnicode = IsClipboardFormatAvailable(CF_UNICODETEXT) != FALSE;
+        for (UINT format = EnumClipboardFormats(0); format != 0; format = EnumClipboardFormats(format)) {
+            // Filter by id first: GetClipboardData makes a delay-rendering owner render
+            if (!IsGlobalMemory(format, hasUnicode)) continue;
+            HANDLE data = GetClipboardData(format);
+            if (!data) continue;  // Delay-rendered by an owner that failed to render it
+            HANDLE copy = CopyGlobal(data);
+            if (copy) m_items.push_back({format, copy});
+        }
+    }
+
+    // Clipboard open and emptied: the copies now belong to the clipboard
+    void Restore() {
+        for (const Item& item : m_items) {
+            if (!SetClipboardData(item.format, item.data)) GlobalFree(item.data);
+        }
+        m_items.clear();
+    }
+
+    void Clear() {
+        for (const Item& item : m_items) GlobalFree(item.data);
+        m_items.clear();
+    }
+
+private:
+    struct Item {
+        UINT format;
+        HGLOBAL data;
+    };
+
+    static constexpr SIZE_T MAX_FORMAT_BYTES = 16 * 1024 * 1024;
+
+    // Formats documented as HGLOBAL; registered formats (RTF, HTML, file
+    // lists from the shell...) are global memory by convention
+    static bool IsGlobalMemory(UINT format, bool hasUnicode) {
+        switch (format) {
+        case CF_TEXT:
+        case CF_OEMTEXT:
+            return !hasUnicode;
+        case CF_UNICODETEXT:
+        case CF_SYLK:
+        case CF_DIF:
+        case CF_TIFF:
+        case CF_DIB:
+        case CF_DIBV5:
+        case CF_PENDATA:
+        case CF_RIFF:
+        case CF_WAVE:
+        case CF_HDROP:
+        case CF_LOCALE:
+            return true;
+        default:
+            return format >= 0xC000 && format <= 0xFFFF;
+        }
+    }
+
+    static HGLOBAL CopyGlobal(HANDLE data) {
+        SIZE_T size = GlobalSize(data);
+        if (size == 0 || size > MAX_FORMAT_BYTES) return nullptr;  // Not global memory, or too big
+        const void* source = GlobalLock(data);
+        if (!source) return nullptr;
+        HGLOBAL copy = GlobalAlloc(GMEM_MOVEABLE, size);
+        void* target = copy ? GlobalLock(copy) : nullptr;
+        if (target) {
+            memcpy(target, source, size);
+            GlobalUnlock(copy);
+        } else if (copy) {
+            GlobalFree(copy);
+            copy = nullptr;
+        }
+        GlobalUnlock(data);
+        return copy;
+    }
+
+    std::vector<Item> m_items;
+};
+
+// Message-only window owning the clipboard while a paste is in flight. Our
+// text is delay-rendered: the first read after Ctrl+V tells us the target
+// has it, so the user's clipboard goes back without guessing a delay.
+struct PasteOwner {
+    HWND window = nullptr;
+    const std::wstring* text = nullptr;  // Text of the paste in flight
+    uint64_t renderedNs = 0;             // Set when it was read
+};
+
+// One owner per pasting thread (the output worker, the selection worker)
+static PasteOwner& Owner() {
+    thread_local PasteOwner owner;
+    return owner;
+}
+
+static HGLOBAL CopyText(const std::wstring& text) {
+    size_t size = (text.length() + 1) * sizeof(wchar_t);
+    HGLOBAL data = GlobalAlloc(GMEM_MOVEABLE, size);
+    if (!data) return nullptr;
+    wchar_t* target = static_cast<wchar_t*>(GlobalLock(data));
+    if (!target) {
+        GlobalFree(data);
+        return nullptr;
+    }
+    wcscpy_s(target, text.length() + 1, text.c_str());
+    GlobalUnlock(data);
+    return data;
+}
+
+static void RenderText(PasteOwner& owner) {
+    HGLOBAL data = CopyText(*owner.text);
+    if (data && !SetClipboardData(CF_UNICODETEXT, data)) GlobalFree(data);
+    owner.renderedNs = Win32Platform::Instance().TimestampNs();
+}
+
+static LRESULT CALLBACK PasteOwnerProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam) {
+    PasteOwner& owner = Owner();
+    switch (message) {
+    case WM_RENDERFORMAT:
+        // The reader holds the clipboard open
+        if (wParam == CF_UNICODETEXT && owner.text) RenderText(owner);
+        return 0;
+    case WM_RENDERALLFORMATS:
+        // Going away with our text still unrendered
+        if (owner.text && OpenClipboard(window)) {
+            if (GetClipboardOwner() == window) RenderText(owner);
+            CloseClipboard();
+        }
+        return 0;
+    default:
+        return DefWindowProcW(window, message, wParam, lParam);
+    }
+}
+
+static HWND OwnerWindow() {
+    PasteOwner& owner = Owner();
+    if (!owner.window) {
+        WNDCLASSEXW wc = {};
+        wc.cbSize = sizeof(wc);
+        wc.lpfnWndProc = PasteOwnerProc;
+        wc.hInstance = GetModuleHandleW(nullptr);
+        wc.lpszClassName = L"ViKeyPasteOwner";
+        RegisterClassExW(&wc);  // Fails harmlessly once registered
+        owner.window = CreateWindowExW(0, wc.lpszClassName, L"", 0, 0, 0, 0, 0,
+                                       HWND_MESSAGE, nullptr, wc.hInstance, nullptr);
+    }
+    return owner.window;
+}
+
+// Handle window messages (the clipboard asking us to render) until wakeUs
+// or until our text has been read
+static void PumpUntil(uint64_t wakeUs, const PasteOwner& owner) {
+    for (;;) {
+        MSG msg;
+        while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
+            DispatchMessageW(&msg);
+        }
+        uint64_t now = Win32Platform::Instance().TimestampNs() / 1000;
+        if (owner.renderedNs != 0 || now >= wakeUs) return;
+        if (wakeUs - now < 2000) {
+            // Below the timer tick: a message wait would overshoot
+            PaceWait(static_cast<uint32_t>(wakeUs - now));
+            return;
+        }
+        DWORD timeoutMs = static_cast<DWORD>((wakeUs - now) / 1000);
+        MsgWaitForMultipleObjectsEx(0, nullptr, timeoutMs, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    }
+}
+
+InjectionFeedback Win32Platform::PasteText(const std::wstring& text, int backspaces, const InjectionPacing& pacing) {
+    const INPUT ctrlV[4] = {
+        Win32InputTraits::Make(VK_CONTROL, 0x1D, 0, INJECTED_KEY_MARKER),
+        Win32InputTraits::Make('V', 0x2F, 0, INJECTED_KEY_MARKER),
+        Win32InputTraits::Make('V', 0x2F, KEYEVENTF_KEYUP_FLAG, INJECTED_KEY_MARKER),
+        Win32InputTraits::Make(VK_CONTROL, 0x1D, KEYEVENTF_KEYUP_FLAG, INJECTED_KEY_MARKER),
+    };
+
+    ModifierGuard guard;  // A held Shift or Ctrl would change the backspaces and Ctrl+V
+    PasteOwner& owner = Owner();
+    HWND window = OwnerWindow();
+    owner.text = &text;
+    owner.renderedNs = 0;
+    ClipboardSnapshot snapshot;
+    ClipboardPaste paste(backspaces, !text.empty(), pacing, TimestampNs() / 1000);
+
+    for (;;) {
+        if (owner.renderedNs != 0) {
+            paste.Rendered(owner.renderedNs / 1000);
+            owner.renderedNs = 0;
+        }
+
+        bool ok = true;
+        switch (paste.Next(TimestampNs() / 1000)) {
+        case PasteAction::Wait:
+            PumpUntil(paste.WakeUs(), owner);
+            continue;
+        case PasteAction::SendBackspaces: {
+            size_t count = 0;
+            const INPUT* inputs = Encoder().Encode(nullptr, 0, backspaces, count);
+            ok = SendEvents(inputs, count);
+            break;
+        }
+        case PasteAction::SaveClipboard:
+            ok = OpenClipboard(window) != FALSE;
+            if (ok) {
+                snapshot.Capture();
+                CloseClipboard();
+            }
+            break;
+        case PasteAction::OfferText:
+            ok = OpenClipboard(window) != FALSE;
+            if (ok) {
+                EmptyClipboard();
+                if (window) {
+                    SetClipboardData(CF_UNICODETEXT, nullptr);  // Rendered on first read
+                } else {
+                    RenderText(owner);  // No owner window: offered up front, read unsignaled
+                }
+                CloseClipboard();
+            }
+            break;
+        case PasteAction::PasteKeysDown:
+            ok = SendEvents(ctrlV, 2);
+            break;
+        case PasteAction::PasteKeysUp:
+            ok = SendEvents(ctrlV + 2, 2);
+            break;
+        case PasteAction::RestoreClipboard:
+            // An empty snapshot still clears our text: it won't be pasted again by accident
+            ok = OpenClipboard(window) != FALSE;
+            if (ok) {
+                EmptyClipboard();
+                snapshot.Restore();
+                CloseClipboard();
+            }
+            break;
+        case PasteAction::TypeText:
+            snapshot.Clear();
+            InjectText(text.c_str(), text.length(), 0);
+            break;
+        case PasteAction::Done:
+            owner.text = nullptr;
+            return paste.Feedback();
+        }
+        paste.Complete(ok, TimestampNs() / 1000);
+    }
+}
+
+// ============================================================
+// Selection copy
+// ============================================================
+
+// Clipboard open: the copied text (none if the selection was not text)
+static bool ReadText(std::wstring& text) {
+    text.clear();
+    HANDLE data = GetClipboardData(CF_UNICODETEXT);
+    if (!data) return true;
+    const wchar_t* source = static_cast<const wchar_t*>(GlobalLock(data));
+    if (!source) return false;
+    text.assign(source, wcsnlen(source, GlobalSize(data) / sizeof(wchar_t)));
+    GlobalUnlock(data);
+    return true;
+}
+
+bool Win32Platform::CopySelection(std::wstring& text) {
+    const INPUT ctrlC[4] = {
+        Win32InputTraits::Make(VK_CONTROL, 0x1D, 0, INJECTED_KEY_MARKER),
+        Win32InputTraits::Make('C', 0x2E, 0, INJECTED_KEY_MARKER),
+        Win32InputTraits::Make('C', 0x2E, KEYEVENTF_KEYUP_FLAG, INJECTED_KEY_MARKER),
+        Win32InputTraits::Make(VK_CONTROL, 0x1D, KEYEVENTF_KEYUP_FLAG, INJECTED_KEY_MARKER),
+    };
+
+    ModifierGuard guard;  // The hotkey's modifiers may still be down: Ctrl+Shift+C is not copy
+    const PasteOwner& owner = Owner();
+    HWND window = OwnerWindow();
+    ClipboardSnapshot snapshot;
+    SelectionCopy copy(TimestampNs() / 1000);
+    DWORD sequence = 0;  // Clipboard before Ctrl+C
+    bool sent = false;
+    text.clear();
+
+    for (;;) {
+        // The target copying bumps the sequence number (no owner message for it)
+        if (sent && GetClipboardSequenceNumber() != sequence) copy.Copied(TimestampNs() / 1000);
+
+        bool ok = true;
+        switch (copy.Next(TimestampNs() / 1000)) {
+        case CopyAction::Wait:
+            PumpUntil(copy.WakeUs(), owner);
+            continue;
+        case CopyAction::SaveClipboard:
+            ok = OpenClipboard(window) != FALSE;
+            if (ok) {
+                snapshot.Capture();
+                CloseClipboard();
+                sequence = GetClipboardSequenceNumber();
+            }
+            break;
+        case CopyAction::CopyKeysDown:
+            ok = SendEvents(ctrlC, 2);
+            sent = true;
+            break;
+        case CopyAction::CopyKeysUp:
+            ok = SendEvents(ctrlC + 2, 2);
+            break;
+        case CopyAction::ReadClipboard:
+            ok = OpenClipboard(window) != FALSE;
+            if (ok) {
+                ok = ReadText(text);
+                CloseClipboard();
+            }
+            break;
+        case CopyAction::RestoreClipboard:
+            ok = OpenClipboard(window) != FALSE;
+            if (ok) {
+                EmptyClipboard();
+                snapshot.Restore();
+                CloseClipboard();
+            }
+            break;
+        case CopyAction::Done:
+            return !copy.IsFailed();
+        }
+        copy.Complete(ok, TimestampNs() / 1000);
+    }
+}
+
+// ============================================================
+// Settings store (HKEY_CURRENT_USER)
+// ============================================================
+
+bool Win32Platform::ReadDword(const wchar_t* path, const wchar_t* name, DWORD& value) {
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, path, 0, KEY_READ, &hKey) != ERROR_SUCCESS) return false;
+    DWORD data = 0, size = sizeof(data), type = REG_DWORD;
+    bool ok = RegQueryValueExW(hKey, name, nullptr, &type, (LPBYTE)&data, &size) == ERROR_SUCCESS;
+    RegCloseKey(hKey);
+    if (ok) value = data;
+    return ok;
+}
+
+void Win32Platform::WriteDword(const wchar_t* path, const wchar_t* name, DWORD value) {
+    HKEY hKey;
+    if (RegCreateKeyExW(HKEY_CURRENT_USER, path, 0, nullptr,
+                        REG_OPTION_NON_VOLATILE, KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
+        RegSetValueExW(hKey, name, 0, REG_DWORD, (LPBYTE)&value, sizeof(value));
+        RegCloseKey(hKey);
+    }
+}
+
+bool Win32Platform::ReadString(const wchar_t* path, const wchar_t* name, std::wstring& value) {
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, path, 0, KEY_READ, &hKey) != ERROR_SUCCESS) return false;
+    wchar_t buffer[4096] = {};
+    DWORD size = sizeof(buffer);
+    DWORD type = REG_SZ;
+    bool ok = RegQueryValueExW(hKey, name, nullptr, &type, (LPBYTE)buffer, &size) == ERROR_SUCCESS;
+    RegCloseKey(hKey);
+    if (ok) value = buffer;
+    return ok;
+}
+
+void Win32Platform::WriteString(const wchar_t* path, const wchar_t* name, const std::wstring& value) {
+    HKEY hKey;
+    if (RegCreateKeyExW(HKEY_CURRENT_USER, path, 0, nullptr,
+                        REG_OPTION_NON_VOLATILE, KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
+        RegSetValueExW(hKey, name, 0, REG_SZ,
+                       (LPBYTE)value.c_str(), static_cast<DWORD>((value.length() + 1) * sizeof(wchar_t)));
+        RegCloseKey(hKey);
+    }
+}
+
+void Win32Platform::DeleteValue(const wchar_t* path, const wchar_t* name) {
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, path, 0, KEY_WRITE, &hKey) == ERROR_SUCCESS) {
+        RegDeleteValueW(hKey, name);
+        RegCloseKey(hKey);
+    }
+}
+
+void Win32Platform::EnumDwords(const wchar_t* path, const std::function<void(const wchar_t*, DWORD)>& visit) {
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, path, 0, KEY_READ, &hKey) != ERROR_SUCCESS) return;
+
+    wchar_t valueName[256];
+    DWORD valueNameSize;
+    DWORD valueData;
+    DWORD valueDataSize;
+    DWORD type;
+    DWORD index = 0;
+
+    for (;;) {
+        valueNameSize = 256;
+        valueDataSize = sizeof(valueData);
+        LONG result = RegEnumValueW(hKey, index++, valueName, &valueNameSize,
+                                     nullptr, &type, (LPBYTE)&valueData, &valueDataSize);
+        if (result != ERROR_SUCCESS) break;
+        if (type == REG_DWORD) {
+            visit(valueName, valueData);
+        }
+    }
+    RegCloseKey(hKey);
+}
@@ -0,0 +1,89 @@
+// ViKey - Win32 Platform Backend
+// platform_win32.h
+// SetWindowsHookEx, SetWinEventHook, SendInput, clipboard and registry implementation of Platform
+
+#pragma once
+
+#include "platform.h"
+#include <atomic>
+
+class Win32Platform : public Platform {
+public:
+    static Win32Platform& Instance();
+
+    HMODULE LoadCoreLibrary() override;
+    void* GetCoreProc(HMODULE module, const char* name) override;
+    void FreeCoreLibrary(HMODULE module) override;
+    void ShowError(const wchar_t* title, const wchar_t* message) override;
+
+    uint64_t TimestampNs() override;
+    void LogEvent(const wchar_t* message) override;
+
+    bool InstallKeyboardHook() override;
+    void RemoveKeyboardHook() override;
+    bool IsKeyDown(int vkCode) override;
+    bool IsCapsLockOn() override;
+
+    HWND GetForegroundWindow() override;
+    std::wstring GetWindowClassName(HWND window) override;
+    DWORD GetWindowProcessId(HWND window) override;
+    std::wstring GetProcessImagePath(DWORD processId) override;
+    bool InstallForegroundHook() override;
+    void RemoveForegroundHook() override;
+
+    void InjectText(const wchar_t* text, size_t length, int backspaces) override;
+    InjectionFeedback InjectTextPaced(const wchar_t* text, size_t length, int backspaces,
+                                      const InjectionPacing& pacing) override;
+    void InjectKey(int vkCode, bool shift, bool ctrl, bool alt) override;
+    InjectionFeedback PasteText(const std::wstring& text, int backspaces, const InjectionPacing& pacing) override;
+    bool CopySelection(std::wstring& text) override;
+
+    bool ReadDword(const wchar_t* path, const wchar_t* name, DWORD& value) override;
+    void WriteDword(const wchar_t* path, const wchar_t* name, DWORD value) override;
+    bool ReadString(const wchar_t* path, const wchar_t* name, std::wstring& value) override;
+    void WriteString(const wchar_t* path, const wchar_t* name, const std::wstring& value) override;
+    void DeleteValue(const wchar_t* path, const wchar_t* name) override;
+    void EnumDwords(const wchar_t* path, const std::function<void(const wchar_t*, DWORD)>& visit) override;
+
+private:
+    Win32Platform() = default;
+    ~Win32Platform() override = default;
+    Win32Platform(const Win32Platform&) = delete;
+    Win32Platform& operator=(const Win32Platform&) = delete;
+
+    // Modifiers held down turn injected keys into shortcuts (Ctrl+Backspace
+    // erases a word): released for the guard's lifetime, except the
+    // MODIFIER_* bits in keep, then pressed again if the user still holds them
+    class ModifierGuard {
+    public:
+        explicit ModifierGuard(uint8_t keep = 0);
+        ~ModifierGuard();
+        ModifierGuard(const ModifierGuard&) = delete;
+        ModifierGuard& operator=(const ModifierGuard&) = delete;
+
+    private:
+        uint8_t m_released = 0;  // Bit i: modifier key VK_LSHIFT + i
+    };
+
+    // Low-level keyboard hook procedure (forwards key events to KeyboardHook)
+    static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
+
+    // WinEvent procedure (forwards foreground changes to ForegroundTracker)
+    static void CALLBACK ForegroundEventProc(HWINEVENTHOOK hook, DWORD event, HWND window,
+                                             LONG idObject, LONG idChild, DWORD thread, DWORD time);
+
+    // Pacing feedback: wait until the hook has seen every event injected
+    // since seenBefore (the input queue drained to the target), then time a
+    // round trip to the target window's thread (back at its message loop).
+    // Neither shows the app handled the keys, so feedback is never confirmed.
+    void WaitConsumed(HWND target, uint64_t seenBefore, uint64_t lastSendNs, InjectionFeedback& feedback);
+
+    // SendInput, counting the events (and any SendInput refused) into feedback
+    static void SendCounted(const INPUT* inputs, size_t count, InjectionFeedback& feedback);
+
+    HHOOK m_hookId = nullptr;
+    std::atomic<uint64_t> m_injectedSeen{0};    // Our injected events seen by the hook (down and up)
+    std::atomic<uint64_t> m_injectedSeenNs{0};  // When the hook saw the last one
+    std::atomic<uint8_t> m_physicalModifiers{0};  // Bit i: the user holds modifier key VK_LSHIFT + i
+    HWINEVENTHOOK m_foregroundHook = nullptr;
+};
@@ -54,6 +54,12 @@
 #define IDC_BTN_CONVERT           444
 #define IDC_BTN_SWAP              445
 #define IDC_BTN_COPY              446
+#define IDC_BTN_DETECT            447
+#define IDC_STATIC_DETECT         448
+#define IDC_CHECK_SELECTION       449
+#define IDC_COMBO_CASE            455
+#define IDC_CHECK_STRIP           456
+#define IDC_CHECK_NFC             457
 
 // Settings Dialog Controls
 #define IDC_CHECK_ENABLED     400
@@ -105,7 +111,7 @@
 // Custom messages
 #define WM_TRAYICON           (WM_USER + 1)
 #define WM_TOGGLE_IME         (WM_USER + 2)
-#define WM_DEFERRED_CLIPBOARD (WM_USER + 3)
+#define WM_SELECTION_DONE     (WM_USER + 3)  // wParam: SelectionStatus
 
 // Update Dialog Controls
 #define IDD_UPDATE            305
@@ -117,6 +123,7 @@
 #define IDC_CHECK_DISABLE_UPDATE 465
 #define IDC_CHECK_AUTO_UPDATE 466
 #define IDM_CHECK_UPDATE      217
+#define IDM_DIAGNOSTICS       218
 
 // String IDs
 #define IDS_APP_TITLE         1000
@@ -4,16 +4,28 @@
 
 #include "rust_bridge.h"
 #include <codecvt>
+#include <cstring>
+#include <cwchar>
 #include <locale>
 #include <string>
 
 // ImeResult implementation
-ImeResult::ImeResult(ImeAction a, uint8_t bs, uint8_t c, uint8_t f, const uint32_t* ch, size_t len)
-    : action(a), backspace(bs), count(c), flags(f), m_charCount(0) {
-    if (ch && len > 0) {
-        m_charCount = len < 256 ? len : 256;
-        memcpy(m_chars, ch, m_charCount * sizeof(uint32_t));
-    }
+void ImeResult::Reset() {
+    action = ImeAction::None;
+    backspace = 0;
+    count = 0;
+    flags = 0;
+    m_native.action = 0;
+    m_native.backspace = 0;
+    m_native.count = 0;
+    m_native.flags = 0;
+}
+
+void ImeResult::SyncFromNative() {
+    action = static_cast<ImeAction>(m_native.action);
+    backspace = m_native.backspace;
+    count = m_native.count;
+    flags = m_native.flags;
 }
 
 std::wstring ImeResult::GetText() const {
@@ -22,8 +34,8 @@ std::wstring ImeResult::GetText() const {
     std::wstring result;
     result.reserve(count);
 
-    for (size_t i = 0; i < count && i < m_charCount; i++) {
-        uint32_t cp = m_chars[i];
+    for (size_t i = 0; i < count; i++) {
+        uint32_t cp = m_native.chars[i];
         if (cp == 0) continue;
 
         // Convert UTF-32 code point to UTF-16
@@ -39,6 +51,94 @@ std::wstring ImeResult::GetText() const {
     return result;
 }
 
+size_t ImeResult::CopyText(wchar_t* out, size_t capacity) const {
+    size_t written = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t cp = m_native.chars[i];
+        if (cp == 0) continue;
+
+        if (cp < 0x10000 || WCHAR_MAX > 0xFFFF) {
+            if (written + 1 > capacity) break;
+            out[written++] = static_cast<wchar_t>(cp);
+        } else {
+            if (written + 2 > capacity) break;
+            cp -= 0x10000;
+            out[written++] = static_cast<wchar_t>(0xD800 + (cp >> 10));
+            out[written++] = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+        }
+    }
+    return written;
+}
+
+// ImeCompactResult implementation
+void ImeCompactResult::Reset() {
+    action = ImeAction::None;
+    backspace = 0;
+    flags = 0;
+    m_text = nullptr;
+    m_length = 0;
+}
+
+void ImeCompactResult::SyncFromNative() {
+    action = static_cast<ImeAction>(m_native.action);
+    backspace = m_native.backspace;
+    flags = m_native.flags;
+    const uint16_t* units = m_native.len <= COMPACT_INLINE ? m_native.text : m_native.overflow;
+#if WCHAR_MAX <= 0xFFFF
+    // wchar_t is UTF-16 (Windows): inject the engine's buffer as-is
+    m_length = m_native.len;
+    m_text = reinterpret_cast<const wchar_t*>(units);
+#else
+    // 32-bit wchar_t (non-Windows builds): join surrogate pairs into m_legacyText
+    const size_t capacity = sizeof(m_legacyText) / sizeof(m_legacyText[0]);
+    size_t written = 0;
+    for (uint32_t i = 0; i < m_native.len && written < capacity; i++) {
+        uint32_t cp = units[i];
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < m_native.len) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (units[++i] - 0xDC00);
+        }
+        m_legacyText[written++] = static_cast<wchar_t>(cp);
+    }
+    m_length = written;
+    m_text = m_legacyText;
+#endif
+}
+
+void ImeCompactResult::SyncFromLegacy(const ImeResult& legacy) {
+    action = legacy.action;
+    backspace = legacy.backspace;
+    flags = legacy.flags;
+    m_length = legacy.CopyText(m_legacyText, sizeof(m_legacyText) / sizeof(m_legacyText[0]));
+    m_text = m_legacyText;
+}
+
+// Wide string (UTF-16 or UTF-32 wchar_t) to UTF-8 for the core's C string API
+static std::string ToUtf8(const wchar_t* text) {
+    std::string out;
+    for (const wchar_t* p = text; *p; p++) {
+        uint32_t cp = static_cast<uint32_t>(*p);
+        if (cp >= 0xD800 && cp <= 0xDBFF && p[1] >= 0xDC00 && p[1] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (static_cast<uint32_t>(*++p) - 0xDC00);
+        }
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+    return out;
+}
+
 // RustBridge implementation
 RustBridge& RustBridge::Instance() {
     static RustBridge instance;
@@ -62,12 +162,40 @@ RustBridge::RustBridge()
     , m_ime_esc_restore(nullptr)
     , m_ime_free_tone(nullptr)
     , m_ime_allow_foreign_consonants(nullptr)
+    , m_ime_minimal_diff(nullptr)
     , m_ime_shortcuts_enabled(nullptr)
     , m_ime_add_shortcut(nullptr)
     , m_ime_remove_shortcut(nullptr)
     , m_ime_clear_shortcuts(nullptr)
     , m_ime_key(nullptr)
-    , m_ime_key_ext(nullptr) {
+    , m_ime_key_ext(nullptr)
+    , m_ime_key_into(nullptr)
+    , m_ime_key_compact(nullptr)
+    , m_ime_engine_new(nullptr)
+    , m_ime_engine_new_like(nullptr)
+    , m_ime_engine_free(nullptr)
+    , m_ime_engine_clear(nullptr)
+    , m_ime_engine_clear_all(nullptr)
+    , m_ime_engine_method(nullptr)
+    , m_ime_engine_enabled(nullptr)
+    , m_ime_engine_modern(nullptr)
+    , m_ime_engine_english_auto_restore(nullptr)
+    , m_ime_engine_auto_capitalize(nullptr)
+    , m_ime_engine_skip_w_shortcut(nullptr)
+    , m_ime_engine_bracket_shortcut(nullptr)
+    , m_ime_engine_esc_restore(nullptr)
+    , m_ime_engine_free_tone(nullptr)
+    , m_ime_engine_allow_foreign_consonants(nullptr)
+    , m_ime_engine_minimal_diff(nullptr)
+    , m_ime_engine_shortcuts_enabled(nullptr)
+    , m_ime_engine_add_shortcut(nullptr)
+    , m_ime_engine_remove_shortcut(nullptr)
+    , m_ime_engine_clear_shortcuts(nullptr)
+    , m_ime_engine_key_ext(nullptr)
+    , m_ime_engine_key_compact(nullptr)
+    , m_active(nullptr)
+    , m_typed(&m_globalTyped)
+    , m_useClock(0) {
 }
 
 RustBridge::~RustBridge() {
@@ -77,175 +205,330 @@ RustBridge::~RustBridge() {
 bool RustBridge::Initialize() {
     if (m_loaded) return true;
 
-    // Load the Rust core DLL using full path (prevent DLL hijacking)
-    wchar_t path[MAX_PATH];
-    GetModuleFileNameW(nullptr, path, MAX_PATH);
-    wchar_t* lastSlash = wcsrchr(path, L'\\');
-    if (lastSlash) {
-        wcscpy_s(lastSlash + 1, MAX_PATH - (lastSlash + 1 - path), L"core.dll");
-        m_hModule = LoadLibraryW(path);
-    }
-
+    Platform& platform = Platform::Current();
+    m_hModule = platform.LoadCoreLibrary();
     if (!m_hModule) {
-        MessageBoxW(nullptr, L"Failed to load core.dll", L"IME Error", MB_ICONERROR);
+        platform.ShowError(L"IME Error", L"Failed to load core.dll");
         return false;
     }
 
     // Get function addresses
-    m_ime_init = (FnInit)GetProcAddress(m_hModule, "ime_init");
-    m_ime_clear = (FnClear)GetProcAddress(m_hModule, "ime_clear");
-    m_ime_clear_all = (FnClearAll)GetProcAddress(m_hModule, "ime_clear_all");
-    m_ime_free = (FnFree)GetProcAddress(m_hModule, "ime_free");
-    m_ime_method = (FnMethod)GetProcAddress(m_hModule, "ime_method");
-    m_ime_enabled = (FnEnabled)GetProcAddress(m_hModule, "ime_enabled");
-    m_ime_modern = (FnModern)GetProcAddress(m_hModule, "ime_modern");
-    m_ime_english_auto_restore = (FnEnglishAutoRestore)GetProcAddress(m_hModule, "ime_english_auto_restore");
-    m_ime_auto_capitalize = (FnAutoCapitalize)GetProcAddress(m_hModule, "ime_auto_capitalize");
-    m_ime_skip_w_shortcut = (FnSkipWShortcut)GetProcAddress(m_hModule, "ime_skip_w_shortcut");
-    m_ime_bracket_shortcut = (FnBracketShortcut)GetProcAddress(m_hModule, "ime_bracket_shortcut");
-    m_ime_esc_restore = (FnEscRestore)GetProcAddress(m_hModule, "ime_esc_restore");
-    m_ime_free_tone = (FnFreeTone)GetProcAddress(m_hModule, "ime_free_tone");
-    m_ime_allow_foreign_consonants = (FnAllowForeignConsonants)GetProcAddress(m_hModule, "ime_allow_foreign_consonants");
-    m_ime_shortcuts_enabled = (FnShortcutsEnabled)GetProcAddress(m_hModule, "ime_shortcuts_enabled");
-    m_ime_add_shortcut = (FnAddShortcut)GetProcAddress(m_hModule, "ime_add_shortcut");
-    m_ime_remove_shortcut = (FnRemoveShortcut)GetProcAddress(m_hModule, "ime_remove_shortcut");
-    m_ime_clear_shortcuts = (FnClearShortcuts)GetProcAddress(m_hModule, "ime_clear_shortcuts");
-    m_ime_key = (FnKey)GetProcAddress(m_hModule, "ime_key");
-    m_ime_key_ext = (FnKeyExt)GetProcAddress(m_hModule, "ime_key_ext");
+    m_ime_init = (FnInit)platform.GetCoreProc(m_hModule, "ime_init");
+    m_ime_clear = (FnClear)platform.GetCoreProc(m_hModule, "ime_clear");
+    m_ime_clear_all = (FnClearAll)platform.GetCoreProc(m_hModule, "ime_clear_all");
+    m_ime_free = (FnFree)platform.GetCoreProc(m_hModule, "ime_free");
+    m_ime_method = (FnMethod)platform.GetCoreProc(m_hModule, "ime_method");
+    m_ime_enabled = (FnEnabled)platform.GetCoreProc(m_hModule, "ime_enabled");
+    m_ime_modern = (FnModern)platform.GetCoreProc(m_hModule, "ime_modern");
+    m_ime_english_auto_restore = (FnEnglishAutoRestore)platform.GetCoreProc(m_hModule, "ime_english_auto_restore");
+    m_ime_auto_capitalize = (FnAutoCapitalize)platform.GetCoreProc(m_hModule, "ime_auto_capitalize");
+    m_ime_skip_w_shortcut = (FnSkipWShortcut)platform.GetCoreProc(m_hModule, "ime_skip_w_shortcut");
+    m_ime_bracket_shortcut = (FnBracketShortcut)platform.GetCoreProc(m_hModule, "ime_bracket_shortcut");
+    m_ime_esc_restore = (FnEscRestore)platform.GetCoreProc(m_hModule, "ime_esc_restore");
+    m_ime_free_tone = (FnFreeTone)platform.GetCoreProc(m_hModule, "ime_free_tone");
+    m_ime_allow_foreign_consonants = (FnAllowForeignConsonants)platform.GetCoreProc(m_hModule, "ime_allow_foreign_consonants");
+    m_ime_minimal_diff = (FnMinimalDiff)platform.GetCoreProc(m_hModule, "ime_minimal_diff");
+    m_ime_shortcuts_enabled = (FnShortcutsEnabled)platform.GetCoreProc(m_hModule, "ime_shortcuts_enabled");
+    m_ime_add_shortcut = (FnAddShortcut)platform.GetCoreProc(m_hModule, "ime_add_shortcut");
+    m_ime_remove_shortcut = (FnRemoveShortcut)platform.GetCoreProc(m_hModule, "ime_remove_shortcut");
+    m_ime_clear_shortcuts = (FnClearShortcuts)platform.GetCoreProc(m_hModule, "ime_clear_shortcuts");
+    m_ime_key = (FnKey)platform.GetCoreProc(m_hModule, "ime_key");
+    m_ime_key_ext = (FnKeyExt)platform.GetCoreProc(m_hModule, "ime_key_ext");
+    m_ime_key_into = (FnKeyInto)platform.GetCoreProc(m_hModule, "ime_key_into");
+    m_ime_key_compact = (FnKeyCompact)platform.GetCoreProc(m_hModule, "ime_key_compact");
+    m_ime_engine_new = (FnEngineNew)platform.GetCoreProc(m_hModule, "ime_engine_new");
+    m_ime_engine_new_like = (FnEngineNewLike)platform.GetCoreProc(m_hModule, "ime_engine_new_like");
+    m_ime_engine_free = (FnEngineFree)platform.GetCoreProc(m_hModule, "ime_engine_free");
+    m_ime_engine_clear = (FnEngineOp)platform.GetCoreProc(m_hModule, "ime_engine_clear");
+    m_ime_engine_clear_all = (FnEngineOp)platform.GetCoreProc(m_hModule, "ime_engine_clear_all");
+    m_ime_engine_method = (FnEngineSetU8)platform.GetCoreProc(m_hModule, "ime_engine_method");
+    m_ime_engine_enabled = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_enabled");
+    m_ime_engine_modern = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_modern");
+    m_ime_engine_english_auto_restore = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_english_auto_restore");
+    m_ime_engine_auto_capitalize = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_auto_capitalize");
+    m_ime_engine_skip_w_shortcut = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_skip_w_shortcut");
+    m_ime_engine_bracket_shortcut = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_bracket_shortcut");
+    m_ime_engine_esc_restore = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_esc_restore");
+    m_ime_engine_free_tone = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_free_tone");
+    m_ime_engine_allow_foreign_consonants = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_allow_foreign_consonants");
+    m_ime_engine_minimal_diff = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_minimal_diff");
+    m_ime_engine_shortcuts_enabled = (FnEngineSetBool)platform.GetCoreProc(m_hModule, "ime_engine_shortcuts_enabled");
+    m_ime_engine_add_shortcut = (FnEngineAddShortcut)platform.GetCoreProc(m_hModule, "ime_engine_add_shortcut");
+    m_ime_engine_remove_shortcut = (FnEngineRemoveShortcut)platform.GetCoreProc(m_hModule, "ime_engine_remove_shortcut");
+    m_ime_engine_clear_shortcuts = (FnEngineOp)platform.GetCoreProc(m_hModule, "ime_engine_clear_shortcuts");
+    m_ime_engine_key_ext = (FnEngineKeyExt)platform.GetCoreProc(m_hModule, "ime_engine_key_ext");
+    m_ime_engine_key_compact = (FnEngineKeyCompact)platform.GetCoreProc(m_hModule, "ime_engine_key_compact");
 
     // Check required functions
     if (!m_ime_init || !m_ime_key || !m_ime_free) {
-        MessageBoxW(nullptr, L"Failed to find required DLL functions", L"IME Error", MB_ICONERROR);
-        FreeLibrary(m_hModule);
+        platform.ShowError(L"IME Error", L"Failed to find required DLL functions");
+        platform.FreeCoreLibrary(m_hModule);
         m_hModule = nullptr;
         return false;
     }
 
     // Initialize the engine
     m_ime_init();
+    InitContexts();
     m_loaded = true;
     return true;
 }
 
+void RustBridge::InitContexts() {
+    if (!m_ime_engine_new || !m_ime_engine_new_like || !m_ime_engine_free || !m_ime_engine_key_ext) {
+        return;
+    }
+    EngineContext& def = m_contexts[0];
+    def.engine = EnginePtr(m_ime_engine_new(), EngineDeleter{m_ime_engine_free});
+    m_active = def.engine.get();
+    m_typed = &def.typed;
+}
+
+void RustBridge::SwitchContext(HWND window) {
+    if (!m_active) return;
+
+    // Known window: swap the active engine pointer
+    EngineContext* lru = nullptr;
+    for (EngineContext& ctx : m_contexts) {
+        if (ctx.engine && ctx.window == window) {
+            ctx.lastUse = ++m_useClock;
+            m_active = ctx.engine.get();
+            m_typed = &ctx.typed;
+            return;
+        }
+        if (&ctx == &m_contexts[0]) continue;  // Default context is never reused
+        if (!lru || !ctx.engine || (lru->engine && ctx.lastUse < lru->lastUse)) {
+            lru = &ctx;
+        }
+    }
+
+    // New window: reuse a free or least recently used slot. The new engine
+    // copies settings and shortcuts from the default context.
+    NativeEngine* engine = m_ime_engine_new_like(m_contexts[0].engine.get());
+    if (!engine) return;
+    lru->engine.reset(engine);
+    lru->engine.get_deleter().free = m_ime_engine_free;
+    lru->window = window;
+    lru->typed.Reset();
+    lru->lastUse = ++m_useClock;
+    m_active = engine;
+    m_typed = &lru->typed;
+}
+
+template <typename T>
+void RustBridge::ApplySetting(void (*global)(T), void (*perEngine)(NativeEngine*, T), T value) {
+    if (m_active && perEngine) {
+        for (EngineContext& ctx : m_contexts) {
+            if (ctx.engine) perEngine(ctx.engine.get(), value);
+        }
+    } else if (global) {
+        global(value);
+    }
+}
+
 void RustBridge::Shutdown() {
+    // Engines must be freed while core.dll is still loaded
+    for (EngineContext& ctx : m_contexts) {
+        ctx.engine.reset();
+        ctx.window = nullptr;
+    }
+    m_active = nullptr;
+    m_typed = &m_globalTyped;
+
     if (m_hModule) {
-        FreeLibrary(m_hModule);
+        Platform::Current().FreeCoreLibrary(m_hModule);
         m_hModule = nullptr;
     }
     m_loaded = false;
 }
 
 void RustBridge::Clear() {
-    if (m_ime_clear) m_ime_clear();
+    if (m_active && m_ime_engine_clear) {
+        m_ime_engine_clear(m_active);
+    } else if (m_ime_clear) {
+        m_ime_clear();
+    }
 }
 
 void RustBridge::ClearAll() {
-    if (m_ime_clear_all) m_ime_clear_all();
+    if (m_active && m_ime_engine_clear_all) {
+        m_ime_engine_clear_all(m_active);
+    } else if (m_ime_clear_all) {
+        m_ime_clear_all();
+    }
 }
 
 void RustBridge::SetMethod(InputMethod method) {
-    if (m_ime_method) m_ime_method(static_cast<uint8_t>(method));
+    ApplySetting<uint8_t>(m_ime_method, m_ime_engine_method, static_cast<uint8_t>(method));
 }
 
 void RustBridge::SetEnabled(bool enabled) {
-    if (m_ime_enabled) m_ime_enabled(enabled);
+    ApplySetting(m_ime_enabled, m_ime_engine_enabled, enabled);
 }
 
 void RustBridge::SetModernTone(bool modern) {
-    if (m_ime_modern) m_ime_modern(modern);
+    ApplySetting(m_ime_modern, m_ime_engine_modern, modern);
 }
 
 void RustBridge::SetEnglishAutoRestore(bool enabled) {
-    if (m_ime_english_auto_restore) m_ime_english_auto_restore(enabled);
+    ApplySetting(m_ime_english_auto_restore, m_ime_engine_english_auto_restore, enabled);
 }
 
 void RustBridge::SetAutoCapitalize(bool enabled) {
-    if (m_ime_auto_capitalize) m_ime_auto_capitalize(enabled);
+    ApplySetting(m_ime_auto_capitalize, m_ime_engine_auto_capitalize, enabled);
 }
 
 void RustBridge::SetSkipWShortcut(bool skip) {
-    if (m_ime_skip_w_shortcut) m_ime_skip_w_shortcut(skip);
+    ApplySetting(m_ime_skip_w_shortcut, m_ime_engine_skip_w_shortcut, skip);
 }
 
 void RustBridge::SetBracketShortcut(bool enabled) {
-    if (m_ime_bracket_shortcut) m_ime_bracket_shortcut(enabled);
+    ApplySetting(m_ime_bracket_shortcut, m_ime_engine_bracket_shortcut, enabled);
 }
 
 void RustBridge::SetEscRestore(bool enabled) {
-    if (m_ime_esc_restore) m_ime_esc_restore(enabled);
+    ApplySetting(m_ime_esc_restore, m_ime_engine_esc_restore, enabled);
 }
 
 void RustBridge::SetFreeTone(bool enabled) {
-    if (m_ime_free_tone) m_ime_free_tone(enabled);
+    ApplySetting(m_ime_free_tone, m_ime_engine_free_tone, enabled);
 }
 
 void RustBridge::SetAllowForeignConsonants(bool enabled) {
-    if (m_ime_allow_foreign_consonants) m_ime_allow_foreign_consonants(enabled);
+    ApplySetting(m_ime_allow_foreign_consonants, m_ime_engine_allow_foreign_consonants, enabled);
+}
+
+void RustBridge::SetMinimalDiff(bool enabled) {
+    ApplySetting(m_ime_minimal_diff, m_ime_engine_minimal_diff, enabled);
 }
 
 void RustBridge::SetShortcutsEnabled(bool enabled) {
-    if (m_ime_shortcuts_enabled) m_ime_shortcuts_enabled(enabled);
+    ApplySetting(m_ime_shortcuts_enabled, m_ime_engine_shortcuts_enabled, enabled);
 }
 
 void RustBridge::AddShortcut(const wchar_t* trigger, const wchar_t* replacement) {
-    if (!m_ime_add_shortcut || !trigger || !replacement) return;
+    bool perEngine = m_active && m_ime_engine_add_shortcut;
+    if ((!perEngine && !m_ime_add_shortcut) || !trigger || !replacement) return;
 
     // Convert wide strings to UTF-8
-    int triggerLen = WideCharToMultiByte(CP_UTF8, 0, trigger, -1, nullptr, 0, nullptr, nullptr);
-    int replacementLen = WideCharToMultiByte(CP_UTF8, 0, replacement, -1, nullptr, 0, nullptr, nullptr);
-
-    if (triggerLen <= 0 || replacementLen <= 0) return;
-
-    std::string triggerUtf8(triggerLen, 0);
-    std::string replacementUtf8(replacementLen, 0);
+    std::string triggerUtf8 = ToUtf8(trigger);
+    std::string replacementUtf8 = ToUtf8(replacement);
 
-    WideCharToMultiByte(CP_UTF8, 0, trigger, -1, &triggerUtf8[0], triggerLen, nullptr, nullptr);
-    WideCharToMultiByte(CP_UTF8, 0, replacement, -1, &replacementUtf8[0], replacementLen, nullptr, nullptr);
-
-    m_ime_add_shortcut(triggerUtf8.c_str(), replacementUtf8.c_str());
+    if (!perEngine) {
+        m_ime_add_shortcut(triggerUtf8.c_str(), replacementUtf8.c_str());
+        return;
+    }
+    for (EngineContext& ctx : m_contexts) {
+        if (ctx.engine) m_ime_engine_add_shortcut(ctx.engine.get(), triggerUtf8.c_str(), replacementUtf8.c_str());
+    }
 }
 
 void RustBridge::RemoveShortcut(const wchar_t* trigger) {
-    if (!m_ime_remove_shortcut || !trigger) return;
-
-    int triggerLen = WideCharToMultiByte(CP_UTF8, 0, trigger, -1, nullptr, 0, nullptr, nullptr);
-    if (triggerLen <= 0) return;
+    bool perEngine = m_active && m_ime_engine_remove_shortcut;
+    if ((!perEngine && !m_ime_remove_shortcut) || !trigger) return;
 
-    std::string triggerUtf8(triggerLen, 0);
-    WideCharToMultiByte(CP_UTF8, 0, trigger, -1, &triggerUtf8[0], triggerLen, nullptr, nullptr);
+    std::string triggerUtf8 = ToUtf8(trigger);
 
-    m_ime_remove_shortcut(triggerUtf8.c_str());
+    if (!perEngine) {
+        m_ime_remove_shortcut(triggerUtf8.c_str());
+        return;
+    }
+    for (EngineContext& ctx : m_contexts) {
+        if (ctx.engine) m_ime_engine_remove_shortcut(ctx.engine.get(), triggerUtf8.c_str());
+    }
 }
 
 void RustBridge::ClearShortcuts() {
-    if (m_ime_clear_shortcuts) m_ime_clear_shortcuts();
+    if (m_active && m_ime_engine_clear_shortcuts) {
+        for (EngineContext& ctx : m_contexts) {
+            if (ctx.engine) m_ime_engine_clear_shortcuts(ctx.engine.get());
+        }
+    } else if (m_ime_clear_shortcuts) {
+        m_ime_clear_shortcuts();
+    }
+}
+
+ImeResult& RustBridge::ThreadResult() {
+    // One result per thread: the hook thread reuses it for every keystroke
+    static thread_local ImeResult result;
+    return result;
+}
+
+ImeCompactResult& RustBridge::ThreadCompactResult() {
+    static thread_local ImeCompactResult result;
+    return result;
 }
 
-ImeResult RustBridge::ProcessKey(uint16_t keycode, bool caps, bool ctrl) {
-    if (!m_ime_key) return ImeResult::Empty();
+const ImeResult& RustBridge::ProcessKey(uint16_t keycode, bool caps, bool ctrl) {
+    if (m_active || m_ime_key_into) return ProcessKeyExt(keycode, caps, ctrl, false);
+
+    if (!m_ime_key) {
+        ImeResult& result = ThreadResult();
+        result.Reset();
+        return result;
+    }
 
     NativeResult* ptr = m_ime_key(keycode, caps, ctrl);
     return ParseResult(ptr);
 }
 
-ImeResult RustBridge::ProcessKeyExt(uint16_t keycode, bool caps, bool ctrl, bool shift) {
+const ImeResult& RustBridge::ProcessKeyExt(uint16_t keycode, bool caps, bool ctrl, bool shift) {
+    if (m_active) {
+        // Focused context's engine: single owner, no lock in core.dll
+        ImeResult& result = ThreadResult();
+        if (m_ime_engine_key_ext(m_active, &result.m_native, keycode, caps, ctrl, shift)) {
+            result.SyncFromNative();
+        } else {
+            result.Reset();
+        }
+        return result;
+    }
+
+    if (m_ime_key_into) {
+        // Fast path: engine writes straight into the per-thread buffer
+        ImeResult& result = ThreadResult();
+        if (m_ime_key_into(&result.m_native, keycode, caps, ctrl, shift)) {
+            result.SyncFromNative();
+        } else {
+            result.Reset();
+        }
+        return result;
+    }
+
     if (!m_ime_key_ext) return ProcessKey(keycode, caps, ctrl);
 
     NativeResult* ptr = m_ime_key_ext(keycode, caps, ctrl, shift);
     return ParseResult(ptr);
 }
 
-ImeResult RustBridge::ParseResult(NativeResult* ptr) {
-    if (!ptr) return ImeResult::Empty();
+const ImeCompactResult& RustBridge::ProcessKeyCompact(uint16_t keycode, bool caps, bool ctrl, bool shift) {
+    ImeCompactResult& result = ThreadCompactResult();
+    bool perEngine = m_active && m_ime_engine_key_compact;
+    if (perEngine || (!m_active && m_ime_key_compact)) {
+        bool ok = perEngine ? m_ime_engine_key_compact(m_active, &result.m_native, keycode, caps, ctrl, shift)
+                            : m_ime_key_compact(&result.m_native, keycode, caps, ctrl, shift);
+        if (ok) {
+            result.SyncFromNative();
+        } else {
+            result.Reset();
+        }
+        return result;
+    }
+
+    // Older core.dll: convert the full UTF-32 result into the per-thread buffer
+    result.SyncFromLegacy(ProcessKeyExt(keycode, caps, ctrl, shift));
+    return result;
+}
+
+const ImeResult& RustBridge::ParseResult(NativeResult* ptr) {
+    ImeResult& result = ThreadResult();
+    if (!ptr) {
+        result.Reset();
+        return result;
+    }
 
-    ImeResult result(
-        static_cast<ImeAction>(ptr->action),
-        ptr->backspace,
-        ptr->count,
-        ptr->flags,
-        ptr->chars,
-        ptr->count
-    );
+    memcpy(&result.m_native, ptr, sizeof(NativeResult));
+    result.SyncFromNative();
 
     if (m_ime_free) m_ime_free(ptr);
 
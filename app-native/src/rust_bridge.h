@@ -4,8 +4,10 @@
 
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
+#include "typed_history.h"
 #include <cstdint>
+#include <memory>
 #include <string>
 
 // Input method type
@@ -32,7 +34,28 @@ struct NativeResult {
     uint8_t flags;
 };
 
+// Compact native result from Rust (must match CompactResult in core/src/engine/types.rs)
+// action/backspace/flags/reserved (4) + len (4) + text[16] (32) + overflow (8) = 48 bytes
+// Text is UTF-16 (surrogate pairs included): inline when len <= 16, else in overflow
+// (engine-owned, valid until the next key call).
+constexpr size_t COMPACT_INLINE = 16;
+
+struct NativeCompactResult {
+    uint8_t action;
+    uint8_t backspace;
+    uint8_t flags;
+    uint8_t reserved;
+    uint32_t len;
+    uint16_t text[COMPACT_INLINE];
+    const uint16_t* overflow;
+};
+
+// Opaque engine handle from core.dll (ime_engine_new / ime_engine_free)
+struct NativeEngine;
+
 // Managed IME result
+// Wraps the native result in place: RustBridge fills m_native directly through
+// ime_key_into, so reading a result never copies the 1 KB chars array.
 class ImeResult {
 public:
     static constexpr uint8_t FLAG_KEY_CONSUMED = 0x01;
@@ -42,8 +65,7 @@ public:
     uint8_t count;
     uint8_t flags;
 
-    ImeResult() : action(ImeAction::None), backspace(0), count(0), flags(0) {}
-    ImeResult(ImeAction a, uint8_t bs, uint8_t c, uint8_t f, const uint32_t* ch, size_t len);
+    ImeResult() : action(ImeAction::None), backspace(0), count(0), flags(0), m_native() {}
 
     // Check if key should be consumed (not passed through)
     bool IsKeyConsumed() const { return (flags & FLAG_KEY_CONSUMED) != 0; }
@@ -51,11 +73,60 @@ public:
     // Get the result text as a wstring
     std::wstring GetText() const;
 
+    // Write the result text as UTF-16 into out (no allocation)
+    // Returns the number of UTF-16 units written (truncated to capacity)
+    size_t CopyText(wchar_t* out, size_t capacity) const;
+
     static ImeResult Empty() { return ImeResult(); }
 
 private:
-    uint32_t m_chars[256];
-    size_t m_charCount;
+    friend class RustBridge;
+
+    // Reset to an empty (pass-through) result
+    void Reset();
+
+    // Refresh the public header fields from m_native
+    void SyncFromNative();
+
+    NativeResult m_native;
+};
+
+// Compact IME result: ready-to-inject UTF-16 text, read in place
+// (no UTF-32 conversion and no allocation per key)
+class ImeCompactResult {
+public:
+    static constexpr uint8_t FLAG_KEY_CONSUMED = ImeResult::FLAG_KEY_CONSUMED;
+
+    ImeAction action;
+    uint8_t backspace;
+    uint8_t flags;
+
+    ImeCompactResult() : action(ImeAction::None), backspace(0), flags(0), m_native(), m_text(nullptr), m_length(0) {}
+
+    // Check if key should be consumed (not passed through)
+    bool IsKeyConsumed() const { return (flags & FLAG_KEY_CONSUMED) != 0; }
+
+    // UTF-16 text to inject (valid until the next key call on this thread)
+    const wchar_t* Text() const { return m_text; }
+    size_t Length() const { return m_length; }
+
+private:
+    friend class RustBridge;
+
+    // Reset to an empty (pass-through) result
+    void Reset();
+
+    // Refresh header fields and text pointer from m_native
+    void SyncFromNative();
+
+    // Fill from a full result (core.dll without ime_key_compact)
+    void SyncFromLegacy(const ImeResult& legacy);
+
+    NativeCompactResult m_native;
+    const wchar_t* m_text;
+    size_t m_length;
+    wchar_t m_legacyText[512];  // Text copy when the engine buffer cannot be used in place
+                                // (older core.dll, or 32-bit wchar_t builds)
 };
 
 // Rust bridge singleton
@@ -108,6 +179,9 @@ public:
     // Allow foreign consonants (f, j, w, z) as valid initials
     void SetAllowForeignConsonants(bool enabled);
 
+    // Trim results to the smallest suffix edit (no-op on older core.dll builds)
+    void SetMinimalDiff(bool enabled);
+
     // Shortcut management
     void SetShortcutsEnabled(bool enabled);
     void AddShortcut(const wchar_t* trigger, const wchar_t* replacement);
@@ -115,10 +189,31 @@ public:
     void ClearShortcuts();
 
     // Process a keystroke and get the result
-    ImeResult ProcessKey(uint16_t keycode, bool caps, bool ctrl);
+    // The returned reference points to a per-thread result that is reused by
+    // the next ProcessKey/ProcessKeyExt call on the same thread (no per-key allocation).
+    const ImeResult& ProcessKey(uint16_t keycode, bool caps, bool ctrl);
 
     // Process a keystroke with shift parameter (for VNI symbols)
-    ImeResult ProcessKeyExt(uint16_t keycode, bool caps, bool ctrl, bool shift);
+    const ImeResult& ProcessKeyExt(uint16_t keycode, bool caps, bool ctrl, bool shift);
+
+    // Process a keystroke and get a compact UTF-16 result (hot path for injection).
+    // The core converts its full result; this saves the copy and UTF-32 conversion here.
+    // The returned reference is a per-thread result reused by the next call.
+    const ImeCompactResult& ProcessKeyCompact(uint16_t keycode, bool caps, bool ctrl, bool shift);
+
+    // Typing contexts (core.dll with ime_engine_* exports): one engine per window.
+    // Make the engine owned by `window` active, creating it from the current
+    // settings and shortcuts if needed. Other contexts keep their in-progress
+    // word state, so switching back continues the word instead of losing it.
+    // The least recently used context is dropped when all slots are taken.
+    void SwitchContext(HWND window);
+
+    // True if keys go to per-window engines instead of the global one
+    bool HasContexts() const { return m_active != nullptr; }
+
+    // Backspace widths of the characters typed in the active context
+    // (TextSender): they stay valid as long as the context's word does
+    TypedHistory& Typed() { return *m_typed; }
 
 private:
     RustBridge();
@@ -141,12 +236,44 @@ private:
     using FnEscRestore = void(*)(bool);
     using FnFreeTone = void(*)(bool);
     using FnAllowForeignConsonants = void(*)(bool);
+    using FnMinimalDiff = void(*)(bool);
     using FnShortcutsEnabled = void(*)(bool);
     using FnAddShortcut = void(*)(const char*, const char*);
     using FnRemoveShortcut = void(*)(const char*);
     using FnClearShortcuts = void(*)();
     using FnKey = NativeResult*(*)(uint16_t, bool, bool);
     using FnKeyExt = NativeResult*(*)(uint16_t, bool, bool, bool);
+    using FnKeyInto = bool(*)(NativeResult*, uint16_t, bool, bool, bool);
+    using FnKeyCompact = bool(*)(NativeCompactResult*, uint16_t, bool, bool, bool);
+    using FnEngineNew = NativeEngine*(*)();
+    using FnEngineNewLike = NativeEngine*(*)(NativeEngine*);
+    using FnEngineFree = void(*)(NativeEngine*);
+    using FnEngineOp = void(*)(NativeEngine*);
+    using FnEngineSetU8 = void(*)(NativeEngine*, uint8_t);
+    using FnEngineSetBool = void(*)(NativeEngine*, bool);
+    using FnEngineKeyExt = bool(*)(NativeEngine*, NativeResult*, uint16_t, bool, bool, bool);
+    using FnEngineKeyCompact = bool(*)(NativeEngine*, NativeCompactResult*, uint16_t, bool, bool, bool);
+    using FnEngineAddShortcut = void(*)(NativeEngine*, const char*, const char*);
+    using FnEngineRemoveShortcut = void(*)(NativeEngine*, const char*);
+
+    // Owns one engine handle; frees it through core.dll
+    struct EngineDeleter {
+        FnEngineFree free;
+        EngineDeleter() : free(nullptr) {}
+        explicit EngineDeleter(FnEngineFree fn) : free(fn) {}
+        void operator()(NativeEngine* engine) const { if (free && engine) free(engine); }
+    };
+    using EnginePtr = std::unique_ptr<NativeEngine, EngineDeleter>;
+
+    // One typing context. Slot 0 (window == nullptr) is the default context:
+    // never evicted, and the template new contexts copy their settings from.
+    struct EngineContext {
+        HWND window = nullptr;
+        EnginePtr engine;
+        TypedHistory typed;
+        uint32_t lastUse = 0;
+    };
+    static constexpr size_t MAX_CONTEXTS = 8;
 
     HMODULE m_hModule;
     bool m_loaded;
@@ -166,12 +293,57 @@ private:
     FnEscRestore m_ime_esc_restore;
     FnFreeTone m_ime_free_tone;
     FnAllowForeignConsonants m_ime_allow_foreign_consonants;
+    FnMinimalDiff m_ime_minimal_diff;  // Optional: older core.dll builds lack it
     FnShortcutsEnabled m_ime_shortcuts_enabled;
     FnAddShortcut m_ime_add_shortcut;
     FnRemoveShortcut m_ime_remove_shortcut;
     FnClearShortcuts m_ime_clear_shortcuts;
     FnKey m_ime_key;
     FnKeyExt m_ime_key_ext;
-
-    ImeResult ParseResult(NativeResult* ptr);
+    FnKeyInto m_ime_key_into;  // Optional: older core.dll builds lack it
+    FnKeyCompact m_ime_key_compact;  // Optional: older core.dll builds lack it
+
+    // Engine handle API (optional: older core.dll builds use the global engine)
+    FnEngineNew m_ime_engine_new;
+    FnEngineNewLike m_ime_engine_new_like;
+    FnEngineFree m_ime_engine_free;
+    FnEngineOp m_ime_engine_clear;
+    FnEngineOp m_ime_engine_clear_all;
+    FnEngineSetU8 m_ime_engine_method;
+    FnEngineSetBool m_ime_engine_enabled;
+    FnEngineSetBool m_ime_engine_modern;
+    FnEngineSetBool m_ime_engine_english_auto_restore;
+    FnEngineSetBool m_ime_engine_auto_capitalize;
+    FnEngineSetBool m_ime_engine_skip_w_shortcut;
+    FnEngineSetBool m_ime_engine_bracket_shortcut;
+    FnEngineSetBool m_ime_engine_esc_restore;
+    FnEngineSetBool m_ime_engine_free_tone;
+    FnEngineSetBool m_ime_engine_allow_foreign_consonants;
+    FnEngineSetBool m_ime_engine_minimal_diff;
+    FnEngineSetBool m_ime_engine_shortcuts_enabled;
+    FnEngineAddShortcut m_ime_engine_add_shortcut;
+    FnEngineRemoveShortcut m_ime_engine_remove_shortcut;
+    FnEngineOp m_ime_engine_clear_shortcuts;
+    FnEngineKeyExt m_ime_engine_key_ext;
+    FnEngineKeyCompact m_ime_engine_key_compact;
+
+    EngineContext m_contexts[MAX_CONTEXTS];
+    NativeEngine* m_active;  // Engine of the focused context (null: global engine)
+    TypedHistory* m_typed;   // History of the focused context (the global engine's: m_globalTyped)
+    TypedHistory m_globalTyped;
+    uint32_t m_useClock;
+
+    // Create the default context if core.dll exports the handle API
+    void InitContexts();
+
+    // Apply a setting to every context, or to the global engine
+    template <typename T>
+    void ApplySetting(void (*global)(T), void (*perEngine)(NativeEngine*, T), T value);
+
+    // Copy a heap result into the per-thread result and free it (legacy path)
+    const ImeResult& ParseResult(NativeResult* ptr);
+
+    // Per-thread reusable result returned by ProcessKey/ProcessKeyExt
+    static ImeResult& ThreadResult();
+    static ImeCompactResult& ThreadCompactResult();
 };
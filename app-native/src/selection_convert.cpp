@@ -0,0 +1,244 @@
+// ViKey - Selection Convert Implementation
+// selection_convert.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "selection_convert.h"
+#include "encoding_stream.h"
+#include "keycodes.h"
+#include "platform.h"
+#include "text_sender.h"
+#include <algorithm>
+#include <chrono>
+
+// ============================================================
+// Copy
+// ============================================================
+
+SelectionCopy::SelectionCopy(uint64_t nowUs)
+    : m_state(State::Save)
+    , m_wakeUs(nowUs)
+    , m_deadlineUs(0)
+    , m_retries(0)
+    , m_copied(false)
+    , m_read(false)
+    , m_failed(false) {
+}
+
+CopyAction SelectionCopy::Next(uint64_t nowUs) {
+    if (m_state == State::Done) return CopyAction::Done;
+    if (nowUs < m_wakeUs) return CopyAction::Wait;
+
+    switch (m_state) {
+    case State::Save: return CopyAction::SaveClipboard;
+    case State::CopyDown: return CopyAction::CopyKeysDown;
+    case State::CopyUp: return CopyAction::CopyKeysUp;
+    case State::AwaitCopy:
+        if (nowUs < m_deadlineUs) {
+            m_wakeUs = std::min<uint64_t>(nowUs + POLL_US, m_deadlineUs);
+            return CopyAction::Wait;
+        }
+        // Timed out: the target had nothing selected to copy
+        m_state = State::Restore;
+        m_retries = 0;
+        return CopyAction::RestoreClipboard;
+    case State::Read: return CopyAction::ReadClipboard;
+    case State::Restore: return CopyAction::RestoreClipboard;
+    default: return CopyAction::Done;
+    }
+}
+
+void SelectionCopy::Retry(uint64_t nowUs, State giveUp) {
+    if (++m_retries > MAX_RETRIES) {
+        m_state = giveUp;
+        m_retries = 0;
+        m_wakeUs = nowUs;
+        return;
+    }
+    m_wakeUs = nowUs + RETRY_US;
+}
+
+void SelectionCopy::Complete(bool ok, uint64_t nowUs) {
+    switch (m_state) {
+    case State::Save:
+        if (!ok) {
+            Retry(nowUs, State::Done);
+            if (m_state == State::Done) m_failed = true;
+            break;
+        }
+        m_state = State::CopyDown;
+        m_retries = 0;
+        m_wakeUs = nowUs;
+        break;
+    case State::CopyDown:
+        if (!ok) {
+            // Keys refused (a window above our integrity level): nothing to wait for
+            m_failed = true;
+            m_state = State::Restore;
+            m_wakeUs = nowUs;
+            break;
+        }
+        m_state = State::CopyUp;
+        m_wakeUs = nowUs;
+        break;
+    case State::CopyUp:
+        m_state = m_copied ? State::Read : State::AwaitCopy;
+        m_deadlineUs = nowUs + COPY_TIMEOUT_US;
+        m_wakeUs = nowUs;
+        break;
+    case State::Read:
+        if (!ok) {
+            Retry(nowUs, State::Restore);
+            if (m_state == State::Restore) m_failed = true;
+            break;
+        }
+        m_read = true;
+        m_state = State::Restore;
+        m_retries = 0;
+        m_wakeUs = nowUs;
+        break;
+    case State::Restore:
+        if (!ok) {
+            Retry(nowUs, State::Done);  // Give up: the copied text stays on the clipboard
+            break;
+        }
+        m_state = State::Done;
+        break;
+    default:
+        break;
+    }
+}
+
+void SelectionCopy::Copied(uint64_t nowUs) {
+    if (m_state == State::CopyUp) {
+        m_copied = true;  // Copied on key down; read once C is up
+    } else if (m_state == State::AwaitCopy) {
+        m_state = State::Read;
+        m_retries = 0;
+        m_wakeUs = nowUs;
+    }
+}
+
+// ============================================================
+// Converter
+// ============================================================
+
+bool SelectionConverter::Convert(const std::wstring& text, VietEncoding from, VietEncoding to,
+                                 std::wstring& out, const std::atomic<bool>& cancel) {
+    constexpr size_t CHUNK = 4096;
+    static_assert(CHUNK_UNITS % CHUNK == 0, "cancel checked on a chunk boundary");
+    EncodingStream stream(from, to);
+    wchar_t buffer[EncodingStream::MaxOutput(CHUNK)];
+    out.clear();
+    out.reserve(text.size() + text.size() / 2);
+    for (size_t at = 0; at < text.size(); at += CHUNK) {
+        if (at % CHUNK_UNITS == 0 && cancel.load(std::memory_order_acquire)) return false;
+        size_t length = text.size() - at < CHUNK ? text.size() - at : CHUNK;
+        out.append(buffer, stream.Push(text.data() + at, length, buffer));
+    }
+    out.append(buffer, stream.Finish(buffer));
+    return true;
+}
+
+bool SelectionConverter::Toggle(VietEncoding from, VietEncoding to) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_busy.load(std::memory_order_acquire)) {
+        m_cancel.store(true, std::memory_order_release);
+        return false;
+    }
+    if (!m_thread.joinable()) {
+        m_stopping = false;
+        m_thread = std::thread(&SelectionConverter::Run, this);
+    }
+    m_from = from;
+    m_to = to;
+    m_cancel.store(false, std::memory_order_release);
+    m_busy.store(true, std::memory_order_release);
+    m_pending = true;
+    m_wake.notify_one();
+    return true;
+}
+
+void SelectionConverter::Wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return !m_busy.load(std::memory_order_acquire); });
+}
+
+void SelectionConverter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_cancel.store(true, std::memory_order_release);
+        m_wake.notify_one();
+    }
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void SelectionConverter::Run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this]() { return m_pending || m_stopping; });
+        if (!m_pending) return;
+        m_pending = false;
+        VietEncoding from = m_from;
+        VietEncoding to = m_to;
+        lock.unlock();
+
+        SelectionStatus status = Execute(from, to);
+        if (m_callback) m_callback(status);
+
+        lock.lock();
+        m_busy.store(false, std::memory_order_release);
+        m_idle.notify_all();
+        if (m_stopping) return;
+    }
+}
+
+bool SelectionConverter::WaitForModifiers() {
+    Platform& platform = Platform::Current();
+    static constexpr int MODIFIERS[] = {VK_CONTROL_KEY, VK_SHIFT_KEY, VK_MENU_KEY,
+                                        VK_LWIN_KEY, VK_RWIN_KEY};
+    uint64_t deadlineNs = platform.TimestampNs() + KEY_RELEASE_TIMEOUT_US * 1000ull;
+    for (;;) {
+        bool held = false;
+        for (int vkCode : MODIFIERS) held = held || platform.IsKeyDown(vkCode);
+        if (!held) return true;
+        if (m_cancel.load(std::memory_order_acquire) || platform.TimestampNs() >= deadlineNs) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(KEY_POLL_US));
+    }
+}
+
+// The copy and the paste take the keyboard and clipboard from the output
+// thread: queued injections and the keys the hook holds wait for them
+struct ExclusiveOutput {
+    ExclusiveOutput() { TextSender::Instance().BeginExclusiveOutput(); }
+    ~ExclusiveOutput() { TextSender::Instance().EndExclusiveOutput(); }
+    ExclusiveOutput(const ExclusiveOutput&) = delete;
+    ExclusiveOutput& operator=(const ExclusiveOutput&) = delete;
+};
+
+SelectionStatus SelectionConverter::Execute(VietEncoding from, VietEncoding to) {
+    Platform& platform = Platform::Current();
+    auto cancelled = [this]() { return m_cancel.load(std::memory_order_acquire); };
+
+    if (!WaitForModifiers()) return cancelled() ? SelectionStatus::Cancelled : SelectionStatus::Failed;
+    HWND window = platform.GetForegroundWindow();
+    std::wstring text;
+    bool copied;
+    {
+        ExclusiveOutput exclusive;
+        copied = platform.CopySelection(text);
+    }
+    if (!copied) return cancelled() ? SelectionStatus::Cancelled : SelectionStatus::Failed;
+    if (cancelled()) return SelectionStatus::Cancelled;
+    if (text.empty()) return SelectionStatus::NoSelection;
+
+    std::wstring converted;
+    if (!Convert(text, from, to, converted, m_cancel)) return SelectionStatus::Cancelled;
+    if (converted == text) return SelectionStatus::Unchanged;
+
+    // The selection belongs to the window it was copied from
+    ExclusiveOutput exclusive;
+    if (cancelled() || platform.GetForegroundWindow() != window) return SelectionStatus::Cancelled;
+    platform.PasteText(converted, 0, PacingProfile().Pacing());
+    return SelectionStatus::Converted;
+}
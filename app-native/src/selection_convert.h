@@ -0,0 +1,158 @@
+// ViKey - Selection Convert
+// selection_convert.h
+// Converts the text selected in the foreground app in place (the selection
+// hotkey): Ctrl+C captures it, EncodingStream converts it on a worker
+// thread, and PasteText puts the result back over the selection. The user's
+// clipboard comes back after both the copy and the paste, which run
+// exclusive of TextSender's output (typed keys wait behind them). The
+// hotkey only hands the job over, so megabytes selected in Word never hold
+// up the UI or the hook; pressing it again cancels the job. Portable.
+
+#pragma once
+
+#include "encoding_converter.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// ============================================================
+// Copy: Ctrl+C with the user's clipboard saved around it
+// ============================================================
+
+enum class CopyAction : uint8_t {
+    SaveClipboard,     // Snapshot the clipboard's global-memory formats
+    CopyKeysDown,      // Ctrl down, C down
+    CopyKeysUp,        // C up, Ctrl up
+    ReadClipboard,     // Take the copied text
+    RestoreClipboard,  // Put the snapshot back
+    Wait,              // Nothing to do before WakeUs() (or the clipboard changing)
+    Done
+};
+
+// One copy as a state machine, driven like ClipboardPaste: the backend
+// performs each action and reports Copied() once the clipboard changed
+// after Ctrl+C (the clipboard sequence number on Win32).
+class SelectionCopy {
+public:
+    static constexpr uint32_t RETRY_US = 10000;          // Clipboard held by another app
+    static constexpr uint32_t MAX_RETRIES = 15;
+    static constexpr uint32_t POLL_US = 5000;            // Backends polling for the change
+    static constexpr uint32_t COPY_TIMEOUT_US = 1000000; // Nothing copied: no selection (Word takes a while on megabytes)
+
+    explicit SelectionCopy(uint64_t nowUs);
+
+    // Action to perform at nowUs (Wait: call again at WakeUs() or on Copied())
+    CopyAction Next(uint64_t nowUs);
+
+    // Outcome of the action Next() returned: false if the clipboard could not
+    // be opened, or if SendInput refused key events
+    void Complete(bool ok, uint64_t nowUs);
+
+    // The clipboard changed after Ctrl+C went down
+    void Copied(uint64_t nowUs);
+
+    // Waiting for the target to copy (poll the backend's signal)
+    bool IsAwaitingCopy() const { return m_state == State::AwaitCopy; }
+
+    uint64_t WakeUs() const { return m_wakeUs; }
+    bool IsDone() const { return m_state == State::Done; }
+
+    // The copied text was read
+    bool HasText() const { return m_read; }
+
+    // The copy could not be made (clipboard busy, keys refused); a copy
+    // that timed out is no failure, there was just nothing selected
+    bool IsFailed() const { return m_failed; }
+
+private:
+    enum class State : uint8_t { Save, CopyDown, CopyUp, AwaitCopy, Read, Restore, Done };
+
+    // Clipboard busy: try again later, or take `giveUp` after MAX_RETRIES
+    void Retry(uint64_t nowUs, State giveUp);
+
+    State m_state;
+    uint64_t m_wakeUs;
+    uint64_t m_deadlineUs;  // AwaitCopy gives up
+    uint32_t m_retries;
+    bool m_copied;          // Changed before Ctrl+C came up
+    bool m_read;
+    bool m_failed;
+};
+
+// ============================================================
+// Converter: one job at a time on a worker thread
+// ============================================================
+
+enum class SelectionStatus : uint8_t {
+    Converted,    // Pasted over the selection
+    Unchanged,    // Nothing to convert: left as it was
+    NoSelection,  // Ctrl+C copied no text
+    Cancelled,    // Hotkey pressed again, focus moved or shutting down
+    Failed        // Modifiers held too long, or the clipboard stayed busy
+};
+
+class SelectionConverter {
+public:
+    // Input units converted between two looks at the cancel flag
+    static constexpr size_t CHUNK_UNITS = 64 * 1024;
+
+    // Hotkey modifiers still held when the job starts would turn Ctrl+C
+    // into another shortcut: wait this long for them to come up
+    static constexpr uint32_t KEY_RELEASE_TIMEOUT_US = 2000000;
+    static constexpr uint32_t KEY_POLL_US = 10000;
+
+    // Called on the worker thread when a job ends
+    using Callback = std::function<void(SelectionStatus)>;
+
+    SelectionConverter() = default;
+    ~SelectionConverter() { Stop(); }
+    SelectionConverter(const SelectionConverter&) = delete;
+    SelectionConverter& operator=(const SelectionConverter&) = delete;
+
+    void SetCallback(Callback callback) { m_callback = std::move(callback); }
+
+    // Hotkey: start converting the foreground app's selection, or cancel the
+    // job in flight. Returns true if a job was started. Never blocks.
+    bool Toggle(VietEncoding from, VietEncoding to);
+
+    // Stop the job in flight, if any (it reports Cancelled)
+    void Cancel() { m_cancel.store(true, std::memory_order_release); }
+
+    // True from Toggle() until the job's callback has returned
+    bool IsBusy() const { return m_busy.load(std::memory_order_acquire); }
+
+    // Block until the job in flight has ended
+    void Wait();
+
+    // Cancel the job and join the worker thread
+    void Stop();
+
+    // text converted chunk by chunk into out; false (out partial) once
+    // cancel is set
+    static bool Convert(const std::wstring& text, VietEncoding from, VietEncoding to,
+                        std::wstring& out, const std::atomic<bool>& cancel);
+
+private:
+    void Run();
+    SelectionStatus Execute(VietEncoding from, VietEncoding to);
+
+    // Wait until the user lets go of Ctrl, Shift, Alt and Windows
+    bool WaitForModifiers();
+
+    Callback m_callback;
+    std::thread m_thread;
+    std::mutex m_mutex;                   // Guards the job fields below
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    bool m_pending = false;               // Job handed over, not yet picked up
+    bool m_stopping = false;
+    VietEncoding m_from = VietEncoding::VNI_Windows;
+    VietEncoding m_to = VietEncoding::Unicode;
+    std::atomic<bool> m_busy{false};
+    std::atomic<bool> m_cancel{false};
+};
@@ -3,11 +3,14 @@
 // Registry helpers, Load, Save, AutoStart, Shortcuts/ExcludedApps
 
 #include "settings.h"
-#include <shlwapi.h>
+#include "keycodes.h"
 #include <sstream>
 #include <vector>
 
+#ifdef _WIN32
+#include <shlwapi.h>
 #pragma comment(lib, "shlwapi.lib")
+#endif
 
 Settings& Settings::Instance() {
     static Settings instance;
@@ -31,9 +34,15 @@ Settings::Settings()
     , autoStart(false)
     , silentStartup(false)
     , shortcutsEnabled(true)
-    , checkForUpdates(true) {
+    , checkForUpdates(true)
+    , selectionConvert(false)
+    , selectionFrom(VietEncoding::VNI_Windows)
+    , selectionTo(VietEncoding::Unicode) {
+    selectionHotkey.shift = true;
+    selectionHotkey.vkCode = VK_F9_KEY;
 }
 
+#ifdef _WIN32
 // Batch registry helpers (single key open for all reads/writes)
 static bool ReadBool(HKEY hKey, const wchar_t* name, bool defaultValue) {
     DWORD value = 0, size = sizeof(value), type = REG_DWORD;
@@ -59,7 +68,16 @@ static void WriteInt(HKEY hKey, const wchar_t* name, int value) {
     RegSetValueExW(hKey, name, 0, REG_DWORD, (LPBYTE)&dw, sizeof(dw));
 }
 
+static VietEncoding ReadEncoding(HKEY hKey, const wchar_t* name, VietEncoding defaultValue) {
+    int value = ReadInt(hKey, name, static_cast<int>(defaultValue));
+    return value >= 0 && value < VIET_ENCODING_COUNT ? static_cast<VietEncoding>(value) : defaultValue;
+}
+#endif
+
+// Headless builds keep the DWORD settings and auto-start at their defaults;
+// string values (shortcuts, excluded apps) go through the platform store.
 void Settings::Load() {
+#ifdef _WIN32
     HKEY hKey;
     if (RegOpenKeyExW(HKEY_CURRENT_USER, REGISTRY_PATH, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
         enabled = ReadBool(hKey, L"Enabled", true);
@@ -84,14 +102,25 @@ void Settings::Load() {
         toggleHotkey.alt = ReadBool(hKey, L"HotkeyAlt", false);
         toggleHotkey.win = ReadBool(hKey, L"HotkeyWin", false);
         toggleHotkey.vkCode = static_cast<UINT>(ReadInt(hKey, L"HotkeyKey", VK_SPACE));
+        selectionConvert = ReadBool(hKey, L"SelectionConvert", false);
+        selectionHotkey.ctrl = ReadBool(hKey, L"SelectionHotkeyCtrl", true);
+        selectionHotkey.shift = ReadBool(hKey, L"SelectionHotkeyShift", true);
+        selectionHotkey.alt = ReadBool(hKey, L"SelectionHotkeyAlt", false);
+        selectionHotkey.win = ReadBool(hKey, L"SelectionHotkeyWin", false);
+        selectionHotkey.vkCode = static_cast<UINT>(ReadInt(hKey, L"SelectionHotkeyKey", VK_F9_KEY));
+        selectionFrom = ReadEncoding(hKey, L"SelectionFrom", VietEncoding::VNI_Windows);
+        selectionTo = ReadEncoding(hKey, L"SelectionTo", VietEncoding::Unicode);
         RegCloseKey(hKey);
     }
     autoStart = GetAutoStart();
+#endif
     LoadShortcuts();
     LoadExcludedApps();
+    appRules = GetString(L"AppRules", L"");
 }
 
 void Settings::Save() {
+#ifdef _WIN32
     HKEY hKey;
     if (RegCreateKeyExW(HKEY_CURRENT_USER, REGISTRY_PATH, 0, nullptr,
                         REG_OPTION_NON_VOLATILE, KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
@@ -116,11 +145,21 @@ void Settings::Save() {
         WriteBool(hKey, L"HotkeyAlt", toggleHotkey.alt);
         WriteBool(hKey, L"HotkeyWin", toggleHotkey.win);
         WriteInt(hKey, L"HotkeyKey", static_cast<int>(toggleHotkey.vkCode));
+        WriteBool(hKey, L"SelectionConvert", selectionConvert);
+        WriteBool(hKey, L"SelectionHotkeyCtrl", selectionHotkey.ctrl);
+        WriteBool(hKey, L"SelectionHotkeyShift", selectionHotkey.shift);
+        WriteBool(hKey, L"SelectionHotkeyAlt", selectionHotkey.alt);
+        WriteBool(hKey, L"SelectionHotkeyWin", selectionHotkey.win);
+        WriteInt(hKey, L"SelectionHotkeyKey", static_cast<int>(selectionHotkey.vkCode));
+        WriteInt(hKey, L"SelectionFrom", static_cast<int>(selectionFrom));
+        WriteInt(hKey, L"SelectionTo", static_cast<int>(selectionTo));
         RegCloseKey(hKey);
     }
     SetAutoStart(autoStart);
+#endif
     SaveShortcuts();
     SaveExcludedApps();
+    SetString(L"AppRules", appRules);
 }
 
 std::vector<TextShortcut> Settings::DefaultShortcuts() {
@@ -129,37 +168,19 @@ std::vector<TextShortcut> Settings::DefaultShortcuts() {
 }
 
 std::wstring Settings::GetString(const wchar_t* name, const wchar_t* defaultValue) {
-    HKEY hKey;
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, REGISTRY_PATH, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
-        return defaultValue;
-    }
-
-    wchar_t buffer[4096] = {0};
-    DWORD size = sizeof(buffer);
-    DWORD type = REG_SZ;
     std::wstring result = defaultValue;
-
-    if (RegQueryValueExW(hKey, name, nullptr, &type, (LPBYTE)buffer, &size) == ERROR_SUCCESS) {
-        result = buffer;
-    }
-
-    RegCloseKey(hKey);
+    Platform::Current().ReadString(REGISTRY_PATH, name, result);
     return result;
 }
 
 void Settings::SetString(const wchar_t* name, const std::wstring& value) {
-    HKEY hKey;
-    if (RegCreateKeyExW(HKEY_CURRENT_USER, REGISTRY_PATH, 0, nullptr,
-                        REG_OPTION_NON_VOLATILE, KEY_WRITE, nullptr, &hKey, nullptr) != ERROR_SUCCESS) {
-        return;
-    }
-
-    RegSetValueExW(hKey, name, 0, REG_SZ,
-                   (LPBYTE)value.c_str(), static_cast<DWORD>((value.length() + 1) * sizeof(wchar_t)));
-    RegCloseKey(hKey);
+    Platform::Current().WriteString(REGISTRY_PATH, name, value);
 }
 
 bool Settings::GetAutoStart() const {
+#ifndef _WIN32
+    return false;
+#else
     HKEY hKey;
     if (RegOpenKeyExW(HKEY_CURRENT_USER, STARTUP_PATH, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
         return false;
@@ -171,9 +192,13 @@ bool Settings::GetAutoStart() const {
 
     RegCloseKey(hKey);
     return exists;
+#endif
 }
 
 void Settings::SetAutoStart(bool enabled) {
+#ifndef _WIN32
+    (void)enabled;
+#else
     HKEY hKey;
     if (RegOpenKeyExW(HKEY_CURRENT_USER, STARTUP_PATH, 0, KEY_WRITE, &hKey) != ERROR_SUCCESS) {
         return;
@@ -190,6 +215,7 @@ void Settings::SetAutoStart(bool enabled) {
     }
 
     RegCloseKey(hKey);
+#endif
 }
 
 void Settings::LoadShortcuts() {
@@ -4,11 +4,12 @@
 
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
 #include <string>
 #include <vector>
 #include "rust_bridge.h"
 #include "shortcut_manager.h"
+#include "encoding_converter.h"
 
 // Hotkey configuration for language toggle
 struct HotkeyConfig {
@@ -59,7 +60,12 @@ public:
     bool checkForUpdates;   // Check for updates on startup
     std::vector<TextShortcut> shortcuts;
     std::vector<std::wstring> excludedApps;  // Apps to auto-disable (Feature 3)
+    std::wstring appRules;  // Per-app rules, one per line (see ParseAppRules)
     HotkeyConfig toggleHotkey;  // Configurable toggle hotkey
+    bool selectionConvert;          // Selection hotkey registered (converter dialog)
+    HotkeyConfig selectionHotkey;   // Converts the selected text in place (default Ctrl+Shift+F9)
+    VietEncoding selectionFrom;     // Encoding pair it converts (the converter dialog's last)
+    VietEncoding selectionTo;
 
     // Get default shortcuts
     static std::vector<TextShortcut> DefaultShortcuts();
@@ -3,6 +3,7 @@
 // JSON escape/parse functions and Settings::ImportFromJson, ExportToJson, ExportShortcutsToJson, ImportShortcutsFromJson
 
 #include "settings.h"
+#include "keycodes.h"
 #include <shlwapi.h>
 #include <sstream>
 #include <vector>
@@ -136,6 +137,16 @@ std::wstring Settings::ExportToJson() const {
     ss << L"    \"win\": " << (toggleHotkey.win ? L"true" : L"false") << L",\n";
     ss << L"    \"key\": " << toggleHotkey.vkCode << L"\n";
     ss << L"  },\n";
+    ss << L"  \"selectionHotkey\": {\n";
+    ss << L"    \"enabled\": " << (selectionConvert ? L"true" : L"false") << L",\n";
+    ss << L"    \"ctrl\": " << (selectionHotkey.ctrl ? L"true" : L"false") << L",\n";
+    ss << L"    \"shift\": " << (selectionHotkey.shift ? L"true" : L"false") << L",\n";
+    ss << L"    \"alt\": " << (selectionHotkey.alt ? L"true" : L"false") << L",\n";
+    ss << L"    \"win\": " << (selectionHotkey.win ? L"true" : L"false") << L",\n";
+    ss << L"    \"key\": " << selectionHotkey.vkCode << L",\n";
+    ss << L"    \"from\": " << static_cast<int>(selectionFrom) << L",\n";
+    ss << L"    \"to\": " << static_cast<int>(selectionTo) << L"\n";
+    ss << L"  },\n";
     ss << L"  \"excludedApps\": [\n";
     for (size_t i = 0; i < excludedApps.size(); i++) {
         ss << L"    \"" << excludedApps[i] << L"\"";
@@ -189,6 +200,23 @@ bool Settings::ImportFromJson(const std::wstring& json) {
         toggleHotkey.vkCode = static_cast<UINT>(ExtractJsonInt(hotkeySection, L"key", VK_SPACE));
     }
 
+    size_t selectionPos = json.find(L"\"selectionHotkey\":");
+    if (selectionPos != std::wstring::npos) {
+        size_t selectionEnd = json.find(L"}", selectionPos);
+        if (selectionEnd == std::wstring::npos) return false;
+        std::wstring selectionSection = json.substr(selectionPos, selectionEnd - selectionPos + 1);
+        selectionConvert = ExtractJsonBool(selectionSection, L"enabled", false);
+        selectionHotkey.ctrl = ExtractJsonBool(selectionSection, L"ctrl", true);
+        selectionHotkey.shift = ExtractJsonBool(selectionSection, L"shift", true);
+        selectionHotkey.alt = ExtractJsonBool(selectionSection, L"alt", false);
+        selectionHotkey.win = ExtractJsonBool(selectionSection, L"win", false);
+        selectionHotkey.vkCode = static_cast<UINT>(ExtractJsonInt(selectionSection, L"key", VK_F9_KEY));
+        int from = ExtractJsonInt(selectionSection, L"from", static_cast<int>(VietEncoding::VNI_Windows));
+        int to = ExtractJsonInt(selectionSection, L"to", static_cast<int>(VietEncoding::Unicode));
+        if (from < VIET_ENCODING_COUNT) selectionFrom = static_cast<VietEncoding>(from);
+        if (to < VIET_ENCODING_COUNT) selectionTo = static_cast<VietEncoding>(to);
+    }
+
     excludedApps.clear();
     size_t excludedPos = json.find(L"\"excludedApps\":");
     if (excludedPos != std::wstring::npos) {
@@ -0,0 +1,47 @@
+// ViKey - Snapshot Exchange
+// snapshot_exchange.h
+// Triple buffer for publishing a value from one writer thread to one reader
+// thread. Publish() and Read() are wait-free (one atomic exchange at most),
+// the reader never sees a half-written value, and no memory is reclaimed,
+// so T may own heap data (std::wstring) as long as the writer fully
+// overwrites Back() before each Publish().
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class SnapshotExchange {
+public:
+    SnapshotExchange() : m_middle(2), m_back(1), m_front(0) {}
+    SnapshotExchange(const SnapshotExchange&) = delete;
+    SnapshotExchange& operator=(const SnapshotExchange&) = delete;
+
+    // Writer: slot to fill (holds stale data from an older publish)
+    T& Back() { return m_slots[m_back]; }
+
+    // Writer: make Back() the latest value
+    void Publish() {
+        uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | FRESH), std::memory_order_acq_rel);
+        m_back = previous & INDEX;
+    }
+
+    // Reader: latest published value (valid until the next Read())
+    const T& Read() {
+        if (m_middle.load(std::memory_order_relaxed) & FRESH) {
+            uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front = previous & INDEX;
+        }
+        return m_slots[m_front];
+    }
+
+private:
+    static constexpr uint8_t INDEX = 0x03;
+    static constexpr uint8_t FRESH = 0x04;  // Middle slot not yet taken by the reader
+
+    T m_slots[3];
+    alignas(64) std::atomic<uint8_t> m_middle;
+    alignas(64) uint8_t m_back;   // Writer only
+    alignas(64) uint8_t m_front;  // Reader only
+};
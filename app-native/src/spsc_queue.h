@@ -0,0 +1,67 @@
+// ViKey - Single-Producer Single-Consumer Queue
+// spsc_queue.h
+// Lock-free bounded ring buffer: one producer thread, one consumer thread.
+// Items come out in push order. Portable (std::atomic only).
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() : m_head(0), m_tail(0) {}
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer: returns a slot to fill, or nullptr if the queue is full.
+    // The item becomes visible to the consumer on Commit().
+    T* Reserve() {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) return nullptr;
+        return &m_items[tail & (Capacity - 1)];
+    }
+
+    void Commit() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool TryPush(const T& item) {
+        T* slot = Reserve();
+        if (!slot) return false;
+        *slot = item;
+        Commit();
+        return true;
+    }
+
+    // Consumer: oldest item, or nullptr if empty. Valid until Pop().
+    T* Front() {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return nullptr;
+        return &m_items[head & (Capacity - 1)];
+    }
+
+    // Consumer: the index-th oldest item (0 = Front()), or nullptr
+    T* Peek(size_t index) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_tail.load(std::memory_order_acquire) - head <= index) return nullptr;
+        return &m_items[(head + index) & (Capacity - 1)];
+    }
+
+    void Pop(size_t count = 1) {
+        m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    bool Empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    // Head and tail on separate cache lines: each is written by one thread only
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+    alignas(64) T m_items[Capacity];
+};
@@ -3,277 +3,261 @@
 // Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
 
 #include "text_sender.h"
-#include "keyboard_hook.h"
-#include "keycodes.h"
 #include "encoding_converter.h"
-#include "resource.h"
-#include <vector>
-
-extern HWND g_hWnd;
-
-// Win32 Constants
-constexpr DWORD INPUT_KEYBOARD_TYPE = 1;
-constexpr DWORD KEYEVENTF_KEYUP_FLAG = 0x0002;
-constexpr DWORD KEYEVENTF_UNICODE_FLAG = 0x0004;
-
-// INPUT struct for SendInput (explicit layout for 64-bit compatibility)
-#pragma pack(push, 8)
-struct INPUT_DATA {
-    DWORD type;
-    union {
-        struct {
-            WORD wVk;
-            WORD wScan;
-            DWORD dwFlags;
-            DWORD time;
-            ULONG_PTR dwExtraInfo;
-            DWORD padding[2]; // Padding for 64-bit alignment
-        } ki;
-    };
-};
-#pragma pack(pop)
+#include "encoding_tables.h"
+#include "app_detector.h"
+#include "keycodes.h"
+#include "rust_bridge.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
 TextSender& TextSender::Instance() {
     static TextSender instance;
     return instance;
 }
 
-TextSender::TextSender() : m_slowMode(false), m_clipboardMode(false), m_outputEncoding(OutputEncoding::Unicode) {}
-
-void TextSender::SendText(const std::wstring& text, int backspaces) {
-    if (text.empty() && backspaces == 0) return;
+TextSender::TextSender()
+    : m_slowMode(false), m_clipboardMode(false), m_forceFast(false), m_appInjection(InjectionMode::Auto)
+    , m_outputEncoding(OutputEncoding::Unicode), m_appId(0)
+    , m_worker(&TextSender::Execute) {
+    // Learned pacing is kept per app by AppDetector
+    m_pacer.SetStore(
+        [](const std::wstring& app, uint32_t& packed) { return AppDetector::Instance().GetAppPacing(app, packed); },
+        [](const std::wstring& app, uint32_t packed) { AppDetector::Instance().SaveAppPacing(app, packed); });
+}
 
-    // Convert text if needed (Feature 8: App Encoding Memory)
-    std::wstring outputText = text;
-    if (m_outputEncoding != OutputEncoding::Unicode && !text.empty()) {
-        VietEncoding targetEnc = (m_outputEncoding == OutputEncoding::VNI) ?
-            VietEncoding::VNI_Windows : VietEncoding::TCVN3;
-        outputText = EncodingConverter::Instance().Convert(text, VietEncoding::Unicode, targetEnc);
-    }
+void TextSender::SetApp(uint32_t appId, const std::wstring& appName) {
+    m_appId = appId;
+    m_pacer.SetAppName(appId, appName);
+}
 
-    if (m_clipboardMode) {
-        SendTextClipboardDeferred(outputText, backspaces);  // Deferred, safe in hook context
-    } else if (m_slowMode) {
-        SendTextSlow(outputText, backspaces);
-    } else {
-        SendTextFast(outputText, backspaces);
+void TextSender::NoteKey(int vkCode, bool shortcut) {
+    TypedHistory& typed = RustBridge::Instance().Typed();
+    if (shortcut) {
+        typed.Reset();
+    } else if (vkCode == VK_BACK_KEY) {
+        typed.EraseUnit();
+    } else if (KeyCodes::IsCaretKey(vkCode) || (KeyCodes::IsBufferClearKey(vkCode) && vkCode != VK_SPACE_KEY)) {
+        typed.Reset();  // Line break or caret moved: the engine starts over
+    } else if (KeyCodes::IsRelevantKey(vkCode) && vkCode != VK_ESCAPE_KEY) {
+        typed.Record(1);  // One ASCII character
     }
 }
 
-void TextSender::SendTextFast(const std::wstring& text, int backspaces) {
-    // Combine backspaces + Unicode chars into a SINGLE SendInput call.
-    // This is atomic: no gaps between events, preventing race conditions
-    // where the hook callback re-enters during Sleep() pauses.
-    std::vector<INPUT> inputs;
-    inputs.reserve(backspaces * 2 + text.length() * 2);
+int TextSender::EraseTyped(int count) {
+    return RustBridge::Instance().Typed().Erase(count);
+}
 
-    // Backspace down/up pairs
-    for (int i = 0; i < backspaces; i++) {
-        INPUT down = {};
-        down.type = INPUT_KEYBOARD;
-        down.ki.wVk = VK_BACK;
-        down.ki.wScan = 0x0E;
-        down.ki.dwFlags = 0;
-        down.ki.dwExtraInfo = INJECTED_KEY_MARKER;
-        inputs.push_back(down);
+// Backspaces the app needs to erase c written in encoding
+static uint8_t TypedWidth(OutputEncoding encoding, uint32_t c) {
+    if (encoding == OutputEncoding::Unicode || c < 0x80) return 1;
+    const EncodingTables::CharTable& table =
+        encoding == OutputEncoding::VNI ? EncodingTables::VNI_ENCODER : EncodingTables::TCVN3_ENCODER;
+    return static_cast<uint8_t>(EncodingTables::SequenceLength(table.Map(c)));
+}
 
-        INPUT up = {};
-        up.type = INPUT_KEYBOARD;
-        up.ki.wVk = VK_BACK;
-        up.ki.wScan = 0x0E;
-        up.ki.dwFlags = KEYEVENTF_KEYUP_FLAG;
-        up.ki.dwExtraInfo = INJECTED_KEY_MARKER;
-        inputs.push_back(up);
+void TextSender::RecordTyped(OutputEncoding encoding, const wchar_t* text, size_t length) {
+    TypedHistory& typed = RustBridge::Instance().Typed();
+    for (size_t i = 0; i < length; i++) {
+        uint32_t c = static_cast<uint32_t>(text[i]);
+        // A surrogate pair is one character
+        if (c >= 0xDC00 && c <= 0xDFFF && i > 0 && text[i - 1] >= 0xD800 && text[i - 1] <= 0xDBFF) continue;
+        typed.Record(TypedWidth(encoding, c));
     }
+}
 
-    // Unicode char down/up pairs
-    for (wchar_t c : text) {
-        if (c >= 0xD800 && c <= 0xDBFF) continue;
+void TextSender::SendText(const std::wstring& text, int backspaces) {
+    SendText(text.c_str(), text.length(), backspaces);
+}
 
-        INPUT down = {};
-        down.type = INPUT_KEYBOARD;
-        down.ki.wVk = 0;
-        down.ki.wScan = c;
-        down.ki.dwFlags = KEYEVENTF_UNICODE_FLAG;
-        down.ki.dwExtraInfo = INJECTED_KEY_MARKER;
-        inputs.push_back(down);
+void TextSender::SendText(const wchar_t* text, size_t length, int backspaces) {
+    if (length == 0 && backspaces == 0) return;
 
-        INPUT up = {};
-        up.type = INPUT_KEYBOARD;
-        up.ki.wVk = 0;
-        up.ki.wScan = c;
-        up.ki.dwFlags = KEYEVENTF_UNICODE_FLAG | KEYEVENTF_KEYUP_FLAG;
-        up.ki.dwExtraInfo = INJECTED_KEY_MARKER;
-        inputs.push_back(up);
+    InjectionMode mode = m_appInjection;
+    if (mode == InjectionMode::Auto) {
+        mode = m_clipboardMode ? InjectionMode::Clipboard : m_slowMode ? InjectionMode::Slow : InjectionMode::Fast;
     }
 
-    if (!inputs.empty()) {
-        UINT sent = SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT));
-        // SendInput returns number of events inserted; 0 on failure (best-effort, no action needed)
-        (void)sent;
+    if (m_forceFast) {
+        Enqueue(OutputCommand::Kind::Text, m_outputEncoding, text, length, backspaces);
+    } else if (mode == InjectionMode::Clipboard) {
+        Enqueue(OutputCommand::Kind::Paste, m_outputEncoding, text, length, backspaces);
+    } else if (mode == InjectionMode::Slow) {
+        // Slow mode: send events one by one with delays (for problematic apps)
+        Enqueue(OutputCommand::Kind::TextPaced, m_outputEncoding, text, length, backspaces);
+    } else {
+        // Fast mode: batch all events (default)
+        Enqueue(OutputCommand::Kind::Text, m_outputEncoding, text, length, backspaces);
     }
 }
 
-void TextSender::SendTextSlow(const std::wstring& text, int backspaces) {
-    // Use keybd_event for backspaces with longer delays
-    for (int i = 0; i < backspaces; i++) {
-        keybd_event(VK_BACK, 0x0E, 0, INJECTED_KEY_MARKER);
-        Sleep(15);
-        keybd_event(VK_BACK, 0x0E, KEYEVENTF_KEYUP_FLAG, INJECTED_KEY_MARKER);
-        Sleep(15);
-    }
-
-    // Longer delay between backspaces and text
-    if (backspaces > 0) {
-        Sleep(30);
-    }
+void TextSender::SendKey(int vkCode, bool shift, wchar_t typed, bool ctrl, bool alt) {
+    OutputCommand& cmd = m_worker.Begin();
+    cmd.kind = OutputCommand::Kind::Key;
+    cmd.encoding = static_cast<uint8_t>(OutputEncoding::Unicode);
+    cmd.shift = shift;
+    cmd.ctrl = ctrl;
+    cmd.alt = alt;
+    cmd.backspaces = 0;
+    cmd.vkCode = vkCode;
+    cmd.appId = m_appId;
+    cmd.length = typed != 0 ? 1 : 0;
+    cmd.text[0] = typed;
+    m_worker.Submit();
+}
 
-    // Send Unicode characters using SendInput
-    INPUT input[2] = {};
-    input[0].type = INPUT_KEYBOARD;
-    input[1].type = INPUT_KEYBOARD;
+void TextSender::SendTextClipboardDeferred(const std::wstring& text, int backspaces) {
+    SendTextClipboardDeferred(text.c_str(), text.length(), backspaces);
+}
 
-    for (wchar_t c : text) {
-        if (c >= 0xD800 && c <= 0xDBFF) continue;
+void TextSender::SendTextClipboardDeferred(const wchar_t* text, size_t length, int backspaces) {
+    // Pasted as Unicode regardless of the app's output encoding
+    OutputCommand::Kind kind = m_forceFast ? OutputCommand::Kind::Text : OutputCommand::Kind::Paste;
+    Enqueue(kind, OutputEncoding::Unicode, text, length, backspaces);
+}
 
-        input[0].ki.wVk = 0;
-        input[0].ki.wScan = c;
-        input[0].ki.dwFlags = KEYEVENTF_UNICODE_FLAG;
-        input[0].ki.dwExtraInfo = INJECTED_KEY_MARKER;
+void TextSender::Enqueue(OutputCommand::Kind kind, OutputEncoding encoding, const wchar_t* text, size_t length, int backspaces) {
+    // From here on backspaces count units of the output encoding
+    backspaces = EraseTyped(backspaces);
+    RecordTyped(encoding, text, length);
+    do {
+        size_t chunk = length < OutputCommand::TEXT_CAPACITY ? length : OutputCommand::TEXT_CAPACITY;
+        // Don't split a surrogate pair across two injections
+        if (chunk < length && chunk > 0 && text[chunk - 1] >= 0xD800 && text[chunk - 1] <= 0xDBFF) {
+            chunk--;
+        }
 
-        input[1].ki.wVk = 0;
-        input[1].ki.wScan = c;
-        input[1].ki.dwFlags = KEYEVENTF_UNICODE_FLAG | KEYEVENTF_KEYUP_FLAG;
-        input[1].ki.dwExtraInfo = INJECTED_KEY_MARKER;
+        OutputCommand& cmd = m_worker.Begin();
+        cmd.kind = kind;
+        cmd.encoding = static_cast<uint8_t>(encoding);
+        cmd.shift = false;
+        cmd.ctrl = false;
+        cmd.alt = false;
+        cmd.backspaces = backspaces;
+        cmd.vkCode = 0;
+        cmd.appId = m_appId;
+        cmd.length = chunk;
+        std::copy(text, text + chunk, cmd.text);
+        m_worker.Submit();
+
+        text += chunk;
+        length -= chunk;
+        backspaces = 0;
+    } while (length > 0);
+}
 
-        SendInput(2, input, sizeof(INPUT));
-        Sleep(15);
+void TextSender::BeginExclusiveOutput() {
+    m_exclusive.fetch_add(1, std::memory_order_acq_rel);
+    // Keys held until now go first (without an output thread they wait for
+    // the next FlushOutput())
+    while (m_worker.IsRunning() && m_worker.IsBusy()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    m_outputLock.lock();
 }
 
-// Clipboard mode: use clipboard + Ctrl+V for stubborn apps (Feature 4)
-void TextSender::SendTextClipboard(const std::wstring& text, int backspaces) {
-    // Step 1: Send backspaces as a single batch SendInput
-    if (backspaces > 0) {
-        std::vector<INPUT> bsInputs;
-        bsInputs.reserve(backspaces * 2);
-        for (int i = 0; i < backspaces; i++) {
-            INPUT down = {};
-            down.type = INPUT_KEYBOARD;
-            down.ki.wVk = VK_BACK;
-            down.ki.wScan = 0x0E;
-            down.ki.dwFlags = 0;
-            down.ki.dwExtraInfo = INJECTED_KEY_MARKER;
-            bsInputs.push_back(down);
-
-            INPUT up = {};
-            up.type = INPUT_KEYBOARD;
-            up.ki.wVk = VK_BACK;
-            up.ki.wScan = 0x0E;
-            up.ki.dwFlags = KEYEVENTF_KEYUP_FLAG;
-            up.ki.dwExtraInfo = INJECTED_KEY_MARKER;
-            bsInputs.push_back(up);
-        }
-        SendInput(static_cast<UINT>(bsInputs.size()), bsInputs.data(), sizeof(INPUT));
-    }
+void TextSender::EndExclusiveOutput() {
+    m_outputLock.unlock();
+    m_exclusive.fetch_sub(1, std::memory_order_acq_rel);
+}
 
-    if (text.empty()) return;
+void TextSender::Execute(const OutputCommand& cmd) {
+    std::lock_guard<std::mutex> lock(Instance().m_outputLock);
+    Platform& platform = Platform::Current();
+    uint64_t start = platform.TimestampNs();
+    Inject(cmd);
+    uint64_t end = platform.TimestampNs();
+    Instance().m_injectLatency.Record(end, end - start);
+}
 
-    // Delay between backspaces and clipboard paste
-    if (backspaces > 0) {
-        Sleep(20);
+void TextSender::Inject(const OutputCommand& cmd) {
+    Platform& platform = Platform::Current();
+    const wchar_t* text = nullptr;
+    size_t length = 0;
+    int backspaces = cmd.backspaces;
+    OutputCommand::Kind kind = cmd.kind;
+    uint8_t runEncoding = cmd.encoding;
+    if (FoldQueued(cmd, kind, runEncoding)) {
+        const PendingEdit& pending = Instance().m_pending;
+        text = pending.Text().c_str();
+        length = pending.Text().length();
+        backspaces = pending.Backspaces();
+    } else if (kind == OutputCommand::Kind::Key) {
+        platform.InjectKey(cmd.vkCode, cmd.shift, cmd.ctrl, cmd.alt);
+        return;
+    } else {
+        text = Encoded(cmd, length);
     }
 
-    // Step 2: Save previous clipboard content, set our text
-    if (!OpenClipboard(nullptr)) return;
-
-    // Save previous clipboard content
-    HGLOBAL hSaved = nullptr;
-    if (IsClipboardFormatAvailable(CF_UNICODETEXT)) {
-        HGLOBAL hClip = GetClipboardData(CF_UNICODETEXT);
-        if (hClip) {
-            SIZE_T clipSize = GlobalSize(hClip);
-            hSaved = GlobalAlloc(GMEM_MOVEABLE, clipSize);
-            if (hSaved) {
-                void* pSrc = GlobalLock(hClip);
-                void* pDst = GlobalLock(hSaved);
-                if (pSrc && pDst) {
-                    memcpy(pDst, pSrc, clipSize);
-                }
-                GlobalUnlock(hClip);
-                GlobalUnlock(hSaved);
-            }
-        }
+    switch (kind) {
+    case OutputCommand::Kind::Text:
+        platform.InjectText(text, length, backspaces);
+        break;
+    case OutputCommand::Kind::TextPaced: {
+        InjectionPacer& pacer = Instance().m_pacer;
+        pacer.Report(cmd.appId, platform.InjectTextPaced(text, length, backspaces, pacer.Pacing(cmd.appId)));
+        break;
     }
-
-    // Set our text to clipboard
-    EmptyClipboard();
-    size_t size = (text.length() + 1) * sizeof(wchar_t);
-    HGLOBAL hGlobal = GlobalAlloc(GMEM_MOVEABLE, size);
-    if (hGlobal) {
-        wchar_t* pGlobal = static_cast<wchar_t*>(GlobalLock(hGlobal));
-        if (pGlobal) {
-            wcscpy_s(pGlobal, text.length() + 1, text.c_str());
-            GlobalUnlock(hGlobal);
-            SetClipboardData(CF_UNICODETEXT, hGlobal);
-        } else {
-            GlobalFree(hGlobal);
-        }
+    case OutputCommand::Kind::Paste: {
+        // Clipboard mode: use clipboard + Ctrl+V for stubborn apps (Feature 4)
+        InjectionPacer& pacer = Instance().m_pacer;
+        pacer.Report(cmd.appId, platform.PasteText(std::wstring(text, length), backspaces, pacer.Pacing(cmd.appId)));
+        break;
     }
-    CloseClipboard();
-
-    // Step 3: Send Ctrl+V
-    Sleep(10);
-    keybd_event(VK_CONTROL, 0x1D, 0, INJECTED_KEY_MARKER);
-    Sleep(5);
-    keybd_event('V', 0x2F, 0, INJECTED_KEY_MARKER);
-    Sleep(10);
-    keybd_event('V', 0x2F, KEYEVENTF_KEYUP_FLAG, INJECTED_KEY_MARKER);
-    Sleep(5);
-    keybd_event(VK_CONTROL, 0x1D, KEYEVENTF_KEYUP_FLAG, INJECTED_KEY_MARKER);
-
-    // Step 4: Restore previous clipboard content (or clear ViKey's text)
-    // Wait for Ctrl+V to be fully processed by the target application
-    Sleep(150);
-
-    // Retry OpenClipboard up to 3 times (another app may hold the clipboard briefly)
-    bool clipboardOpened = false;
-    for (int attempt = 0; attempt < 3; attempt++) {
-        if (OpenClipboard(nullptr)) {
-            clipboardOpened = true;
-            break;
-        }
-        Sleep(50);
+    default:
+        break;
     }
+}
 
-    if (clipboardOpened) {
-        EmptyClipboard();
-        if (hSaved) {
-            // Restore the user's previous clipboard content
-            if (!SetClipboardData(CF_UNICODETEXT, hSaved)) {
-                GlobalFree(hSaved);
-            }
-            hSaved = nullptr; // Ownership transferred to clipboard or freed
-        }
-        // If hSaved was null (clipboard was empty), EmptyClipboard already
-        // cleared ViKey's text — user won't accidentally paste it later
-        CloseClipboard();
-    } else if (hSaved) {
-        GlobalFree(hSaved);
-    }
+const wchar_t* TextSender::Encoded(const OutputCommand& cmd, size_t& length) {
+    // Convert text if needed (Feature 8: App Encoding Memory)
+    length = cmd.length;
+    OutputEncoding encoding = static_cast<OutputEncoding>(cmd.encoding);
+    if (encoding == OutputEncoding::Unicode || length == 0) return cmd.text;
+    VietEncoding targetEnc = (encoding == OutputEncoding::VNI) ?
+        VietEncoding::VNI_Windows : VietEncoding::TCVN3;
+    std::wstring& converted = Instance().m_encoded;
+    converted = EncodingConverter::Instance().Convert(std::wstring(cmd.text, cmd.length), VietEncoding::Unicode, targetEnc);
+    length = converted.length();
+    return converted.c_str();
 }
 
-void TextSender::SendTextClipboardDeferred(const std::wstring& text, int backspaces) {
-    auto* data = new DeferredClipboardData{text, backspaces};
-    if (!PostMessage(g_hWnd, WM_DEFERRED_CLIPBOARD, 0, (LPARAM)data)) {
-        // PostMessage failed — fallback to synchronous
-        SendTextClipboard(text, backspaces);
-        delete data;
-    }
+// A held key that types a known character can join a run of text edits
+static bool IsTypedKey(const OutputCommand& cmd) {
+    return cmd.kind == OutputCommand::Kind::Key && cmd.length == 1;
 }
 
-void TextSender::ExecuteDeferredClipboard(DeferredClipboardData* data) {
-    if (!data) return;
-    TextSender::Instance().SendTextClipboard(data->text, data->backspaces);
-    delete data;
+bool TextSender::FoldQueued(const OutputCommand& cmd, OutputCommand::Kind& kind, uint8_t& encoding) {
+    OutputWorker& worker = Instance().m_worker;
+    const OutputCommand* next = worker.PeekQueued(0);
+    if (!next) return false;
+
+    // Typed keys only fold into the text edit that follows them
+    if (IsTypedKey(cmd)) {
+        size_t index = 0;
+        while (next && IsTypedKey(*next)) next = worker.PeekQueued(++index);
+        if (!next || next->kind == OutputCommand::Kind::Key) return false;
+        kind = next->kind;
+        encoding = next->encoding;
+        next = worker.PeekQueued(0);
+    } else if (cmd.kind == OutputCommand::Kind::Key) {
+        return false;
+    }
+
+    PendingEdit& pending = Instance().m_pending;
+    pending.Reset();
+    // Folded in the output encoding: backspaces count its units
+    size_t length = 0;
+    const wchar_t* text = Encoded(cmd, length);
+    pending.Fold(cmd.backspaces, text, length);
+    size_t count = 0;
+    for (; next != nullptr; next = worker.PeekQueued(++count)) {
+        if (next->appId != cmd.appId) break;
+        if (!IsTypedKey(*next) && (next->kind != kind || next->encoding != encoding)) break;
+        text = Encoded(*next, length);
+        pending.Fold(next->backspaces, text, length);
+    }
+    worker.MergeQueued(count);
+    return count > 0;
 }
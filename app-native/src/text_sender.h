@@ -1,18 +1,19 @@
 // ViKey - Text Sender
 // text_sender.h
-// Sends text using Win32 SendInput API with KEYEVENTF_UNICODE
+// Queues engine output for the output thread, which encodes it and injects
+// it through Platform (SendInput with KEYEVENTF_UNICODE on Win32)
 
 #pragma once
 
-#include <windows.h>
+#include "platform.h"
+#include "output_worker.h"
+#include "latency_histogram.h"
+#include "injection_pacer.h"
+#include "pending_edit.h"
+#include <atomic>
+#include <mutex>
 #include <string>
 
-// Heap-allocated data for deferred clipboard paste
-struct DeferredClipboardData {
-    std::wstring text;
-    int backspaces;
-};
-
 // Output encoding for per-app encoding (Feature 8)
 enum class OutputEncoding {
     Unicode = 0,
@@ -20,6 +21,14 @@ enum class OutputEncoding {
     TCVN3 = 2
 };
 
+// Per-app injection override (app rules); Auto follows slow/clipboard mode
+enum class InjectionMode : uint8_t {
+    Auto = 0,
+    Fast = 1,
+    Slow = 2,
+    Clipboard = 3
+};
+
 class TextSender {
 public:
     static TextSender& Instance();
@@ -32,21 +41,74 @@ public:
     void SetClipboardMode(bool clipboard) { m_clipboardMode = clipboard; }
     bool IsClipboardMode() const { return m_clipboardMode; }
 
+    // Injection mode of the foreground app, overriding slow/clipboard mode
+    void SetAppInjection(InjectionMode mode) { m_appInjection = mode; }
+    InjectionMode GetAppInjection() const { return m_appInjection; }
+
+    // Foreground app the next injections target (hook thread, on app
+    // change); slow and clipboard mode pace each app by its learned profile
+    // (below the default delay only once the app confirmed a clipboard paste)
+    void SetApp(uint32_t appId, const std::wstring& appName);
+    InjectionPacer& Pacer() { return m_pacer; }
+
+    // Force fast (batched SendInput) injection regardless of slow/clipboard
+    // mode; set while the hook watchdog has degraded processing
+    void SetForceFast(bool force) { m_forceFast = force; }
+    bool IsForceFast() const { return m_forceFast; }
+
     // Output encoding for per-app encoding (Feature 8)
     void SetOutputEncoding(OutputEncoding enc) { m_outputEncoding = enc; }
     OutputEncoding GetOutputEncoding() const { return m_outputEncoding; }
 
+    // Output thread. Until StartOutput() (headless runs), queued injections
+    // execute on the calling thread in FlushOutput() or when the queue fills.
+    void StartOutput() { m_worker.Start(); }
+    void StopOutput() { m_worker.Stop(); }
+    void FlushOutput() { m_worker.Flush(); }
+
+    // A key the hook let through to the app, now or replayed behind the
+    // queued output (hook thread): keeps the character widths in step.
+    // shortcut: pressed with Ctrl or Alt (it may paste or undo anything).
+    void NoteKey(int vkCode, bool shortcut = false);
+
+    // True while injections are queued or executing. Keys the hook would pass
+    // through must be queued with SendKey() instead, or they overtake them.
+    bool IsOutputBusy() const {
+        return m_worker.IsBusy() || m_exclusive.load(std::memory_order_acquire) > 0;
+    }
+
+    // Output outside the queue (the selection converter's Ctrl+C and paste,
+    // on its own thread): waits for the injections queued so far, then keeps
+    // the output thread off the keyboard and clipboard until
+    // EndExclusiveOutput(). The hook holds keys behind it meanwhile. Never
+    // call on the hook or output thread.
+    void BeginExclusiveOutput();
+    void EndExclusiveOutput();
+
+    // Injections queued while the queue was full (the app fell far behind)
+    uint64_t OutputOverflows() const { return m_worker.Overflows(); }
+
+    // Time the output thread spent per injection (recent windows)
+    LatencySnapshot InjectLatency(uint64_t nowNs) const { return m_injectLatency.Snapshot(nowNs); }
+
+    // The Send* calls below only queue the injection (hook thread only);
+    // the output thread executes them in call order.
+
     // Send text replacement: delete characters then insert new text
     void SendText(const std::wstring& text, int backspaces);
 
-    // Clipboard mode: use clipboard + Ctrl+V (for stubborn apps)
-    void SendTextClipboard(const std::wstring& text, int backspaces);
+    // Send UTF-16 text (e.g. ImeCompactResult::Text()); copied into the queue slot
+    void SendText(const wchar_t* text, size_t length, int backspaces);
 
-    // Post clipboard operation to main window (call from hook thread)
-    void SendTextClipboardDeferred(const std::wstring& text, int backspaces);
+    // Inject a single virtual key press (replaying a key that was held back).
+    // typed: the character it types, if known (KeyCodes::TypedChar); such a
+    // key queued among text edits is injected as part of them. Ctrl and Alt
+    // combinations (Ctrl+V, Ctrl+Z) replay with their modifiers.
+    void SendKey(int vkCode, bool shift, wchar_t typed = 0, bool ctrl = false, bool alt = false);
 
-    // Execute deferred clipboard operation (call from WndProc)
-    static void ExecuteDeferredClipboard(DeferredClipboardData* data);
+    // Clipboard + Ctrl+V (stubborn apps, long shortcut expansions)
+    void SendTextClipboardDeferred(const std::wstring& text, int backspaces);
+    void SendTextClipboardDeferred(const wchar_t* text, size_t length, int backspaces);
 
 private:
     TextSender();
@@ -54,13 +116,45 @@ private:
     TextSender(const TextSender&) = delete;
     TextSender& operator=(const TextSender&) = delete;
 
-    // Fast mode: batch all events (default)
-    void SendTextFast(const std::wstring& text, int backspaces);
+    // Queue text in slot-sized chunks (only the first chunk carries the backspaces)
+    void Enqueue(OutputCommand::Kind kind, OutputEncoding encoding, const wchar_t* text, size_t length, int backspaces);
+
+    // Hook thread: the engine counts backspaces in characters, but a letter
+    // in the app's encoding may take more (VNI writes ê as "eâ"). Returns
+    // the backspaces that erase the last count characters and forgets them.
+    // The widths live in the active typing context (RustBridge::Typed()).
+    int EraseTyped(int count);
+
+    // Hook thread: remember how many backspaces each character of text
+    // takes once written in encoding
+    void RecordTyped(OutputEncoding encoding, const wchar_t* text, size_t length);
+
+    // Output thread: encode and inject one command (timed)
+    static void Execute(const OutputCommand& cmd);
+    static void Inject(const OutputCommand& cmd);
+
+    // Output thread: cmd's text in the encoding it was queued for (its
+    // backspaces already count that encoding's units). Unicode, the common
+    // case, stays in the queue slot.
+    static const wchar_t* Encoded(const OutputCommand& cmd, size_t& length);
 
-    // Slow mode: send events one by one with delays (for problematic apps)
-    void SendTextSlow(const std::wstring& text, int backspaces);
+    // Fold the edits queued right behind cmd (same kind, encoding and app,
+    // and the typed keys held between them) into m_pending: one injection
+    // for a burst of keys that arrived while the output was busy. Returns
+    // false if nothing was queued to fold; kind and encoding are the run's.
+    static bool FoldQueued(const OutputCommand& cmd, OutputCommand::Kind& kind, uint8_t& encoding);
 
     bool m_slowMode;
     bool m_clipboardMode;
+    bool m_forceFast;
+    InjectionMode m_appInjection;
     OutputEncoding m_outputEncoding;
+    uint32_t m_appId;
+    InjectionPacer m_pacer;  // Learned delays per app (used by the output thread)
+    PendingEdit m_pending;   // Output thread only
+    std::wstring m_encoded;  // Output thread: last command text converted by Encoded()
+    LatencyRing m_injectLatency;  // Written by the output thread only
+    std::mutex m_outputLock;      // Held while a command or exclusive output runs
+    std::atomic<uint32_t> m_exclusive{0};  // Exclusive output waiting or running
+    OutputWorker m_worker;
 };
@@ -0,0 +1,255 @@
+// ViKey - Text Transform Implementation
+// text_transform.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "text_transform.h"
+#include "encoding_stream.h"
+#include "encoding_tables.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VIKEY_CONVERTER_SSE2 1
+#endif
+
+using EncodingTables::CharTable;
+using EncodingTables::DecodeTrie;
+
+// ============================================================
+// Stages, one letter at a time
+// ============================================================
+
+namespace {
+
+using EncodingTables::CASE_LETTERS;
+using EncodingTables::LETTER_COUNT;
+using EncodingTables::UNICODE_LETTERS;
+
+// Position of c in UNICODE_LETTERS, LETTER_COUNT if it is not a Vietnamese letter
+size_t LetterIndex(uint32_t c) {
+    for (size_t i = 0; i < LETTER_COUNT; i++) {
+        if (UNICODE_LETTERS[i] == c) return i;
+    }
+    return LETTER_COUNT;
+}
+
+// Base letter without tone, hat, breve or horn; đ becomes d
+uint32_t StripLetter(uint32_t c) {
+    size_t i = LetterIndex(c);
+    if (i == LETTER_COUNT) return c;
+    size_t row = (i % CASE_LETTERS) / 6;
+    uint32_t base = row == EncodingTables::VOWEL_ROWS ? 'd' : static_cast<uint32_t>(EncodingTables::VOWEL_BASES[row]);
+    return i < CASE_LETTERS ? base : base - 0x20;
+}
+
+// ASCII, Latin-1 and the Vietnamese letters (each has its pair in the table)
+uint32_t UpperLetter(uint32_t c) {
+    if (c - 'a' < 26) return c - 0x20;
+    size_t i = LetterIndex(c);
+    if (i < CASE_LETTERS) return UNICODE_LETTERS[i + CASE_LETTERS];
+    if (c >= 0xE0 && c <= 0xFE && c != 0xF7) return c - 0x20;
+    if (c == 0xFF) return 0x178;  // ÿ → Ÿ
+    return c;
+}
+
+uint32_t LowerLetter(uint32_t c) {
+    if (c - 'A' < 26) return c + 0x20;
+    size_t i = LetterIndex(c);
+    if (i != LETTER_COUNT && i >= CASE_LETTERS) return UNICODE_LETTERS[i - CASE_LETTERS];
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;
+    if (c == 0x178) return 0xFF;
+    return c;
+}
+
+// c through every stage in order (ComposeNfc works on sequences: the
+// tables below handle it)
+uint32_t ApplyStages(const std::vector<TransformStage>& stages, uint32_t c, bool wordStart) {
+    for (TransformStage stage : stages) {
+        switch (stage) {
+        case TransformStage::StripDiacritics: c = StripLetter(c); break;
+        case TransformStage::Upper: c = UpperLetter(c); break;
+        case TransformStage::Lower: c = LowerLetter(c); break;
+        case TransformStage::Title: c = wordStart ? UpperLetter(c) : LowerLetter(c); break;
+        case TransformStage::ComposeNfc: break;
+        }
+    }
+    return c;
+}
+
+// Letters, digits and combining marks continue a word (Title case);
+// Latin-1 symbols and the punctuation and symbol blocks end it
+inline bool IsWordUnit(uint32_t c) {
+    if (c < 0x80) return (c | 0x20) - 'a' < 26 || c - '0' < 10;
+    if (c < 0xC0 || c == 0xD7 || c == 0xF7) return false;
+    if (c >= 0x2000 && c < 0x2C00) return false;
+    return c < 0x3000 || c >= 0x3040;
+}
+
+// One table for the whole pipeline at one word position. Stripping folds
+// the marks into the letter, so it reads decomposed letters the way NFC
+// repair does: every form COMPOSITE_FORMS lists, one output unit each.
+DecodeTrie BuildTable(const std::vector<TransformStage>& stages, bool wordStart, bool compose) {
+    CharTable encoder = {};
+    auto add = [&](uint32_t c) {
+        uint32_t mapped = ApplyStages(stages, c, wordStart);
+        if (mapped != c) encoder.Add(c, mapped);
+    };
+    for (uint32_t c = 1; c < 0x80; c++) add(c);
+    for (uint32_t c = 0xC0; c <= 0xFF; c++) add(c);
+    add(0x178);
+    for (size_t i = 0; i < LETTER_COUNT; i++) add(UNICODE_LETTERS[i]);
+    encoder.asciiUnchanged = EncodingTables::AsciiUnchanged(encoder);
+    return compose ? EncodingTables::Compose(EncodingTables::COMPOSITE_TO_UNICODE, encoder)
+                   : EncodingTables::FromUnicode(encoder);
+}
+
+// ASCII letters in [first, first + 26) get their case flipped
+wchar_t* FlipCase(const wchar_t* text, size_t length, wchar_t* out, uint32_t first) {
+    size_t i = 0;
+#ifdef VIKEY_CONVERTER_SSE2
+    constexpr size_t LANES = 16 / sizeof(wchar_t);
+    const bool wide = sizeof(wchar_t) == 4;
+    auto all = [wide](uint32_t value) {
+        return wide ? _mm_set1_epi32(static_cast<int>(value)) : _mm_set1_epi16(static_cast<short>(value));
+    };
+    auto greater = [wide](__m128i a, __m128i b) { return wide ? _mm_cmpgt_epi32(a, b) : _mm_cmpgt_epi16(a, b); };
+    const __m128i below = all(first - 1), above = all(first + 26), flip = all(0x20);
+    for (; i + LANES <= length; i += LANES) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i letter = _mm_and_si128(greater(chunk, below), greater(above, chunk));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(chunk, _mm_and_si128(letter, flip)));
+    }
+#endif
+    for (; i < length; i++) {
+        uint32_t c = static_cast<uint32_t>(text[i]);
+        out[i] = static_cast<wchar_t>(c - first < 26 ? c ^ 0x20 : c);
+    }
+    return out + length;
+}
+
+} // namespace
+
+// ============================================================
+// Pipeline
+// ============================================================
+
+TextTransform::TextTransform(const std::vector<TransformStage>& stages)
+    : m_held(nullptr)
+    , m_asciiCase(AsciiCase::Mapped)
+    , m_title(false)
+    , m_wordStart(true)
+    , m_node(0)
+    , m_matched(0) {
+    bool compose = false;
+    bool title = false;
+    for (TransformStage stage : stages) {
+        compose = compose || stage == TransformStage::ComposeNfc || stage == TransformStage::StripDiacritics;
+        title = title || stage == TransformStage::Title;
+    }
+
+    bool upper = true, lower = true, copy = true;
+    for (uint32_t c = 0; c < 0x80; c++) {
+        for (int wordStart = 0; wordStart < 2; wordStart++) {
+            m_ascii[wordStart][c] = static_cast<wchar_t>(ApplyStages(stages, c, wordStart != 0));
+        }
+        uint32_t mapped = static_cast<uint32_t>(m_ascii[0][c]);
+        m_title = m_title || (title && m_ascii[0][c] != m_ascii[1][c]);
+        copy = copy && mapped == c;
+        upper = upper && mapped == UpperLetter(c);
+        lower = lower && mapped == LowerLetter(c);
+    }
+    if (!m_title) {
+        m_asciiCase = copy ? AsciiCase::Copy : upper ? AsciiCase::Upper : lower ? AsciiCase::Lower : AsciiCase::Mapped;
+    }
+
+    // Only Title case needs a second table: ASCII tells whether it changes anything
+    m_tables.reset(new DecodeTrie[m_title ? 2 : 1]);
+    m_tables[0] = BuildTable(stages, false, compose);
+    if (m_title) m_tables[1] = BuildTable(stages, true, compose);
+    m_table[0] = &m_tables[0];
+    m_table[1] = &m_tables[m_title ? 1 : 0];
+}
+
+TextTransform::~TextTransform() = default;
+
+wchar_t* TextTransform::MapAscii(const wchar_t* text, size_t length, wchar_t* out) {
+    switch (m_asciiCase) {
+    case AsciiCase::Copy:
+        std::memcpy(out, text, length * sizeof(wchar_t));
+        return out + length;
+    case AsciiCase::Upper: return FlipCase(text, length, out, 'a');
+    case AsciiCase::Lower: return FlipCase(text, length, out, 'A');
+    default: break;
+    }
+    for (size_t i = 0; i < length; i++) {
+        uint32_t c = static_cast<uint32_t>(text[i]);
+        *out++ = m_ascii[m_wordStart][c];
+        if (m_title) m_wordStart = !IsWordUnit(c);
+    }
+    return out;
+}
+
+size_t TextTransform::Push(const wchar_t* text, size_t length, wchar_t* out) {
+    using EncodingTables::NODE_SHIFT;
+    using EncodingTables::OUTPUT_MASK;
+    wchar_t* start = out;
+    size_t i = 0;
+    while (i < length) {
+        uint32_t c = static_cast<uint32_t>(text[i]);
+        if (m_node != 0) {
+            uint64_t entry = m_held->Next(m_node, c);
+            if (entry != 0) {
+                // A mark that continues the letter: hold on if more may follow
+                i++;
+                m_node = static_cast<uint32_t>(entry >> NODE_SHIFT);
+                m_matched = entry & OUTPUT_MASK;
+                if (m_node == 0) *out++ = static_cast<wchar_t>(m_matched);
+                continue;
+            }
+            *out++ = static_cast<wchar_t>(m_matched);
+            m_node = 0;
+        }
+        if (c < 0x80) {
+            // Map all but the last unit of the run: only it can be the
+            // base of a decomposed letter
+            size_t run = EncodingStream::AsciiRun(text + i, length - i) - 1;
+            out = MapAscii(text + i, run, out);
+            i += run;
+            c = static_cast<uint32_t>(text[i]);
+        }
+        i++;
+        const DecodeTrie* table = m_table[m_wordStart];
+        if (m_title) m_wordStart = !IsWordUnit(c);
+        uint64_t entry = table->Start(c);
+        uint64_t mapped = entry & OUTPUT_MASK;
+        if ((entry >> NODE_SHIFT) != 0) {
+            m_node = static_cast<uint32_t>(entry >> NODE_SHIFT);
+            m_held = table;
+            m_matched = mapped != 0 ? mapped : c;
+        } else {
+            *out++ = static_cast<wchar_t>(mapped != 0 ? mapped : c);
+        }
+    }
+    return static_cast<size_t>(out - start);
+}
+
+size_t TextTransform::Finish(wchar_t* out) {
+    m_wordStart = true;
+    if (m_node == 0) return 0;
+    m_node = 0;
+    *out = static_cast<wchar_t>(m_matched);
+    return 1;
+}
+
+std::wstring TextTransform::Apply(const std::wstring& text) {
+    constexpr size_t CHUNK = 4096;
+    wchar_t out[MaxOutput(CHUNK)];
+    std::wstring result;
+    result.reserve(text.size());
+    for (size_t at = 0; at < text.size(); at += CHUNK) {
+        size_t length = text.size() - at < CHUNK ? text.size() - at : CHUNK;
+        result.append(out, Push(text.data() + at, length, out));
+    }
+    result.append(out, Finish(out));
+    return result;
+}
@@ -0,0 +1,69 @@
+// ViKey - Text Transform
+// text_transform.h
+// Character-level transforms of Unicode text: "bỏ dấu" (strip the tones and
+// hats down to the base letter), UPPER, lower and Title case aware of the
+// Vietnamese letters, and NFC repair of decomposed letters. A pipeline of
+// stages compiles into one table (two for Title case) at construction, so
+// any chain runs as a single pass with no intermediate string; ASCII runs
+// are case mapped 16 bytes at a time with SSE2. Portable.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace EncodingTables {
+struct DecodeTrie;
+}
+
+enum class TransformStage : uint8_t {
+    StripDiacritics,  // ấ → a, Ư → U, đ → d
+    Upper,
+    Lower,
+    Title,            // Upper at the start of a word, lower inside it
+    ComposeNfc        // Decomposed letters (base + marks) to precomposed
+};
+
+class TextTransform {
+public:
+    // Output capacity Push() or Finish() may need for length input units
+    // (a letter never grows: its marks fold into one unit)
+    static constexpr size_t MaxOutput(size_t length) { return length + 2; }
+
+    // Stages apply in order; an empty list leaves text unchanged
+    explicit TextTransform(const std::vector<TransformStage>& stages);
+    ~TextTransform();
+    TextTransform(const TextTransform&) = delete;
+    TextTransform& operator=(const TextTransform&) = delete;
+
+    // Transform the next chunk into out (MaxOutput(length) units); returns
+    // the units written. A letter whose marks may continue into the next
+    // chunk is held back.
+    size_t Push(const wchar_t* text, size_t length, wchar_t* out);
+
+    // End of input: write the held letter, if any, and start over
+    size_t Finish(wchar_t* out);
+
+    // Whole text through the pipeline, a cache-sized chunk at a time
+    std::wstring Apply(const std::wstring& text);
+
+private:
+    enum class AsciiCase : uint8_t { Copy, Upper, Lower, Mapped };
+
+    // ASCII run before the last unit: copy, case map with SSE2, or map one
+    // unit at a time tracking the word (Title case)
+    wchar_t* MapAscii(const wchar_t* text, size_t length, wchar_t* out);
+
+    std::unique_ptr<EncodingTables::DecodeTrie[]> m_tables;
+    const EncodingTables::DecodeTrie* m_table[2];  // Inside a word, at its start
+    const EncodingTables::DecodeTrie* m_held;      // Table the held letter started in
+    wchar_t m_ascii[2][0x80];                      // ASCII through the pipeline, same order
+    AsciiCase m_asciiCase;
+    bool m_title;                                  // Tables differ by word position
+    bool m_wordStart;
+    uint32_t m_node;                               // Trie node of the held units, 0 if none
+    uint64_t m_matched;                            // Output for the held units as they are
+};
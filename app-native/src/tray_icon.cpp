@@ -171,6 +171,7 @@ void TrayIcon::InitializeMenu(HINSTANCE hInstance) {
         }
         ModifyMenuW(hPopup, IDM_IMPORT_SETTINGS, MF_BYCOMMAND | MF_STRING, IDM_IMPORT_SETTINGS, L"Nh\u1EADp c\u00E0i \u0111\u1EB7t...");
         ModifyMenuW(hPopup, IDM_CHECK_UPDATE, MF_BYCOMMAND | MF_STRING, IDM_CHECK_UPDATE, L"Ki\u1EC3m tra c\u1EADp nh\u1EADt");
+        ModifyMenuW(hPopup, IDM_DIAGNOSTICS, MF_BYCOMMAND | MF_STRING, IDM_DIAGNOSTICS, L"Ch\u1EA9n \u0111o\u00E1n...");
         ModifyMenuW(hPopup, IDM_ABOUT, MF_BYCOMMAND | MF_STRING, IDM_ABOUT, L"Gi\u1EDBi thi\u1EC7u");
         ModifyMenuW(hPopup, IDM_EXIT, MF_BYCOMMAND | MF_STRING, IDM_EXIT, L"Tho\u00E1t");
     }
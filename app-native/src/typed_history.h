@@ -0,0 +1,50 @@
+// ViKey - Typed Character History
+// typed_history.h
+// Backspaces each recently typed character takes in the target app. Kept
+// per typing context (RustBridge) so it follows the engine's word across
+// window switches. Not thread-safe: hook thread only.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class TypedHistory {
+public:
+    // The engine starts a new word: earlier characters take one backspace
+    void Reset() { m_count = 0; }
+
+    // A character typed into the app, taking width backspaces to erase
+    void Record(uint8_t width) {
+        m_widths[m_end++ & (SIZE - 1)] = width;
+        if (m_count < SIZE) m_count++;
+    }
+
+    // The user pressed Backspace: one unit of the last character is gone
+    // (the base of a VNI "eâ" stays)
+    void EraseUnit() {
+        if (m_count == 0) return;
+        uint8_t& width = m_widths[(m_end - 1) & (SIZE - 1)];
+        if (--width == 0) {
+            m_end--;
+            m_count--;
+        }
+    }
+
+    // Backspaces that erase the last count characters; forgets them
+    int Erase(int count) {
+        int backspaces = 0;
+        for (; count > 0 && m_count > 0; count--) {
+            m_end--;
+            m_count--;
+            backspaces += m_widths[m_end & (SIZE - 1)];
+        }
+        return backspaces + (count > 0 ? count : 0);
+    }
+
+private:
+    static constexpr size_t SIZE = 64;  // Power of two
+    uint8_t m_widths[SIZE] = {};  // Ring of widths
+    size_t m_end = 0;             // Ring position after the most recent character
+    size_t m_count = 0;           // Characters known; older ones take one backspace
+};
@@ -0,0 +1,162 @@
+// ViKey - UTF-8 Codec Implementation
+// utf8_codec.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+
+#include "utf8_codec.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VIKEY_CONVERTER_SSE2 1
+#endif
+
+namespace Utf8Codec {
+
+size_t WholeLength(const uint8_t* data, size_t length) {
+    for (size_t back = 1; back <= 3 && back <= length; back++) {
+        uint8_t b = data[length - back];
+        if ((b & 0xC0) == 0x80) continue;  // Continuation: look for its lead
+        size_t need = b >= 0xF0 ? 4 : b >= 0xE0 ? 3 : b >= 0xC0 ? 2 : 1;
+        return need > back ? length - back : length;
+    }
+    return length;  // No lead close enough: malformed either way
+}
+
+// One malformed byte, or the sequence at data[i]: writes it to out and
+// returns the bytes it took
+static inline size_t DecodeOne(const uint8_t* data, size_t i, size_t length, wchar_t*& out) {
+    static const uint32_t MIN_FOR_EXTRA[4] = {0, 0x80, 0x800, 0x10000};
+    uint8_t b = data[i];
+    if (b < 0x80) {
+        *out++ = static_cast<wchar_t>(b);
+        return 1;
+    }
+    size_t extra = b >= 0xF0 && b < 0xF5 ? 3 : b >= 0xE0 && b < 0xF0 ? 2 : b >= 0xC2 && b < 0xE0 ? 1 : 0;
+    uint32_t cp = b & (0x3F >> extra);
+    bool valid = extra > 0;
+    for (size_t k = 1; valid && k <= extra; k++) {
+        if (i + k >= length || (data[i + k] & 0xC0) != 0x80) {
+            valid = false;
+        } else {
+            cp = (cp << 6) | (data[i + k] & 0x3F);
+        }
+    }
+    if (valid && (cp < MIN_FOR_EXTRA[extra] || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)) valid = false;
+    if (!valid) {
+        *out++ = static_cast<wchar_t>(0xFFFD);
+        return 1;
+    }
+    if (sizeof(wchar_t) == 2 && cp > 0xFFFF) {
+        cp -= 0x10000;
+        *out++ = static_cast<wchar_t>(0xD800 + (cp >> 10));
+        *out++ = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+    } else {
+        *out++ = static_cast<wchar_t>(cp);
+    }
+    return extra + 1;
+}
+
+size_t Decode(const uint8_t* data, size_t length, wchar_t* out) {
+    wchar_t* start = out;
+    size_t i = 0;
+#ifdef VIKEY_CONVERTER_SSE2
+    // One test per 16 bytes: an all-ASCII block is widened at once, any
+    // other block is decoded one character at a time (a sequence may run
+    // into the next block)
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= length) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        if (_mm_movemask_epi8(chunk) != 0) {
+            for (size_t end = i + 16; i < end;) i += DecodeOne(data, i, length, out);
+            continue;
+        }
+        __m128i low = _mm_unpacklo_epi8(chunk, zero);
+        __m128i high = _mm_unpackhi_epi8(chunk, zero);
+        __m128i* dest = reinterpret_cast<__m128i*>(out);
+        if (sizeof(wchar_t) == 2) {
+            _mm_storeu_si128(dest, low);
+            _mm_storeu_si128(dest + 1, high);
+        } else {
+            _mm_storeu_si128(dest, _mm_unpacklo_epi16(low, zero));
+            _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(low, zero));
+            _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(high, zero));
+            _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(high, zero));
+        }
+        i += 16;
+        out += 16;
+    }
+#endif
+    while (i < length) i += DecodeOne(data, i, length, out);
+    return static_cast<size_t>(out - start);
+}
+
+// The character at text[i] (a surrogate pair whole): writes it to out and
+// returns the units it took
+static inline size_t EncodeOne(const wchar_t* text, size_t i, size_t length, char*& out) {
+    uint32_t cp = static_cast<uint32_t>(text[i]);
+    size_t units = 1;
+    if (cp < 0x80) {
+        *out++ = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp >= 0xD800 && cp <= 0xDFFF) {
+        uint32_t low = i + 1 < length ? static_cast<uint32_t>(text[i + 1]) : 0;
+        if (sizeof(wchar_t) == 2 && cp <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            units = 2;
+        } else {
+            cp = 0xFFFD;
+        }
+    } else if (cp > 0x10FFFF) {
+        cp = 0xFFFD;
+    }
+    if (cp < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (cp >> 6));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (cp >> 12));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xF0 | (cp >> 18));
+        *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return units;
+}
+
+size_t Encode(const wchar_t* text, size_t length, char* out) {
+    char* start = out;
+    size_t i = 0;
+#ifdef VIKEY_CONVERTER_SSE2
+    // Same blocks as Decode: 16 ASCII units narrow at once (values below
+    // 0x80 pack unchanged)
+    constexpr size_t LANES = 16 / sizeof(wchar_t);
+    const __m128i nonAscii = sizeof(wchar_t) == 2 ? _mm_set1_epi16(static_cast<short>(0xFF80))
+                                                  : _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= length) {
+        const __m128i* src = reinterpret_cast<const __m128i*>(text + i);
+        __m128i units[4] = {zero, zero, zero, zero};
+        __m128i any = zero;
+        for (size_t k = 0; k < 16 / LANES; k++) {
+            units[k] = _mm_loadu_si128(src + k);
+            any = _mm_or_si128(any, units[k]);
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(any, nonAscii), zero)) != 0xFFFF) {
+            for (size_t end = i + 16; i < end;) i += EncodeOne(text, i, length, out);
+            continue;
+        }
+        __m128i bytes = sizeof(wchar_t) == 2 ? _mm_packus_epi16(units[0], units[1])
+                                             : _mm_packus_epi16(_mm_packs_epi32(units[0], units[1]),
+                                                                _mm_packs_epi32(units[2], units[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+        i += 16;
+        out += 16;
+    }
+#endif
+    while (i < length) i += EncodeOne(text, i, length, out);
+    return static_cast<size_t>(out - start);
+}
+
+} // namespace Utf8Codec
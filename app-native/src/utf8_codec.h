@@ -0,0 +1,32 @@
+// ViKey - UTF-8 Codec
+// utf8_codec.h
+// UTF-8 to code units and back for the byte overloads of EncodingConverter:
+// the converter runs on wchar_t, so bytes are decoded a chunk at a time into
+// a buffer that stays in cache, never into a whole wide string. ASCII goes
+// 16 bytes per step with SSE2. Code units are UTF-16 where wchar_t is 16
+// bits (Windows), code points where it is 32. Portable.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Utf8Codec {
+
+// Longest UTF-8 for one code unit (a surrogate pair takes 4 bytes for 2)
+constexpr size_t MAX_BYTES_PER_UNIT = sizeof(wchar_t) == 2 ? 3 : 4;
+
+// The first length bytes of data, less a sequence cut short at the end:
+// where a chunk of a longer text may stop
+size_t WholeLength(const uint8_t* data, size_t length);
+
+// Decode into out (length units); returns the units written. Malformed
+// input (stray or missing continuation bytes, overlong forms, surrogates,
+// values past U+10FFFF) becomes U+FFFD, one per bad byte.
+size_t Decode(const uint8_t* data, size_t length, wchar_t* out);
+
+// Encode into out (length * MAX_BYTES_PER_UNIT bytes); returns the bytes
+// written. A surrogate without its pair becomes U+FFFD.
+size_t Encode(const wchar_t* text, size_t length, char* out);
+
+} // namespace Utf8Codec
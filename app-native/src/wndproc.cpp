@@ -19,6 +19,7 @@
 #include "keyboard_hook.h"
 #include "app_detector.h"
 #include "updater.h"
+#include "selection_convert.h"
 
 // Tray icon message ID (must match main.cpp and tray_icon.cpp)
 constexpr UINT WM_TRAYICON_MSG = WM_USER + 1;
@@ -105,6 +106,10 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             CheckForUpdatesManual();
             break;
 
+        case IDM_DIAGNOSTICS:
+            ShowDiagnosticsDialog();
+            break;
+
         case IDM_EXIT:
             if (TrayIcon::Instance().onExit)
                 TrayIcon::Instance().onExit();
@@ -123,12 +128,6 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         return 0;
     }
 
-    case WM_DEFERRED_CLIPBOARD: {
-        auto* data = reinterpret_cast<DeferredClipboardData*>(lParam);
-        TextSender::ExecuteDeferredClipboard(data);
-        return 0;
-    }
-
     case WM_SETTINGCHANGE: {
         if (lParam && wcscmp(reinterpret_cast<LPCWSTR>(lParam), L"ImmersiveColorSet") == 0) {
             RefreshDarkMode();
@@ -140,6 +139,17 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         HotkeyManager::Instance().ProcessHotkey(wParam);
         return 0;
 
+    case WM_SELECTION_DONE:
+        // Converted, unchanged and cancelled need no word; the rest left the text as it was
+        if (static_cast<SelectionStatus>(wParam) == SelectionStatus::NoSelection) {
+            TrayIcon::Instance().ShowBalloon(L"Chuy\u1EC3n m\u00E3",
+                                             L"Ch\u01B0a ch\u1ECDn v\u0103n b\u1EA3n \u0111\u1EC3 chuy\u1EC3n m\u00E3");
+        } else if (static_cast<SelectionStatus>(wParam) == SelectionStatus::Failed) {
+            TrayIcon::Instance().ShowBalloon(L"Chuy\u1EC3n m\u00E3",
+                                             L"Kh\u00F4ng sao ch\u00E9p \u0111\u01B0\u1EE3c v\u0103n b\u1EA3n \u0111ang ch\u1ECDn");
+        }
+        return 0;
+
     case WM_TIMER:
         if (wParam == TIMER_HOOK_CHECK) {
             KeyboardHook::Instance().EnsureInstalled();
@@ -0,0 +1,446 @@
+// ViKey - Batch file converter
+// vikey_convert.cpp
+// Project: ViKey | Author: Trần Công Sinh | https://github.com/kmis8x/ViKey
+//
+// Converts large files between Vietnamese encodings with EncodingConverter.
+// The input is memory-mapped and split into chunks at character boundaries;
+// a thread pool converts the chunks and the main thread writes them out in
+// order, holding at most a few chunks per thread in memory. POSIX.
+//
+// Usage: vikey-convert -f ENC -t ENC [-o OUT] [--bom] [--utf16] [--threads N]
+//                      [--chunk MB] [--quiet] INPUT
+//
+// Encodings: unicode (UTF-8, or UTF-16LE with a BOM), composite, vni, tcvn3,
+// viscii, cp1258, viqr; -f auto picks the source encoding from a sample of
+// the input. Legacy files (all but unicode and composite) are one byte per
+// code unit. An input BOM is always
+// recognized and dropped; --bom writes one to Unicode output.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "encoding_converter.h"
+#include "utf8_codec.h"
+
+// ============================================================
+// Byte formats
+// ============================================================
+
+// How the file stores code units: legacy encodings one byte per unit,
+// Unicode as UTF-8 or UTF-16LE
+enum class ByteFormat { Legacy, Utf8, Utf16 };
+
+static void DecodeUtf16(const uint8_t* data, size_t length, std::wstring& text) {
+    for (size_t i = 0; i + 1 < length; i += 2) {
+        uint32_t unit = data[i] | (data[i + 1] << 8);
+        if (sizeof(wchar_t) > 2 && unit >= 0xD800 && unit <= 0xDBFF && i + 3 < length) {
+            uint32_t low = data[i + 2] | (data[i + 3] << 8);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                text += static_cast<wchar_t>(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+                i += 2;
+                continue;
+            }
+        }
+        text += static_cast<wchar_t>(unit);
+    }
+}
+
+static void Decode(const uint8_t* data, size_t length, ByteFormat format, std::wstring& text) {
+    text.clear();
+    text.reserve(length);
+    switch (format) {
+        case ByteFormat::Utf8: text.resize(length); text.resize(Utf8Codec::Decode(data, length, &text[0])); break;
+        case ByteFormat::Utf16: DecodeUtf16(data, length, text); break;
+        default: text.assign(data, data + length); break;
+    }
+}
+
+// Code point at text[i]; advances i past a surrogate pair
+static uint32_t NextCodePoint(const std::wstring& text, size_t& i) {
+    uint32_t c = static_cast<uint32_t>(text[i]);
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < text.size()) {
+        uint32_t low = static_cast<uint32_t>(text[i + 1]);
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+            i++;
+            return 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+        }
+    }
+    return c;
+}
+
+// Units a legacy byte cannot hold are written as '?'
+static void Encode(const std::wstring& text, ByteFormat format, std::string& out) {
+    if (format == ByteFormat::Utf8) {
+        out.resize(text.size() * Utf8Codec::MAX_BYTES_PER_UNIT);
+        out.resize(Utf8Codec::Encode(text.data(), text.size(), &out[0]));
+        return;
+    }
+    // Worst case: a surrogate pair, four bytes for two units
+    out.resize(format == ByteFormat::Legacy ? text.size() : text.size() * 4);
+    char* p = &out[0];
+    for (size_t i = 0; i < text.size(); i++) {
+        uint32_t unit = static_cast<uint32_t>(text[i]);
+        if (format == ByteFormat::Legacy) {
+            *p++ = unit <= 0xFF ? static_cast<char>(unit) : '?';
+            continue;
+        }
+        uint32_t cp = NextCodePoint(text, i);
+        if (cp > 0xFFFF) {
+            cp -= 0x10000;
+            uint32_t high = 0xD800 + (cp >> 10);
+            *p++ = static_cast<char>(high & 0xFF);
+            *p++ = static_cast<char>(high >> 8);
+            cp = 0xDC00 + (cp & 0x3FF);
+        }
+        *p++ = static_cast<char>(cp & 0xFF);
+        *p++ = static_cast<char>(cp >> 8);
+    }
+    out.resize(static_cast<size_t>(p - out.data()));
+}
+
+// ============================================================
+// Chunking
+// ============================================================
+
+// ASCII units that may be part of a letter: bases, and the VIQR marks
+static bool InLetter(uint32_t c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c != 0 && std::strchr("(^+`?~'.\\", static_cast<int>(c)));
+}
+
+// A chunk may end after an ASCII unit that is part of no letter: it never
+// starts a VNI, Windows-1258 or VIQR letter and never sits inside a UTF-8 or
+// UTF-16 character, so every chunk converts on its own exactly as it would
+// inside the whole file.
+static bool SafeEnd(const uint8_t* data, size_t end, ByteFormat format) {
+    if (format == ByteFormat::Utf16) {
+        return end % 2 == 0 && data[end - 1] == 0 && data[end - 2] < 0x80 && !InLetter(data[end - 2]);
+    }
+    return data[end - 1] < 0x80 && !InLetter(data[end - 1]);
+}
+
+// Fallback for text with no such unit nearby: a character boundary, which
+// only a letter split from its marks can notice
+static bool CharacterEnd(const uint8_t* data, size_t size, size_t end, ByteFormat format) {
+    switch (format) {
+        case ByteFormat::Utf8: return (data[end] & 0xC0) != 0x80;
+        case ByteFormat::Utf16: return end % 2 == 0 && end + 1 < size && (data[end + 1] & 0xFC) != 0xDC;
+        default: return true;
+    }
+}
+
+static std::vector<size_t> SplitChunks(const uint8_t* data, size_t size, size_t begin, size_t target, ByteFormat format) {
+    const size_t SEARCH_LIMIT = 1 << 20;
+    std::vector<size_t> ends;
+    size_t start = begin;
+    while (size - start > target) {
+        size_t want = start + target;
+        size_t limit = std::min(size, want + SEARCH_LIMIT);
+        size_t end = want;
+        while (end < limit && !SafeEnd(data, end, format)) end++;
+        if (end == limit) {
+            end = want;
+            while (end < size && !CharacterEnd(data, size, end, format)) end++;
+        }
+        if (end >= size) break;
+        ends.push_back(end);
+        start = end;
+    }
+    ends.push_back(size);
+    return ends;
+}
+
+// ============================================================
+// Pipeline
+// ============================================================
+
+struct Options {
+    VietEncoding from = VietEncoding::Unicode;
+    VietEncoding to = VietEncoding::Unicode;
+    bool hasFrom = false;
+    bool hasTo = false;
+    bool detect = false;  // -f auto
+    std::string input;
+    std::string output = "-";
+    bool bom = false;
+    bool utf16 = false;
+    unsigned threads = 0;  // 0: one per core
+    size_t chunkBytes = 4 << 20;
+    bool quiet = false;
+};
+
+struct Chunk {
+    size_t begin = 0;
+    size_t end = 0;
+    std::string out;
+    bool done = false;
+};
+
+// Chunks converted in parallel; the writer takes them in order and workers
+// stay at most `window` chunks ahead of it
+class ChunkPipeline {
+public:
+    ChunkPipeline(const uint8_t* data, std::vector<Chunk>& chunks, const Options& options,
+                  ByteFormat inFormat, ByteFormat outFormat)
+        : m_data(data), m_chunks(chunks), m_options(options)
+        , m_inFormat(inFormat), m_outFormat(outFormat)
+        , m_next(0), m_written(0), m_window(0) {
+    }
+
+    // Convert all chunks on `threads` workers; write(chunk) runs on the
+    // calling thread in chunk order
+    template <typename Write>
+    void Run(unsigned threads, Write write) {
+        m_window = threads * 2;
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; i++) workers.emplace_back([this] { Work(); });
+        for (size_t i = 0; i < m_chunks.size(); i++) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_doneCv.wait(lock, [&] { return m_chunks[i].done; });
+            lock.unlock();
+            write(m_chunks[i]);
+            std::string().swap(m_chunks[i].out);
+            lock.lock();
+            m_written = i + 1;
+            m_writtenCv.notify_all();
+        }
+        for (std::thread& worker : workers) worker.join();
+    }
+
+private:
+    void Work() {
+        std::wstring text;
+        for (;;) {
+            size_t i = m_next.fetch_add(1);
+            if (i >= m_chunks.size()) return;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_writtenCv.wait(lock, [&] { return i < m_written + m_window; });
+            }
+            Chunk& chunk = m_chunks[i];
+            EncodingConverter& converter = EncodingConverter::Instance();
+            if (m_inFormat != ByteFormat::Utf16 && m_outFormat != ByteFormat::Utf16) {
+                // UTF-8 and legacy bytes convert straight into the chunk's output
+                StringSink sink(chunk.out);
+                converter.Convert(m_data + chunk.begin, chunk.end - chunk.begin, sink, m_options.from, m_options.to);
+            } else {
+                Decode(m_data + chunk.begin, chunk.end - chunk.begin, m_inFormat, text);
+                Encode(converter.Convert(text, m_options.from, m_options.to), m_outFormat, chunk.out);
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            chunk.done = true;
+            m_doneCv.notify_all();
+        }
+    }
+
+    const uint8_t* m_data;
+    std::vector<Chunk>& m_chunks;
+    const Options& m_options;
+    ByteFormat m_inFormat;
+    ByteFormat m_outFormat;
+    std::atomic<size_t> m_next;
+    size_t m_written;  // Guarded by m_mutex
+    size_t m_window;
+    std::mutex m_mutex;
+    std::condition_variable m_doneCv;
+    std::condition_variable m_writtenCv;
+};
+
+// ============================================================
+// Command line
+// ============================================================
+
+static bool ParseEncoding(const char* name, VietEncoding& encoding) {
+    struct Name { const char* name; VietEncoding encoding; };
+    static const Name NAMES[] = {
+        {"unicode", VietEncoding::Unicode}, {"utf8", VietEncoding::Unicode}, {"utf-8", VietEncoding::Unicode},
+        {"composite", VietEncoding::Unicode_Comp}, {"nfd", VietEncoding::Unicode_Comp},
+        {"vni", VietEncoding::VNI_Windows}, {"tcvn3", VietEncoding::TCVN3}, {"abc", VietEncoding::TCVN3},
+        {"viscii", VietEncoding::VISCII}, {"cp1258", VietEncoding::CP1258}, {"windows-1258", VietEncoding::CP1258},
+        {"viqr", VietEncoding::VIQR},
+    };
+    for (const Name& n : NAMES) {
+        if (strcasecmp(name, n.name) == 0) {
+            encoding = n.encoding;
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::string Name(VietEncoding encoding) {
+    const wchar_t* name = EncodingConverter::GetEncodingName(encoding);
+    return std::string(name, name + std::wcslen(name));  // ASCII
+}
+
+static bool IsUnicode(VietEncoding encoding) {
+    return encoding == VietEncoding::Unicode || encoding == VietEncoding::Unicode_Comp;
+}
+
+static void Usage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s -f ENC -t ENC [-o OUT] [--bom] [--utf16] [--threads N] [--chunk MB] [--quiet] INPUT\n"
+                 "Encodings: unicode, composite, vni, tcvn3, viscii, cp1258, viqr (-f auto: detect)\n", program);
+}
+
+// -f auto: read the start of the input as UTF-8 (UTF-16LE after its BOM)
+// if it decodes cleanly, as legacy bytes if not, and take the best guess
+static void DetectSource(const uint8_t* data, size_t size, Options& options) {
+    const size_t SAMPLE_BYTES = 64 << 10;
+    size_t length = std::min(size, SAMPLE_BYTES);
+    // Whole characters only: drop a UTF-8 sequence cut at the end
+    size_t whole = length;
+    while (whole > 0 && length < size && (data[whole] & 0xC0) == 0x80) whole--;
+    std::wstring sample;
+    if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+        DecodeUtf16(data + 2, length - 2, sample);
+    } else {
+        Decode(data, whole, ByteFormat::Utf8, sample);
+        if (sample.find(L'\xFFFD') != std::wstring::npos) sample.assign(data, data + length);
+    }
+    std::vector<EncodingGuess> guesses = EncodingConverter::Detect(sample);
+    options.from = guesses.front().encoding;
+    if (!options.quiet) {
+        std::fprintf(stderr, "Detected %s (%.0f%%", Name(options.from).c_str(), guesses.front().confidence * 100.0);
+        if (guesses.size() > 1) {
+            std::fprintf(stderr, "; next %s %.0f%%", Name(guesses[1].encoding).c_str(), guesses[1].confidence * 100.0);
+        }
+        std::fprintf(stderr, ")\n");
+    }
+}
+
+static bool ParseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if ((std::strcmp(arg, "-f") == 0 || std::strcmp(arg, "--from") == 0) && hasValue) {
+            const char* name = argv[++i];
+            options.detect = strcasecmp(name, "auto") == 0;
+            if (!options.detect && !ParseEncoding(name, options.from)) return false;
+            options.hasFrom = true;
+        } else if ((std::strcmp(arg, "-t") == 0 || std::strcmp(arg, "--to") == 0) && hasValue) {
+            if (!ParseEncoding(argv[++i], options.to)) return false;
+            options.hasTo = true;
+        } else if ((std::strcmp(arg, "-o") == 0 || std::strcmp(arg, "--output") == 0) && hasValue) {
+            options.output = argv[++i];
+        } else if (std::strcmp(arg, "--bom") == 0) {
+            options.bom = true;
+        } else if (std::strcmp(arg, "--utf16") == 0) {
+            options.utf16 = true;
+        } else if (std::strcmp(arg, "--threads") == 0 && hasValue) {
+            options.threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(arg, "--chunk") == 0 && hasValue) {
+            options.chunkBytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i]))) << 20;
+        } else if (std::strcmp(arg, "--quiet") == 0 || std::strcmp(arg, "-q") == 0) {
+            options.quiet = true;
+        } else if (arg[0] != '-' && options.input.empty()) {
+            options.input = arg;
+        } else {
+            return false;
+        }
+    }
+    return options.hasFrom && options.hasTo && !options.input.empty();
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    int fd = open(options.input.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::fprintf(stderr, "Cannot open %s\n", options.input.c_str());
+        return 1;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    const uint8_t* data = nullptr;
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            std::fprintf(stderr, "Cannot map %s\n", options.input.c_str());
+            return 1;
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const uint8_t*>(mapped);
+    }
+
+    FILE* out = options.output == "-" ? stdout : std::fopen(options.output.c_str(), "wb");
+    if (!out) {
+        std::fprintf(stderr, "Cannot write %s\n", options.output.c_str());
+        return 1;
+    }
+
+    if (options.detect) DetectSource(data, size, options);
+
+    // Input BOM decides between UTF-8 and UTF-16LE and is dropped
+    ByteFormat inFormat = IsUnicode(options.from) ? ByteFormat::Utf8 : ByteFormat::Legacy;
+    size_t begin = 0;
+    if (inFormat == ByteFormat::Utf8 && size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        begin = 3;
+    } else if (inFormat == ByteFormat::Utf8 && size >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+        inFormat = ByteFormat::Utf16;
+        begin = 2;
+    }
+    ByteFormat outFormat = !IsUnicode(options.to) ? ByteFormat::Legacy : options.utf16 ? ByteFormat::Utf16 : ByteFormat::Utf8;
+    if (options.bom && outFormat != ByteFormat::Legacy) {
+        std::fputs(outFormat == ByteFormat::Utf16 ? "\xFF\xFE" : "\xEF\xBB\xBF", out);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<Chunk> chunks;
+    if (size > begin) {
+        size_t chunkStart = begin;
+        for (size_t end : SplitChunks(data, size, begin, options.chunkBytes, inFormat)) {
+            Chunk chunk;
+            chunk.begin = chunkStart;
+            chunk.end = end;
+            chunks.push_back(std::move(chunk));
+            chunkStart = end;
+        }
+    }
+
+    unsigned threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(1, chunks.size())));
+    size_t written = 0;
+    bool writeFailed = false;
+    ChunkPipeline pipeline(data, chunks, options, inFormat, outFormat);
+    pipeline.Run(threads, [&](const Chunk& chunk) {
+        if (std::fwrite(chunk.out.data(), 1, chunk.out.size(), out) != chunk.out.size()) writeFailed = true;
+        written += chunk.out.size();
+    });
+    if (std::fflush(out) != 0) writeFailed = true;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (out != stdout) std::fclose(out);
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    close(fd);
+
+    if (writeFailed) {
+        std::fprintf(stderr, "Write failed: %s\n", options.output.c_str());
+        return 1;
+    }
+    if (!options.quiet) {
+        std::fprintf(stderr, "%s -> %s: %zu bytes in, %zu bytes out, %zu chunks on %u threads, %.3f s, %.0f MB/s\n",
+                     Name(options.from).c_str(), Name(options.to).c_str(), size, written, chunks.size(),
+                     threads, seconds, seconds > 0 ? size / seconds / 1e6 : 0.0);
+    }
+    return 0;
+}
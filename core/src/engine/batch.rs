@@ -0,0 +1,140 @@
+//! Batched key processing
+//!
+//! Folds a burst of keys into ONE net edit (backspaces + text), so a host
+//! that queued keys while an injection was in flight can apply them with a
+//! single injection instead of one per key.
+//!
+//! The fold follows the same screen model as per-key processing:
+//! - `Send` replaces `backspace` chars with `chars`; a break key that is not
+//!   consumed (punctuation after auto-restore) still types itself after it
+//! - `None` passes the key through: its char is typed, DELETE erases one char
+//!
+//! Backspaces that erase text produced earlier in the batch cancel against
+//! it instead of being emitted, so "vieejt" folds to `backspace=0, "việt"`.
+
+use super::helpers::key_typed_char;
+use super::types::{Action, KeyEvent, Result, FLAG_MORE_PENDING};
+use super::Engine;
+use crate::data::keys;
+use crate::engine::buffer::MAX;
+
+/// Output capacity of the net edit (`Result::count` is a u8)
+const TEXT_CAP: usize = MAX - 1;
+
+/// Backspace capacity of the net edit (`Result::backspace` is a u8)
+const BACKSPACE_CAP: usize = u8::MAX as usize;
+
+/// Check if a key can be folded into a batch
+///
+/// Modifier shortcuts and navigation/commit keys (Enter, Tab, Esc, arrows)
+/// move the caret or leave the text field, so the batch stops before them
+/// and the host processes them individually.
+pub(super) fn is_batchable(ev: &KeyEvent) -> bool {
+    if ev.ctrl {
+        return false;
+    }
+    ev.key == keys::SPACE || ev.key == keys::DELETE || key_char(ev).is_some()
+}
+
+/// Character typed by a key when it passes through the engine
+fn key_char(ev: &KeyEvent) -> Option<char> {
+    key_typed_char(ev.key, ev.caps, ev.shift)
+}
+
+/// Fold one edit (`backspace` erases, then `text` is typed) into `out`
+///
+/// Returns false (leaving `out` untouched) if the combined edit would not fit.
+fn fold(out: &mut Result, backspace: usize, text: &[u32]) -> bool {
+    let count = out.count as usize;
+    let cancelled = backspace.min(count);
+    let deleted = out.backspace as usize + (backspace - cancelled);
+    let kept = count - cancelled;
+    if deleted > BACKSPACE_CAP || kept + text.len() > TEXT_CAP {
+        return false;
+    }
+    out.chars[kept..kept + text.len()].copy_from_slice(text);
+    out.backspace = deleted as u8;
+    out.count = (kept + text.len()) as u8;
+    true
+}
+
+/// Fold the on-screen effect of one key's result into `out`
+fn fold_key(out: &mut Result, ev: &KeyEvent, r: &Result) -> bool {
+    if r.action != Action::None as u8 {
+        let text = &r.chars[..r.count as usize];
+        let types_itself = ev.key != keys::SPACE
+            && ev.key != keys::DELETE
+            && keys::is_break_ext(ev.key, ev.shift)
+            && !r.key_consumed();
+        if !types_itself {
+            return fold(out, r.backspace as usize, text);
+        }
+        // Replacement plus the break char itself, folded atomically
+        let c = key_char(ev).map_or(0, |c| c as u32);
+        let (bs, count) = (out.backspace, out.count);
+        if fold(out, r.backspace as usize, text) && fold(out, 0, &[c]) {
+            return true;
+        }
+        (out.backspace, out.count) = (bs, count);
+        return false;
+    }
+    if r.key_consumed() {
+        true
+    } else if ev.key == keys::DELETE {
+        fold(out, 1, &[])
+    } else if ev.key == keys::SPACE {
+        fold(out, 0, &[' ' as u32])
+    } else {
+        fold(out, 0, &[key_char(ev).map_or(0, |c| c as u32)])
+    }
+}
+
+/// Process `events` as one batch, writing the coalesced net edit to `out`
+///
+/// Stops at the first non-batchable key. Returns the number of events
+/// consumed; the host handles the rest (or re-submits them).
+///
+/// If a key's own edit no longer fits next to what was already folded, the
+/// key is still processed (engine state has advanced) and its edit is carried
+/// to the next call: `out.flags` gets `FLAG_MORE_PENDING` and the host must
+/// call again - with no events if needed - to collect it before anything else.
+pub(super) fn on_keys_batch(e: &mut Engine, events: &[KeyEvent], out: &mut Result) -> usize {
+    out.action = Action::None as u8;
+    out.backspace = 0;
+    out.count = 0;
+    out.flags = 0;
+
+    if let Some(carry) = e.batch_carry.take() {
+        // A single key's edit always fits an empty net edit
+        fold(
+            out,
+            carry.backspace as usize,
+            &carry.chars[..carry.count as usize],
+        );
+    }
+
+    let mut consumed = 0;
+    for ev in events {
+        if !is_batchable(ev) {
+            break;
+        }
+        let r = e.on_key_ext(ev.key, ev.caps, false, ev.shift);
+        consumed += 1;
+        if !fold_key(out, ev, &r) {
+            let mut carry = Result::none();
+            fold_key(&mut carry, ev, &r);
+            e.batch_carry = Some(carry);
+            out.flags |= FLAG_MORE_PENDING;
+            break;
+        }
+    }
+
+    if out.backspace > 0 || out.count > 0 {
+        out.action = Action::Send as u8;
+    }
+    consumed
+}
+
+#[cfg(test)]
+#[path = "batch_tests.rs"]
+mod tests;
@@ -0,0 +1,137 @@
+use super::*;
+use crate::engine::shortcut::Shortcut;
+use crate::utils::{char_to_key, type_word};
+
+/// Build batch events from test input ('<' = DELETE, like `type_word`)
+fn events(input: &str) -> Vec<KeyEvent> {
+    input
+        .chars()
+        .map(|c| KeyEvent::new(char_to_key(c), c.is_uppercase(), false))
+        .collect()
+}
+
+/// Apply a net edit to a screen string
+fn apply(screen: &mut String, r: &Result) {
+    for _ in 0..r.backspace {
+        screen.pop();
+    }
+    for &cp in &r.chars[..r.count as usize] {
+        screen.extend(char::from_u32(cp));
+    }
+}
+
+/// Feed `input` in chunks of `chunk` keys, applying each net edit
+fn type_batched(e: &mut Engine, input: &str, chunk: usize) -> String {
+    let evs = events(input);
+    let mut screen = String::new();
+    let mut out = Result::none();
+    for part in evs.chunks(chunk) {
+        let mut rest = part;
+        loop {
+            let n = e.on_keys_batch(rest, &mut out);
+            apply(&mut screen, &out);
+            rest = &rest[n..];
+            if out.flags & FLAG_MORE_PENDING == 0 && rest.is_empty() {
+                break;
+            }
+            assert!(n > 0 || out.count > 0 || out.backspace > 0, "no progress");
+        }
+    }
+    screen
+}
+
+#[test]
+fn batch_matches_per_key_screen() {
+    let inputs = [
+        "vieejt",
+        "vieejt nam ddaats nuwowcs ",
+        "hello text ",
+        "tieengs vieejt<<<t cos daaus ",
+        "abc<<<<<xyz",
+        "dduwowcj, khoong. ",
+    ];
+    for input in inputs {
+        for chunk in [1, 2, 3, 7, 64] {
+            let expected = type_word(&mut Engine::new(), input);
+            let got = type_batched(&mut Engine::new(), input, chunk);
+            assert_eq!(got, expected, "input {:?}, chunk {}", input, chunk);
+        }
+    }
+}
+
+#[test]
+fn batch_cancels_backspaces_inside_batch() {
+    let mut e = Engine::new();
+    let mut out = Result::none();
+    let n = e.on_keys_batch(&events("vieejt"), &mut out);
+    assert_eq!(n, 6);
+    assert_eq!(out.action, Action::Send as u8);
+    assert_eq!(out.backspace, 0);
+    let text: String = out.chars[..out.count as usize]
+        .iter()
+        .filter_map(|&c| char::from_u32(c))
+        .collect();
+    assert_eq!(text, "việt");
+}
+
+#[test]
+fn batch_deletes_before_batch_are_emitted() {
+    let mut e = Engine::new();
+    let mut out = Result::none();
+    e.on_keys_batch(&events("vie"), &mut out);
+    // "vie" is on screen; next batch rewrites "e" → "ệ" and erases nothing else
+    e.on_keys_batch(&events("ej<<"), &mut out);
+    let mut screen = String::from("vie");
+    apply(&mut screen, &out);
+    assert_eq!(screen, type_word(&mut Engine::new(), "vieej<<"));
+}
+
+#[test]
+fn batch_stops_at_non_batchable_key() {
+    let mut e = Engine::new();
+    let mut out = Result::none();
+    let mut evs = events("ab");
+    evs.push(KeyEvent {
+        ctrl: true,
+        ..KeyEvent::new(keys::C, false, false)
+    });
+    evs.extend(events("cd"));
+    assert_eq!(e.on_keys_batch(&evs, &mut out), 2);
+    assert_eq!(out.count, 2);
+
+    let ret = KeyEvent::new(keys::RETURN, false, false);
+    assert_eq!(e.on_keys_batch(&[ret], &mut out), 0);
+    assert_eq!(out.action, Action::None as u8);
+}
+
+#[test]
+fn batch_carries_edit_that_does_not_fit() {
+    let long = "x".repeat(200);
+    let mut e = Engine::new();
+    e.shortcuts_mut().add(Shortcut::new("zz", &long));
+
+    // 100 pass-through chars, then a 200-char expansion: cannot share one result
+    let input = format!("{} zz ", "a".repeat(99));
+    let expected = type_word(
+        &mut {
+            let mut r = Engine::new();
+            r.shortcuts_mut().add(Shortcut::new("zz", &long));
+            r
+        },
+        &input,
+    );
+
+    let evs = events(&input);
+    let mut out = Result::none();
+    let n = e.on_keys_batch(&evs, &mut out);
+    assert_eq!(n, evs.len());
+    assert_ne!(out.flags & FLAG_MORE_PENDING, 0);
+    let mut screen = String::new();
+    apply(&mut screen, &out);
+
+    // Collect the carried edit with an empty batch
+    assert_eq!(e.on_keys_batch(&[], &mut out), 0);
+    assert_eq!(out.flags & FLAG_MORE_PENDING, 0);
+    apply(&mut screen, &out);
+    assert_eq!(screen, expected);
+}
@@ -127,6 +127,11 @@ pub(super) fn break_key_to_char(key: u16, shift: bool) -> Option<char> {
     }
 }
 
+/// Character a key types when the engine passes it through
+pub(super) fn key_typed_char(key: u16, caps: bool, shift: bool) -> Option<char> {
+    utils::key_to_char_ext(key, caps, shift).or_else(|| break_key_to_char(key, shift))
+}
+
 /// Rebuild output from position `from` to end of buffer.
 /// Backspace count = number of chars from `from` to end.
 pub(super) fn rebuild_from(buf: &Buffer, from: usize) -> Result {
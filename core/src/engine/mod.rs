@@ -19,6 +19,7 @@ pub mod transform;
 pub mod validation;
 
 mod types;
+mod batch;
 mod helpers;
 mod key_handler;
 mod tone_handler;
@@ -30,12 +31,16 @@ mod letter_handler;
 mod auto_restore;
 mod english_pattern;
 mod raw_input;
+mod screen;
 #[cfg(test)]
 mod tests;
 
 use types::Transform;
-pub use types::{Action, Result};
+pub use types::{
+    Action, CompactResult, KeyEvent, Result, COMPACT_INLINE, FLAG_KEY_CONSUMED, FLAG_MORE_PENDING,
+};
 use helpers::WordHistory;
+use screen::Screen;
 
 use crate::data::{
     chars,
@@ -159,6 +164,14 @@ pub struct Engine {
     /// Enable/disable shortcut expansion
     /// When false, shortcuts are not triggered
     pub(super) shortcuts_enabled: bool,
+    /// UTF-16 spill buffer for `CompactResult` output longer than the inline
+    /// capacity (shortcut expansions). Reused across keys; capacity is kept.
+    pub(super) compact_overflow: Vec<u16>,
+    /// Edit of the last batched key that did not fit the previous batch
+    /// result; emitted first by the next `on_keys_batch` call
+    pub(super) batch_carry: Option<Result>,
+    pub(super) minimal_diff: bool,
+    pub(super) screen: Screen,
 }
 
 impl Default for Engine {
@@ -207,6 +220,31 @@ impl Engine {
             saw_sentence_ending: false,
             allow_foreign_consonants: false, // Default: OFF
             shortcuts_enabled: true, // Default: ON
+            compact_overflow: Vec::new(),
+            batch_carry: None,
+            minimal_diff: false, // Default: OFF (hosts that track the caret turn it on)
+            screen: Screen::new(),
+        }
+    }
+
+    /// Create an engine with the same settings and shortcuts as `self`
+    /// but fresh typing state (empty buffer and word history)
+    pub fn new_like(&self) -> Self {
+        Self {
+            method: self.method,
+            enabled: self.enabled,
+            shortcuts: self.shortcuts.clone(),
+            skip_w_shortcut: self.skip_w_shortcut,
+            bracket_shortcut: self.bracket_shortcut,
+            esc_restore_enabled: self.esc_restore_enabled,
+            free_tone_enabled: self.free_tone_enabled,
+            modern_tone: self.modern_tone,
+            english_auto_restore: self.english_auto_restore,
+            auto_capitalize: self.auto_capitalize,
+            allow_foreign_consonants: self.allow_foreign_consonants,
+            shortcuts_enabled: self.shortcuts_enabled,
+            minimal_diff: self.minimal_diff,
+            ..Self::new()
         }
     }
 
@@ -216,6 +254,7 @@ impl Engine {
 
     pub fn set_enabled(&mut self, enabled: bool) {
         self.enabled = enabled;
+        self.screen.clear();
         if !enabled {
             self.buf.clear();
             self.word_history.clear();
@@ -282,6 +321,12 @@ impl Engine {
         self.shortcuts_enabled
     }
 
+    /// Set whether results are trimmed to the smallest suffix edit against
+    /// the text already on screen (see `screen` module)
+    pub fn set_minimal_diff(&mut self, enabled: bool) {
+        self.minimal_diff = enabled;
+    }
+
     pub fn shortcuts(&self) -> &ShortcutTable {
         &self.shortcuts
     }
@@ -383,7 +428,42 @@ impl Engine {
     /// * `ctrl` - true if Cmd/Ctrl/Alt is pressed (bypasses IME)
     /// * `shift` - true if Shift key is pressed (for symbols like @, #, $)
     pub fn on_key_ext(&mut self, key: u16, caps: bool, ctrl: bool, shift: bool) -> Result {
-        key_handler::on_key_ext(self, key, caps, ctrl, shift)
+        let mut r = key_handler::on_key_ext(self, key, caps, ctrl, shift);
+        if ctrl {
+            self.screen.clear();
+            return r;
+        }
+        if self.minimal_diff {
+            self.screen.minimize(&mut r);
+        }
+        self.screen.apply(key, caps, shift, &r);
+        r
+    }
+
+    /// Handle key event, writing a compact UTF-16 result into `out`
+    ///
+    /// Runs `on_key_ext` and converts its full `Result`, so processing costs
+    /// the same; only what crosses the FFI boundary shrinks. Output longer
+    /// than `COMPACT_INLINE` units spills into an engine-owned buffer
+    /// referenced by `out.overflow` (valid until the next key call).
+    pub fn on_key_compact(
+        &mut self,
+        key: u16,
+        caps: bool,
+        ctrl: bool,
+        shift: bool,
+        out: &mut CompactResult,
+    ) {
+        let r = self.on_key_ext(key, caps, ctrl, shift);
+        out.fill_from(&r, &mut self.compact_overflow);
+    }
+
+    /// Process a burst of keys, writing one coalesced net edit into `out`
+    ///
+    /// Returns how many keys were consumed (stops before Ctrl shortcuts and
+    /// navigation keys). See `batch` module for the fold rules.
+    pub fn on_keys_batch(&mut self, events: &[KeyEvent], out: &mut Result) -> usize {
+        batch::on_keys_batch(self, events, out)
     }
 
     /// Try "w" as vowel "ư" in Telex mode
@@ -598,6 +678,17 @@ impl Engine {
         self.clear();
         self.word_history.clear();
         self.spaces_after_commit = 0;
+        self.screen.clear();
+    }
+
+    /// Forget the text tracked before the caret
+    ///
+    /// For host-side word boundaries: keys the host handles itself (Enter,
+    /// Tab) type text the engine never sees. `clear()` alone keeps it, so
+    /// edits that reach back across an internal word boundary (auto-restore,
+    /// ESC restore) can still be diffed.
+    pub fn clear_screen(&mut self) {
+        self.screen.clear();
     }
 
     /// Get the full composed buffer as a Vietnamese string with diacritics.
@@ -643,6 +734,8 @@ impl Engine {
                 }
             }
         }
+        // The host restores the word the caret sits right after
+        self.screen.set(word);
         // Mark that buffer was restored from screen - if user types a regular consonant,
         // clear buffer first (they want fresh word, not append to restored word)
         // This allows: click on "shortcuts" → type "Nuw" → get "Nư" (not "shortcutsNuw")
@@ -0,0 +1,138 @@
+//! Minimal-diff output
+//!
+//! Rebuild paths (`rebuild_from`, tone repositioning, mark changes) answer
+//! with "backspace N, retype N+1" even when only one character in the middle
+//! changed. Every retyped character costs the host two injected events (and
+//! a delay in slow mode), so the engine keeps a copy of the text it knows is
+//! before the caret and trims each edit to the smallest suffix edit:
+//! characters shared by the erased text and the replacement stay on screen.
+//!
+//! The screen model is the one `batch` folds with:
+//! - `Send` replaces `backspace` chars with `chars`; a break key that is not
+//!   consumed still types itself after it
+//! - `None` passes the key through: its char is typed, DELETE erases one char
+//! - anything else (Ctrl shortcuts, arrows, Enter, Tab, ESC) may move the
+//!   caret, so the tracked text is dropped
+//!
+//! Only text inside the tracked tail is ever diffed; an edit that erases
+//! further back is emitted unchanged.
+//!
+//! Off by default: a host turns it on (`ime_minimal_diff`) only if it
+//! applies every result against the text at the caret, as the Windows app
+//! does. Hosts that replay their own copy of the word keep full edits.
+
+use super::helpers::key_typed_char;
+use super::types::{Action, Result};
+use crate::data::keys;
+use crate::engine::buffer::MAX;
+
+/// Tracked characters before the caret (a word plus a shortcut expansion)
+const CAP: usize = MAX;
+
+pub(crate) struct Screen {
+    chars: [u32; CAP],
+    len: usize,
+}
+
+impl Screen {
+    pub fn new() -> Self {
+        Self {
+            chars: [0; CAP],
+            len: 0,
+        }
+    }
+
+    /// Forget the tracked text (caret moved or text changed behind our back)
+    pub fn clear(&mut self) {
+        self.len = 0;
+    }
+
+    /// Text known to be before the caret (oldest first)
+    #[cfg(test)]
+    pub fn text(&self) -> &[u32] {
+        &self.chars[..self.len]
+    }
+
+    /// Start tracking from a word the host says is before the caret
+    pub fn set(&mut self, word: &str) {
+        self.clear();
+        for c in word.chars() {
+            self.push(c as u32);
+        }
+    }
+
+    fn push(&mut self, c: u32) {
+        if self.len == CAP {
+            // Keep the newest half; edits never reach back that far
+            self.chars.copy_within(CAP / 2.., 0);
+            self.len -= CAP / 2;
+        }
+        self.chars[self.len] = c;
+        self.len += 1;
+    }
+
+    fn erase(&mut self, count: usize) {
+        // Erasing past the tracked text leaves an unknown prefix: track nothing
+        self.len = self.len.saturating_sub(count);
+    }
+
+    /// Trim `r` to the smallest suffix edit against the tracked text
+    ///
+    /// Drops the leading characters the erased text and the replacement have
+    /// in common, both from `backspace` and from `chars`. The action is kept,
+    /// so a fully redundant edit still consumes the key.
+    pub fn minimize(&self, r: &mut Result) {
+        let backspace = r.backspace as usize;
+        let count = r.count as usize;
+        if r.action == Action::None as u8 || backspace == 0 || backspace > self.len {
+            return;
+        }
+        let erased = &self.chars[self.len - backspace..self.len];
+        let same = erased
+            .iter()
+            .zip(&r.chars[..count])
+            .take_while(|(a, b)| a == b)
+            .count();
+        if same == 0 {
+            return;
+        }
+        r.chars.copy_within(same..count, 0);
+        r.backspace = (backspace - same) as u8;
+        r.count = (count - same) as u8;
+    }
+
+    /// Record the on-screen effect of one key and its result
+    pub fn apply(&mut self, key: u16, caps: bool, shift: bool, r: &Result) {
+        let typed = key_typed_char(key, caps, shift);
+        if key != keys::SPACE && key != keys::DELETE && typed.is_none() {
+            self.clear();
+            return;
+        }
+
+        if r.action != Action::None as u8 {
+            self.erase(r.backspace as usize);
+            for &c in &r.chars[..r.count as usize] {
+                self.push(c);
+            }
+            let types_itself = key != keys::SPACE
+                && key != keys::DELETE
+                && keys::is_break_ext(key, shift)
+                && !r.key_consumed();
+            if types_itself {
+                self.push(typed.map_or(0, |c| c as u32));
+            }
+        } else if r.key_consumed() {
+            // Shortcut swallowed the key without output
+        } else if key == keys::DELETE {
+            self.erase(1);
+        } else if key == keys::SPACE {
+            self.push(' ' as u32);
+        } else {
+            self.push(typed.map_or(0, |c| c as u32));
+        }
+    }
+}
+
+#[cfg(test)]
+#[path = "screen_tests.rs"]
+mod tests;
@@ -0,0 +1,158 @@
+use super::*;
+use crate::engine::Engine;
+use crate::utils::{char_to_key, type_word};
+
+fn send(backspace: u8, text: &str) -> Result {
+    let chars: Vec<char> = text.chars().collect();
+    Result::send(backspace, &chars)
+}
+
+fn text(r: &Result) -> String {
+    r.chars[..r.count as usize]
+        .iter()
+        .filter_map(|&c| char::from_u32(c))
+        .collect()
+}
+
+fn track(screen: &mut Screen, input: &str) {
+    for c in input.chars() {
+        screen.apply(char_to_key(c), c.is_uppercase(), false, &Result::none());
+    }
+}
+
+/// Type `input`; returns the screen and the units injected (backspaces +
+/// characters), the cost the host pays for each result
+fn type_counting(e: &mut Engine, input: &str) -> (String, usize) {
+    let mut screen = String::new();
+    let mut injected = 0;
+    for c in input.chars() {
+        let key = char_to_key(c);
+        let r = e.on_key_ext(key, c.is_uppercase(), false, false);
+        if r.action == Action::Send as u8 {
+            injected += r.backspace as usize + r.count as usize;
+            for _ in 0..r.backspace {
+                screen.pop();
+            }
+            screen.push_str(&text(&r));
+            if keys::is_break_ext(key, false) && !r.key_consumed() {
+                screen.push(c);
+            }
+        } else if key == keys::DELETE {
+            screen.pop();
+        } else if !r.key_consumed() {
+            screen.push(c);
+        }
+    }
+    (screen, injected)
+}
+
+#[test]
+fn minimize_drops_common_prefix() {
+    let mut screen = Screen::new();
+    track(&mut screen, "hoa");
+    let mut r = send(2, "oà");
+    screen.minimize(&mut r);
+    assert_eq!((r.backspace, text(&r).as_str()), (1, "à"));
+}
+
+#[test]
+fn minimize_keeps_edit_past_tracked_text() {
+    let mut screen = Screen::new();
+    track(&mut screen, "ab");
+    let mut r = send(3, "xab");
+    screen.minimize(&mut r);
+    assert_eq!((r.backspace, text(&r).as_str()), (3, "xab"));
+}
+
+#[test]
+fn minimize_redundant_edit_keeps_action() {
+    let mut screen = Screen::new();
+    track(&mut screen, "uo");
+    let mut r = send(2, "uo");
+    screen.minimize(&mut r);
+    assert_eq!(r.action, Action::Send as u8);
+    assert_eq!((r.backspace, r.count), (0, 0));
+}
+
+#[test]
+fn apply_follows_delete_and_navigation() {
+    let mut screen = Screen::new();
+    track(&mut screen, "abc<");
+    assert_eq!(screen.text(), &['a' as u32, 'b' as u32]);
+    screen.apply(keys::LEFT, false, false, &Result::none());
+    assert!(screen.text().is_empty());
+}
+
+#[test]
+fn esc_restore_keeps_unchanged_prefix() {
+    for (minimal, backspace, expected) in [(true, 2, "eetj"), (false, 4, "vieetj")] {
+        let mut e = Engine::new();
+        e.set_esc_restore(true);
+        e.set_minimal_diff(minimal);
+        let (screen, _) = type_counting(&mut e, "vieetj");
+        assert_eq!(screen, "việt");
+        let r = e.on_key_ext(keys::ESC, false, false, false);
+        assert_eq!((r.backspace, text(&r).as_str()), (backspace, expected));
+    }
+}
+
+#[test]
+fn restored_word_is_tracked() {
+    let mut e = Engine::new();
+    e.restore_word("chao");
+    let r = e.on_key_ext(keys::S, false, false, false);
+    assert_eq!(r.action, Action::Send as u8);
+    assert!(r.backspace <= 2, "got backspace {}", r.backspace);
+}
+
+#[test]
+fn same_screen_as_full_edits() {
+    let inputs = [
+        "vieetj nam ",
+        "tieengs vieetj ",
+        "hoaf bifnh ",
+        "nguowif ddi ",
+        "truwowngf hojc ",
+        "Vieejt<t Nam ",
+        "please review the code ",
+        "merge branch test ",
+    ];
+    let mut full_total = 0;
+    let mut minimal_total = 0;
+    for input in inputs {
+        let mut full = Engine::new();
+        full.set_english_auto_restore(true);
+        let mut minimal = Engine::new();
+        minimal.set_minimal_diff(true);
+        minimal.set_english_auto_restore(true);
+        let (full_screen, full_units) = type_counting(&mut full, input);
+        let (minimal_screen, minimal_units) = type_counting(&mut minimal, input);
+        assert_eq!(minimal_screen, full_screen, "input {:?}", input);
+        assert!(minimal_units <= full_units, "input {:?}", input);
+        full_total += full_units;
+        minimal_total += minimal_units;
+    }
+    assert!(minimal_total < full_total);
+
+    // Default settings still produce the usual screen
+    assert_eq!(type_word(&mut Engine::new(), "vieetj nam "), "việt nam ");
+}
+
+#[test]
+fn full_edits_by_default() {
+    // Hosts that inject "backspace N, then the text" and never enable
+    // minimal diff (Linux, macOS) get the whole word back on a restore or
+    // a shortcut expansion, as before
+    let mut e = Engine::new();
+    e.set_english_auto_restore(true);
+    let (screen, _) = type_counting(&mut e, "nurses");
+    let r = e.on_key_ext(keys::SPACE, false, false, false);
+    let word = screen.chars().count() as u8;
+    assert_eq!((r.backspace, text(&r).as_str()), (word, "nurses "));
+
+    let mut e = Engine::new();
+    e.shortcuts_mut().add(crate::engine::shortcut::Shortcut::new("ko", "không"));
+    type_counting(&mut e, "ko");
+    let r = e.on_key_ext(keys::SPACE, false, false, false);
+    assert_eq!((r.backspace, text(&r).as_str()), (2, "không "));
+}
@@ -165,7 +165,7 @@ pub struct ShortcutMatch {
 }
 
 /// Shortcut table manager
-#[derive(Debug, Default)]
+#[derive(Debug, Clone, Default)]
 pub struct ShortcutTable {
     /// Shortcuts indexed by trigger (lowercase)
     shortcuts: HashMap<String, Shortcut>,
@@ -25,6 +25,34 @@ pub struct Result {
 /// Flag: key was consumed by shortcut, don't pass through
 pub const FLAG_KEY_CONSUMED: u8 = 0x01;
 
+/// Flag (batch results only): an edit did not fit and is carried over;
+/// call `ime_keys_batch` again to collect it before injecting anything else
+pub const FLAG_MORE_PENDING: u8 = 0x02;
+
+/// One key for batched processing (`ime_keys_batch`)
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+pub struct KeyEvent {
+    /// macOS virtual keycode
+    pub key: u16,
+    pub caps: bool,
+    pub ctrl: bool,
+    pub shift: bool,
+    pub reserved: u8,
+}
+
+impl KeyEvent {
+    pub fn new(key: u16, caps: bool, shift: bool) -> Self {
+        Self {
+            key,
+            caps,
+            ctrl: false,
+            shift,
+            reserved: 0,
+        }
+    }
+}
+
 impl Result {
     pub fn none() -> Self {
         Self {
@@ -63,6 +91,92 @@ impl Result {
     }
 }
 
+/// Inline UTF-16 capacity of `CompactResult`
+///
+/// Almost every keystroke produces 1-3 codepoints; 16 units also covers
+/// a full rebuilt syllable plus trailing space without touching `overflow`.
+pub const COMPACT_INLINE: usize = 16;
+
+/// Compact FFI result: small header + inline UTF-16 output (48 bytes on 64-bit)
+///
+/// Output is ready-to-inject UTF-16 (non-BMP chars as surrogate pairs).
+/// When `len <= COMPACT_INLINE` the text is in `text`; longer output (shortcut
+/// expansions) is in `overflow`, which is owned by the engine and stays valid
+/// until the next key call on the same engine.
+///
+/// The engine still builds a full `Result` for every key and converts it
+/// (`fill_from`); the saving is only at the FFI boundary, where the host
+/// reads 48 bytes of UTF-16 instead of copying and converting 1 KB of UTF-32.
+#[repr(C)]
+pub struct CompactResult {
+    pub action: u8,
+    pub backspace: u8,
+    /// Same bits as `Result::flags`
+    pub flags: u8,
+    pub reserved: u8,
+    /// Number of UTF-16 code units of output
+    pub len: u32,
+    pub text: [u16; COMPACT_INLINE],
+    /// Output when `len > COMPACT_INLINE`, otherwise null
+    pub overflow: *const u16,
+}
+
+impl CompactResult {
+    pub fn none() -> Self {
+        Self {
+            action: Action::None as u8,
+            backspace: 0,
+            flags: 0,
+            reserved: 0,
+            len: 0,
+            text: [0; COMPACT_INLINE],
+            overflow: std::ptr::null(),
+        }
+    }
+
+    /// Fill from a full `Result` (the engine's own output, built first),
+    /// spilling into `overflow_buf` only when the UTF-16 output does not fit inline
+    pub fn fill_from(&mut self, r: &Result, overflow_buf: &mut Vec<u16>) {
+        self.action = r.action;
+        self.backspace = r.backspace;
+        self.flags = r.flags;
+        self.reserved = 0;
+        self.overflow = std::ptr::null();
+
+        let chars = r.chars[..r.count as usize]
+            .iter()
+            .filter_map(|&cp| char::from_u32(cp));
+        let utf16_len: usize = chars.clone().map(char::len_utf16).sum();
+        self.len = utf16_len as u32;
+
+        let out: &mut [u16] = if utf16_len <= COMPACT_INLINE {
+            &mut self.text
+        } else {
+            overflow_buf.clear();
+            overflow_buf.resize(utf16_len, 0);
+            overflow_buf.as_mut_slice()
+        };
+        let mut pos = 0;
+        for c in chars {
+            pos += c.encode_utf16(&mut out[pos..]).len();
+        }
+        if utf16_len > COMPACT_INLINE {
+            self.overflow = overflow_buf.as_ptr();
+        }
+    }
+
+    /// Output as UTF-16 code units (inline or overflow)
+    pub fn units(&self) -> &[u16] {
+        if self.len as usize <= COMPACT_INLINE {
+            &self.text[..self.len as usize]
+        } else {
+            // SAFETY: overflow points to `len` units owned by the engine
+            // and valid until the next key call
+            unsafe { std::slice::from_raw_parts(self.overflow, self.len as usize) }
+        }
+    }
+}
+
 /// Transform type for revert tracking
 #[derive(Clone, Copy, Debug, PartialEq)]
 pub(crate) enum Transform {
@@ -0,0 +1,310 @@
+//! FFI engine handles for Vietnamese IME
+//!
+//! Each handle owns an independent `Engine` (typing state, settings and
+//! shortcuts), so a host can keep one typing context per window and switch
+//! between them by swapping pointers instead of calling `ime_clear_all`.
+//!
+//! Unlike the global `ime_*` functions, handle calls take no lock: a handle
+//! has a single owner, which must not use it from two threads at once.
+//!
+//! ```c
+//! ImeEngine* e = ime_engine_new();
+//! ime_engine_method(e, 0);
+//! ImeResult out;
+//! if (ime_engine_key_ext(e, &out, keycode, is_caps, is_ctrl, is_shift) && out.action == 1) {
+//!     // Send out.backspace deletes, then out.chars
+//! }
+//! ime_engine_free(e);
+//! ```
+
+use crate::engine::{CompactResult, Engine, KeyEvent, Result};
+use crate::ffi_shortcuts::add_shortcut_str;
+use std::ffi::CStr;
+use std::os::raw::c_char;
+
+/// Borrow the engine behind a handle (None for null)
+///
+/// # Safety
+/// `h` must be null or a live handle from `ime_engine_new`/`ime_engine_new_like`.
+unsafe fn engine<'a>(h: *mut Engine) -> Option<&'a mut Engine> {
+    h.as_mut()
+}
+
+/// Read a C string as UTF-8 (None for null or invalid UTF-8)
+///
+/// # Safety
+/// `s` must be null or a valid null-terminated string.
+unsafe fn c_str<'a>(s: *const c_char) -> Option<&'a str> {
+    if s.is_null() {
+        return None;
+    }
+    CStr::from_ptr(s).to_str().ok()
+}
+
+/// Create a new engine with default settings.
+///
+/// Release with `ime_engine_free`.
+#[no_mangle]
+pub extern "C" fn ime_engine_new() -> *mut Engine {
+    Box::into_raw(Box::new(Engine::new()))
+}
+
+/// Create a new engine with the settings and shortcuts of `src`
+/// but empty typing state. Returns a default engine if `src` is null.
+///
+/// # Safety
+/// `src` must be null or a live engine handle.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_new_like(src: *mut Engine) -> *mut Engine {
+    let e = match engine(src) {
+        Some(src) => src.new_like(),
+        None => Engine::new(),
+    };
+    Box::into_raw(Box::new(e))
+}
+
+/// Destroy an engine handle. Null is ignored.
+///
+/// # Safety
+/// `h` must be null or a live engine handle; it is invalid afterwards.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_free(h: *mut Engine) {
+    if !h.is_null() {
+        drop(Box::from_raw(h));
+    }
+}
+
+/// Process a key event on an engine, writing the result into `out`.
+///
+/// Same semantics as `ime_key_into`, without the global lock.
+///
+/// # Returns
+/// `false` if `h` or `out` is null (`out` is reset when non-null).
+///
+/// # Safety
+/// `h` must be null or a live engine handle; `out` must be null or point
+/// to writable memory for one `Result`.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_key_ext(
+    h: *mut Engine,
+    out: *mut Result,
+    key: u16,
+    caps: bool,
+    ctrl: bool,
+    shift: bool,
+) -> bool {
+    if out.is_null() {
+        return false;
+    }
+    match engine(h) {
+        Some(e) => {
+            out.write(e.on_key_ext(key, caps, ctrl, shift));
+            true
+        }
+        None => {
+            out.write(Result::none());
+            false
+        }
+    }
+}
+
+/// Process a key event on an engine, writing a compact UTF-16 result.
+///
+/// Same semantics as `ime_key_compact`; `out->overflow` points into this
+/// engine and stays valid until its next key call.
+///
+/// # Safety
+/// `h` must be null or a live engine handle; `out` must be null or point
+/// to writable memory for one `CompactResult`.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_key_compact(
+    h: *mut Engine,
+    out: *mut CompactResult,
+    key: u16,
+    caps: bool,
+    ctrl: bool,
+    shift: bool,
+) -> bool {
+    if out.is_null() {
+        return false;
+    }
+    let out = &mut *out;
+    match engine(h) {
+        Some(e) => {
+            e.on_key_compact(key, caps, ctrl, shift, out);
+            true
+        }
+        None => {
+            *out = CompactResult::none();
+            false
+        }
+    }
+}
+
+/// Process a burst of keys on an engine as one net edit.
+///
+/// Same semantics as `ime_keys_batch`.
+///
+/// # Safety
+/// `h` must be null or a live engine handle; `keys` must be null or point
+/// to `n` events; `out` must be null or point to writable memory for one `Result`.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_keys_batch(
+    h: *mut Engine,
+    keys: *const KeyEvent,
+    n: usize,
+    out: *mut Result,
+) -> usize {
+    if out.is_null() {
+        return 0;
+    }
+    out.write(Result::none());
+    let events = if keys.is_null() || n == 0 {
+        &[][..]
+    } else {
+        std::slice::from_raw_parts(keys, n)
+    };
+    match engine(h) {
+        Some(e) => e.on_keys_batch(events, &mut *out),
+        None => 0,
+    }
+}
+
+/// Clear the engine's input buffer (word boundary).
+///
+/// # Safety
+/// `h` must be null or a live engine handle.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_clear(h: *mut Engine) {
+    if let Some(e) = engine(h) {
+        e.clear();
+        e.clear_screen();
+    }
+}
+
+/// Clear the engine's buffer and word history (cursor moved).
+///
+/// # Safety
+/// `h` must be null or a live engine handle.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_clear_all(h: *mut Engine) {
+    if let Some(e) = engine(h) {
+        e.clear_all();
+    }
+}
+
+/// Per-handle setters, mirroring the global `ime_*` setters in `ffi_settings`.
+macro_rules! engine_setter {
+    ($(#[$doc:meta])* $name:ident, $arg:ident: $ty:ty, $method:ident) => {
+        $(#[$doc])*
+        ///
+        /// # Safety
+        /// `h` must be null (no-op) or a live engine handle.
+        #[no_mangle]
+        pub unsafe extern "C" fn $name(h: *mut Engine, $arg: $ty) {
+            if let Some(e) = engine(h) {
+                e.$method($arg);
+            }
+        }
+    };
+}
+
+engine_setter!(
+    /// Set the input method (0 = Telex, 1 = VNI). See `ime_method`.
+    ime_engine_method, method: u8, set_method
+);
+engine_setter!(
+    /// Enable or disable the engine. See `ime_enabled`.
+    ime_engine_enabled, enabled: bool, set_enabled
+);
+engine_setter!(
+    /// Skip w→ư at word start. See `ime_skip_w_shortcut`.
+    ime_engine_skip_w_shortcut, skip: bool, set_skip_w_shortcut
+);
+engine_setter!(
+    /// Bracket shortcuts ] → ư, [ → ơ. See `ime_bracket_shortcut`.
+    ime_engine_bracket_shortcut, enabled: bool, set_bracket_shortcut
+);
+engine_setter!(
+    /// ESC restores raw ASCII. See `ime_esc_restore`.
+    ime_engine_esc_restore, enabled: bool, set_esc_restore
+);
+engine_setter!(
+    /// Free tone placement. See `ime_free_tone`.
+    ime_engine_free_tone, enabled: bool, set_free_tone
+);
+engine_setter!(
+    /// Modern tone placement (hoà, thuý). See `ime_modern`.
+    ime_engine_modern, modern: bool, set_modern_tone
+);
+engine_setter!(
+    /// English auto-restore. See `ime_english_auto_restore`.
+    ime_engine_english_auto_restore, enabled: bool, set_english_auto_restore
+);
+engine_setter!(
+    /// Auto-capitalize after sentence end. See `ime_auto_capitalize`.
+    ime_engine_auto_capitalize, enabled: bool, set_auto_capitalize
+);
+engine_setter!(
+    /// Foreign consonants (z, w, j, f) as initials. See `ime_allow_foreign_consonants`.
+    ime_engine_allow_foreign_consonants, enabled: bool, set_allow_foreign_consonants
+);
+engine_setter!(
+    /// Shortcut expansion. See `ime_shortcuts_enabled`.
+    ime_engine_shortcuts_enabled, enabled: bool, set_shortcuts_enabled
+);
+engine_setter!(
+    /// Smallest-suffix-edit output. See `ime_minimal_diff`.
+    ime_engine_minimal_diff, enabled: bool, set_minimal_diff
+);
+
+/// Add a shortcut to an engine. See `ime_add_shortcut`.
+///
+/// # Safety
+/// `h` must be null or a live engine handle; both strings must be null or
+/// valid null-terminated UTF-8.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_add_shortcut(
+    h: *mut Engine,
+    trigger: *const c_char,
+    replacement: *const c_char,
+) {
+    if let (Some(e), Some(t), Some(r)) = (engine(h), c_str(trigger), c_str(replacement)) {
+        add_shortcut_str(e, t, r);
+    }
+}
+
+/// Remove a shortcut from an engine.
+///
+/// # Safety
+/// `h` must be null or a live engine handle; `trigger` must be null or
+/// valid null-terminated UTF-8.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_remove_shortcut(h: *mut Engine, trigger: *const c_char) {
+    if let (Some(e), Some(t)) = (engine(h), c_str(trigger)) {
+        e.shortcuts_mut().remove(t);
+    }
+}
+
+/// Clear all shortcuts of an engine.
+///
+/// # Safety
+/// `h` must be null or a live engine handle.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_clear_shortcuts(h: *mut Engine) {
+    if let Some(e) = engine(h) {
+        e.shortcuts_mut().clear();
+    }
+}
+
+/// Restore an engine's buffer from a Vietnamese word. See `ime_restore_word`.
+///
+/// # Safety
+/// `h` must be null or a live engine handle; `word` must be null or valid
+/// null-terminated UTF-8.
+#[no_mangle]
+pub unsafe extern "C" fn ime_engine_restore_word(h: *mut Engine, word: *const c_char) {
+    if let (Some(e), Some(w)) = (engine(h), c_str(word)) {
+        e.restore_word(w);
+    }
+}
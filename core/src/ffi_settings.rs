@@ -150,6 +150,21 @@ pub extern "C" fn ime_shortcuts_enabled(enabled: bool) {
     }
 }
 
+/// Set whether results are trimmed to the smallest suffix edit.
+///
+/// When `enabled` is true, characters that an edit would erase and type
+/// again unchanged are left on screen: "backspace 2, òa" becomes
+/// "backspace 1, à". The screen text is the same either way.
+/// Default: false (full edits).
+/// No-op if engine not initialized.
+#[no_mangle]
+pub extern "C" fn ime_minimal_diff(enabled: bool) {
+    let mut guard = lock_engine();
+    if let Some(ref mut e) = *guard {
+        e.set_minimal_diff(enabled);
+    }
+}
+
 /// Clear the input buffer.
 ///
 /// Call on word boundaries (space, punctuation).
@@ -160,6 +175,7 @@ pub extern "C" fn ime_clear() {
     let mut guard = lock_engine();
     if let Some(ref mut e) = *guard {
         e.clear();
+        e.clear_screen();
     }
 }
 
@@ -1,5 +1,7 @@
 //! FFI shortcut management functions for Vietnamese IME
 
+use crate::engine::shortcut::Shortcut;
+use crate::engine::Engine;
 use crate::lock_engine;
 
 /// Add a shortcut to the engine.
@@ -30,19 +32,24 @@ pub unsafe extern "C" fn ime_add_shortcut(
 
     let mut guard = lock_engine();
     if let Some(ref mut e) = *guard {
-        // Auto-detect shortcut type:
-        // - If trigger contains only non-letter chars (like "->", "=>"), use immediate trigger
-        // - Otherwise use word boundary trigger (traditional abbreviations like "vn" → "Việt Nam")
-        let is_symbol_trigger = trigger_str.chars().all(|c| !c.is_alphabetic());
-        let shortcut = if is_symbol_trigger {
-            crate::engine::shortcut::Shortcut::immediate(trigger_str, replacement_str)
-        } else {
-            crate::engine::shortcut::Shortcut::new(trigger_str, replacement_str)
-        };
-        e.shortcuts_mut().add(shortcut);
+        add_shortcut_str(e, trigger_str, replacement_str);
     }
 }
 
+/// Add a shortcut, picking its trigger type from the trigger text
+pub(crate) fn add_shortcut_str(e: &mut Engine, trigger: &str, replacement: &str) {
+    // Auto-detect shortcut type:
+    // - If trigger contains only non-letter chars (like "->", "=>"), use immediate trigger
+    // - Otherwise use word boundary trigger (traditional abbreviations like "vn" → "Việt Nam")
+    let is_symbol_trigger = trigger.chars().all(|c| !c.is_alphabetic());
+    let shortcut = if is_symbol_trigger {
+        Shortcut::immediate(trigger, replacement)
+    } else {
+        Shortcut::new(trigger, replacement)
+    };
+    e.shortcuts_mut().add(shortcut);
+}
+
 /// Remove a shortcut from the engine.
 ///
 /// # Arguments
@@ -3,8 +3,52 @@
 use crate::*;
 use crate::data::keys;
 use serial_test::serial;
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::cell::Cell;
 use std::ffi::CString;
 
+// ============================================================
+// Allocation counting (per-thread, so parallel tests don't interfere)
+// ============================================================
+
+struct CountingAlloc;
+
+thread_local! {
+    static ALLOC_COUNT: Cell<usize> = const { Cell::new(0) };
+}
+
+fn bump_alloc_count() {
+    // try_with: TLS may already be torn down while the thread exits
+    let _ = ALLOC_COUNT.try_with(|c| c.set(c.get() + 1));
+}
+
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        bump_alloc_count();
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        bump_alloc_count();
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        bump_alloc_count();
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static COUNTING_ALLOC: CountingAlloc = CountingAlloc;
+
+/// Number of heap operations (alloc + dealloc + realloc) performed by `f` on this thread
+fn count_heap_ops<F: FnOnce()>(f: F) -> usize {
+    let before = ALLOC_COUNT.with(|c| c.get());
+    f();
+    ALLOC_COUNT.with(|c| c.get()) - before
+}
+
 #[test]
 #[serial]
 fn test_ffi_flow() {
@@ -311,3 +355,367 @@ fn test_restore_word_ffi_null_safety() {
 
     ime_clear();
 }
+
+// ============================================================
+// Caller-owned result buffer (ime_key_into)
+// ============================================================
+
+#[test]
+#[serial]
+fn test_key_into_matches_key_ext() {
+    ime_init();
+    ime_method(0); // Telex
+
+    let mut out = engine::Result::none();
+    for key in [keys::V, keys::I, keys::E, keys::E, keys::J] {
+        assert!(unsafe { ime_key_into(&mut out, key, false, false, false) });
+    }
+    let output: String = (0..out.count as usize)
+        .filter_map(|i| char::from_u32(out.chars[i]))
+        .collect();
+
+    ime_init();
+    ime_method(0);
+    let mut last = std::ptr::null_mut();
+    for key in [keys::V, keys::I, keys::E, keys::E, keys::J] {
+        unsafe { ime_free(last) };
+        last = ime_key_ext(key, false, false, false);
+    }
+    let r = unsafe { &*last };
+    assert_eq!(out.action, r.action);
+    assert_eq!(out.backspace, r.backspace);
+    assert_eq!(out.count, r.count);
+    assert_eq!(out.flags, r.flags);
+    assert_eq!(
+        &out.chars[..out.count as usize],
+        &r.chars[..r.count as usize]
+    );
+    assert_eq!(out.action, engine::Action::Send as u8);
+    assert!(output.ends_with('ệ'), "got {output:?}");
+    unsafe { ime_free(last) };
+
+    ime_clear();
+}
+
+#[test]
+#[serial]
+fn test_key_into_null_safety() {
+    ime_init();
+    assert!(!unsafe { ime_key_into(std::ptr::null_mut(), keys::A, false, false, false) });
+
+    // Engine should still work
+    let mut out = engine::Result::none();
+    assert!(unsafe { ime_key_into(&mut out, keys::A, false, false, false) });
+
+    ime_clear();
+}
+
+/// The result path of `ime_key_into` must not touch the heap: every heap
+/// operation during the call comes from the engine itself.
+#[test]
+#[serial]
+fn test_key_into_zero_result_allocations() {
+    ime_init();
+    ime_method(0);
+
+    // Reference engine in the same state, driven directly (no FFI)
+    let mut reference = engine::Engine::new();
+    let mut out = engine::Result::none();
+
+    for key in crate::utils::keys_from_str("vieejt nam ddaats nuwowcs hello text ") {
+        let engine_ops = count_heap_ops(|| {
+            let _ = reference.on_key_ext(key, false, false, false);
+        });
+        let ffi_ops = count_heap_ops(|| unsafe {
+            ime_key_into(&mut out, key, false, false, false);
+        });
+        assert_eq!(
+            ffi_ops, engine_ops,
+            "ime_key_into must add no heap operations (key {key})"
+        );
+    }
+
+    // Keys the engine passes straight through are zero heap operations end-to-end
+    let ops = count_heap_ops(|| unsafe {
+        ime_key_into(&mut out, keys::A, false, true, false);
+    });
+    assert_eq!(ops, 0, "Ctrl+key should not allocate");
+
+    // The boxed API pays one allocation + one free for the same key
+    let boxed_ops = count_heap_ops(|| unsafe {
+        ime_free(ime_key_ext(keys::A, false, true, false));
+    });
+    assert_eq!(boxed_ops, 2, "ime_key_ext boxes every result");
+
+    ime_clear();
+}
+
+// ============================================================
+// Compact UTF-16 result (ime_key_compact)
+// ============================================================
+
+/// Type `input` + space through ime_key_compact, returning the last result's text
+fn compact_type_and_space(input: &str, out: &mut engine::CompactResult) -> String {
+    for key in crate::utils::keys_from_str(input) {
+        assert!(unsafe { ime_key_compact(out, key, false, false, false) });
+    }
+    assert!(unsafe { ime_key_compact(out, keys::SPACE, false, false, false) });
+    String::from_utf16(out.units()).unwrap()
+}
+
+#[test]
+fn test_compact_result_layout() {
+    // Header (4) + len (4) + 16 UTF-16 units (32) + overflow pointer
+    assert_eq!(
+        std::mem::size_of::<engine::CompactResult>(),
+        40 + std::mem::size_of::<*const u16>()
+    );
+}
+
+#[test]
+#[serial]
+fn test_key_compact_inline_text() {
+    ime_init();
+    ime_method(0);
+
+    let mut out = engine::CompactResult::none();
+    for key in [keys::V, keys::I, keys::E, keys::E, keys::J] {
+        assert!(unsafe { ime_key_compact(&mut out, key, false, false, false) });
+    }
+    assert_eq!(out.action, engine::Action::Send as u8);
+    assert!(out.overflow.is_null(), "short output must stay inline");
+    assert_eq!(String::from_utf16(out.units()).unwrap(), "ệ");
+
+    assert!(!unsafe { ime_key_compact(std::ptr::null_mut(), keys::A, false, false, false) });
+    ime_clear();
+}
+
+#[test]
+#[serial]
+fn test_key_compact_overflow_for_long_shortcut() {
+    ime_init();
+    ime_clear_shortcuts();
+    ime_method(0);
+
+    let trigger = CString::new("tphcm").unwrap();
+    let replacement = CString::new("Thành phố Hồ Chí Minh").unwrap();
+    unsafe { ime_add_shortcut(trigger.as_ptr(), replacement.as_ptr()) };
+
+    let mut out = engine::CompactResult::none();
+    let text = compact_type_and_space("tphcm", &mut out);
+    assert_eq!(out.action, engine::Action::Send as u8);
+    assert_eq!(out.backspace, 5);
+    assert!(out.len as usize > engine::COMPACT_INLINE);
+    assert!(!out.overflow.is_null());
+    assert_eq!(text, "Thành phố Hồ Chí Minh ");
+
+    ime_clear_shortcuts();
+    ime_clear();
+}
+
+#[test]
+#[serial]
+fn test_key_compact_surrogate_pairs() {
+    ime_init();
+    ime_clear_shortcuts();
+    ime_method(0);
+
+    let trigger = CString::new("smile").unwrap();
+    let replacement = CString::new("😀").unwrap();
+    unsafe { ime_add_shortcut(trigger.as_ptr(), replacement.as_ptr()) };
+
+    let mut out = engine::CompactResult::none();
+    let text = compact_type_and_space("smile", &mut out);
+    // U+1F600 is one codepoint but two UTF-16 units
+    assert_eq!(out.len, 3);
+    assert_eq!(&out.text[..2], &[0xD83D, 0xDE00]);
+    assert_eq!(text, "😀 ");
+
+    ime_clear_shortcuts();
+    ime_clear();
+}
+
+#[test]
+#[serial]
+fn test_keys_batch_net_edit() {
+    ime_init();
+    ime_method(0);
+    ime_clear();
+
+    let events: Vec<engine::KeyEvent> = crate::utils::keys_from_str("vieejt nam ")
+        .into_iter()
+        .map(|k| engine::KeyEvent::new(k, false, false))
+        .collect();
+    let mut out = engine::Result::none();
+    let n = unsafe { ime_keys_batch(events.as_ptr(), events.len(), &mut out) };
+    assert_eq!(n, events.len());
+    assert_eq!(out.action, 1);
+    assert_eq!(out.backspace, 0);
+    let text: String = out.chars[..out.count as usize]
+        .iter()
+        .filter_map(|&c| char::from_u32(c))
+        .collect();
+    assert_eq!(text, "việt nam ");
+
+    ime_clear();
+}
+
+#[test]
+#[serial]
+fn test_keys_batch_null_safety() {
+    ime_init();
+    let ev = engine::KeyEvent::new(keys::A, false, false);
+    assert_eq!(unsafe { ime_keys_batch(&ev, 1, std::ptr::null_mut()) }, 0);
+
+    // Null keys is an empty batch
+    let mut out = engine::Result::none();
+    assert_eq!(unsafe { ime_keys_batch(std::ptr::null(), 5, &mut out) }, 0);
+    assert_eq!(out.action, 0);
+
+    ime_clear();
+}
+
+/// Type `input` on an engine handle, returning the screen text
+fn engine_type(h: *mut engine::Engine, input: &str) -> String {
+    let mut screen = String::new();
+    let mut out = engine::Result::none();
+    for key in crate::utils::keys_from_str(input) {
+        assert!(unsafe { ime_engine_key_ext(h, &mut out, key, false, false, false) });
+        if out.action == 1 {
+            for _ in 0..out.backspace {
+                screen.pop();
+            }
+            screen.extend(
+                out.chars[..out.count as usize]
+                    .iter()
+                    .filter_map(|&c| char::from_u32(c)),
+            );
+        } else if key == keys::SPACE {
+            screen.push(' ');
+        } else if let Some(c) = crate::utils::key_to_char(key, false) {
+            screen.push(c);
+        }
+    }
+    screen
+}
+
+#[test]
+fn test_engine_handles_keep_separate_word_state() {
+    let a = ime_engine_new();
+    let b = ime_engine_new();
+
+    // Interleave two words: each handle keeps its own in-progress syllable
+    let mut screen_a = engine_type(a, "vie");
+    let screen_b = engine_type(b, "dda");
+    screen_a += &engine_type(a, "ej");
+    assert_eq!(screen_b, "đa");
+    assert!(screen_a.ends_with('ệ'), "got {:?}", screen_a);
+
+    unsafe {
+        ime_engine_free(a);
+        ime_engine_free(b);
+    }
+}
+
+#[test]
+fn test_engine_handle_settings_are_per_handle() {
+    let telex = ime_engine_new();
+    let vni = ime_engine_new();
+    unsafe { ime_engine_method(vni, 1) };
+
+    assert_eq!(engine_type(telex, "as"), "á");
+    assert_eq!(engine_type(vni, "a1"), "á");
+
+    unsafe {
+        ime_engine_free(telex);
+        ime_engine_free(vni);
+    }
+}
+
+#[test]
+fn test_engine_new_like_copies_settings_not_state() {
+    let src = ime_engine_new();
+    let trigger = CString::new("vn").unwrap();
+    let replacement = CString::new("Việt Nam").unwrap();
+    unsafe {
+        ime_engine_method(src, 1);
+        ime_engine_add_shortcut(src, trigger.as_ptr(), replacement.as_ptr());
+    }
+    engine_type(src, "vie");
+
+    let copy = unsafe { ime_engine_new_like(src) };
+    // Fresh buffer, same method and shortcuts
+    assert_eq!(engine_type(copy, "a1"), "á");
+    assert_eq!(engine_type(copy, " vn "), " Việt Nam ");
+
+    unsafe {
+        ime_engine_free(src);
+        ime_engine_free(copy);
+    }
+}
+
+#[test]
+fn test_engine_minimal_diff_setting() {
+    // Off by default: hosts that consume full edits keep getting them
+    let minimal = ime_engine_new();
+    let full = ime_engine_new();
+    let trigger = CString::new("ko").unwrap();
+    let replacement = CString::new("không").unwrap();
+    unsafe {
+        ime_engine_minimal_diff(minimal, true);
+        ime_engine_add_shortcut(minimal, trigger.as_ptr(), replacement.as_ptr());
+        ime_engine_add_shortcut(full, trigger.as_ptr(), replacement.as_ptr());
+    }
+    let copy = unsafe { ime_engine_new_like(minimal) };
+
+    // Same screen; only the minimal edit keeps the shared "k"
+    for (h, backspace, text) in [(minimal, 1, "hông "), (full, 2, "không "), (copy, 1, "hông ")] {
+        assert_eq!(engine_type(h, "ko "), "không ");
+        let mut out = engine::Result::none();
+        engine_type(h, "ko");
+        unsafe { ime_engine_key_ext(h, &mut out, keys::SPACE, false, false, false) };
+        let sent: String = out.chars[..out.count as usize]
+            .iter()
+            .filter_map(|&c| char::from_u32(c))
+            .collect();
+        assert_eq!((out.backspace, sent.as_str()), (backspace, text));
+    }
+
+    unsafe {
+        ime_engine_free(minimal);
+        ime_engine_free(full);
+        ime_engine_free(copy);
+    }
+}
+
+#[test]
+fn test_engine_handle_null_safety() {
+    let mut out = engine::Result::none();
+    let null_engine = std::ptr::null_mut();
+    unsafe {
+        assert!(!ime_engine_key_ext(
+            null_engine,
+            &mut out,
+            keys::A,
+            false,
+            false,
+            false
+        ));
+        assert_eq!(out.action, 0);
+        ime_engine_method(null_engine, 1);
+        ime_engine_clear(null_engine);
+        ime_engine_free(null_engine);
+
+        let e = ime_engine_new();
+        let null_out = std::ptr::null_mut();
+        assert!(!ime_engine_key_ext(
+            e,
+            null_out,
+            keys::A,
+            false,
+            false,
+            false
+        ));
+        ime_engine_free(e);
+    }
+}
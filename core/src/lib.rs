@@ -18,6 +18,16 @@
 //! }
 //! ime_free(r);
 //!
+//! // Or, without a heap allocation per key:
+//! ImeResult out;
+//! if (ime_key_into(&out, keycode, is_caps, is_ctrl, is_shift) && out.action == 1) {
+//!     // Send out.backspace deletes, then out.chars
+//! }
+//!
+//! // Keys queued during an injection: one net edit for the whole burst
+//! ImeResult net;
+//! size_t done = ime_keys_batch(queued, queued_count, &net);
+//!
 //! // Clean up on word boundary
 //! ime_clear();
 //! ```
@@ -28,15 +38,17 @@ pub mod input;
 pub mod updater;
 pub mod utils;
 
+mod ffi_engine;
 mod ffi_restore;
 mod ffi_settings;
 mod ffi_shortcuts;
 
+pub use ffi_engine::*;
 pub use ffi_restore::*;
 pub use ffi_settings::*;
 pub use ffi_shortcuts::*;
 
-use engine::{Engine, Result};
+use engine::{CompactResult, Engine, KeyEvent, Result};
 use std::sync::Mutex;
 
 // Global engine instance (thread-safe via Mutex)
@@ -104,6 +116,134 @@ pub extern "C" fn ime_key_ext(key: u16, caps: bool, ctrl: bool, shift: bool) ->
     }
 }
 
+/// Process a key event, writing the result into a caller-owned buffer.
+///
+/// Same semantics as `ime_key_ext`, but the result is written to `out`
+/// instead of a heap-allocated `Result`, so no `ime_free` call is needed.
+/// Intended for per-keystroke callers (e.g. low-level keyboard hooks)
+/// that keep one reusable result buffer.
+///
+/// # Arguments
+/// * `out` - Caller-owned result buffer (overwritten on every call)
+/// * `key` - macOS virtual keycode (0-127 for standard keys)
+/// * `caps` - true if CapsLock is pressed (for uppercase letters)
+/// * `ctrl` - true if Cmd/Ctrl/Alt is pressed (bypasses IME)
+/// * `shift` - true if Shift key is pressed (for symbols like @, #, $)
+///
+/// # Returns
+/// * `true` if `out` holds the engine result
+/// * `false` if `out` is null or the engine is not initialized
+///   (`out` is reset to an empty result when non-null)
+///
+/// # Safety
+/// `out` must be null or point to valid, writable memory for one `Result`.
+#[no_mangle]
+pub unsafe extern "C" fn ime_key_into(
+    out: *mut Result,
+    key: u16,
+    caps: bool,
+    ctrl: bool,
+    shift: bool,
+) -> bool {
+    if out.is_null() {
+        return false;
+    }
+    let mut guard = lock_engine();
+    if let Some(ref mut e) = *guard {
+        out.write(e.on_key_ext(key, caps, ctrl, shift));
+        true
+    } else {
+        out.write(Result::none());
+        false
+    }
+}
+
+/// Process a key event, writing a compact UTF-16 result into a caller-owned buffer.
+///
+/// Same semantics as `ime_key_into`, but the output is already UTF-16 and
+/// stored inline (up to `COMPACT_INLINE` units) in a 48-byte result. The
+/// engine still produces the full result internally; the host just copies
+/// and converts less.
+/// Longer output (shortcut expansions) is referenced by `out->overflow`,
+/// which points into engine-owned memory valid until the next key call.
+///
+/// # Returns
+/// * `true` if `out` holds the engine result
+/// * `false` if `out` is null or the engine is not initialized
+///   (`out` is reset to an empty result when non-null)
+///
+/// # Safety
+/// `out` must be null or point to valid, writable memory for one `CompactResult`.
+#[no_mangle]
+pub unsafe extern "C" fn ime_key_compact(
+    out: *mut CompactResult,
+    key: u16,
+    caps: bool,
+    ctrl: bool,
+    shift: bool,
+) -> bool {
+    if out.is_null() {
+        return false;
+    }
+    let out = &mut *out;
+    let mut guard = lock_engine();
+    if let Some(ref mut e) = *guard {
+        e.on_key_compact(key, caps, ctrl, shift, out);
+        true
+    } else {
+        *out = CompactResult::none();
+        false
+    }
+}
+
+/// Process a burst of keys, writing ONE coalesced net edit into `out`.
+///
+/// Intended for hosts that queue keys while an injection is in flight:
+/// instead of injecting once per key, apply `out->backspace` deletes then
+/// `out->chars` once. Backspaces that erase text produced earlier in the
+/// batch cancel against it (e.g. "vieejt" → backspace 0, "việt").
+/// `app-native/bench/key_latency_bench` replays its corpora this way to
+/// report the injections and events saved against per-key processing.
+///
+/// Stops before the first key that cannot be batched (Ctrl shortcuts,
+/// Enter, Tab, Esc, arrows); keys from the returned index on were not
+/// processed.
+///
+/// If `out->flags & FLAG_MORE_PENDING`, the edit of the last consumed key
+/// did not fit and was carried over: inject `out`, then call again (with
+/// `n = 0` if no keys are left) before injecting anything else.
+///
+/// # Returns
+/// Number of events consumed; 0 if `out` is null or the engine is not
+/// initialized (`out` is reset to an empty result when non-null).
+///
+/// # Safety
+/// `keys` must be null or point to `n` valid `KeyEvent`s (null is treated
+/// as an empty batch). `out` must be null or point to valid, writable
+/// memory for one `Result`.
+#[no_mangle]
+pub unsafe extern "C" fn ime_keys_batch(
+    keys: *const KeyEvent,
+    n: usize,
+    out: *mut Result,
+) -> usize {
+    if out.is_null() {
+        return 0;
+    }
+    out.write(Result::none());
+    let out = &mut *out;
+    let events = if keys.is_null() || n == 0 {
+        &[][..]
+    } else {
+        std::slice::from_raw_parts(keys, n)
+    };
+    let mut guard = lock_engine();
+    match *guard {
+        Some(ref mut e) => e.on_keys_batch(events, out),
+        None => 0,
+    }
+}
+
 /// Get the full composed buffer as UTF-32 codepoints.
 ///
 /// # Arguments